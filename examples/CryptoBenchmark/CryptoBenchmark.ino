@@ -0,0 +1,89 @@
+#include <Arduino.h>
+#include <LoRaCrypto.h>
+
+// Measures the crypto work of one LoRaWAN uplink for each available AES backend:
+// CTR encryption of the FRMPayload plus a CMAC over B0 | header | payload.
+
+// Payload size of a typical sensor frame
+#define PAYLOAD_LEN 24
+// Frame header (MHDR, FHDR, FPort) plus the B0 block in front of it
+#define MIC_INPUT_LEN (16 + 9 + PAYLOAD_LEN)
+#define ITERATIONS 1000
+
+// Read a cycle counter where the platform has one, microseconds otherwise
+static uint32_t readCycles() {
+#if defined(ESP32)
+  return ESP.getCycleCount();
+#else
+  return micros();
+#endif
+}
+
+void benchmark(LoRaCryptoBackend& backend) {
+  if (!backend.isSupported()) {
+    Serial.print(backend.getName());
+    Serial.println(F(": not supported on this CPU"));
+    return;
+  }
+
+  const uint8_t key[16] = {0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6,
+                           0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C};
+  uint8_t counterBlock[16] = {0x01};
+  uint8_t payload[PAYLOAD_LEN] = {0};
+  uint8_t micInput[MIC_INPUT_LEN] = {0};
+  uint8_t mac[16];
+
+  // The schedule is prepared once per session key, not per frame
+  uint32_t start = readCycles();
+  LoRaAesSchedule schedule;
+  LoRaCrypto::prepare(backend, key, schedule);
+  uint32_t prepareCycles = readCycles() - start;
+
+  start = readCycles();
+  for (uint16_t i = 0; i < ITERATIONS; i++) {
+    counterBlock[10] = (uint8_t)i;
+    LoRaCrypto::ctr(backend, schedule, counterBlock, payload, &micInput[16 + 9], PAYLOAD_LEN);
+    LoRaCrypto::cmac(backend, schedule, micInput, MIC_INPUT_LEN, mac);
+  }
+  uint32_t frameCycles = (readCycles() - start) / ITERATIONS;
+
+  Serial.print(backend.getName());
+#if defined(ESP32)
+  Serial.print(F(": key setup "));
+  Serial.print(prepareCycles);
+  Serial.print(F(" cycles, "));
+  Serial.print(frameCycles);
+  Serial.println(F(" cycles per frame"));
+#else
+  Serial.print(F(": key setup "));
+  Serial.print(prepareCycles);
+  Serial.print(F(" us, "));
+  Serial.print(frameCycles);
+  Serial.println(F(" us per frame"));
+#endif
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(3000);
+
+  Serial.println("LoRaManager - Crypto Backend Benchmark");
+  Serial.println("======================================");
+
+  LoRaSoftAesBackend software;
+  benchmark(software);
+
+#if defined(ESP32)
+  LoRaEsp32AesBackend hardware;
+  benchmark(hardware);
+#endif
+
+#if defined(LORA_CRYPTO_HAS_AESNI)
+  LoRaAesNiBackend aesni;
+  benchmark(aesni);
+#endif
+}
+
+void loop() {
+  delay(1000);
+}
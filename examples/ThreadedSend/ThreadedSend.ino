@@ -0,0 +1,110 @@
+#include <Arduino.h>
+#include <LoRaManager.h>
+#include <LoRaRadioTask.h>
+
+// Define LoRa pins for HELTEC ESP32 LoRa
+#define LORA_CS   18
+#define LORA_DIO1 23
+#define LORA_RST  14
+#define LORA_BUSY 33
+
+// Alarm input; a falling edge sends an urgent uplink straight from the interrupt
+#define ALARM_PIN 0
+
+// LoRaWAN credentials - Replace with your own
+uint64_t joinEUI = 0x0000000000000000;
+uint64_t devEUI = 0x0000000000000000;
+uint8_t appKey[16] = {0};
+uint8_t nwkKey[16] = {0};
+
+LoRaManager lora;
+LoRaRadioTask radioTask(lora);
+
+// Sampling runs on the loop task (core 1); the radio task runs on core 0
+const unsigned long sampleInterval = 50;
+const unsigned long sendInterval = 60000;
+unsigned long lastSample = 0;
+unsigned long lastSend = 0;
+unsigned long maxLoopGap = 0;
+uint32_t sampleCount = 0;
+
+// Runs in interrupt context: copy into a preallocated slot and wake the radio task
+void IRAM_ATTR onAlarm() {
+  static const uint8_t alarm[1] = {0xA1};
+  radioTask.enqueueFromIsr(alarm, sizeof(alarm), 2, false);
+}
+
+void setup() {
+  Serial.begin(115200);
+  delay(3000);
+  
+  Serial.println("LoRaManager - Threaded Send Example");
+  Serial.println("==================================");
+  
+  if (!lora.begin(LORA_CS, LORA_DIO1, LORA_RST, LORA_BUSY)) {
+    Serial.println("Failed to initialize LoRa module!");
+    while (1) {
+      delay(1000);
+    }
+  }
+  lora.setCredentials(joinEUI, devEUI, appKey, nwkKey);
+  lora.joinNetwork();
+  
+  // From here on only the radio task touches the LoRaManager
+  if (!radioTask.start(0)) {
+    Serial.println("Failed to start the radio task!");
+  }
+  
+  pinMode(ALARM_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ALARM_PIN), onAlarm, FALLING);
+}
+
+void loop() {
+  unsigned long now = millis();
+  
+  // Sampling keeps its rhythm while an uplink sits in its RX windows
+  if (now - lastSample >= sampleInterval) {
+    unsigned long gap = now - lastSample;
+    if (lastSample != 0 && gap > maxLoopGap) {
+      maxLoopGap = gap;
+    }
+    lastSample = now;
+    sampleCount++;
+  }
+  
+  if (now - lastSend >= sendInterval) {
+    lastSend = now;
+    uint8_t payload[4] = {
+      (uint8_t)(sampleCount >> 24), (uint8_t)(sampleCount >> 16),
+      (uint8_t)(sampleCount >> 8), (uint8_t)sampleCount
+    };
+    if (radioTask.submit(payload, sizeof(payload)) == 0) {
+      Serial.println("Uplink queue full");
+    }
+  }
+  
+  LoRaRadioResult result;
+  while (radioTask.poll(result)) {
+    if (result.type == LORA_RADIO_RESULT_UPLINK) {
+      Serial.print("Uplink ");
+      Serial.print(result.id);
+      if (result.urgent) {
+        Serial.print(" (alarm, started ");
+        Serial.print(result.startUs);
+        Serial.print(" us after the interrupt)");
+      }
+      Serial.print(result.success ? " sent" : " failed");
+      Serial.print(" in ");
+      Serial.print(result.latencyUs / 1000);
+      Serial.print(" ms; longest sampling gap so far ");
+      Serial.print(maxLoopGap);
+      Serial.println(" ms");
+    } else {
+      Serial.print("Downlink on port ");
+      Serial.print(result.port);
+      Serial.print(", ");
+      Serial.print(result.len);
+      Serial.println(" bytes");
+    }
+  }
+}
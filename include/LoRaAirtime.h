@@ -0,0 +1,200 @@
+#ifndef LORA_AIRTIME_H
+#define LORA_AIRTIME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// LoRaWAN bytes around FRMPayload: MHDR, FHDR without FOpts, FPort, MIC
+#define LORA_AIRTIME_LORAWAN_OVERHEAD 13
+
+// Returned by LoRaAirtimeLimiter when a frame can never fit the configured burst
+#define LORA_AIRTIME_NEVER 0xFFFFFFFFUL
+
+// Ports that can have their own airtime budget in addition to the global one
+#define LORA_AIRTIME_MAX_PORT_LIMITS 8
+
+// Port to charge frames without an application FPort (join requests) to; it has no budget of its own
+#define LORA_AIRTIME_GLOBAL_ONLY 0
+
+/**
+ * @brief Uplink schedule that fits the duty-cycle and airtime budgets
+ */
+struct LoRaUplinkPlan {
+    uint8_t datarate;           // data rate the plan was made for
+    uint8_t samplesPerUplink;   // samples to aggregate into one uplink
+    uint16_t payloadLen;        // application payload per uplink
+    uint32_t airtimeMs;         // time on air per uplink
+    uint32_t uplinkIntervalMs;  // time between uplinks
+    uint32_t sampleIntervalMs;  // requested sampling interval, or a longer one if the budget can't keep up
+};
+
+/**
+ * @brief Time-on-air calculations (Semtech AN1200.13)
+ */
+namespace LoRaAirtime {
+
+/**
+ * @brief Time on air of a LoRa packet
+ *
+ * @param phyLen PHY payload length in bytes
+ * @param spreadingFactor 5-12
+ * @param bandwidth Bandwidth in kHz
+ * @param codingRate 5-8 for 4/5-4/8
+ * @param preambleLength Preamble symbols
+ * @param explicitHeader Whether the PHY header is sent
+ * @param crc Whether the payload CRC is sent
+ * @return uint32_t Time on air in microseconds
+ */
+uint32_t loraUs(size_t phyLen, uint8_t spreadingFactor, float bandwidth, uint8_t codingRate = 5,
+                uint16_t preambleLength = 8, bool explicitHeader = true, bool crc = true);
+
+/**
+ * @brief Time on air of an FSK packet with LoRaWAN framing
+ *
+ * Five preamble bytes, three sync word bytes, a length byte and a CRC-16.
+ *
+ * @param phyLen PHY payload length in bytes
+ * @param bitRate Bit rate in kbps
+ * @return uint32_t Time on air in microseconds
+ */
+uint32_t fskUs(size_t phyLen, float bitRate);
+
+/**
+ * @brief Shortest interval at which frames of a given airtime can be sent forever
+ *
+ * @param airtimeMs Time on air per frame
+ * @param dutyCycleFactor 1 / duty cycle (100 for 1%), 0 if there is no duty cycle
+ * @param budgetMs Fair-use airtime per period, 0 if unlimited
+ * @param periodMs Length of the fair-use period
+ * @return uint32_t Interval in milliseconds
+ */
+uint32_t sustainableIntervalMs(uint32_t airtimeMs, uint16_t dutyCycleFactor, uint32_t budgetMs, uint32_t periodMs);
+
+} // namespace LoRaAirtime
+
+/**
+ * @brief Token-bucket limiter for uplink airtime, globally and per FPort
+ *
+ * Budgets are given as airtime milliseconds per period (e.g. the 30 s per
+ * day of a fair-use policy) and refill continuously; the burst size caps how
+ * much unused budget can accumulate. A frame is allowed only if both the
+ * global bucket and the bucket of its port (if any) hold its airtime, and it
+ * is then charged to both. A frame that turns out longer than charged leaves
+ * the bucket in debt, which the refill pays off before the next frame is
+ * allowed. Queries leave the buckets untouched, so they can run on any
+ * thread; only charges change them. Times are millis() values passed in
+ * by the caller.
+ */
+class LoRaAirtimeLimiter {
+public:
+    LoRaAirtimeLimiter();
+
+    /**
+     * @brief Limit the airtime of all ports together
+     *
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @param burstMs Largest amount of airtime that can be used at once, 0 for budgetMs
+     * @param now Current time in milliseconds
+     */
+    void setGlobalLimit(uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now);
+
+    /**
+     * @brief Limit the airtime of one port
+     *
+     * @param port FPort
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @param burstMs Largest amount of airtime that can be used at once, 0 for budgetMs
+     * @param now Current time in milliseconds
+     * @return false for LORA_AIRTIME_GLOBAL_ONLY or if LORA_AIRTIME_MAX_PORT_LIMITS ports are already limited
+     */
+    bool setPortLimit(uint8_t port, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now);
+
+    /**
+     * @brief Get how long to wait before a frame may be sent
+     *
+     * @param port FPort
+     * @param airtimeMs Airtime of the frame
+     * @param now Current time in milliseconds
+     * @return uint32_t Milliseconds to wait, 0 if allowed now, LORA_AIRTIME_NEVER if it exceeds a burst size
+     */
+    uint32_t getWait(uint8_t port, uint32_t airtimeMs, uint32_t now) const;
+
+    /**
+     * @brief Charge a frame if the budgets allow it
+     *
+     * @param port FPort
+     * @param airtimeMs Airtime of the frame
+     * @param now Current time in milliseconds
+     * @return true if allowed and charged
+     */
+    bool tryConsume(uint8_t port, uint32_t airtimeMs, uint32_t now);
+
+    /**
+     * @brief Charge a frame whatever the budgets, e.g. one already sent
+     *
+     * @param port FPort
+     * @param airtimeMs Airtime of the frame
+     * @param now Current time in milliseconds
+     */
+    void consume(uint8_t port, uint32_t airtimeMs, uint32_t now);
+
+    /**
+     * @brief Correct an earlier charge once the real airtime is known
+     *
+     * @param port FPort
+     * @param deltaMs Real minus charged airtime; negative values refund
+     */
+    void adjust(uint8_t port, int32_t deltaMs);
+
+    /**
+     * @brief Get the airtime left in the global bucket
+     *
+     * @param now Current time in milliseconds
+     * @return uint32_t Milliseconds, LORA_AIRTIME_NEVER if there is no global limit
+     */
+    uint32_t getGlobalAvailable(uint32_t now) const;
+
+    /**
+     * @brief Get the configured global budget
+     *
+     * @param budgetMs Output airtime per period
+     * @param periodMs Output period
+     * @return true if a global limit is set
+     */
+    bool getGlobalLimit(uint32_t& budgetMs, uint32_t& periodMs) const;
+
+    /**
+     * @brief Get the configured budget of a port
+     *
+     * @param port FPort
+     * @param budgetMs Output airtime per period
+     * @param periodMs Output period
+     * @return true if the port has its own limit
+     */
+    bool getPortLimit(uint8_t port, uint32_t& budgetMs, uint32_t& periodMs) const;
+
+private:
+    struct Bucket {
+        uint64_t remainder;     // refill not yet credited, in µs * periodMs
+        int64_t tokensUs;       // negative while in debt
+        uint32_t capacityUs;
+        uint32_t budgetMs;
+        uint32_t periodMs;
+        uint32_t lastRefill;
+        uint8_t port;
+        bool enabled;
+    };
+
+    Bucket global;
+    Bucket ports[LORA_AIRTIME_MAX_PORT_LIMITS];
+
+    static void configure(Bucket& bucket, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now);
+    static void refill(Bucket& bucket, uint32_t now);
+    static uint32_t waitFor(const Bucket& bucket, uint32_t airtimeUs, uint32_t now);
+    Bucket* findPort(uint8_t port);
+    const Bucket* findPort(uint8_t port) const;
+};
+
+#endif // LORA_AIRTIME_H
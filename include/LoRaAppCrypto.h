@@ -0,0 +1,141 @@
+#ifndef LORA_APP_CRYPTO_H
+#define LORA_APP_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaKeyProvider.h"
+
+// Length of the truncated CCM authentication tag appended to each payload
+#define LORA_APP_CRYPTO_TAG_LEN 4
+
+// CCM nonce length; with 2 length bytes this leaves room for payloads up to 64 KiB
+#define LORA_APP_CRYPTO_NONCE_LEN 13
+
+// Frame directions, as in the LoRaWAN B0/A_i blocks
+#define LORA_APP_CRYPTO_UPLINK   0
+#define LORA_APP_CRYPTO_DOWNLINK 1
+
+// Key type byte of the session key derivation block (LoRaWAN uses 0x01-0x06)
+#define LORA_APP_CRYPTO_KEY_TYPE 0x10
+
+/**
+ * @brief Application-layer AES-CCM, end to end between device and application server
+ *
+ * Payloads are encrypted and authenticated with a session key derived from a
+ * root key the network server does not know (LORA_KEY_HANDLE_E2E_KEY), the
+ * same way LoRaWAN derives its session keys:
+ *
+ * Session key = AES-128(E2E key, [ 0x10 | JoinNonce (3) | JoinEUI (8) | DevNonce (2) | 0x00 0x00 ])
+ *
+ * with the fields LSB first. Every join changes JoinNonce and DevNonce, so the
+ * frame counters restarting at 0 never repeat a key and nonce pair. The 13-byte
+ * nonce is built from the direction, the DevEUI and the LoRaWAN frame counter
+ * of the frame carrying the payload, so nothing but the 4-byte tag is added
+ * over the air. The FPort is authenticated as associated data.
+ */
+namespace LoRaAppCrypto {
+
+/**
+ * @brief Build the CCM nonce for a frame
+ *
+ * @param dir LORA_APP_CRYPTO_UPLINK or LORA_APP_CRYPTO_DOWNLINK
+ * @param devEUI Device EUI
+ * @param fCnt Frame counter of the LoRaWAN frame carrying the payload
+ * @param nonce Output, LORA_APP_CRYPTO_NONCE_LEN bytes
+ */
+void buildNonce(uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t* nonce);
+
+/**
+ * @brief Build the block the session key of a join is derived with
+ *
+ * @param joinNonce JoinNonce of the Join-Accept (24 bits)
+ * @param joinEUI JoinEUI
+ * @param devNonce DevNonce of the Join-Request
+ * @param block Output, 16 bytes
+ */
+void buildSessionBlock(uint32_t joinNonce, uint64_t joinEUI, uint16_t devNonce, uint8_t* block);
+
+/**
+ * @brief Get the session key of a join, derived in the provider's key cache
+ *
+ * @param keys Key provider holding LORA_KEY_HANDLE_E2E_KEY
+ * @param joinNonce JoinNonce of the Join-Accept (24 bits)
+ * @param joinEUI JoinEUI
+ * @param devNonce DevNonce of the Join-Request
+ * @return LoRaKeyHandle Handle for seal() and open(), or LORA_KEY_HANDLE_INVALID
+ */
+LoRaKeyHandle sessionKey(LoRaKeyProvider& keys, uint32_t joinNonce, uint64_t joinEUI, uint16_t devNonce);
+
+/**
+ * @brief Generic AES-CCM encryption (RFC 3610) with L = 2
+ *
+ * @param keys Key provider
+ * @param key Key handle
+ * @param nonce LORA_APP_CRYPTO_NONCE_LEN bytes
+ * @param aad Associated data (at most 14 bytes)
+ * @param aadLen Length of aad
+ * @param in Plaintext
+ * @param len Length of plaintext
+ * @param out Ciphertext followed by the tag (len + tagLen bytes, may alias in)
+ * @param tagLen Tag length (4, 6, 8, 10, 12, 14 or 16)
+ * @return true if successful
+ */
+bool ccmEncrypt(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len,
+                uint8_t* out, uint8_t tagLen);
+
+/**
+ * @brief Generic AES-CCM decryption and tag verification (RFC 3610) with L = 2
+ *
+ * @param keys Key provider
+ * @param key Key handle
+ * @param nonce LORA_APP_CRYPTO_NONCE_LEN bytes
+ * @param aad Associated data (at most 14 bytes)
+ * @param aadLen Length of aad
+ * @param in Ciphertext followed by the tag
+ * @param len Length of ciphertext plus tag
+ * @param out Plaintext output (len - tagLen bytes, may alias in)
+ * @param tagLen Tag length
+ * @return true if the tag is valid; out is wiped otherwise
+ */
+bool ccmDecrypt(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len,
+                uint8_t* out, uint8_t tagLen);
+
+/**
+ * @brief Encrypt an application payload for the given frame
+ *
+ * @param keys Key provider
+ * @param key Session key from sessionKey()
+ * @param dir Frame direction
+ * @param devEUI Device EUI
+ * @param fCnt Frame counter of the carrying frame
+ * @param port FPort of the carrying frame
+ * @param in Plaintext payload
+ * @param len Length of payload
+ * @param out Output, len + LORA_APP_CRYPTO_TAG_LEN bytes
+ * @return true if successful
+ */
+bool seal(LoRaKeyProvider& keys, LoRaKeyHandle key, uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t port,
+          const uint8_t* in, size_t len, uint8_t* out);
+
+/**
+ * @brief Verify and decrypt an application payload from the given frame
+ *
+ * @param keys Key provider
+ * @param key Session key from sessionKey()
+ * @param dir Frame direction
+ * @param devEUI Device EUI
+ * @param fCnt Frame counter of the carrying frame
+ * @param port FPort of the carrying frame
+ * @param in Ciphertext followed by the tag
+ * @param len Length of ciphertext plus tag
+ * @param out Output, len - LORA_APP_CRYPTO_TAG_LEN bytes
+ * @return true if the payload is authentic
+ */
+bool open(LoRaKeyProvider& keys, LoRaKeyHandle key, uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t port,
+          const uint8_t* in, size_t len, uint8_t* out);
+
+} // namespace LoRaAppCrypto
+
+#endif // LORA_APP_CRYPTO_H
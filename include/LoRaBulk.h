@@ -0,0 +1,213 @@
+#ifndef LORA_BULK_H
+#define LORA_BULK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaPhy.h"
+
+// Payload bytes per data frame and frames sent per acknowledgement
+#define LORA_BULK_CHUNK_SIZE 240
+#define LORA_BULK_MAX_WINDOW 32
+#define LORA_BULK_WINDOW     16
+
+// Largest frame on air: type, session, sequence number and one chunk
+#define LORA_BULK_HEADER_LEN 4
+#define LORA_BULK_MAX_FRAME  (LORA_BULK_HEADER_LEN + LORA_BULK_CHUNK_SIZE)
+
+/**
+ * @brief Read the next part of the data to send
+ *
+ * @param offset Byte offset into the transfer
+ * @param buffer Output buffer
+ * @param len Number of bytes requested
+ * @param context Pointer passed to LoRaBulkSender::begin()
+ * @return size_t Number of bytes read; anything less than len aborts the transfer
+ */
+typedef size_t (*LoRaBulkReadCallback)(uint32_t offset, uint8_t* buffer, size_t len, void* context);
+
+/**
+ * @brief Store a received part of the data
+ *
+ * Chunks arrive in any order but each offset is written exactly once.
+ *
+ * @param offset Byte offset into the transfer
+ * @param data Received bytes
+ * @param len Number of bytes
+ * @param context Pointer passed to the LoRaBulkReceiver constructor
+ * @return false to abort the transfer
+ */
+typedef bool (*LoRaBulkWriteCallback)(uint32_t offset, const uint8_t* data, size_t len, void* context);
+
+/**
+ * @brief Sending side of the bulk transfer protocol
+ *
+ * Selective repeat: the sender transmits a window of chunks back to back,
+ * flagging the last one as an acknowledgement request. The receiver answers
+ * with the first missing chunk and a bitmap of the chunks it holds after it,
+ * so only lost chunks are repeated and the window slides as soon as the
+ * oldest chunk is in.
+ *
+ * Frames on air (multi-byte fields big-endian):
+ *   START [ 0x1F | session | total length (4) | chunk size | window ]
+ *   DATA  [ 0x2x | session | sequence (2) | chunk ]
+ *   ACK   [ 0x30 | session | first missing (2) | received bitmap (4) ]
+ * The low nibble of the first byte is 1 when an ACK is requested.
+ *
+ * The class only builds and parses frames; LoRaManager::sendBulk() drives
+ * the radio.
+ */
+class LoRaBulkSender {
+public:
+    LoRaBulkSender();
+
+    /**
+     * @brief Start a new transfer
+     *
+     * @param sessionId Identifier carried in every frame
+     * @param totalLen Number of bytes to send
+     * @param chunkSize Bytes per data frame, at most LORA_BULK_CHUNK_SIZE
+     * @param window Frames per acknowledgement, at most LORA_BULK_MAX_WINDOW
+     * @param read Callback supplying the data
+     * @param context Pointer passed to the callback
+     * @return true if the parameters are valid
+     */
+    bool begin(uint8_t sessionId, uint32_t totalLen, uint8_t chunkSize, uint8_t window,
+               LoRaBulkReadCallback read, void* context);
+
+    /**
+     * @brief Build the next frame of the current burst
+     *
+     * @param out Output buffer of at least LORA_BULK_MAX_FRAME bytes
+     * @return size_t Frame length, 0 when the burst is done and an ACK is due
+     */
+    size_t nextFrame(uint8_t* out);
+
+    /**
+     * @brief Process a frame received from the peer
+     *
+     * @param frame Received frame
+     * @param len Length of frame
+     * @return true if it was an ACK for this transfer
+     */
+    bool onFrame(const uint8_t* frame, size_t len);
+
+    /**
+     * @brief No ACK arrived; repeat the unacknowledged frames of the window
+     */
+    void onTimeout();
+
+    /**
+     * @brief Check if the peer has acknowledged everything
+     */
+    bool isComplete() const;
+
+    /**
+     * @brief Check if the read callback failed
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief Get the number of data frames transmitted, including repeats
+     */
+    uint32_t getFramesSent() const;
+
+private:
+    LoRaBulkReadCallback read;
+    void* context;
+    uint32_t totalLen;
+    uint16_t chunkCount;
+    uint16_t base;        // first chunk not acknowledged
+    uint16_t cursor;      // next chunk to consider in this burst
+    uint32_t acked;       // bit i: chunk base + i acknowledged
+    uint32_t framesSent;
+    uint8_t sessionId;
+    uint8_t chunkSize;
+    uint8_t window;
+    bool started;
+    bool failed;
+
+    uint16_t windowEnd() const;
+};
+
+/**
+ * @brief Receiving side of the bulk transfer protocol
+ */
+class LoRaBulkReceiver {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param write Callback storing the data
+     * @param context Pointer passed to the callback
+     */
+    LoRaBulkReceiver(LoRaBulkWriteCallback write, void* context = nullptr);
+
+    /**
+     * @brief Process a frame received from the sender
+     *
+     * @param frame Received frame
+     * @param len Length of frame
+     * @return true if the sender requested an ACK
+     */
+    bool onFrame(const uint8_t* frame, size_t len);
+
+    /**
+     * @brief Build an ACK describing the chunks received so far
+     *
+     * @param out Output buffer of at least 8 bytes
+     * @return size_t Frame length
+     */
+    size_t buildAck(uint8_t* out) const;
+
+    /**
+     * @brief Check if all data has been received
+     */
+    bool isComplete() const;
+
+    /**
+     * @brief Check if the write callback aborted the transfer
+     */
+    bool hasFailed() const;
+
+    /**
+     * @brief Get the total length announced by the sender (0 before START)
+     */
+    uint32_t getTotalLength() const;
+
+private:
+    LoRaBulkWriteCallback write;
+    void* context;
+    uint32_t totalLen;
+    uint16_t chunkCount;
+    uint16_t base;        // first chunk not received
+    uint32_t received;    // bit i: chunk base + i received
+    uint8_t sessionId;
+    uint8_t chunkSize;
+    bool started;
+    bool failed;
+};
+
+/**
+ * @brief Radio settings suited to bulk transfers
+ */
+namespace LoRaBulk {
+
+/**
+ * @brief 50 kbps GFSK, the fastest option for short links
+ *
+ * @param frequency Channel in MHz
+ * @param power Output power in dBm
+ */
+LoRaPhyConfig fskConfig(float frequency, int8_t power);
+
+/**
+ * @brief LoRa SF7 / 500 kHz (about 21 kbps raw), more robust than FSK
+ *
+ * @param frequency Channel in MHz
+ * @param power Output power in dBm
+ */
+LoRaPhyConfig loraConfig(float frequency, int8_t power);
+
+} // namespace LoRaBulk
+
+#endif // LORA_BULK_H
@@ -0,0 +1,271 @@
+#ifndef LORA_CONFIG_H
+#define LORA_CONFIG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+// FPort carrying configuration patches and the reports answering them
+#ifndef LORA_CONFIG_FPORT
+#define LORA_CONFIG_FPORT 222
+#endif
+
+// Entries the store can hold
+#define LORA_CONFIG_MAX_ENTRIES 16
+
+// Entry types and their sizes on air and in storage (1, 1, 1, 2, 2, 4 bytes, MSB first)
+#define LORA_CONFIG_BOOL 0
+#define LORA_CONFIG_U8   1
+#define LORA_CONFIG_I8   2
+#define LORA_CONFIG_U16  3
+#define LORA_CONFIG_I16  4
+#define LORA_CONFIG_I32  5
+
+// Report statuses
+#define LORA_CONFIG_APPLIED 0   // patch applied and persisted
+#define LORA_CONFIG_CURRENT 1   // answer to a query, nothing changed
+#define LORA_CONFIG_STALE   2   // patch made for another version, not applied
+#define LORA_CONFIG_INVALID 3   // unknown key, value out of range or truncated, not applied
+#define LORA_CONFIG_BUSY    4   // another patch is waiting to be applied, not applied
+#define LORA_CONFIG_UNSAVED 5   // patch applied, but storage failed
+
+// Bytes of a report: status, version, hash
+#define LORA_CONFIG_REPORT_LEN 5
+
+/**
+ * @brief Called once per changed entry after a patch is applied
+ *
+ * @param key Entry key
+ * @param value New value
+ */
+typedef void (*LoRaConfigCallback)(uint8_t key, int32_t value);
+
+/**
+ * @brief Configuration store statistics
+ */
+struct LoRaConfigStats {
+    uint32_t patches;       // patches received
+    uint32_t queries;       // version queries received
+    uint32_t applied;       // patches applied
+    uint32_t stale;         // patches refused for their base version
+    uint32_t rejected;      // patches refused as invalid or while busy
+    uint32_t persisted;     // journal records written
+    uint32_t compactions;   // journal rewrites into the other bank
+    uint32_t storageErrors; // failed storage writes
+};
+
+/**
+ * @brief Byte-addressed non-volatile storage for the configuration journal
+ *
+ * EEPROM, a flash page or an NVS blob. Unwritten bytes should read 0xFF or
+ * 0x00. Implement this for the storage at hand; LoRaRamConfigStorage keeps
+ * the journal in RAM.
+ */
+class LoRaConfigStorage {
+public:
+    virtual ~LoRaConfigStorage() {}
+
+    /**
+     * @brief Get the size of the storage in bytes
+     */
+    virtual size_t size() const = 0;
+
+    /**
+     * @brief Read bytes
+     *
+     * @param offset Start
+     * @param data Output buffer
+     * @param len Number of bytes
+     * @return true if read
+     */
+    virtual bool read(size_t offset, uint8_t* data, size_t len) = 0;
+
+    /**
+     * @brief Write bytes
+     *
+     * @param offset Start
+     * @param data Bytes to write
+     * @param len Number of bytes
+     * @return true if written
+     */
+    virtual bool write(size_t offset, const uint8_t* data, size_t len) = 0;
+};
+
+/**
+ * @brief LoRaConfigStorage in RAM
+ *
+ * @tparam N Size in bytes
+ */
+template <size_t N>
+class LoRaRamConfigStorage : public LoRaConfigStorage {
+public:
+    LoRaRamConfigStorage() {
+        memset(bytes, 0xFF, sizeof(bytes));
+    }
+
+    size_t size() const override {
+        return N;
+    }
+
+    bool read(size_t offset, uint8_t* data, size_t len) override {
+        if (offset > N || len > N - offset) {
+            return false;
+        }
+        memcpy(data, &bytes[offset], len);
+        return true;
+    }
+
+    bool write(size_t offset, const uint8_t* data, size_t len) override {
+        if (offset > N || len > N - offset) {
+            return false;
+        }
+        memcpy(&bytes[offset], data, len);
+        return true;
+    }
+
+private:
+    uint8_t bytes[N];
+};
+
+/**
+ * @brief Typed, versioned configuration patched by downlinks
+ *
+ * The application defines integer entries (key, type, default, range); the
+ * server changes them with patches on LORA_CONFIG_FPORT:
+ *
+ * Patch:  [ base version (2) | key | value | key | value ... ]
+ * Report: [ status | version (2) | hash (2) ]
+ *
+ * A patch is checked as a whole when it arrives (base version equal to the
+ * current one, known keys, values in range) and staged; applyPatch() then
+ * writes every value at once and bumps the version, so readers never see
+ * half a patch. A patch with no entries is a query. The hash is the
+ * CRC-16/CCITT-FALSE of [key | value] over all entries in key order, so the
+ * server can check the contents as well as the version.
+ *
+ * Storage holds a journal in two halves (banks): each patch appends one
+ * record of the entries it touched, [length | version (2) | key | type |
+ * value ... | CRC-16], and when a bank is full the whole configuration is
+ * written as the first record of the other one. A torn write fails its CRC
+ * and loading stops at the last good record. Radio access is done by
+ * LoRaManager, this class only keeps the books.
+ */
+class LoRaConfig {
+public:
+    LoRaConfig();
+
+    /**
+     * @brief Define an entry; call before load()
+     *
+     * @param key Entry key
+     * @param type LORA_CONFIG_* type
+     * @param defaultValue Value until a patch changes it
+     * @param minValue Smallest value a patch may set, clamped to the type
+     * @param maxValue Largest value a patch may set, clamped to the type
+     * @return false if the key exists, the store is full or the default is out of range
+     */
+    bool define(uint8_t key, uint8_t type, int32_t defaultValue, int32_t minValue, int32_t maxValue);
+
+    /**
+     * @brief Get the value of an entry
+     *
+     * @param key Entry key
+     * @return int32_t Value, 0 if the key is not defined
+     */
+    int32_t get(uint8_t key) const;
+
+    /**
+     * @brief Restore the configuration from storage and journal to it from now on
+     *
+     * @param storage Storage, or nullptr to keep the configuration in RAM only
+     * @return true if a stored configuration was restored
+     */
+    bool load(LoRaConfigStorage* storage);
+
+    /**
+     * @brief Check and stage a patch received on LORA_CONFIG_FPORT
+     *
+     * @param payload Downlink FRMPayload
+     * @param len Length of payload
+     * @return uint8_t LORA_CONFIG_APPLIED if staged, otherwise the status reported
+     */
+    uint8_t acceptPatch(const uint8_t* payload, size_t len);
+
+    /**
+     * @brief Check if a patch is waiting for applyPatch()
+     */
+    bool hasPendingPatch() const;
+
+    /**
+     * @brief Apply the staged patch, persist it and queue its report
+     *
+     * @param callback Called for each changed entry afterwards, or nullptr
+     * @return true if a patch was applied
+     */
+    bool applyPatch(LoRaConfigCallback callback);
+
+    /**
+     * @brief Check if a report is waiting to be sent
+     */
+    bool hasReport() const;
+
+    /**
+     * @brief Write the waiting report
+     *
+     * @param out Output buffer of LORA_CONFIG_REPORT_LEN bytes
+     * @return size_t LORA_CONFIG_REPORT_LEN, 0 if there is none
+     */
+    size_t buildReport(uint8_t* out) const;
+
+    /**
+     * @brief Report the outcome of the uplink carrying the report
+     *
+     * @param sent Whether it went out; if not, it is sent again later
+     */
+    void confirmReport(bool sent);
+
+    /**
+     * @brief Get the configuration version, 0 for the defaults
+     */
+    uint16_t getVersion() const;
+
+    /**
+     * @brief Get the hash of the configuration
+     */
+    uint16_t getHash() const;
+
+    /**
+     * @brief Get the configuration store statistics
+     */
+    const LoRaConfigStats& getStats() const;
+
+private:
+    struct Entry {
+        int32_t value;
+        int32_t minValue;
+        int32_t maxValue;
+        uint8_t key;
+        uint8_t type;
+    };
+
+    Entry entries[LORA_CONFIG_MAX_ENTRIES];
+    int32_t pendingValues[LORA_CONFIG_MAX_ENTRIES];
+    LoRaConfigStats stats;
+    LoRaConfigStorage* storage;
+    size_t writeOffset;     // end of the journal in the active bank
+    uint32_t pendingMask;   // entries of the staged patch
+    uint16_t version;
+    uint8_t entryCount;
+    uint8_t bank;           // active journal bank
+    uint8_t reportStatus;
+    bool reportPending;
+
+    int findEntry(uint8_t key) const;
+    void queueReport(uint8_t status);
+    size_t buildRecord(uint8_t* out, uint32_t mask) const;
+    bool writeRecord(uint8_t toBank, size_t offset, const uint8_t* record, size_t len);
+    bool persist(uint32_t mask);
+    bool scanBank(uint8_t fromBank, bool apply, size_t& end, uint16_t& lastVersion);
+};
+
+#endif // LORA_CONFIG_H
@@ -0,0 +1,170 @@
+#ifndef LORA_CRYPTO_H
+#define LORA_CRYPTO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief An AES-128 key prepared for a particular backend
+ *
+ * Holds the expanded round keys (or the raw key for hardware engines that
+ * expand internally) and the CMAC subkeys, so none of this is recomputed
+ * per frame. Prepare once per key with LoRaCrypto::prepare().
+ */
+struct alignas(16) LoRaAesSchedule {
+    uint8_t roundKeys[176];
+    uint8_t cmacK1[16];
+    uint8_t cmacK2[16];
+};
+
+/**
+ * @brief AES-128 engine used for the library's own crypto
+ *
+ * Backends only implement key expansion and single-block encryption; CTR and
+ * CMAC are built on top in LoRaCrypto. A backend may override encryptBlocks()
+ * to pipeline several independent blocks.
+ */
+class LoRaCryptoBackend {
+public:
+    virtual ~LoRaCryptoBackend() {}
+
+    /**
+     * @brief Get a short name for logs and benchmarks
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * @brief Check if the backend can run on this CPU
+     */
+    virtual bool isSupported() const { return true; }
+
+    /**
+     * @brief Expand a key into the backend's round key format
+     *
+     * @param key 16-byte key
+     * @param schedule Output schedule (only roundKeys is written)
+     */
+    virtual void expandKey(const uint8_t* key, LoRaAesSchedule& schedule) = 0;
+
+    /**
+     * @brief Encrypt one 16-byte block
+     *
+     * @param schedule Schedule from expandKey()
+     * @param in Input block
+     * @param out Output block (may be the same as in)
+     */
+    virtual void encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) = 0;
+
+    /**
+     * @brief Encrypt several independent 16-byte blocks
+     *
+     * @param schedule Schedule from expandKey()
+     * @param in Input blocks
+     * @param out Output blocks (may be the same as in)
+     * @param blocks Number of blocks
+     */
+    virtual void encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks);
+};
+
+/**
+ * @brief Portable table-based AES-128 (one 1 KiB T-table plus the S-box)
+ */
+class LoRaSoftAesBackend : public LoRaCryptoBackend {
+public:
+    const char* getName() const override { return "software"; }
+    void expandKey(const uint8_t* key, LoRaAesSchedule& schedule) override;
+    void encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) override;
+};
+
+#if defined(ESP32)
+/**
+ * @brief ESP32 AES peripheral, through the ESP-IDF esp_aes driver
+ *
+ * The peripheral expands keys itself, so the schedule holds the raw key.
+ */
+class LoRaEsp32AesBackend : public LoRaCryptoBackend {
+public:
+    const char* getName() const override { return "esp32-hw"; }
+    void expandKey(const uint8_t* key, LoRaAesSchedule& schedule) override;
+    void encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) override;
+    void encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks) override;
+};
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define LORA_CRYPTO_HAS_AESNI 1
+/**
+ * @brief x86 AES-NI backend for host builds and simulation
+ *
+ * Compiled with function-level target attributes, so no -maes flag is
+ * needed; isSupported() checks the CPU at runtime.
+ */
+class LoRaAesNiBackend : public LoRaCryptoBackend {
+public:
+    const char* getName() const override { return "aes-ni"; }
+    bool isSupported() const override;
+    void expandKey(const uint8_t* key, LoRaAesSchedule& schedule) override;
+    void encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) override;
+    void encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks) override;
+};
+#endif
+
+/**
+ * @brief Backend selection and the modes built on the block cipher
+ */
+namespace LoRaCrypto {
+
+/**
+ * @brief Get the software backend (always available)
+ */
+LoRaCryptoBackend& softwareBackend();
+
+/**
+ * @brief Get the fastest backend supported on this platform
+ *
+ * ESP32 hardware on ESP32 targets, AES-NI on x86 hosts that support it,
+ * the software backend otherwise.
+ */
+LoRaCryptoBackend& defaultBackend();
+
+/**
+ * @brief Expand a key and derive its CMAC subkeys
+ *
+ * @param backend Backend that will use the schedule
+ * @param key 16-byte key
+ * @param schedule Output schedule
+ */
+void prepare(LoRaCryptoBackend& backend, const uint8_t* key, LoRaAesSchedule& schedule);
+
+/**
+ * @brief AES-128 CMAC (RFC 4493)
+ *
+ * @param backend Backend the schedule was prepared for
+ * @param schedule Prepared schedule
+ * @param data Data to authenticate
+ * @param len Length of data
+ * @param mac Output, 16 bytes
+ */
+void cmac(LoRaCryptoBackend& backend, const LoRaAesSchedule& schedule, const uint8_t* data, size_t len, uint8_t* mac);
+
+/**
+ * @brief AES-128 counter mode
+ *
+ * The last two bytes of the counter block (big-endian) are incremented per
+ * block, matching the A_i blocks of LoRaWAN FRMPayload encryption and of
+ * CCM. The keystream for up to four blocks is generated in one
+ * encryptBlocks() call.
+ *
+ * @param backend Backend the schedule was prepared for
+ * @param schedule Prepared schedule
+ * @param counterBlock Initial counter block (16 bytes)
+ * @param in Input data
+ * @param out Output data (may be the same as in)
+ * @param len Length of data
+ */
+void ctr(LoRaCryptoBackend& backend, const LoRaAesSchedule& schedule, const uint8_t* counterBlock,
+         const uint8_t* in, uint8_t* out, size_t len);
+
+} // namespace LoRaCrypto
+
+#endif // LORA_CRYPTO_H
@@ -0,0 +1,207 @@
+#ifndef LORA_DIAGNOSTICS_H
+#define LORA_DIAGNOSTICS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FPort carrying dump requests and the snapshot chunks answering them
+#ifndef LORA_DIAG_FPORT
+#define LORA_DIAG_FPORT 221
+#endif
+
+// Quiet time after any uplink before a chunk may go out
+#ifndef LORA_DIAG_GAP_MS
+#define LORA_DIAG_GAP_MS 15000UL
+#endif
+
+// Error codes remembered, newest first in the snapshot
+#define LORA_DIAG_ERRORS 4
+
+// Snapshot layout version and size
+#define LORA_DIAG_FORMAT 1
+#define LORA_DIAG_SNAPSHOT_LEN 51
+
+// Bytes in front of each chunk: dump ID, offset, snapshot length
+#define LORA_DIAG_HEADER_LEN 3
+
+// Snapshot bytes a chunk carries at least, whatever the data rate
+#define LORA_DIAG_MIN_CHUNK 8
+
+// Failed chunk uplinks in a row before a dump is given up
+#define LORA_DIAG_MAX_FAILURES 3
+
+// LoRaDiagState::flags
+#define LORA_DIAG_FLAG_JOINED      0x01
+#define LORA_DIAG_FLAG_RELAY       0x02
+#define LORA_DIAG_FLAG_RPC         0x04
+#define LORA_DIAG_FLAG_CONFIG      0x08
+#define LORA_DIAG_FLAG_POWER       0x10
+#define LORA_DIAG_FLAG_DR_SELECT   0x20
+#define LORA_DIAG_FLAG_APP_CRYPTO  0x40
+#define LORA_DIAG_FLAG_VIRTUAL     0x80
+
+/**
+ * @brief State LoRaManager hands over for a snapshot
+ */
+struct LoRaDiagState {
+    uint32_t airtimeMs;          // time on air, all transceivers
+    uint32_t airtimeAvailableMs; // global airtime budget left, 0xFFFFFFFF without a limit
+    float rssi;
+    float snr;
+    int lastError;
+    uint16_t configVersion;
+    uint8_t flags;               // LORA_DIAG_FLAG_*
+    uint8_t datarate;
+    int8_t txPowerDbm;
+    uint8_t consecutiveErrors;
+    uint8_t queued;              // uplinks waiting: application (setQueuedUplinks()), RPC responses, config report
+    uint8_t relayQueued;         // child frames waiting to be forwarded
+    uint8_t radios;
+    uint8_t healthyRadios;
+};
+
+/**
+ * @brief Diagnostics statistics
+ */
+struct LoRaDiagStats {
+    uint32_t requests;      // dumps requested
+    uint32_t duplicates;    // repeated requests for the dump in progress
+    uint32_t completed;     // dumps fully sent
+    uint32_t abandoned;     // dumps given up after LORA_DIAG_MAX_FAILURES
+    uint32_t chunks;        // chunks sent
+};
+
+/**
+ * @brief Diagnostics counters and snapshot dumps over one FPort
+ *
+ * Counts uplinks, retries and joins and remembers the last error codes as
+ * they happen. A downlink on LORA_DIAG_FPORT ([ dump ID ]) asks for a dump:
+ * the state is serialized once into a fixed LORA_DIAG_SNAPSHOT_LEN byte
+ * snapshot, with no allocation and no loops beyond the error ring, and
+ * uplinked on the same port in chunks sized to the data rate of each one:
+ *
+ * Chunk: [ dump ID | offset | snapshot length | snapshot bytes ]
+ *
+ * Snapshot (format 1, MSB first): format, flags, uptime s (4), last error
+ * (2), error ring (4 x 2), uplinks (2), failed uplinks (2), retries (2),
+ * joins (2), failed joins (2), consecutive errors, RSSI dBm (2), SNR in
+ * 0.25 dB, data rate, TX power dBm, queued uplinks, queued relay frames,
+ * airtime used ms (4), airtime left ms (4), lowest free heap (4), stack
+ * headroom (2), radios (healthy << 4 | total), config version (2).
+ * Counters wrap at 16 bits; memory watermarks read 0 where unknown.
+ *
+ * A request repeating the ID of the dump in progress is ignored, so the
+ * network retransmitting it does not restart the dump. Radio access is done
+ * by LoRaManager, this class only keeps the books. Times are millis() values.
+ */
+class LoRaDiagnostics {
+public:
+    LoRaDiagnostics();
+
+    /**
+     * @brief Record the outcome of an uplink
+     *
+     * @param attempts Transmissions it took
+     * @param sent Whether it went out
+     * @param now Current time
+     */
+    void recordUplink(uint8_t attempts, bool sent, uint32_t now);
+
+    /**
+     * @brief Record the outcome of a join
+     *
+     * @param attempts Join requests it took
+     * @param joined Whether it succeeded
+     */
+    void recordJoin(uint8_t attempts, bool joined);
+
+    /**
+     * @brief Remember an error code
+     *
+     * @param code RadioLib or LORAMANAGER_ERR_* code
+     */
+    void recordError(int code);
+
+    /**
+     * @brief Take a dump request received on LORA_DIAG_FPORT
+     *
+     * @param payload Downlink FRMPayload; the first byte is the dump ID
+     * @param len Length of payload
+     * @return true if a new dump was requested
+     */
+    bool acceptRequest(const uint8_t* payload, size_t len);
+
+    /**
+     * @brief Check if a requested snapshot has not been taken yet
+     */
+    bool isRequested() const;
+
+    /**
+     * @brief Take the snapshot of a requested dump
+     *
+     * @param state State from LoRaManager
+     * @param now Current time
+     */
+    void capture(const LoRaDiagState& state, uint32_t now);
+
+    /**
+     * @brief Check if snapshot bytes are waiting to be sent
+     */
+    bool hasChunk() const;
+
+    /**
+     * @brief Get the time of the last uplink recorded
+     */
+    uint32_t getLastUplink() const;
+
+    /**
+     * @brief Write the next chunk; held until confirmChunk()
+     *
+     * @param out Output buffer
+     * @param maxLen Largest uplink payload, at least LORA_DIAG_HEADER_LEN + LORA_DIAG_MIN_CHUNK
+     * @return size_t Length of the chunk, 0 if there is none
+     */
+    size_t buildChunk(uint8_t* out, size_t maxLen);
+
+    /**
+     * @brief Report the outcome of the uplink from buildChunk()
+     *
+     * @param sent Whether it went out
+     */
+    void confirmChunk(bool sent);
+
+    /**
+     * @brief Get the diagnostics statistics
+     */
+    const LoRaDiagStats& getStats() const;
+
+    /**
+     * @brief Lowest free heap since boot in bytes, 0 if unknown
+     */
+    static uint32_t minFreeHeap();
+
+    /**
+     * @brief Smallest stack headroom the calling task has had, in bytes, 0 if unknown
+     */
+    static uint32_t stackHeadroom();
+
+private:
+    LoRaDiagStats stats;
+    uint32_t lastUplinkMs;
+    uint16_t uplinks;
+    uint16_t failedUplinks;
+    uint16_t retries;
+    uint16_t joins;
+    uint16_t failedJoins;
+    int16_t errors[LORA_DIAG_ERRORS];
+    uint8_t errorHead;
+    uint8_t snapshot[LORA_DIAG_SNAPSHOT_LEN];
+    uint8_t dumpId;
+    uint8_t sentLen;        // snapshot bytes confirmed sent
+    uint8_t chunkLen;       // snapshot bytes in the chunk awaiting confirmChunk()
+    uint8_t failures;
+    bool requested;
+    bool dumping;
+};
+
+#endif // LORA_DIAGNOSTICS_H
@@ -0,0 +1,90 @@
+#ifndef LORA_FRAME_PLANNER_H
+#define LORA_FRAME_PLANNER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaRegion.h"
+
+// What to do with a frame before it goes to the radio
+#define LORA_FRAME_FITS      0   // send as is
+#define LORA_FRAME_CHANGE_DR 1   // send at LoRaFramePlan::datarate
+#define LORA_FRAME_FRAGMENT  2   // too long for every usable data rate; split it
+#define LORA_FRAME_DEFER     3   // fits, but the airtime budgets need LoRaFramePlan::waitMs first
+
+/**
+ * @brief Pre-flight decision for one uplink
+ */
+struct LoRaFramePlan {
+    uint8_t action;         // LORA_FRAME_*
+    uint8_t datarate;       // data rate to send (each fragment) at
+    uint8_t fragments;      // number of frames, 1 unless fragmenting
+    uint8_t maxLen;         // largest frame payload at datarate
+    uint32_t airtimeMs;     // time on air of the (first) frame at datarate
+    uint32_t waitMs;        // time until the airtime budgets allow it, 0 if now
+};
+
+/**
+ * @brief Pre-flight payload check against regional limits
+ *
+ * Decides, from the regional tables only, whether a frame fits the current
+ * data rate under the dwell-time state set by TxParamSetupReq, and if not,
+ * which data rate to use or how to split it. No radio access and no
+ * airtime arithmetic, so it costs a handful of table reads. It also picks
+ * per-frame data rates from payload size and link margin.
+ */
+namespace LoRaFramePlanner {
+
+/**
+ * @brief Check if a data rate can be used without network configuration
+ *
+ * LoRa data rates at 125 kHz, plus the 500 kHz ones of fixed channel plans
+ * whose sub-band always carries a 500 kHz uplink channel. FSK and 250 kHz
+ * channels exist only when the network adds them.
+ *
+ * @param bandType BAND_TYPE_* constant
+ * @param datarate Uplink data rate
+ */
+bool isDefaultDatarate(uint8_t bandType, uint8_t datarate);
+
+/**
+ * @brief Plan a frame
+ *
+ * Keeps the current data rate when the frame fits. Otherwise takes the
+ * slowest faster data rate it fits at, so range is given up only as far as
+ * needed. If it fits nowhere, it is split for the current data rate (or the
+ * slowest one that carries any payload under the dwell time). airtimeMs and
+ * waitMs are left 0 for the caller.
+ *
+ * @param bandType BAND_TYPE_* constant
+ * @param datarate Current uplink data rate
+ * @param frameLen FRMPayload length as sent
+ * @param dwellTime Whether the 400 ms dwell time is in force
+ * @param plan Output plan
+ * @return false if no usable data rate carries any payload
+ */
+bool plan(uint8_t bandType, uint8_t datarate, size_t frameLen, bool dwellTime, LoRaFramePlan& plan);
+
+/**
+ * @brief Pick the data rate of a frame from its size and the link margin
+ *
+ * Takes the fastest usable data rate in [minDatarate, maxDatarate] that
+ * carries the frame and keeps marginDb above its demodulation floor, given
+ * the SNR of the link measured at 125 kHz. If none keeps the margin, the
+ * slowest one that carries the frame. A fixed scan of the DR table.
+ *
+ * @param bandType BAND_TYPE_* constant
+ * @param frameLen FRMPayload length as sent
+ * @param dwellTime Whether the 400 ms dwell time is in force
+ * @param snr Link SNR in dB
+ * @param marginDb Margin to keep above the demodulation floor
+ * @param minDatarate Slowest data rate allowed
+ * @param maxDatarate Fastest data rate allowed
+ * @param margin Output estimated margin at the chosen data rate
+ * @return uint8_t Data rate, LORA_REGION_DATARATES if the frame fits none
+ */
+uint8_t selectDatarate(uint8_t bandType, size_t frameLen, bool dwellTime, float snr, float marginDb,
+                       uint8_t minDatarate, uint8_t maxDatarate, float& margin);
+
+} // namespace LoRaFramePlanner
+
+#endif // LORA_FRAME_PLANNER_H
@@ -0,0 +1,176 @@
+#ifndef LORA_HEX_H
+#define LORA_HEX_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * @brief A 128-bit LoRaWAN key (AppKey, NwkKey or a session key)
+ */
+struct LoRaKey {
+    uint8_t bytes[16];
+};
+
+/**
+ * @brief Strict, allocation-free hex parsing for LoRaWAN credentials
+ *
+ * Accepted input is exactly two hex digits per byte, upper or lower case,
+ * most significant byte first (the format shown by TTN, ChirpStack, etc.).
+ * Prefixes such as "0x", separators and whitespace are rejected.
+ *
+ * The runtime functions use a 256-entry lookup table and never allocate.
+ * The constexpr functions (key(), eui(), isValid()) evaluate at compile time
+ * when given a string literal, e.g.
+ *
+ *     constexpr LoRaKey appKey = LoRaHex::key("F30A2F42EAEA8DE5D796A22DBBC86908");
+ *     constexpr uint64_t devEUI = LoRaHex::eui("70B3D57ED0000001");
+ *
+ * An invalid character in a constexpr context is a compile error.
+ */
+namespace LoRaHex {
+
+/**
+ * @brief Marker returned by nibble() for characters that are not hex digits
+ */
+constexpr uint8_t INVALID_NIBBLE = 0xFF;
+
+/**
+ * @brief Decode a single hex digit (compile-time capable)
+ *
+ * @param c Character to decode
+ * @return uint8_t Value 0-15, or INVALID_NIBBLE
+ */
+constexpr uint8_t nibble(char c) {
+    return (c >= '0' && c <= '9') ? (uint8_t)(c - '0') :
+           (c >= 'A' && c <= 'F') ? (uint8_t)(c - 'A' + 10) :
+           (c >= 'a' && c <= 'f') ? (uint8_t)(c - 'a' + 10) :
+           INVALID_NIBBLE;
+}
+
+namespace detail {
+
+// Deliberately not constexpr: reaching it while evaluating a constant
+// expression turns an invalid hex literal into a compile error
+inline uint8_t invalidHexLiteral() { return 0; }
+
+constexpr uint8_t checkedNibble(char c) {
+    return nibble(c) != INVALID_NIBBLE ? nibble(c) : invalidHexLiteral();
+}
+
+template <size_t N>
+constexpr uint8_t byteAt(const char (&hex)[N], size_t i) {
+    return (uint8_t)((checkedNibble(hex[2 * i]) << 4) | checkedNibble(hex[2 * i + 1]));
+}
+
+template <size_t N>
+constexpr uint64_t euiFrom(const char (&hex)[N], size_t i, uint64_t acc) {
+    return i == 8 ? acc : euiFrom(hex, i + 1, (acc << 8) | byteAt(hex, i));
+}
+
+template <size_t N>
+constexpr bool allHex(const char (&hex)[N], size_t i) {
+    return i == N - 1 ? true : (nibble(hex[i]) != INVALID_NIBBLE && allHex(hex, i + 1));
+}
+
+} // namespace detail
+
+/**
+ * @brief Check whether a string literal is a valid hex string (compile-time capable)
+ *
+ * @param hex String literal
+ * @return true if the literal has an even, non-zero length and only hex digits
+ */
+template <size_t N>
+constexpr bool isValid(const char (&hex)[N]) {
+    return N > 1 && (N - 1) % 2 == 0 && hex[N - 1] == '\0' && detail::allHex(hex, 0);
+}
+
+/**
+ * @brief Convert a 32-character hex literal to a key (compile-time capable)
+ *
+ * @param hex String literal with exactly 32 hex digits
+ * @return LoRaKey The decoded key
+ */
+template <size_t N>
+constexpr LoRaKey key(const char (&hex)[N]) {
+    static_assert(N == 33, "LoRaWAN key literals must be exactly 32 hex characters");
+    return LoRaKey{{
+        detail::byteAt(hex, 0),  detail::byteAt(hex, 1),  detail::byteAt(hex, 2),  detail::byteAt(hex, 3),
+        detail::byteAt(hex, 4),  detail::byteAt(hex, 5),  detail::byteAt(hex, 6),  detail::byteAt(hex, 7),
+        detail::byteAt(hex, 8),  detail::byteAt(hex, 9),  detail::byteAt(hex, 10), detail::byteAt(hex, 11),
+        detail::byteAt(hex, 12), detail::byteAt(hex, 13), detail::byteAt(hex, 14), detail::byteAt(hex, 15)
+    }};
+}
+
+/**
+ * @brief Convert a 16-character hex literal to an EUI (compile-time capable)
+ *
+ * @param hex String literal with exactly 16 hex digits, MSB first
+ * @return uint64_t The decoded EUI
+ */
+template <size_t N>
+constexpr uint64_t eui(const char (&hex)[N]) {
+    static_assert(N == 17, "LoRaWAN EUI literals must be exactly 16 hex characters");
+    return detail::euiFrom(hex, 0, 0);
+}
+
+/**
+ * @brief Convert a hex string of known length to a byte array
+ *
+ * The output is only modified if the whole input is valid.
+ *
+ * @param hex Hex characters (need not be null-terminated)
+ * @param hexLen Number of characters in hex
+ * @param result Output buffer
+ * @param resultLen Number of bytes expected (hexLen must equal 2 * resultLen)
+ * @return true if conversion was successful
+ * @return false if the length is wrong or a character is not a hex digit
+ */
+bool parse(const char* hex, size_t hexLen, uint8_t* result, size_t resultLen);
+
+/**
+ * @brief Convert a null-terminated hex string to a byte array
+ *
+ * @param hex Null-terminated hex string (e.g. "F30A2F42EAEA8DE5D796A22DBBC86908")
+ * @param result Output buffer
+ * @param resultLen Number of bytes expected
+ * @return true if conversion was successful
+ * @return false if conversion failed
+ */
+bool parse(const char* hex, uint8_t* result, size_t resultLen);
+
+/**
+ * @brief Convert a hex string of known length to a key
+ *
+ * @param hex 32 hex characters
+ * @param hexLen Number of characters in hex
+ * @param result Output key
+ * @return true if conversion was successful
+ * @return false if conversion failed
+ */
+bool parseKey(const char* hex, size_t hexLen, LoRaKey& result);
+
+/**
+ * @brief Convert a hex string of known length to an EUI
+ *
+ * @param hex 16 hex characters, MSB first
+ * @param hexLen Number of characters in hex
+ * @param result Output EUI
+ * @return true if conversion was successful
+ * @return false if conversion failed
+ */
+bool parseEui(const char* hex, size_t hexLen, uint64_t& result);
+
+/**
+ * @brief Convert a null-terminated hex string to an EUI
+ *
+ * @param hex Null-terminated string of 16 hex characters, MSB first
+ * @param result Output EUI
+ * @return true if conversion was successful
+ * @return false if conversion failed
+ */
+bool parseEui(const char* hex, uint64_t& result);
+
+} // namespace LoRaHex
+
+#endif // LORA_HEX_H
@@ -0,0 +1,244 @@
+#ifndef LORA_KEY_PROVIDER_H
+#define LORA_KEY_PROVIDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaHex.h"
+#include "LoRaCrypto.h"
+
+// Key handles; root keys have fixed handles, derived keys are allocated by the provider
+typedef uint8_t LoRaKeyHandle;
+#define LORA_KEY_HANDLE_APP_KEY   0
+#define LORA_KEY_HANDLE_NWK_KEY   1
+#define LORA_KEY_HANDLE_E2E_KEY   2   // application-layer end-to-end key, unknown to the network
+#define LORA_KEY_HANDLE_FIRST_DERIVED 3
+#define LORA_KEY_HANDLE_INVALID   0xFF
+
+// Number of derived keys remembered by the session key cache
+#define LORA_KEY_CACHE_SIZE 6
+
+/**
+ * @brief Interface to a store that holds LoRaWAN keys and performs crypto with them
+ *
+ * Keys are referred to by handle. A provider backed by a secure element or an
+ * encrypted NVS partition keeps key material out of LoRaManager's RAM; only
+ * exportKey() hands out a raw key, and a provider may refuse to do so.
+ *
+ * RadioLib performs the LoRaWAN MAC crypto itself, so LoRaManager exports the
+ * root keys into a stack buffer just long enough to pass them to beginOTAA()
+ * and wipes the buffer afterwards.
+ */
+class LoRaKeyProvider {
+public:
+    LoRaKeyProvider();
+    virtual ~LoRaKeyProvider() {}
+
+    /**
+     * @brief Check if a key is available
+     *
+     * @param handle Key handle
+     * @return true if the key exists
+     */
+    virtual bool hasKey(LoRaKeyHandle handle) = 0;
+
+    /**
+     * @brief Encrypt a single 16-byte block with AES-128 (ECB)
+     *
+     * @param handle Key handle
+     * @param in Input block
+     * @param out Output block (may be the same as in)
+     * @return true if successful
+     */
+    virtual bool encryptBlock(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out) = 0;
+
+    /**
+     * @brief Encrypt several independent 16-byte blocks (e.g. a CTR keystream)
+     *
+     * The default implementation calls encryptBlock() per block.
+     *
+     * @param handle Key handle
+     * @param in Input blocks
+     * @param out Output blocks (may be the same as in)
+     * @param blocks Number of blocks
+     * @return true if successful
+     */
+    virtual bool encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks);
+
+    /**
+     * @brief Compute an AES-128 CMAC
+     *
+     * @param handle Key handle
+     * @param data Data to authenticate
+     * @param len Length of data
+     * @param mac Output, 16 bytes
+     * @return true if successful
+     */
+    virtual bool computeCmac(LoRaKeyHandle handle, const uint8_t* data, size_t len, uint8_t* mac) = 0;
+
+    /**
+     * @brief Copy a raw key out of the provider
+     *
+     * Callers must wipe the buffer with wipe() as soon as possible.
+     *
+     * @param handle Key handle
+     * @param key Output, 16 bytes
+     * @return true if successful
+     * @return false if the key does not exist or the provider does not export keys
+     */
+    virtual bool exportKey(LoRaKeyHandle handle, uint8_t* key) = 0;
+
+    /**
+     * @brief Get a session key derived from a root key, deriving it only on a cache miss
+     *
+     * The derived key is AES-128(rootKey, derivationBlock), as used by the LoRaWAN
+     * key derivation functions. It never leaves the provider. LoRaManager derives
+     * the end-to-end session key this way (LoRaAppCrypto::sessionKey()), so a
+     * provider that reads its root keys from NVS touches them once per session.
+     *
+     * @param rootKey Handle of the key to derive from
+     * @param derivationBlock 16-byte derivation input (key type, nonces, padding)
+     * @return LoRaKeyHandle Handle of the derived key, or LORA_KEY_HANDLE_INVALID
+     */
+    LoRaKeyHandle getSessionKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock);
+
+    /**
+     * @brief Forget all derived keys; LoRaManager calls this on every join
+     */
+    void clearSessionKeys();
+
+    /**
+     * @brief Overwrite a buffer in a way the compiler cannot optimize away
+     *
+     * @param buffer Buffer to clear
+     * @param len Length of buffer
+     */
+    static void wipe(void* buffer, size_t len);
+
+protected:
+    /**
+     * @brief Derive a key inside the provider and store it under a handle
+     *
+     * @param rootKey Handle of the key to derive from
+     * @param derivationBlock 16-byte derivation input
+     * @param handle Handle under which to store the result
+     * @return true if successful
+     */
+    virtual bool deriveKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock, LoRaKeyHandle handle) = 0;
+
+    /**
+     * @brief Release a derived key evicted from the cache
+     *
+     * @param handle Handle of the derived key
+     */
+    virtual void releaseKey(LoRaKeyHandle handle) = 0;
+
+private:
+    struct CacheEntry {
+        LoRaKeyHandle rootKey;
+        uint8_t derivationBlock[16];
+        uint32_t lastUsed;
+    };
+
+    CacheEntry cache[LORA_KEY_CACHE_SIZE];
+    uint32_t useCounter;
+};
+
+/**
+ * @brief Software key store, the reference LoRaKeyProvider
+ *
+ * Keys are held in RAM inside the store and wiped when replaced or destroyed.
+ * Each key's AES schedule and CMAC subkeys are prepared once, when the key is
+ * stored, so per-frame operations only run the block cipher.
+ */
+class LoRaSoftKeyStore : public LoRaKeyProvider {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param backend AES engine used for all operations
+     */
+    LoRaSoftKeyStore(LoRaCryptoBackend& backend = LoRaCrypto::defaultBackend());
+    ~LoRaSoftKeyStore();
+
+    /**
+     * @brief Store a key; replacing a root key drops the keys derived from it
+     *
+     * @param handle A root key handle (LORA_KEY_HANDLE_*) or a derived key handle
+     * @param key 16-byte key
+     * @return true if successful
+     */
+    bool setKey(LoRaKeyHandle handle, const uint8_t* key);
+
+    /**
+     * @brief Wipe and remove a key
+     *
+     * @param handle Key handle
+     */
+    void removeKey(LoRaKeyHandle handle);
+
+    bool hasKey(LoRaKeyHandle handle) override;
+    bool encryptBlock(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out) override;
+    bool encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks) override;
+    bool computeCmac(LoRaKeyHandle handle, const uint8_t* data, size_t len, uint8_t* mac) override;
+    bool exportKey(LoRaKeyHandle handle, uint8_t* key) override;
+
+protected:
+    bool deriveKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock, LoRaKeyHandle handle) override;
+    void releaseKey(LoRaKeyHandle handle) override;
+
+private:
+    static const uint8_t SLOT_COUNT = LORA_KEY_HANDLE_FIRST_DERIVED + LORA_KEY_CACHE_SIZE;
+
+    LoRaCryptoBackend& backend;
+    LoRaKey keys[SLOT_COUNT];
+    LoRaAesSchedule schedules[SLOT_COUNT];
+    bool present[SLOT_COUNT];
+};
+
+#if defined(ESP32)
+/**
+ * @brief Key provider that reads root keys from NVS on demand
+ *
+ * With NVS encryption enabled (keys in an eFuse-protected partition) the root
+ * keys are only ever decrypted into short-lived stack buffers. Derived session
+ * keys are kept in RAM by the embedded software store.
+ */
+class LoRaNvsKeyStore : public LoRaKeyProvider {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param nvsNamespace NVS namespace holding the "appkey", "nwkkey" and "e2ekey" blobs
+     * @param backend AES engine used for all operations
+     */
+    LoRaNvsKeyStore(const char* nvsNamespace = "lorawan", LoRaCryptoBackend& backend = LoRaCrypto::defaultBackend());
+
+    /**
+     * @brief Write a root key to NVS (typically done once during provisioning)
+     *
+     * @param handle LORA_KEY_HANDLE_APP_KEY, LORA_KEY_HANDLE_NWK_KEY or LORA_KEY_HANDLE_E2E_KEY
+     * @param key 16-byte key
+     * @return true if successful
+     */
+    bool storeKey(LoRaKeyHandle handle, const uint8_t* key);
+
+    bool hasKey(LoRaKeyHandle handle) override;
+    bool encryptBlock(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out) override;
+    bool encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks) override;
+    bool computeCmac(LoRaKeyHandle handle, const uint8_t* data, size_t len, uint8_t* mac) override;
+    bool exportKey(LoRaKeyHandle handle, uint8_t* key) override;
+
+protected:
+    bool deriveKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock, LoRaKeyHandle handle) override;
+    void releaseKey(LoRaKeyHandle handle) override;
+
+private:
+    const char* nvsNamespace;
+    LoRaCryptoBackend& backend;
+    LoRaSoftKeyStore sessionKeys;
+
+    bool loadRootKey(LoRaKeyHandle handle, uint8_t* key);
+};
+#endif
+
+#endif // LORA_KEY_PROVIDER_H
@@ -3,15 +3,94 @@
 
 #include <Arduino.h>
 #include <RadioLib.h>
+#include <atomic>
+#include "LoRaHex.h"
+#include "LoRaProvisioning.h"
+#include "LoRaKeyProvider.h"
+#include "LoRaAppCrypto.h"
+#include "LoRaRelay.h"
+#include "LoRaBulk.h"
+#include "LoRaP2P.h"
+#include "LoRaAirtime.h"
+#include "LoRaRadioDriver.h"
+#include "LoRaRadioPool.h"
+#include "LoRaSessionTable.h"
+#include "LoRaRegion.h"
+#include "LoRaFramePlanner.h"
+#include "LoRaPowerControl.h"
+#include "LoRaRpc.h"
+#include "LoRaConfig.h"
+#include "LoRaDiagnostics.h"
 
-// Define band type constants
-#define BAND_TYPE_US915 1
-#define BAND_TYPE_EU868 2
-#define BAND_TYPE_OTHER 0
+// LoRaManager error codes, outside the ranges used by RadioLib
+#define LORAMANAGER_ERR_APP_CRYPTO      (-2001)
+#define LORAMANAGER_ERR_DOWNLINK_AUTH   (-2002)
+#define LORAMANAGER_ERR_BULK_TIMEOUT    (-2003)
+#define LORAMANAGER_ERR_BULK_ABORTED    (-2004)
+#define LORAMANAGER_ERR_AIRTIME_LIMIT   (-2005)
+#define LORAMANAGER_ERR_BUSY            (-2006)
+#define LORAMANAGER_ERR_NO_RADIO        (-2007)
 
 // Define a callback function type for downlink data
 typedef void (*DownlinkCallback)(uint8_t* payload, size_t size, uint8_t port);
 
+// Define a callback function type for peer-to-peer messages
+typedef void (*P2PMessageCallback)(uint16_t from, const uint8_t* payload, size_t size);
+
+// Define a callback function type for uplink plan changes
+typedef void (*UplinkPlanCallback)(const LoRaUplinkPlan& plan);
+
+// Define a callback function type for work done while waiting for the RX windows
+typedef void (*RxWaitCallback)(uint32_t budgetMs);
+
+// Define callback function types for virtual devices: credentials, uplink payloads and downlinks
+typedef bool (*VirtualCredentialsCallback)(uint16_t session, LoRaCredentials& credentials);
+typedef size_t (*VirtualUplinkCallback)(uint16_t session, uint8_t* payload, size_t maxLen, uint8_t& port);
+typedef void (*VirtualDownlinkCallback)(uint16_t session, uint8_t* payload, size_t size, uint8_t port);
+
+// Shortest RX wait worth doing work in, and the margin left before the window opens
+#define LORA_PIPELINE_MIN_WAIT_MS 10
+#define LORA_PIPELINE_MARGIN_MS   3
+
+// Largest payload that can be staged for pipelining
+#define LORA_PIPELINE_MAX_PAYLOAD 222
+
+/**
+ * @brief Uplink pipelining statistics
+ */
+struct LoRaPipelineStats {
+    uint32_t prepared;    // payloads sealed during an RX wait
+    uint32_t hits;        // uplinks that used a prepared payload
+    uint32_t stale;       // prepared payloads discarded (FCnt or data changed)
+    uint32_t preparedUs;  // sealing time moved into RX waits
+};
+
+// Link margin per-frame data rate selection keeps by default, in dB
+#define LORA_DR_DEFAULT_MARGIN_DB 10.0f
+
+/**
+ * @brief Per-frame data rate selection statistics
+ */
+struct LoRaDatarateStats {
+    uint32_t frames[LORA_REGION_DATARATES];  // uplinks per data rate chosen
+    uint32_t raisedForPayload;  // uplinks moved to a faster data rate to fit the payload
+    uint32_t belowMargin;       // uplinks where no data rate kept the margin; sent at the most robust
+    uint32_t noLinkInfo;        // selections made before any downlink; data rate left as it was
+    float lastMarginDb;         // estimated margin of the last selection
+    uint8_t lastDatarate;
+};
+
+/**
+ * @brief Link status that can be read from any thread
+ */
+struct LoRaStatus {
+    bool joined;
+    bool busy;        // a call is using the radio right now
+    float rssi;       // RSSI and SNR come from the same uplink
+    float snr;
+    int errorCode;
+};
+
 /**
  * @brief A class to manage LoRaWAN communication using RadioLib
  * 
@@ -19,6 +98,15 @@ typedef void (*DownlinkCallback)(uint8_t* payload, size_t size, uint8_t port);
  * handling connection establishment, data transmission and reception.
  * Default configuration uses the US915 frequency band with subband 2 (channels 8-15),
  * but this can be configured in the constructor.
+ * 
+ * Calls that use the radio (joinNetwork(), sendData(), handleEvents(), the P2P
+ * and bulk transfers) may come from several threads. They never block on each
+ * other: a call made while another one holds the radio fails at once with
+ * LORAMANAGER_ERR_BUSY (handleEvents() just returns), so a high-priority task
+ * is never left waiting behind a low-priority one. To queue uplinks from
+ * several tasks instead, use LoRaRadioTask. The status getters are lock-free
+ * and safe everywhere; configuration (begin(), credentials, limits) should be
+ * done before other threads start.
  */
 class LoRaManager {
 public:
@@ -52,6 +140,74 @@ public:
      */
     bool begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pinBusy);
     
+    /**
+     * @brief Initialize with a radio driver
+     * 
+     * Use this for chips other than the SX1262, or for an SX1262 on a board
+     * without a TCXO or DC-DC regulator. The driver must outlive this object.
+     * 
+     * @param driver Radio driver, e.g. LoRaSx1276Driver or LoRaLr1110Driver
+     * @return true if initialization was successful
+     * @return false if initialization failed
+     */
+    bool begin(LoRaRadioDriver& driver);
+    
+    /**
+     * @brief Add another transceiver for load balancing and failover
+     * 
+     * Each uplink goes out on the healthy transceiver with the most duty-cycle
+     * budget left, and the LoRaWAN session (keys, counters, ADR state) moves
+     * with it. Uplinks still take turns, since a Class A device may not send
+     * before the previous RX2 window has closed, but each transceiver has its
+     * own duty cycle, so two radios sustain about twice the rate of one. A
+     * transceiver failing LORA_RADIO_FAULT_LIMIT times in a row is taken out
+     * of service and re-initialized by handleEvents() every
+     * LORA_RADIO_PROBE_INTERVAL_MS. Raw PHY features (P2P, bulk, relay) use
+     * whichever transceiver carried the last uplink.
+     * 
+     * Call after begin() and before joinNetwork(). The driver must outlive
+     * this object.
+     * 
+     * @param driver Radio driver
+     * @return true if the transceiver was initialized and added
+     * @return false if it failed, LORA_MAX_RADIOS are in use or the device has already joined
+     */
+    bool addRadio(LoRaRadioDriver& driver);
+    
+    /**
+     * @brief Set the duty-cycle budget of one transceiver
+     * 
+     * Outside US915 every transceiver starts with 1% of LORA_RADIO_DUTY_PERIOD_MS.
+     * 
+     * @param index Transceiver, 0 for the one passed to begin()
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @return false if there is no such transceiver
+     */
+    bool setRadioDutyCycle(uint8_t index, uint32_t budgetMs, uint32_t periodMs = LORA_RADIO_DUTY_PERIOD_MS);
+    
+    /**
+     * @brief Get the number of transceivers
+     * 
+     * @return uint8_t Transceivers added with begin() and addRadio()
+     */
+    uint8_t getRadioCount() const;
+    
+    /**
+     * @brief Get the transceiver that carried the last uplink
+     * 
+     * @return uint8_t Index
+     */
+    uint8_t getActiveRadio() const;
+    
+    /**
+     * @brief Get the statistics of one transceiver
+     * 
+     * @param index Transceiver
+     * @return LoRaRadioStats Uplinks, airtime, faults and health
+     */
+    LoRaRadioStats getRadioStats(uint8_t index) const;
+    
     /**
      * @brief Set the LoRaWAN credentials
      * 
@@ -60,7 +216,46 @@ public:
      * @param appKey Application Key
      * @param nwkKey Network Key
      */
-    void setCredentials(uint64_t joinEUI, uint64_t devEUI, uint8_t* appKey, uint8_t* nwkKey);
+    void setCredentials(uint64_t joinEUI, uint64_t devEUI, const uint8_t* appKey, const uint8_t* nwkKey);
+    
+    /**
+     * @brief Set the LoRaWAN credentials from decoded keys
+     * 
+     * Combined with LoRaHex::key() on string literals the keys are decoded
+     * at compile time.
+     * 
+     * @param joinEUI Join EUI
+     * @param devEUI Device EUI
+     * @param appKey Application Key
+     * @param nwkKey Network Key
+     */
+    void setCredentials(uint64_t joinEUI, uint64_t devEUI, const LoRaKey& appKey, const LoRaKey& nwkKey);
+    
+    /**
+     * @brief Set the LoRaWAN credentials from a provisioning record
+     * 
+     * @param credentials Credentials, e.g. from LoRaManifestParser or LoRaProvisioning::fromBlob()
+     */
+    void setCredentials(const LoRaCredentials& credentials);
+    
+    /**
+     * @brief Set the LoRaWAN EUIs and use an external key provider for the keys
+     * 
+     * The provider (secure element, encrypted NVS, ...) must outlive the LoRaManager
+     * and hold LORA_KEY_HANDLE_APP_KEY and LORA_KEY_HANDLE_NWK_KEY.
+     * 
+     * @param joinEUI Join EUI
+     * @param devEUI Device EUI
+     * @param keyProvider Key provider holding the root keys
+     */
+    void setCredentials(uint64_t joinEUI, uint64_t devEUI, LoRaKeyProvider& keyProvider);
+    
+    /**
+     * @brief Get the key provider currently in use
+     * 
+     * @return LoRaKeyProvider& The external provider, or the built-in software store
+     */
+    LoRaKeyProvider& getKeyProvider();
     
     /**
      * @brief Set the LoRaWAN credentials using hex strings for keys
@@ -74,6 +269,353 @@ public:
      */
     bool setCredentialsHex(uint64_t joinEUI, uint64_t devEUI, const String& appKeyHex, const String& nwkKeyHex);
     
+    /**
+     * @brief Set the LoRaWAN credentials using hex string literals for keys
+     * 
+     * The literal length is checked at compile time and the keys are decoded
+     * by the constexpr parser, so no String is built and no parsing is left
+     * for runtime once the call is inlined.
+     * 
+     * @param joinEUI Join EUI
+     * @param devEUI Device EUI
+     * @param appKeyHex Application Key literal (32 hex chars)
+     * @param nwkKeyHex Network Key literal (32 hex chars)
+     * @return true if both literals are valid hex
+     * @return false if a literal contains a non-hex character
+     */
+    template <size_t N>
+    bool setCredentialsHex(uint64_t joinEUI, uint64_t devEUI, const char (&appKeyHex)[N], const char (&nwkKeyHex)[N]) {
+        if (!LoRaHex::isValid(appKeyHex) || !LoRaHex::isValid(nwkKeyHex)) {
+            return false;
+        }
+        setCredentials(joinEUI, devEUI, LoRaHex::key(appKeyHex), LoRaHex::key(nwkKeyHex));
+        return true;
+    }
+    
+    /**
+     * @brief Set all LoRaWAN credentials, including the EUIs, from hex strings
+     * 
+     * @param joinEUIHex Join EUI as hex string (16 chars, MSB first)
+     * @param devEUIHex Device EUI as hex string (16 chars, MSB first)
+     * @param appKeyHex Application Key as hex string (32 chars without spaces)
+     * @param nwkKeyHex Network Key as hex string (32 chars without spaces)
+     * @return true if conversion was successful
+     * @return false if conversion failed; the current credentials are left unchanged
+     */
+    bool setCredentialsHexEui(const char* joinEUIHex, const char* devEUIHex, const char* appKeyHex, const char* nwkKeyHex);
+    
+    /**
+     * @brief Enable application-layer encryption with a key held in the built-in key store
+     * 
+     * Payloads passed to sendData() are encrypted and authenticated with AES-CCM
+     * (4-byte tag, nonce derived from DevEUI and FCnt), and downlinks are verified
+     * and decrypted before the downlink callback sees them. Each join derives a
+     * session key from this key, JoinNonce and DevNonce (see LoRaAppCrypto). The
+     * key must not be shared with the network server.
+     * 
+     * @param e2eKey 16-byte end-to-end key shared with the application server
+     */
+    void enableAppEncryption(const uint8_t* e2eKey);
+    
+    /**
+     * @brief Enable application-layer encryption with a key held by a key provider
+     * 
+     * @param keyProvider Provider holding LORA_KEY_HANDLE_E2E_KEY; must outlive the LoRaManager
+     * @return true if the provider has the key
+     * @return false if the key is missing
+     */
+    bool enableAppEncryption(LoRaKeyProvider& keyProvider);
+    
+    /**
+     * @brief Disable application-layer encryption
+     */
+    void disableAppEncryption();
+    
+    /**
+     * @brief Check if application-layer encryption is enabled
+     * 
+     * @return true if enabled
+     */
+    bool isAppEncryptionEnabled() const;
+    
+    /**
+     * @brief Enable relay mode, forwarding frames from out-of-range neighbours
+     * 
+     * handleEvents() then runs channel activity detection on the relay channel
+     * every cadPeriodMs, and frames heard from children are forwarded as this
+     * node's own uplinks on LORA_RELAY_FPORT. Downlinks the network returns on
+     * that port are delivered to the child after its next uplink instead of
+     * reaching the downlink callback.
+     * 
+     * @param config Relay channel, CAD period and per-child rate limit
+     */
+    void enableRelay(const LoRaRelayConfig& config);
+    
+    /**
+     * @brief Disable relay mode; frames still queued are discarded
+     */
+    void disableRelay();
+    
+    /**
+     * @brief Register a command handler and serve RPC on LORA_RPC_FPORT
+     * 
+     * Downlinks on LORA_RPC_FPORT are then parsed as requests (see LoRaRpc)
+     * instead of reaching the downlink callback. Each handler runs once per
+     * request ID, however often the network retransmits it, and reads its
+     * arguments straight from the downlink buffer. handleEvents() sends the
+     * queued responses, batched into one uplink on the same port. Handlers
+     * run while the radio is in use and must not call sendData().
+     * 
+     * @param method Method number
+     * @param handler Handler, or nullptr to remove it
+     * @return false if LORA_RPC_MAX_HANDLERS methods are already registered
+     */
+    bool onRpc(uint8_t method, LoRaRpcHandler handler);
+    
+    /**
+     * @brief Stop serving RPC; LORA_RPC_FPORT downlinks reach the downlink callback again
+     */
+    void disableRpc();
+    
+    /**
+     * @brief Get the RPC statistics
+     * 
+     * @return LoRaRpcStats Counters since begin()
+     */
+    LoRaRpcStats getRpcStats() const;
+    
+    /**
+     * @brief Get the round-trip statistics of one command
+     * 
+     * @param method Method number
+     * @param stats Output statistics
+     * @return true if the method has a handler
+     */
+    bool getRpcMethodStats(uint8_t method, LoRaRpcMethodStats& stats) const;
+    
+    /**
+     * @brief Get the configuration store, to define its entries and read their values
+     * 
+     * @return LoRaConfig& The store; define entries before enableRemoteConfig()
+     */
+    LoRaConfig& getConfig();
+    
+    /**
+     * @brief Accept configuration patches on LORA_CONFIG_FPORT
+     * 
+     * Restores the configuration from storage. Patches are checked when their
+     * downlink arrives and applied whole by the next handleEvents(), which then
+     * calls the callback for each changed entry and sends a report with the
+     * version and hash on the same port. The callback runs while the radio is
+     * in use and must not call sendData().
+     * 
+     * @param storage Storage for the configuration journal, or nullptr for RAM only;
+     *                must outlive the LoRaManager
+     * @param callback Called for each changed entry, or nullptr
+     * @return true if a stored configuration was restored
+     * @return false if there was none, or another thread holds the radio
+     *         (LORAMANAGER_ERR_BUSY, nothing enabled)
+     */
+    bool enableRemoteConfig(LoRaConfigStorage* storage = nullptr, LoRaConfigCallback callback = nullptr);
+    
+    /**
+     * @brief Stop accepting patches; LORA_CONFIG_FPORT downlinks reach the downlink callback again
+     */
+    void disableRemoteConfig();
+    
+    /**
+     * @brief Get the configuration store statistics
+     * 
+     * @return LoRaConfigStats Counters since begin()
+     */
+    LoRaConfigStats getConfigStats() const;
+    
+    /**
+     * @brief Answer diagnostics dump requests on LORA_DIAG_FPORT
+     * 
+     * A request ([ dump ID ]) makes the next handleEvents() take a snapshot of
+     * the join state, recent error codes, retry counters, link quality, queued
+     * uplinks, airtime and memory watermarks (see LoRaDiagnostics). It is sent
+     * in chunks sized to the data rate, at low priority: one per
+     * handleEvents() call, only while no other uplink is waiting, at least
+     * LORA_DIAG_GAP_MS after the previous uplink and within the airtime limits.
+     * Application uplinks count as waiting when reported with setQueuedUplinks().
+     */
+    void enableDiagnostics();
+    
+    /**
+     * @brief Report how many application uplinks wait to be sent
+     * 
+     * Diagnostics chunks hold back while the count is not 0, and dumps
+     * include it. Update it whenever the queue in front of sendData()
+     * changes; LoRaRadioTask reports its own queue. Any thread.
+     * 
+     * @param count Uplinks waiting, 0 once they are sent
+     */
+    void setQueuedUplinks(uint8_t count);
+    
+    /**
+     * @brief Stop answering dump requests; LORA_DIAG_FPORT downlinks reach the downlink callback again
+     */
+    void disableDiagnostics();
+    
+    /**
+     * @brief Get the diagnostics statistics
+     * 
+     * @return LoRaDiagStats Counters since begin()
+     */
+    LoRaDiagStats getDiagnosticsStats() const;
+    
+    /**
+     * @brief Check if relay mode is enabled
+     * 
+     * @return true if enabled
+     */
+    bool isRelayEnabled() const;
+    
+    /**
+     * @brief Get the relay, e.g. for its statistics
+     * 
+     * @return const LoRaRelay& The relay state
+     */
+    const LoRaRelay& getRelay() const;
+    
+    /**
+     * @brief Send a large block of data to a peer over a raw LoRa/FSK link
+     * 
+     * Leaves the LoRaWAN session for the duration of the transfer, runs the
+     * LoRaBulkSender protocol on the given channel and hands the radio back.
+     * The session (keys, counters, ADR state) stays in memory, so no rejoin is
+     * needed afterwards. Blocks until done; respecting the regional duty cycle
+     * on the chosen channel is up to the caller.
+     * 
+     * @param phy Radio settings, e.g. LoRaBulk::fskConfig()
+     * @param read Callback supplying the data
+     * @param context Pointer passed to the callback
+     * @param totalLen Number of bytes to send
+     * @param timeoutMs Give up after this many milliseconds
+     * @return int RADIOLIB_ERR_NONE, LORAMANAGER_ERR_BULK_TIMEOUT, LORAMANAGER_ERR_BULK_ABORTED or a RadioLib error
+     */
+    int sendBulk(const LoRaPhyConfig& phy, LoRaBulkReadCallback read, void* context, uint32_t totalLen,
+                 uint32_t timeoutMs = 60000);
+    
+    /**
+     * @brief Send a buffer to a peer over a raw LoRa/FSK link
+     * 
+     * @param phy Radio settings
+     * @param data Data to send
+     * @param len Length of data
+     * @param timeoutMs Give up after this many milliseconds
+     * @return int Status code, as for the callback version
+     */
+    int sendBulk(const LoRaPhyConfig& phy, const uint8_t* data, uint32_t len, uint32_t timeoutMs = 60000);
+    
+    /**
+     * @brief Receive a bulk transfer from a peer over a raw LoRa/FSK link
+     * 
+     * @param phy Radio settings, identical to the sender's
+     * @param write Callback storing the data
+     * @param context Pointer passed to the callback
+     * @param timeoutMs Give up after this many milliseconds
+     * @return int RADIOLIB_ERR_NONE, LORAMANAGER_ERR_BULK_TIMEOUT, LORAMANAGER_ERR_BULK_ABORTED or a RadioLib error
+     */
+    int receiveBulk(const LoRaPhyConfig& phy, LoRaBulkWriteCallback write, void* context = nullptr,
+                    uint32_t timeoutMs = 60000);
+    
+    /**
+     * @brief Enable peer-to-peer messaging with nearby devices
+     * 
+     * handleEvents() then runs channel activity detection on the P2P channel
+     * every listenPeriodMs, between LoRaWAN uplinks. Messages are sent with a
+     * preamble longer than the listen period so a listening peer always
+     * catches them, giving a worst-case latency of about one listen period
+     * plus the time on air.
+     * 
+     * @param address This node's address (not LORA_P2P_BROADCAST)
+     * @param phy Radio settings shared by all peers (LoRa modem)
+     * @param listenPeriodMs Interval between channel checks
+     * @return true if enabled
+     * @return false if the address or settings are invalid
+     */
+    bool enableP2P(uint16_t address, const LoRaPhyConfig& phy, uint32_t listenPeriodMs = 100);
+    
+    /**
+     * @brief Disable peer-to-peer messaging
+     */
+    void disableP2P();
+    
+    /**
+     * @brief Set the callback for received peer-to-peer messages
+     * 
+     * @param callback Pointer to the callback function
+     */
+    void setP2PCallback(P2PMessageCallback callback);
+    
+    /**
+     * @brief Send a message to a peer, or to all peers with LORA_P2P_BROADCAST
+     * 
+     * Uses listen-before-talk and, when an acknowledgement is requested,
+     * retries up to three times. Blocks until done.
+     * 
+     * @param to Destination address
+     * @param data Message payload (up to LORA_P2P_MAX_PAYLOAD bytes)
+     * @param len Length of payload
+     * @param ack Whether the peer should acknowledge (ignored for broadcasts)
+     * @return true if sent (and acknowledged, if requested)
+     * @return false if sending failed or no acknowledgement arrived
+     */
+    bool sendP2P(uint16_t to, const uint8_t* data, size_t len, bool ack = false);
+    
+    /**
+     * @brief Get the peer-to-peer state, e.g. for latency and airtime statistics
+     * 
+     * @return const LoRaP2P& The P2P state
+     */
+    const LoRaP2P& getP2P() const;
+    
+    /**
+     * @brief Run many virtual LoRaWAN devices on this radio
+     * 
+     * Every session in the table is a device of its own (DevEUI, keys,
+     * counters). handleEvents() takes the session due first, swaps its state
+     * into the LoRaWAN node, joins it or sends the payload the uplink
+     * callback provides, and parks the state in the store again. All sessions
+     * share the radio's duty cycle and the airtime limits; a session that
+     * cannot be served yet stays due. Downlinks are delivered to the session
+     * whose DevAddr opened the receive window.
+     * 
+     * The device's own session is parked meanwhile: joinNetwork() and
+     * sendData() fail until disableVirtualDevices() restores it. A device
+     * that was not joined stays so until joinNetwork(). Application-layer
+     * encryption does not apply to virtual sessions.
+     * 
+     * @param table Session table, e.g. LoRaStaticSessionTable; must outlive the LoRaManager
+     * @param store Storage for parked session state; must outlive the LoRaManager
+     * @param credentials Callback supplying a session's credentials
+     * @param uplink Callback filling a session's next payload; return 0 to skip
+     * @return true if enabled
+     */
+    bool enableVirtualDevices(LoRaSessionTable& table, LoRaSessionStore& store,
+                              VirtualCredentialsCallback credentials, VirtualUplinkCallback uplink);
+    
+    /**
+     * @brief Stop serving virtual devices and restore the device's own session
+     * 
+     * If the parked session cannot be restored, the device joins the
+     * network again before this returns.
+     * 
+     * @return true if virtual devices are stopped and the own session, if there was one, is active
+     * @return false if another thread holds the radio (LORAMANAGER_ERR_BUSY) or the rejoin failed
+     */
+    bool disableVirtualDevices();
+    
+    /**
+     * @brief Set the callback for downlinks to virtual devices
+     * 
+     * @param callback Pointer to the callback function
+     */
+    void setVirtualDownlinkCallback(VirtualDownlinkCallback callback);
+    
     /**
      * @brief Join the LoRaWAN network
      * 
@@ -105,6 +647,274 @@ public:
      */
     bool sendString(const String& data, uint8_t port = 1, bool confirmed = false);
     
+    /**
+     * @brief Limit the uplink airtime of all ports together
+     * 
+     * For example setAirtimeLimit(30000, 86400000) enforces a fair-use policy
+     * of 30 s per day. sendData() checks the budget before anything is
+     * transmitted and fails with LORAMANAGER_ERR_AIRTIME_LIMIT when it is
+     * exhausted. Each attempt is charged its estimated airtime, corrected to
+     * the real time on air once sent.
+     * 
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @param burstMs Largest amount of airtime usable at once, 0 for budgetMs
+     */
+    void setAirtimeLimit(uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs = 0);
+    
+    /**
+     * @brief Limit the uplink airtime of one port, on top of the global limit
+     * 
+     * @param port FPort 1-255
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @param burstMs Largest amount of airtime usable at once, 0 for budgetMs
+     * @return false for port 0 or if LORA_AIRTIME_MAX_PORT_LIMITS ports are already limited
+     */
+    bool setPortAirtimeLimit(uint8_t port, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs = 0);
+    
+    /**
+     * @brief Get the earliest time a port may send a payload under the airtime limits
+     * 
+     * @param port FPort
+     * @param len Application payload length
+     * @return uint32_t A millis() timestamp, or LORA_AIRTIME_NEVER if the frame exceeds a burst size
+     */
+    uint32_t getEarliestSendTime(uint8_t port, size_t len);
+    
+    /**
+     * @brief Estimate the time on air of an uplink at the current data rate
+     * 
+     * @param len Application payload length (including any end-to-end encryption tag)
+     * @return uint32_t Milliseconds, rounded up
+     */
+    uint32_t estimateAirtime(size_t len);
+    
+    /**
+     * @brief Get the shortest interval at which a payload can be sent indefinitely
+     * 
+     * Computed from the current data rate, the band's duty cycle (see
+     * getRegion()) and the global and per-port airtime limits.
+     * 
+     * @param len Application payload length
+     * @param port FPort
+     * @return uint32_t Interval in milliseconds
+     */
+    uint32_t getSustainableInterval(size_t len, uint8_t port = 1);
+    
+    /**
+     * @brief Check an uplink against the regional limits before it is sent
+     * 
+     * Uses the payload limits of the current data rate under the dwell-time
+     * state (see setTxParams()) to decide whether the frame fits, needs a
+     * faster data rate, or has to be split, then how long the airtime budgets
+     * make it wait. Table lookups only; the radio is not touched. sendData()
+     * runs the same check and switches the data rate itself, but fails with
+     * RADIOLIB_ERR_PACKET_TOO_LONG instead of fragmenting.
+     * 
+     * @param len Application payload length
+     * @param port FPort
+     * @param plan Output plan; maxLen is in application bytes
+     * @return false if no usable data rate carries any payload
+     */
+    bool planFrame(size_t len, uint8_t port, LoRaFramePlan& plan);
+    
+    /**
+     * @brief Choose the data rate of every uplink from its size and the link margin
+     * 
+     * Before each uplink, takes the fastest data rate in [minDatarate,
+     * maxDatarate] that carries the payload and keeps marginDb above the
+     * demodulation floor, estimated from the SNR of the last downlink. If
+     * none does, the slowest one that carries it. Small frames on a good link
+     * go out fast; large ones still fit. Network ADR is turned off while this
+     * is on. Until the first downlink the data rate is left as it is.
+     * 
+     * @param marginDb Margin to keep, higher for more reliability
+     * @param minDatarate Slowest data rate to use
+     * @param maxDatarate Fastest data rate to use
+     */
+    void enableDatarateSelection(float marginDb = LORA_DR_DEFAULT_MARGIN_DB, uint8_t minDatarate = 0,
+                                 uint8_t maxDatarate = LORA_REGION_DATARATES - 1);
+    
+    /**
+     * @brief Stop per-frame data rate selection and hand the data rate back to ADR
+     * 
+     * ADR stays off while transmit power control is on.
+     */
+    void disableDatarateSelection();
+    
+    /**
+     * @brief Get the data rate decisions made for uplinks
+     * 
+     * @return LoRaDatarateStats Counters since begin()
+     */
+    LoRaDatarateStats getDatarateStats() const;
+    
+    /**
+     * @brief Control the transmit power from the link margin
+     * 
+     * After each downlink, the power is set so the uplink keeps marginDb
+     * above the demodulation floor, estimated from the downlink's SNR and
+     * RSSI. It goes down in 2 dB steps only once the margin exceeds the
+     * target by LORA_POWER_DEFAULT_HYSTERESIS_DB, and back up at once when
+     * it runs short or a confirmed uplink gets no ACK. It never exceeds the
+     * network's limit (max EIRP less the LinkADRReq TXPower steps) nor goes
+     * below minDbm. Network ADR is turned off while this is on, so no
+     * LinkADRReq can command a power the loop would then override.
+     * 
+     * @param marginDb Uplink margin to keep
+     * @param minDbm Lowest output power
+     * @param maxDbm Highest output power of the transceiver
+     */
+    void enablePowerControl(float marginDb = LORA_POWER_DEFAULT_MARGIN_DB, int8_t minDbm = LORA_POWER_MIN_DBM,
+                            int8_t maxDbm = LORA_POWER_MAX_DBM);
+    
+    /**
+     * @brief Stop transmit power control, send at the ceiling again and hand the power back to ADR
+     * 
+     * ADR stays off while data rate selection is on.
+     */
+    void disablePowerControl();
+    
+    /**
+     * @brief Set the TXPower of the network's last LinkADRReq
+     * 
+     * RadioLib applies LinkADRReq without reporting it; pass the TXPower
+     * index here (0 = max EIRP, each step 2 dB less) to cap the control loop.
+     * 
+     * @param txPower LinkADRReq TXPower index
+     */
+    void setNetworkTxPower(uint8_t txPower);
+    
+    /**
+     * @brief Get the transmit power and energy statistics
+     * 
+     * Energy is accounted for every uplink, at the power it was sent with,
+     * together with what sending it at the ceiling would have cost.
+     * 
+     * @return LoRaPowerStats Counters since begin()
+     */
+    LoRaPowerStats getPowerStats() const;
+    
+    /**
+     * @brief Set the uplink transmit parameters of TxParamSetupReq
+     * 
+     * Starts from the region's defaults (dwell time in force in AS923 and
+     * US915, off in AU915 until the network enables it). RadioLib applies
+     * TxParamSetupReq without reporting it, so set it here when the network's
+     * settings are known; an uplink refused for its dwell time also turns it on.
+     * 
+     * @param dwellTime Whether the 400 ms uplink dwell time is in force
+     * @param maxEirpDbm Maximum EIRP in dBm
+     */
+    void setTxParams(bool dwellTime, int8_t maxEirpDbm);
+    
+    /**
+     * @brief Check if the uplink dwell time is in force
+     */
+    bool isDwellTimeEnabled() const;
+    
+    /**
+     * @brief Get the maximum EIRP allowed for uplinks
+     * 
+     * @return int8_t dBm
+     */
+    int8_t getMaxEirp() const;
+    
+    /**
+     * @brief Plan how many samples to aggregate per uplink
+     * 
+     * Picks the smallest number of samples per uplink whose interval is
+     * sustainable. If even a full frame can't keep up with the sampling
+     * interval, the plan stretches sampleIntervalMs instead.
+     * 
+     * @param sampleIntervalMs Desired sampling interval
+     * @param bytesPerSample Encoded size of one sample
+     * @param headerBytes Fixed bytes per uplink
+     * @param plan Output plan
+     * @param port FPort
+     * @return true if a plan was made
+     * @return false if a single sample does not fit in a frame at the current data rate
+     */
+    bool planUplinks(uint32_t sampleIntervalMs, size_t bytesPerSample, size_t headerBytes, LoRaUplinkPlan& plan,
+                     uint8_t port = 1);
+    
+    /**
+     * @brief Re-plan automatically whenever ADR changes the data rate
+     * 
+     * The callback receives a new plan after the first uplink and after every
+     * uplink that used a different data rate than the previous plan.
+     * 
+     * @param callback Callback receiving the plan
+     * @param sampleIntervalMs Desired sampling interval
+     * @param bytesPerSample Encoded size of one sample
+     * @param headerBytes Fixed bytes per uplink
+     * @param port FPort
+     */
+    void enableAutoPlan(UplinkPlanCallback callback, uint32_t sampleIntervalMs, size_t bytesPerSample,
+                        size_t headerBytes = 0, uint8_t port = 1);
+    
+    /**
+     * @brief Stop automatic re-planning
+     */
+    void disableAutoPlan();
+    
+    /**
+     * @brief Hand over the payload of the next uplink so it can be prepared early
+     * 
+     * While the current uplink waits for its RX windows, the staged payload is
+     * sealed with end-to-end encryption for the frame counter the next uplink
+     * will use. A following sendData() with the same port and bytes then goes
+     * straight to the radio. Only useful with enableAppEncryption(); the
+     * LoRaWAN MAC encryption and MIC are computed by RadioLib at send time.
+     * Fails with LORAMANAGER_ERR_BUSY while another thread holds the radio,
+     * so call it from the thread that sends, between uplinks.
+     * 
+     * @param data Payload of the next uplink (copied)
+     * @param len Length of data, at most LORA_PIPELINE_MAX_PAYLOAD
+     * @param port FPort of the next uplink
+     * @return true if staged
+     */
+    bool stageUplink(const uint8_t* data, size_t len, uint8_t port = 1);
+    
+    /**
+     * @brief Drop a staged uplink that will not be sent after all
+     * 
+     * Clears the staged or prepared copy of the payload, if it is this one.
+     * sendData() takes its own payload off the pipeline, so this is only
+     * needed when a staged uplink is cancelled.
+     * 
+     * @param data Payload passed to stageUplink()
+     * @param len Length of data
+     * @param port FPort passed to stageUplink()
+     * @return false if another thread holds the radio
+     */
+    bool unstageUplink(const uint8_t* data, size_t len, uint8_t port = 1);
+    
+    /**
+     * @brief Set a callback that runs while an uplink waits for its RX windows
+     * 
+     * Use it to encode the next payload instead of idling. It runs on the
+     * sending thread and must return within budgetMs.
+     * 
+     * @param callback Callback, or nullptr to disable
+     */
+    void setRxWaitCallback(RxWaitCallback callback);
+    
+    /**
+     * @brief Get the uplink pipelining statistics
+     * 
+     * @return LoRaPipelineStats Counters since begin()
+     */
+    LoRaPipelineStats getPipelineStats() const;
+    
+    /**
+     * @brief Get the airtime limiter
+     * 
+     * @return const LoRaAirtimeLimiter& The limiter
+     */
+    const LoRaAirtimeLimiter& getAirtimeLimiter() const;
+    
     /**
      * @brief Get the last RSSI value
      * 
@@ -139,13 +949,32 @@ public:
      */
     int getLastErrorCode();
     
+    /**
+     * @brief Get the join state, link quality and last error in one snapshot
+     * 
+     * Lock-free and safe from any thread while another one is transmitting.
+     * 
+     * @return LoRaStatus Current status
+     */
+    LoRaStatus getStatus() const;
+    
     /**
      * @brief Get the current band type
      * 
-     * @return uint8_t The current band type (BAND_TYPE_US915, BAND_TYPE_EU868, or BAND_TYPE_OTHER)
+     * @return uint8_t The current band type (BAND_TYPE_* from LoRaRegion.h, BAND_TYPE_OTHER if unknown)
      */
     uint8_t getBandType() const;
     
+    /**
+     * @brief Get the regional parameters of the current band
+     * 
+     * Data rates, payload limits, RX2 defaults, duty cycle, dwell time and
+     * maximum EIRP of the channel plan.
+     * 
+     * @return const LoRaRegion& Channel-plan descriptor
+     */
+    const LoRaRegion& getRegion() const;
+    
     /**
      * @brief Set the callback function for downlink data
      * 
@@ -175,24 +1004,32 @@ public:
     int getRx2Timeout() const;
     
 private:
-    // Radio module and LoRaWAN node
-    SX1262* radio;
+    // Radio driver, the RadioLib object behind it and the LoRaWAN node
+    LoRaRadioDriver* driver;
+    LoRaRadioDriver* ownedDriver;   // created by begin(pins), deleted with this object
+    PhysicalLayer* radio;
     LoRaWANNode* node;
     
-    // LoRaWAN credentials
+    // All transceivers, each with its own node; the members above point at the active one
+    LoRaRadioDriver* radioDrivers[LORA_MAX_RADIOS];
+    LoRaWANNode* radioNodes[LORA_MAX_RADIOS];
+    LoRaRadioPool radioPool;
+    uint8_t activeRadio;
+    
+    // LoRaWAN credentials; keys live in the key provider, not in this object
     uint64_t joinEUI;
     uint64_t devEUI;
-    uint8_t appKey[16];
-    uint8_t nwkKey[16];
+    LoRaKeyProvider* keyProvider;
+    LoRaSoftKeyStore softKeyStore;
     
     // Frequency band and subband configuration
     LoRaWANBand_t freqBand;
     uint8_t subBand;
     
-    // Status variables
-    bool isJoined;
-    float lastRssi;
-    float lastSnr;
+    // Status variables, read from any thread
+    std::atomic<bool> isJoined;
+    std::atomic<float> lastRssi;
+    std::atomic<float> lastSnr;
     uint8_t consecutiveTransmitErrors;
     
     // Receive buffer
@@ -200,14 +1037,115 @@ private:
     size_t receivedBytes;
     
     // Error handling
-    int lastErrorCode;
+    std::atomic<int> lastErrorCode;
+    
+    // Set while a public call is using the radio
+    std::atomic<bool> radioBusy;
+    
+    // Application uplinks waiting outside the manager (setQueuedUplinks())
+    std::atomic<uint8_t> queuedUplinks;
+    
+    // Odd while lastRssi/lastSnr are being updated
+    std::atomic<uint32_t> linkSeq;
     
     // Downlink callback
     DownlinkCallback downlinkCallback;
     
-    // Band type
+    // Application-layer encryption (nullptr when disabled)
+    LoRaKeyProvider* appCryptoProvider;
+    
+    // Correction between getFCntUp() and the FCnt the next uplink actually carries
+    int32_t fCntUpOffset;
+    
+    // Relay mode
+    LoRaRelay relay;
+    bool relayEnabled;
+    uint32_t lastRelayScan;
+    
+    // Downlink RPC
+    LoRaRpc rpc;
+    bool rpcEnabled;
+    
+    // Remote configuration
+    LoRaConfig remoteConfig;
+    LoRaConfigCallback configCallback;
+    bool remoteConfigEnabled;
+    
+    // Diagnostics counters and dumps
+    LoRaDiagnostics diagnostics;
+    bool diagnosticsEnabled;
+    
+    // Virtual devices (sessionTable is nullptr when disabled)
+    LoRaSessionTable* sessionTable;
+    LoRaSessionStore* sessionStore;
+    VirtualCredentialsCallback virtualCredentials;
+    VirtualUplinkCallback virtualUplink;
+    VirtualDownlinkCallback virtualDownlink;
+    
+    // The device's own session, parked while virtual devices are served
+    uint8_t ownNonces[RADIOLIB_LORAWAN_NONCES_BUF_SIZE];
+    uint8_t ownSession[RADIOLIB_LORAWAN_SESSION_BUF_SIZE];
+    bool ownJoined;
+    
+    // Peer-to-peer messaging
+    LoRaP2P p2p;
+    LoRaPhyConfig p2pPhy;
+    bool p2pEnabled;
+    uint32_t p2pListenPeriod;
+    uint16_t p2pWakePreamble;
+    uint32_t lastP2PScan;
+    P2PMessageCallback p2pCallback;
+    
+    // Airtime accounting; the data rate is the one of the last uplink
+    LoRaAirtimeLimiter airtimeLimiter;
+    uint8_t uplinkDatarate;
+    
+    // Automatic uplink planning
+    UplinkPlanCallback planCallback;
+    uint32_t planSampleInterval;
+    uint16_t planBytesPerSample;
+    uint16_t planHeaderBytes;
+    uint8_t planPort;
+    uint8_t plannedDatarate;
+    
+    // Uplink pipelining: the next payload, sealed while the current uplink waits
+    // and kept with its plaintext until that uplink is sent
+    uint8_t stagedData[LORA_PIPELINE_MAX_PAYLOAD];
+    uint8_t preparedData[LORA_PIPELINE_MAX_PAYLOAD + LORA_APP_CRYPTO_TAG_LEN];
+    uint8_t preparedSource[LORA_PIPELINE_MAX_PAYLOAD];
+    uint8_t stagedLen;
+    uint8_t stagedPort;
+    uint8_t preparedLen;
+    uint8_t preparedPort;
+    bool staged;
+    bool prepared;
+    uint32_t preparedFCnt;
+    bool uplinkInFlight;
+    uint32_t inFlightFCnt;
+    RxWaitCallback rxWaitCallback;
+    LoRaPipelineStats pipelineStats;
+    
+    // Band type (BAND_TYPE_*), indexes the regional tables
     uint8_t bandType;
     
+    // TxParamSetupReq state
+    bool dwellTimeUp;
+    int8_t maxEirp;
+    
+    // Per-frame data rate selection
+    bool datarateSelection;
+    float datarateMargin;
+    uint8_t minSelectedDatarate;
+    uint8_t maxSelectedDatarate;
+    LoRaDatarateStats datarateStats;
+    float downlinkSnr;          // SNR of the last downlink actually received
+    bool hasDownlinkSnr;
+    
+    // Transmit power control and energy accounting
+    LoRaPowerControl powerControl;
+    bool powerControlEnabled;
+    uint8_t networkTxPower;
+    
     /**
      * @brief Configure subband channel mask based on the current subband
      * 
@@ -217,15 +1155,211 @@ private:
     int configureSubbandChannels(uint8_t targetSubBand);
     
     /**
-     * @brief Convert hex string to byte array
+     * @brief Add an initialized transceiver and its node to the pool
      * 
-     * @param hexString Hex string to convert (e.g. "F30A2F42EAEA8DE5D796A22DBBC86908")
-     * @param result Byte array to store the result (must be pre-allocated)
-     * @param resultLen Length of the result array
-     * @return true if conversion was successful
-     * @return false if conversion failed
+     * @param driver Radio driver
+     * @param radioNode LoRaWAN node on the driver's radio
+     * @return uint8_t Index, or LORA_RADIO_NONE if the pool is full
+     */
+    uint8_t registerRadio(LoRaRadioDriver* driver, LoRaWANNode* radioNode);
+    
+    /**
+     * @brief Move the LoRaWAN session to another transceiver
+     * 
+     * @param index Transceiver
+     * @return true if that transceiver is now active
+     */
+    bool switchRadio(uint8_t index);
+    
+    /**
+     * @brief Re-initialize transceivers that are due for a probe
+     */
+    void probeRadios();
+    
+    /**
+     * @brief Predict the frame counter of the next uplink
+     * 
+     * @return uint32_t FCnt the next sendReceive() will use
+     */
+    uint32_t nextUplinkFCnt();
+    
+    /**
+     * @brief RadioLib sleep function: does pipelined work, then sleeps the rest
+     * 
+     * @param ms Time RadioLib needs to wait
+     */
+    static void onRadioSleep(RadioLibTime_t ms);
+    
+    /**
+     * @brief Use part of an RX wait for the staged uplink and the RX wait callback
+     * 
+     * @param budgetMs Time available
+     */
+    void useRxWait(uint32_t budgetMs);
+    
+    /**
+     * @brief Take an uplink about to be sent off the pipeline
+     * 
+     * A staged copy no longer needs sealing, and a payload prepared for any
+     * other uplink is discarded as stale.
+     * 
+     * @param data Payload about to be sent
+     * @param len Length of data
+     * @param port FPort
+     * @return true if the sealed payload in preparedData is this uplink's
+     */
+    bool takePipelinedUplink(const uint8_t* data, size_t len, uint8_t port);
+    
+    /**
+     * @brief Load the root keys from the key provider into every transceiver's node
+     * 
+     * @return true if the keys were available
+     */
+    bool loadRootKeys();
+    
+    /**
+     * @brief Get the end-to-end session key of the session in the node
+     * 
+     * @return LoRaKeyHandle Derived key in appCryptoProvider, or LORA_KEY_HANDLE_INVALID
+     */
+    LoRaKeyHandle getAppSessionKey();
+    
+    /**
+     * @brief joinNetwork() for callers that already hold the radio
+     * 
+     * @return true if join was successful
+     */
+    bool joinNetworkLocked();
+    
+    /**
+     * @brief sendData() for callers that already hold the radio
+     * 
+     * @param data Data to send
+     * @param len Length of data
+     * @param port Port to use
+     * @param confirmed Whether to use confirmed transmission
+     * @return true if transmission was successful
+     */
+    bool sendDataLocked(uint8_t* data, size_t len, uint8_t port, bool confirmed);
+    
+    /**
+     * @brief Store the RSSI and SNR of an uplink for getStatus()
+     * 
+     * @param rssi RSSI in dBm
+     * @param snr SNR in dB
+     */
+    void publishLinkQuality(float rssi, float snr);
+    
+    /**
+     * @brief Get the modulation of a LoRaWAN data rate in the current band
+     * 
+     * @param datarate Uplink data rate
+     * @param spreadingFactor Output spreading factor, 0 for FSK
+     * @param bandwidth Output bandwidth in kHz, or bit rate in kbps for FSK
+     * @return true if the data rate is known
+     */
+    bool getDatarateParams(uint8_t datarate, uint8_t& spreadingFactor, float& bandwidth) const;
+    
+    /**
+     * @brief Get the largest application payload of a data rate in the current band
+     * 
+     * @param datarate Uplink data rate
+     * @return size_t Maximum FRMPayload length without FOpts, under the current dwell time
+     */
+    size_t getMaxPayload(uint8_t datarate) const;
+    
+    /**
+     * @brief Estimate the time on air of an uplink at a given data rate
+     * 
+     * @param len FRMPayload length
+     * @param datarate Uplink data rate
+     * @return uint32_t Milliseconds, rounded up
+     */
+    uint32_t estimateAirtimeAt(size_t len, uint8_t datarate) const;
+    
+    /**
+     * @brief Pick the data rate of the next uplink (enableDatarateSelection())
+     * 
+     * @param len Application payload length
+     * @param port FPort
+     */
+    void selectUplinkDatarate(size_t len, uint8_t port);
+    
+    /**
+     * @brief Cap transmit power control to the network's limits
+     */
+    void updatePowerCeiling();
+    
+    /**
+     * @brief Turn network ADR on unless data rate selection or power control is on
+     */
+    void updateAdr();
+    
+    /**
+     * @brief Get the length sendData() puts on air for a payload
+     * 
+     * @param len Application payload length
+     * @param port FPort
+     * @return size_t Length including the end-to-end encryption tag, if any
+     */
+    size_t getUplinkLength(size_t len, uint8_t port) const;
+    
+    /**
+     * @brief Borrow the radio from the LoRaWAN stack with raw PHY settings
+     * 
+     * LoRaWANNode reapplies its own settings on every uplink, so the session
+     * survives; call endPhySession() when done.
+     * 
+     * @param config Radio settings
+     * @return int RadioLib status code
+     */
+    int beginPhySession(const LoRaPhyConfig& config);
+    
+    /**
+     * @brief Hand the radio back to the LoRaWAN stack
+     * 
+     * @param config Settings passed to the matching beginPhySession()
+     */
+    void endPhySession(const LoRaPhyConfig& config);
+    
+    /**
+     * @brief Listen for child frames and forward or answer them (relay mode)
+     */
+    void serviceRelay();
+    
+    /**
+     * @brief Send queued RPC responses in one uplink
+     */
+    void serviceRpc();
+    
+    /**
+     * @brief Apply a staged configuration patch and send its report
+     */
+    void serviceConfig();
+    
+    /**
+     * @brief Take a requested diagnostics snapshot and send its next chunk
+     */
+    void serviceDiagnostics();
+    
+    /**
+     * @brief Check the P2P channel and handle a received message
+     */
+    void serviceP2P();
+    
+    /**
+     * @brief Join or send for the virtual device due first
+     */
+    void serviceVirtualDevices();
+    
+    /**
+     * @brief Deliver and acknowledge a frame received on the P2P channel
+     * 
+     * @param frame Received frame
+     * @param len Length of frame
+     * @return uint8_t Classification from LoRaP2P::parse()
      */
-    bool hexStringToByteArray(const String& hexString, uint8_t* result, size_t resultLen);
+    uint8_t handleP2PFrame(const uint8_t* frame, size_t len);
 };
 
 #endif // LORA_MANAGER_H 
\ No newline at end of file
@@ -0,0 +1,109 @@
+#ifndef LORA_MPSC_QUEUE_H
+#define LORA_MPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free bounded multi-producer/single-consumer queue
+ *
+ * Any number of threads may push; one thread pops. Each cell carries a
+ * sequence number telling whether it is free for the producer that claimed
+ * its position or holds an item for the consumer (D. Vyukov's bounded
+ * queue). Producers claim positions with a compare-and-swap on the tail and
+ * never wait on each other or on the consumer, so a low-priority producer
+ * cannot hold up a high-priority one. Nothing is allocated.
+ *
+ * @tparam T Item type (copied with operator=)
+ * @tparam N Capacity, a power of two
+ */
+template <typename T, size_t N>
+class LoRaMpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "LoRaMpscQueue capacity must be a power of two");
+
+public:
+    LoRaMpscQueue() : tail(0), head(0) {
+        for (size_t i = 0; i < N; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Add an item (any thread)
+     *
+     * @param item Item to copy in
+     * @return false if the queue is full
+     */
+    bool push(const T& item) {
+        size_t pos = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &cells[pos & (N - 1)];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->item = item;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest published item (consumer thread only)
+     *
+     * @param item Output
+     * @return false if no item is ready
+     */
+    bool pop(T& item) {
+        Cell& cell = cells[head & (N - 1)];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if ((intptr_t)seq - (intptr_t)(head + 1) < 0) {
+            return false;
+        }
+        item = cell.item;
+        cell.sequence.store(head + N, std::memory_order_release);
+        head++;
+        return true;
+    }
+
+    /**
+     * @brief Check if an item is ready (consumer thread only)
+     */
+    bool empty() const {
+        const Cell& cell = cells[head & (N - 1)];
+        return (intptr_t)cell.sequence.load(std::memory_order_acquire) - (intptr_t)(head + 1) < 0;
+    }
+
+    /**
+     * @brief Get the number of queued items, counting pushes still in progress (consumer thread only)
+     */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head;
+    }
+
+    /**
+     * @brief Get the capacity
+     */
+    static constexpr size_t capacity() { return N; }
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    Cell cells[N];
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) size_t head;
+};
+
+#endif // LORA_MPSC_QUEUE_H
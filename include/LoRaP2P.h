@@ -0,0 +1,147 @@
+#ifndef LORA_P2P_H
+#define LORA_P2P_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaPhy.h"
+
+// Frame layout: type/flags, destination (2), source (2), sequence number
+#define LORA_P2P_HEADER_LEN  6
+#define LORA_P2P_MAX_PAYLOAD 64
+#define LORA_P2P_MAX_FRAME   (LORA_P2P_HEADER_LEN + LORA_P2P_MAX_PAYLOAD)
+
+// Destination address that every node accepts
+#define LORA_P2P_BROADCAST 0xFFFF
+
+// Recently seen (source, sequence) pairs remembered for duplicate detection
+#define LORA_P2P_DEDUP_SIZE 16
+
+// Result of LoRaP2P::parse()
+#define LORA_P2P_FRAME_IGNORED   0   // not for us, malformed or an unexpected ACK
+#define LORA_P2P_FRAME_MESSAGE   1   // new message to deliver
+#define LORA_P2P_FRAME_DUPLICATE 2   // repeat of a delivered message (our ACK was lost)
+#define LORA_P2P_FRAME_ACK       3   // acknowledgement of the pending message
+
+/**
+ * @brief A received peer-to-peer message; payload points into the received frame
+ */
+struct LoRaP2PMessage {
+    uint16_t from;
+    uint16_t to;
+    uint8_t seq;
+    bool ackRequested;
+    const uint8_t* payload;
+    size_t len;
+};
+
+/**
+ * @brief Peer-to-peer statistics
+ */
+struct LoRaP2PStats {
+    uint32_t sent;
+    uint32_t delivered;       // messages acknowledged by the peer
+    uint32_t failed;          // acknowledged messages that ran out of retries
+    uint32_t retries;
+    uint32_t received;
+    uint32_t duplicates;
+    uint32_t lastRoundTripMs; // transmit start to ACK of the last acknowledged message
+    uint32_t lastAirtimeMs;   // time on air of the last message frame
+};
+
+/**
+ * @brief Framing, addressing and duplicate detection for peer-to-peer messages
+ *
+ * Frames (multi-byte fields big-endian):
+ *   MESSAGE [ 0x5x | to (2) | from (2) | seq | payload ]
+ *   ACK     [ 0x60 | to (2) | from (2) | seq of the acknowledged message ]
+ * The low nibble of a MESSAGE type byte is 1 when an ACK is requested.
+ * Broadcasts are never acknowledged.
+ *
+ * The class only builds and parses frames; LoRaManager drives the radio.
+ */
+class LoRaP2P {
+public:
+    LoRaP2P();
+
+    /**
+     * @brief Set this node's address and clear all state
+     *
+     * @param address Node address, anything but LORA_P2P_BROADCAST
+     * @param initialSeq First sequence number; pick a random one so messages
+     *                   sent after a reboot are not mistaken for duplicates
+     */
+    void begin(uint16_t address, uint8_t initialSeq = 0);
+
+    /**
+     * @brief Get this node's address
+     */
+    uint16_t getAddress() const;
+
+    /**
+     * @brief Build a message frame with the next sequence number
+     *
+     * An acknowledged message becomes the pending message that parse()
+     * matches ACKs against.
+     *
+     * @param to Destination address or LORA_P2P_BROADCAST
+     * @param payload Message payload
+     * @param len Length of payload, at most LORA_P2P_MAX_PAYLOAD
+     * @param ackRequested Whether the peer should acknowledge
+     * @param out Output buffer of at least LORA_P2P_MAX_FRAME bytes
+     * @return size_t Frame length, 0 if the payload is too long
+     */
+    size_t buildMessage(uint16_t to, const uint8_t* payload, size_t len, bool ackRequested, uint8_t* out);
+
+    /**
+     * @brief Build the acknowledgement for a received message
+     *
+     * @param message Message from parse()
+     * @param out Output buffer of at least LORA_P2P_HEADER_LEN bytes
+     * @return size_t Frame length
+     */
+    size_t buildAck(const LoRaP2PMessage& message, uint8_t* out) const;
+
+    /**
+     * @brief Classify a received frame
+     *
+     * @param frame Received frame
+     * @param len Length of frame
+     * @param message Output, valid for MESSAGE and DUPLICATE
+     * @return uint8_t One of the LORA_P2P_FRAME_* values
+     */
+    uint8_t parse(const uint8_t* frame, size_t len, LoRaP2PMessage& message);
+
+    /**
+     * @brief Check if an acknowledged message is still waiting for its ACK
+     */
+    bool isAckPending() const;
+
+    /**
+     * @brief Stop waiting for the pending ACK
+     */
+    void cancelPending();
+
+    /**
+     * @brief Get the statistics; LoRaManager fills in the radio timings
+     */
+    LoRaP2PStats& getStats();
+    const LoRaP2PStats& getStats() const;
+
+private:
+    struct SeenEntry {
+        uint16_t from;
+        uint8_t seq;
+        bool used;
+    };
+
+    uint16_t address;
+    uint8_t nextSeq;
+    uint16_t pendingTo;
+    uint8_t pendingSeq;
+    bool pending;
+    SeenEntry seen[LORA_P2P_DEDUP_SIZE];
+    uint8_t seenNext;
+    LoRaP2PStats stats;
+};
+
+#endif // LORA_P2P_H
@@ -0,0 +1,33 @@
+#ifndef LORA_PHY_H
+#define LORA_PHY_H
+
+#include <stdint.h>
+
+// Modulation used while the radio is borrowed from the LoRaWAN stack
+#define LORA_PHY_MODEM_LORA 0
+#define LORA_PHY_MODEM_FSK  1
+
+// Sync word for private (non-LoRaWAN) LoRa networks
+#define LORA_PHY_SYNC_WORD_PRIVATE 0x12
+
+/**
+ * @brief Raw radio settings for traffic outside the LoRaWAN session
+ *
+ * Used for relay listening, peer-to-peer messaging and bulk transfers, which
+ * borrow the radio between LoRaWAN uplinks. LoRaWANNode reapplies its own
+ * settings on every uplink, so the session is unaffected.
+ */
+struct LoRaPhyConfig {
+    uint8_t modem;            // LORA_PHY_MODEM_LORA or LORA_PHY_MODEM_FSK
+    float frequency;          // MHz
+    float bandwidth;          // kHz (LoRa) or receiver bandwidth in kHz (FSK)
+    uint8_t spreadingFactor;  // LoRa only
+    uint8_t codingRate;       // LoRa only, 5-8 for 4/5-4/8
+    uint8_t syncWord;         // LoRa only
+    float bitRate;            // kbps, FSK only
+    float frequencyDeviation; // kHz, FSK only
+    int8_t power;             // dBm
+    uint16_t preambleLength;  // symbols (LoRa) or bits (FSK)
+};
+
+#endif // LORA_PHY_H
@@ -0,0 +1,142 @@
+#ifndef LORA_POWER_CONTROL_H
+#define LORA_POWER_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Highest output power of the transceiver (SX126x and LR11x0 high-power PA)
+#ifndef LORA_POWER_MAX_DBM
+#define LORA_POWER_MAX_DBM 22
+#endif
+
+// Lowest output power the control loop goes down to
+#define LORA_POWER_MIN_DBM 2
+
+// LoRaWAN TXPower steps are 2 dB apart
+#define LORA_POWER_STEP_DB 2
+
+// Link margin kept above the demodulation floor, and how far above it the
+// margin has to be before power is lowered
+#define LORA_POWER_DEFAULT_MARGIN_DB     10.0f
+#define LORA_POWER_DEFAULT_HYSTERESIS_DB 3.0f
+
+// Receiver noise floor in a 125 kHz channel (-174 dBm/Hz, 6 dB noise figure)
+#define LORA_POWER_NOISE_FLOOR_DBM (-117.0f)
+
+// Supply voltage for energy accounting
+#ifndef LORA_POWER_SUPPLY_V
+#define LORA_POWER_SUPPLY_V 3.3f
+#endif
+
+/**
+ * @brief Transmit power and energy statistics
+ */
+struct LoRaPowerStats {
+    uint32_t uplinks;       // uplinks accounted
+    uint32_t stepsDown;     // power reductions
+    uint32_t stepsUp;       // power increases
+    float energyMj;         // radio energy spent transmitting
+    float savedMj;          // energy saved against sending everything at the ceiling
+    int8_t powerDbm;        // current output power
+};
+
+/**
+ * @brief Closed-loop transmit power control and TX energy accounting
+ *
+ * Downlink quality does not change with our transmit power, so the loop
+ * assumes a reciprocal link: at the power ceiling the uplink has the
+ * margin the downlink shows, and every dB less power costs a dB of it.
+ * The margin is taken from SNR or, once SNR saturates close to the
+ * gateway, from RSSI above the noise floor.
+ * Power is set so the estimated uplink margin stays at marginDb. It is
+ * lowered only when the margin exceeds that by the hysteresis, in whole
+ * LoRaWAN steps, and raised at once when the margin runs short or an
+ * expected downlink is lost. The ceiling is the network's limit (max EIRP,
+ * LinkADRReq TXPower) and the floor the configured minimum. Radio access
+ * is done by LoRaManager, this class only keeps the books.
+ */
+class LoRaPowerControl {
+public:
+    LoRaPowerControl();
+
+    /**
+     * @brief Set the loop's limits and targets; starts at the ceiling
+     *
+     * @param minDbm Lowest output power
+     * @param maxDbm Highest output power
+     * @param marginDb Uplink margin to keep above the demodulation floor
+     * @param hysteresisDb Extra margin needed before lowering the power
+     */
+    void configure(int8_t minDbm, int8_t maxDbm, float marginDb, float hysteresisDb);
+
+    /**
+     * @brief Cap the power, e.g. to the network's EIRP or TXPower setting
+     *
+     * @param dbm Ceiling, clamped to the configured range
+     */
+    void setCeiling(int8_t dbm);
+
+    /**
+     * @brief Get the power ceiling
+     */
+    int8_t getCeiling() const;
+
+    /**
+     * @brief Get the power to send the next uplink at
+     */
+    int8_t getPower() const;
+
+    /**
+     * @brief Feed the link quality of a downlink
+     *
+     * @param rssi Downlink RSSI in dBm
+     * @param snr Downlink SNR in dB
+     * @param requiredSnr Demodulation floor of the uplink's spreading factor
+     * @return true if the power changed
+     */
+    bool update(float rssi, float snr, float requiredSnr);
+
+    /**
+     * @brief Record an uplink whose expected downlink (ACK, LinkCheckAns) never came
+     *
+     * @return true if the power changed
+     */
+    bool reportLost();
+
+    /**
+     * @brief Account the energy of a sent uplink at the current power
+     *
+     * @param airtimeMs Time on air
+     */
+    void charge(uint32_t airtimeMs);
+
+    /**
+     * @brief Get the transmit power and energy statistics
+     */
+    const LoRaPowerStats& getStats() const;
+
+    /**
+     * @brief Approximate supply current while transmitting
+     *
+     * SX1262 figures with the DC-DC regulator; other chips are close enough
+     * for comparing power levels.
+     *
+     * @param dbm Output power
+     * @return float mA
+     */
+    static float txCurrentMa(int8_t dbm);
+
+private:
+    LoRaPowerStats stats;
+    float marginDb;
+    float hysteresisDb;
+    float smoothedMargin;
+    bool haveMargin;
+    int8_t minDbm;
+    int8_t maxDbm;
+    int8_t ceilingDbm;
+
+    void setPower(int8_t dbm);
+};
+
+#endif // LORA_POWER_CONTROL_H
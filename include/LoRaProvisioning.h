@@ -0,0 +1,186 @@
+#ifndef LORA_PROVISIONING_H
+#define LORA_PROVISIONING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaHex.h"
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+// Size of a serialized credential blob: version, DevEUI, JoinEUI, AppKey, NwkKey, CRC-16
+#define LORA_CREDENTIAL_BLOB_SIZE 51
+#define LORA_CREDENTIAL_BLOB_VERSION 1
+
+// Longest manifest line accepted (four fields of at most 32 hex chars plus padding)
+#define LORA_MANIFEST_MAX_LINE 192
+
+// Manifest error codes passed to the error callback
+#define LORA_MANIFEST_ERR_LINE_TOO_LONG  (-1)
+#define LORA_MANIFEST_ERR_FIELD_COUNT    (-2)
+#define LORA_MANIFEST_ERR_DEV_EUI        (-3)
+#define LORA_MANIFEST_ERR_JOIN_EUI       (-4)
+#define LORA_MANIFEST_ERR_APP_KEY        (-5)
+#define LORA_MANIFEST_ERR_NWK_KEY        (-6)
+
+/**
+ * @brief Binary OTAA credentials for one device
+ */
+struct LoRaCredentials {
+    uint64_t devEUI;
+    uint64_t joinEUI;
+    LoRaKey appKey;
+    LoRaKey nwkKey;
+};
+
+/**
+ * @brief Serialization of credentials to fixed-size blobs for secure storage
+ */
+namespace LoRaProvisioning {
+
+/**
+ * @brief Serialize credentials into a LORA_CREDENTIAL_BLOB_SIZE byte blob
+ *
+ * Layout: version, DevEUI (MSB first), JoinEUI (MSB first), AppKey, NwkKey,
+ * CRC-16/CCITT over the preceding bytes (MSB first).
+ *
+ * @param credentials Credentials to serialize
+ * @param blob Output buffer of LORA_CREDENTIAL_BLOB_SIZE bytes
+ */
+void toBlob(const LoRaCredentials& credentials, uint8_t* blob);
+
+/**
+ * @brief Deserialize credentials from a blob created by toBlob()
+ *
+ * @param blob Input buffer of LORA_CREDENTIAL_BLOB_SIZE bytes
+ * @param credentials Output credentials
+ * @return true if the version and CRC are valid
+ * @return false if the blob is corrupt or of an unknown version
+ */
+bool fromBlob(const uint8_t* blob, LoRaCredentials& credentials);
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ *
+ * @param data Data to checksum
+ * @param len Length of data
+ * @return uint16_t The CRC
+ */
+uint16_t crc16(const uint8_t* data, size_t len);
+
+} // namespace LoRaProvisioning
+
+/**
+ * @brief Streaming parser for CSV provisioning manifests
+ *
+ * Each line holds DevEUI, JoinEUI, AppKey and optionally NwkKey as hex strings,
+ * separated by commas or semicolons. Fields are validated with the LoRaHex rules;
+ * surrounding spaces and double quotes are ignored. A missing NwkKey defaults to
+ * the AppKey (LoRaWAN 1.0.x devices). Empty lines and lines starting with '#'
+ * are skipped.
+ *
+ * If the first line is a header (e.g. "DevEUI,JoinEUI,AppKey,NwkKey") its column
+ * names define the field order; "AppEUI" is accepted as an alias for JoinEUI.
+ *
+ * Input can be fed in chunks of any size. Complete lines are parsed straight from
+ * the caller's buffer; only a line split across chunks is copied. No memory is
+ * allocated.
+ */
+class LoRaManifestParser {
+public:
+    /**
+     * @brief Called for every valid record
+     */
+    typedef void (*RecordCallback)(const LoRaCredentials& credentials, uint32_t lineNumber, void* context);
+
+    /**
+     * @brief Called for every rejected line with one of the LORA_MANIFEST_ERR_* codes
+     */
+    typedef void (*ErrorCallback)(int error, uint32_t lineNumber, void* context);
+
+    /**
+     * @brief Constructor
+     *
+     * @param onRecord Callback for valid records
+     * @param context Pointer passed back to the callbacks
+     */
+    LoRaManifestParser(RecordCallback onRecord, void* context = nullptr);
+
+    /**
+     * @brief Set the callback for rejected lines
+     *
+     * @param onError Callback, or nullptr to only count errors
+     */
+    void setErrorCallback(ErrorCallback onError);
+
+    /**
+     * @brief Parse the next chunk of the manifest
+     *
+     * @param data Manifest bytes
+     * @param len Number of bytes
+     */
+    void feed(const char* data, size_t len);
+
+    /**
+     * @brief Parse a final line that has no trailing newline
+     */
+    void finish();
+
+    /**
+     * @brief Clear all state so a new manifest can be parsed
+     */
+    void reset();
+
+#ifdef ARDUINO
+    /**
+     * @brief Parse a whole manifest from a stream (file, serial port, ...)
+     *
+     * @param stream Stream to read until it has no more data
+     * @return uint32_t Number of valid records
+     */
+    uint32_t parse(Stream& stream);
+#endif
+
+    /**
+     * @brief Get the number of valid records
+     */
+    uint32_t getRecordCount() const;
+
+    /**
+     * @brief Get the number of rejected lines
+     */
+    uint32_t getErrorCount() const;
+
+    /**
+     * @brief Get the number of lines seen so far
+     */
+    uint32_t getLineCount() const;
+
+private:
+    static const uint8_t MAX_FIELDS = 4;
+
+    RecordCallback onRecord;
+    ErrorCallback onError;
+    void* context;
+
+    // Partial line carried over between chunks
+    char pending[LORA_MANIFEST_MAX_LINE];
+    size_t pendingLen;
+    bool pendingOverflow;
+
+    // Column index of DevEUI, JoinEUI, AppKey, NwkKey (NwkKey may be absent)
+    uint8_t columns[MAX_FIELDS];
+    uint8_t columnCount;
+    bool headerChecked;
+
+    uint32_t lineCount;
+    uint32_t recordCount;
+    uint32_t errorCount;
+
+    void parseLine(const char* line, size_t len);
+    bool parseHeader(const char* const* fields, const uint8_t* fieldLens, uint8_t fieldCount);
+    void reportError(int error);
+};
+
+#endif // LORA_PROVISIONING_H
@@ -0,0 +1,286 @@
+#ifndef LORA_RADIO_DRIVER_H
+#define LORA_RADIO_DRIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <RadioLib.h>
+#include "LoRaPhy.h"
+
+/**
+ * @brief Board-level radio options
+ *
+ * Defaults match RadioLib's: a 1.6 V TCXO and the DC-DC regulator. Boards
+ * with a plain crystal should set tcxoVoltage to 0, which also skips the
+ * TCXO start-up wait on every wake-up.
+ */
+struct LoRaRadioOptions {
+    float tcxoVoltage;      // TCXO supply in volts, 0 for a crystal (SX126x, LR11x0)
+    bool useDcDc;           // DC-DC regulator instead of the LDO (SX126x, LR11x0)
+    bool dio2AsRfSwitch;    // DIO2 drives the RF switch (SX126x)
+
+    LoRaRadioOptions() : tcxoVoltage(1.6f), useDcDc(true), dio2AsRfSwitch(false) {}
+};
+
+/**
+ * @brief What LoRaManager needs from a radio chip
+ *
+ * LoRaManager holds a driver through this interface, and through
+ * getPhysicalLayer() the RadioLib object the LoRaWAN stack uses. Each call
+ * here covers a whole operation, such as reconfiguring the PHY. The
+ * register-level calls behind it are bound at compile time in
+ * LoRaRadioDriverBase.
+ */
+class LoRaRadioDriver {
+public:
+    virtual ~LoRaRadioDriver() {}
+
+    /**
+     * @brief Get the chip name for logs
+     */
+    virtual const char* getName() const = 0;
+
+    /**
+     * @brief Get the RadioLib radio object
+     */
+    virtual PhysicalLayer* getPhysicalLayer() = 0;
+
+    /**
+     * @brief Initialize the chip in LoRa mode with the board options applied
+     *
+     * @return int RadioLib status code
+     */
+    virtual int begin() = 0;
+
+    /**
+     * @brief Apply raw PHY settings
+     *
+     * LoRa settings are changed in place, keeping the TCXO and regulator
+     * setup; switching to FSK needs a full re-initialization.
+     *
+     * @param config Radio settings
+     * @return int RadioLib status code
+     */
+    virtual int beginPhy(const LoRaPhyConfig& config) = 0;
+
+    /**
+     * @brief Return the radio to LoRa mode after beginPhy()
+     *
+     * @param config Settings passed to the matching beginPhy()
+     * @return int RadioLib status code
+     */
+    virtual int endPhy(const LoRaPhyConfig& config) = 0;
+
+    /**
+     * @brief Set the LoRa preamble length
+     *
+     * @param symbols Preamble length in symbols
+     * @return int RadioLib status code
+     */
+    virtual int setPreambleLength(uint16_t symbols) = 0;
+
+    /**
+     * @brief Invert the LoRa IQ signals (for transmitting downlinks)
+     *
+     * @param enable Whether to invert
+     * @return int RadioLib status code
+     */
+    virtual int invertIQ(bool enable) = 0;
+};
+
+/**
+ * @brief Shared driver logic, statically dispatched to the chip (CRTP)
+ *
+ * Derived provides getChip(), beginChip() and beginFsk(); everything else
+ * calls the chip class directly, so the setters inline and unsupported
+ * features fail at compile time instead of at run time.
+ *
+ * @tparam Chip RadioLib chip class
+ * @tparam Derived The concrete driver
+ */
+template <class Chip, class Derived>
+class LoRaRadioDriverBase : public LoRaRadioDriver {
+public:
+    explicit LoRaRadioDriverBase(const LoRaRadioOptions& options) : options(options) {}
+
+    PhysicalLayer* getPhysicalLayer() override { return &chip(); }
+
+    int begin() override { return derived().beginChip(); }
+
+    int beginPhy(const LoRaPhyConfig& config) override {
+        if (config.modem == LORA_PHY_MODEM_FSK) {
+            return derived().beginFsk(config);
+        }
+
+        Chip& radio = chip();
+        radio.standby();
+        int state = radio.setFrequency(config.frequency);
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setBandwidth(config.bandwidth);
+        }
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setSpreadingFactor(config.spreadingFactor);
+        }
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setCodingRate(config.codingRate);
+        }
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setSyncWord(config.syncWord);
+        }
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setOutputPower(config.power);
+        }
+        if (state == RADIOLIB_ERR_NONE) {
+            state = radio.setPreambleLength(config.preambleLength);
+        }
+        return state;
+    }
+
+    int endPhy(const LoRaPhyConfig& config) override {
+        // LoRaWANNode only reapplies LoRa parameters, so leave FSK mode first
+        if (config.modem == LORA_PHY_MODEM_FSK) {
+            return derived().beginChip();
+        }
+        return chip().standby();
+    }
+
+    int setPreambleLength(uint16_t symbols) override { return chip().setPreambleLength(symbols); }
+
+    int invertIQ(bool enable) override { return chip().invertIQ(enable); }
+
+    /**
+     * @brief Get the board options
+     */
+    const LoRaRadioOptions& getOptions() const { return options; }
+
+protected:
+    LoRaRadioOptions options;
+
+    Derived& derived() { return static_cast<Derived&>(*this); }
+    Chip& chip() { return derived().getChip(); }
+};
+
+/**
+ * @brief Driver for SX126x chips (SX1261, SX1262, SX1268)
+ *
+ * TCXO voltage and regulator are passed to begin() and beginFSK(), so a
+ * switch between LoRa and FSK keeps the board setup.
+ *
+ * @tparam Chip SX1261, SX1262 or SX1268
+ */
+template <class Chip>
+class LoRaSx126xDriver : public LoRaRadioDriverBase<Chip, LoRaSx126xDriver<Chip> > {
+public:
+    LoRaSx126xDriver(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pinBusy,
+                     const LoRaRadioOptions& options = LoRaRadioOptions()) :
+        LoRaRadioDriverBase<Chip, LoRaSx126xDriver<Chip> >(options),
+        module(pinCS, pinDIO1, pinReset, pinBusy),
+        radio(&module) {
+    }
+
+    const char* getName() const override { return "SX126x"; }
+    Chip& getChip() { return radio; }
+
+    int beginChip() {
+        int state = radio.begin(434.0, 125.0, 9, 7, RADIOLIB_SX126X_SYNC_WORD_PRIVATE, 10, 8,
+                                this->options.tcxoVoltage, !this->options.useDcDc);
+        if (state == RADIOLIB_ERR_NONE && this->options.dio2AsRfSwitch) {
+            state = radio.setDio2AsRfSwitch(true);
+        }
+        return state;
+    }
+
+    int beginFsk(const LoRaPhyConfig& config) {
+        return radio.beginFSK(config.frequency, config.bitRate, config.frequencyDeviation, config.bandwidth,
+                              config.power, config.preambleLength, this->options.tcxoVoltage,
+                              !this->options.useDcDc);
+    }
+
+private:
+    Module module;
+    Chip radio;
+};
+
+/**
+ * @brief Driver for SX127x chips (SX1276, SX1277, SX1278, SX1279)
+ *
+ * These chips have neither a TCXO control nor a DC-DC regulator, so those
+ * options are ignored.
+ *
+ * @tparam Chip SX1276, SX1277, SX1278 or SX1279
+ */
+template <class Chip>
+class LoRaSx127xDriver : public LoRaRadioDriverBase<Chip, LoRaSx127xDriver<Chip> > {
+public:
+    LoRaSx127xDriver(int8_t pinCS, int8_t pinDIO0, int8_t pinReset, int8_t pinDIO1,
+                     const LoRaRadioOptions& options = LoRaRadioOptions()) :
+        LoRaRadioDriverBase<Chip, LoRaSx127xDriver<Chip> >(options),
+        module(pinCS, pinDIO0, pinReset, pinDIO1),
+        radio(&module) {
+    }
+
+    const char* getName() const override { return "SX127x"; }
+    Chip& getChip() { return radio; }
+
+    int beginChip() {
+        return radio.begin(434.0, 125.0, 9, 7, RADIOLIB_SX127X_SYNC_WORD, 10, 8, 0);
+    }
+
+    int beginFsk(const LoRaPhyConfig& config) {
+        return radio.beginFSK(config.frequency, config.bitRate, config.frequencyDeviation, config.bandwidth,
+                              config.power, config.preambleLength, false);
+    }
+
+private:
+    Module module;
+    Chip radio;
+};
+
+/**
+ * @brief Driver for LR11x0 chips (LR1110, LR1120, LR1121)
+ *
+ * @tparam Chip LR1110, LR1120 or LR1121
+ */
+template <class Chip>
+class LoRaLr11x0Driver : public LoRaRadioDriverBase<Chip, LoRaLr11x0Driver<Chip> > {
+public:
+    LoRaLr11x0Driver(int8_t pinCS, int8_t pinIRQ, int8_t pinReset, int8_t pinBusy,
+                     const LoRaRadioOptions& options = LoRaRadioOptions()) :
+        LoRaRadioDriverBase<Chip, LoRaLr11x0Driver<Chip> >(options),
+        module(pinCS, pinIRQ, pinReset, pinBusy),
+        radio(&module) {
+    }
+
+    const char* getName() const override { return "LR11x0"; }
+    Chip& getChip() { return radio; }
+
+    int beginChip() {
+        int state = radio.begin(434.0, 125.0, 9, 7, RADIOLIB_LR11X0_LORA_SYNC_WORD_PRIVATE, 10, 8,
+                                this->options.tcxoVoltage);
+        if (state == RADIOLIB_ERR_NONE && this->options.useDcDc) {
+            state = radio.setRegulatorDCDC();
+        }
+        return state;
+    }
+
+    int beginFsk(const LoRaPhyConfig& config) {
+        int state = radio.beginGFSK(config.frequency, config.bitRate, config.frequencyDeviation, config.bandwidth,
+                                    config.power, config.preambleLength, this->options.tcxoVoltage);
+        if (state == RADIOLIB_ERR_NONE && this->options.useDcDc) {
+            state = radio.setRegulatorDCDC();
+        }
+        return state;
+    }
+
+private:
+    Module module;
+    Chip radio;
+};
+
+// Drivers for the supported chips
+typedef LoRaSx126xDriver<SX1262> LoRaSx1262Driver;
+typedef LoRaSx126xDriver<SX1268> LoRaSx1268Driver;
+typedef LoRaSx127xDriver<SX1276> LoRaSx1276Driver;
+typedef LoRaLr11x0Driver<LR1110> LoRaLr1110Driver;
+typedef LoRaLr11x0Driver<LR1120> LoRaLr1120Driver;
+
+#endif // LORA_RADIO_DRIVER_H
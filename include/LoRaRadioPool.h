@@ -0,0 +1,180 @@
+#ifndef LORA_RADIO_POOL_H
+#define LORA_RADIO_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaAirtime.h"
+
+// Transceivers one LoRaManager can drive
+#ifndef LORA_MAX_RADIOS
+#define LORA_MAX_RADIOS 2
+#endif
+
+// Consecutive radio faults before a transceiver is taken out of service
+#define LORA_RADIO_FAULT_LIMIT 3
+
+// How long a faulted transceiver rests before it is re-initialized
+#define LORA_RADIO_PROBE_INTERVAL_MS 60000
+
+// Window over which a regional duty cycle is measured
+#define LORA_RADIO_DUTY_PERIOD_MS 3600000UL
+
+// Returned by LoRaRadioPool::select() when no transceiver can send
+#define LORA_RADIO_NONE 0xFF
+
+/**
+ * @brief Per-transceiver statistics
+ */
+struct LoRaRadioStats {
+    uint32_t uplinks;       // uplinks sent on this transceiver
+    uint32_t airtimeMs;     // their total time on air
+    uint32_t faults;        // radio errors seen
+    uint32_t outages;       // times it was taken out of service
+    bool healthy;           // in service
+};
+
+/**
+ * @brief Scheduling and failover policy for several transceivers
+ *
+ * Each transceiver has its own duty-cycle budget (a token bucket, as in
+ * LoRaAirtimeLimiter). select() picks the healthy one with the most budget
+ * left, so uplinks alternate and a node with two radios sustains twice the
+ * duty-cycle-limited rate of one. A transceiver that reports
+ * LORA_RADIO_FAULT_LIMIT faults in a row is skipped until its probe time,
+ * when LoRaManager re-initializes it. Radio access is done by LoRaManager,
+ * this class only keeps the books. Times are millis() values.
+ */
+class LoRaRadioPool {
+public:
+    LoRaRadioPool();
+
+    /**
+     * @brief Add a transceiver
+     *
+     * @return uint8_t Its index, or LORA_RADIO_NONE if the pool is full
+     */
+    uint8_t add();
+
+    /**
+     * @brief Get the number of transceivers
+     */
+    uint8_t size() const;
+
+    /**
+     * @brief Limit the airtime of one transceiver
+     *
+     * @param index Transceiver
+     * @param budgetMs Airtime allowed per period; 0 removes the limit
+     * @param periodMs Length of the period
+     * @param now Current time
+     */
+    void setDutyCycle(uint8_t index, uint32_t budgetMs, uint32_t periodMs, uint32_t now);
+
+    /**
+     * @brief Pick the transceiver for a frame
+     *
+     * Ties go to the transceiver not used last.
+     *
+     * @param airtimeMs Time on air of the frame
+     * @param now Current time
+     * @return uint8_t Index, or LORA_RADIO_NONE if none is healthy with enough budget
+     */
+    uint8_t select(uint32_t airtimeMs, uint32_t now);
+
+    /**
+     * @brief Get how long until some healthy transceiver can send a frame
+     *
+     * @param airtimeMs Time on air of the frame
+     * @param now Current time
+     * @return uint32_t Milliseconds, LORA_AIRTIME_NEVER if none is healthy or the frame never fits
+     */
+    uint32_t getWait(uint32_t airtimeMs, uint32_t now) const;
+
+    /**
+     * @brief Charge a frame to a transceiver before it is sent
+     *
+     * @param index Transceiver
+     * @param airtimeMs Estimated time on air
+     * @param now Current time
+     */
+    void charge(uint8_t index, uint32_t airtimeMs, uint32_t now);
+
+    /**
+     * @brief Record a sent frame, correcting the charge to the real time on air
+     *
+     * @param index Transceiver
+     * @param chargedMs Airtime passed to charge()
+     * @param airtimeMs Real time on air
+     */
+    void reportSent(uint8_t index, uint32_t chargedMs, uint32_t airtimeMs);
+
+    /**
+     * @brief Take back the charge of a frame that was never transmitted
+     *
+     * @param index Transceiver
+     * @param chargedMs Airtime passed to charge()
+     */
+    void refund(uint8_t index, uint32_t chargedMs);
+
+    /**
+     * @brief Record a radio error
+     *
+     * @param index Transceiver
+     * @param now Current time
+     * @return true if the transceiver has just been taken out of service
+     */
+    bool reportFault(uint8_t index, uint32_t now);
+
+    /**
+     * @brief Check if a faulted transceiver is due to be re-initialized
+     *
+     * @param index Transceiver
+     * @param now Current time
+     */
+    bool isProbeDue(uint8_t index, uint32_t now) const;
+
+    /**
+     * @brief Record the outcome of re-initializing a faulted transceiver
+     *
+     * @param index Transceiver
+     * @param ok Whether it came back
+     * @param now Current time
+     */
+    void reportProbe(uint8_t index, bool ok, uint32_t now);
+
+    /**
+     * @brief Get the number of transceivers in service
+     */
+    uint8_t getHealthyCount() const;
+
+    /**
+     * @brief Get the duty-cycle budget of a transceiver
+     *
+     * @param index Transceiver
+     * @param budgetMs Output airtime per period
+     * @param periodMs Output period
+     * @return true if it has a limit
+     */
+    bool getDutyCycle(uint8_t index, uint32_t& budgetMs, uint32_t& periodMs) const;
+
+    /**
+     * @brief Get the statistics of a transceiver
+     *
+     * @param index Transceiver
+     */
+    const LoRaRadioStats& getStats(uint8_t index) const;
+
+private:
+    struct Radio {
+        LoRaAirtimeLimiter budget;
+        LoRaRadioStats stats;
+        uint32_t probeAt;
+        uint8_t consecutiveFaults;
+    };
+
+    Radio radios[LORA_MAX_RADIOS];
+    uint8_t count;
+    uint8_t lastUsed;
+};
+
+#endif // LORA_RADIO_POOL_H
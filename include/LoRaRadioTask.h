@@ -0,0 +1,429 @@
+#ifndef LORA_RADIO_TASK_H
+#define LORA_RADIO_TASK_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+#include "LoRaManager.h"
+#include "LoRaSpscQueue.h"
+#include "LoRaMpscQueue.h"
+
+// Threading backend: a FreeRTOS task on ESP32, std::thread on hosts
+#if defined(ESP32)
+#define LORA_RADIO_TASK_FREERTOS 1
+#elif !defined(ARDUINO)
+#define LORA_RADIO_TASK_STD_THREAD 1
+#include <thread>
+#endif
+
+// C++20 coroutine support for async operations, on hosts
+#if defined(__cpp_impl_coroutine) && !defined(ARDUINO)
+#define LORA_RADIO_TASK_COROUTINES 1
+#include <coroutine>
+#include <exception>
+#endif
+
+// Largest uplink or downlink payload carried through the queues
+#ifndef LORA_RADIO_TASK_MAX_PAYLOAD
+#define LORA_RADIO_TASK_MAX_PAYLOAD 128
+#endif
+
+// Queue depths (powers of two)
+#ifndef LORA_RADIO_TASK_QUEUE_SIZE
+#define LORA_RADIO_TASK_QUEUE_SIZE 8
+#endif
+
+// Preallocated slots for uplinks queued from interrupt handlers
+#ifndef LORA_RADIO_TASK_URGENT_SLOTS
+#define LORA_RADIO_TASK_URGENT_SLOTS 2
+#endif
+
+// Operations that can be tracked through LoRaAsyncHandle at once
+#ifndef LORA_ASYNC_POOL_SIZE
+#define LORA_ASYNC_POOL_SIZE 8
+#endif
+
+// Functions callable from interrupt handlers live in IRAM on ESP32
+#if defined(IRAM_ATTR)
+#define LORA_RADIO_TASK_ISR_ATTR IRAM_ATTR
+#else
+#define LORA_RADIO_TASK_ISR_ATTR
+#endif
+
+// How long the idle radio task sleeps between handleEvents() calls
+#define LORA_RADIO_TASK_IDLE_MS 10
+
+// Result types
+#define LORA_RADIO_RESULT_UPLINK   0   // an uplink request has finished
+#define LORA_RADIO_RESULT_DOWNLINK 1   // a downlink arrived
+#define LORA_RADIO_RESULT_JOIN     2   // a join request has finished
+
+// Request kinds
+#define LORA_RADIO_REQUEST_UPLINK 0
+#define LORA_RADIO_REQUEST_JOIN   1
+
+// Async operation states
+#define LORA_ASYNC_INVALID   0   // unknown or released handle
+#define LORA_ASYNC_PENDING   1   // queued
+#define LORA_ASYNC_RUNNING   2   // on the radio
+#define LORA_ASYNC_DONE      3   // finished successfully
+#define LORA_ASYNC_FAILED    4   // finished with an error
+#define LORA_ASYNC_CANCELLED 5   // cancelled before it started
+#define LORA_ASYNC_TIMED_OUT 6   // the timeout passed first
+
+// Slot value of requests that are not tracked by a handle
+#define LORA_ASYNC_NO_SLOT 0xFF
+
+/**
+ * @brief An uplink handed to the radio task
+ */
+struct LoRaUplinkRequest {
+    uint32_t id;
+    uint32_t submitUs;
+    uint8_t kind;          // LORA_RADIO_REQUEST_*
+    uint8_t slot;          // async pool slot, or LORA_ASYNC_NO_SLOT
+    uint16_t generation;   // async handle generation
+    uint8_t port;
+    bool confirmed;
+    uint8_t len;
+    uint8_t data[LORA_RADIO_TASK_MAX_PAYLOAD];
+};
+
+/**
+ * @brief A result returned by the radio task
+ */
+struct LoRaRadioResult {
+    uint8_t type;        // LORA_RADIO_RESULT_*
+    uint32_t id;         // request id (uplink results)
+    bool success;        // sendData() result (uplink results)
+    bool urgent;         // queued with enqueueFromIsr() (uplink results)
+    uint8_t state;       // LORA_ASYNC_* (async results)
+    int16_t errorCode;   // getLastErrorCode() after the uplink
+    float rssi;
+    float snr;
+    uint32_t startUs;    // submit to the start of the uplink (uplink results)
+    uint32_t latencyUs;  // submit to completion (uplink results)
+    uint8_t port;        // FPort (downlink results)
+    uint8_t len;         // payload length (downlink results)
+    uint8_t data[LORA_RADIO_TASK_MAX_PAYLOAD];
+};
+
+/**
+ * @brief Refers to an operation started with sendDataAsync() or joinAsync()
+ *
+ * A plain value; stale handles are detected through the generation.
+ */
+struct LoRaAsyncHandle {
+    uint8_t slot;
+    uint16_t generation;
+
+    bool isValid() const { return slot != LORA_ASYNC_NO_SLOT; }
+};
+
+// Called from dispatch() when an async operation finishes, times out or is cancelled
+typedef void (*LoRaAsyncCallback)(LoRaAsyncHandle handle, const LoRaRadioResult& result, void* context);
+
+/**
+ * @brief Radio task statistics
+ */
+struct LoRaRadioTaskStats {
+    uint32_t submitted;
+    uint32_t rejected;        // submit() found the request queue full
+    uint32_t completed;
+    uint32_t droppedResults;  // result queue full; oldest unread results win
+    uint32_t maxLatencyUs;
+    uint32_t urgentSubmitted;
+    uint32_t urgentRejected;  // all urgent slots were taken
+    uint32_t maxUrgentStartUs;  // worst enqueueFromIsr()-to-uplink-start time
+};
+
+/**
+ * @brief Runs a LoRaManager on a dedicated task
+ *
+ * While started, the task owns the manager: it performs all sendData() and
+ * handleEvents() calls, so the application thread never blocks on the radio.
+ * Uplinks go in through a lock-free multi-producer queue, so any number of
+ * threads may call submit() without ever blocking each other or waiting on
+ * the radio. Results and downlinks come back through a single-consumer queue,
+ * so exactly one thread may call poll().
+ * Downlinks are delivered through poll() instead of the downlink callback.
+ * 
+ * Interrupt handlers use enqueueFromIsr() instead, which copies into one of a
+ * few preallocated slots; the task sends those before anything in the normal
+ * queue.
+ *
+ * On ESP32 the task can be pinned to the core that does not run the sketch,
+ * so sensor acquisition is not stalled by RX windows.
+ */
+class LoRaRadioTask {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param manager Manager that has been initialized (begin(), credentials)
+     */
+    LoRaRadioTask(LoRaManager& manager);
+    ~LoRaRadioTask();
+
+    /**
+     * @brief Start the radio task
+     *
+     * @param core CPU core to pin the task to (ESP32 only)
+     * @param priority Task priority (ESP32 only)
+     * @param stackSize Task stack size in bytes (ESP32 only)
+     * @return true if the task is running
+     */
+    bool start(uint8_t core = 0, uint8_t priority = 5, uint32_t stackSize = 8192);
+
+    /**
+     * @brief Stop the task after the request in progress; queued requests are kept
+     */
+    void stop();
+
+    /**
+     * @brief Check if the task is running
+     */
+    bool isRunning() const;
+
+    /**
+     * @brief Queue an uplink (any thread)
+     *
+     * @param data Payload, copied into the queue
+     * @param len Length of payload, at most LORA_RADIO_TASK_MAX_PAYLOAD
+     * @param port FPort
+     * @param confirmed Whether to use confirmed transmission
+     * @return uint32_t Request id to match the result against, 0 if the queue is full
+     */
+    uint32_t submit(const uint8_t* data, size_t len, uint8_t port = 1, bool confirmed = false);
+
+    /**
+     * @brief Queue an urgent uplink from an interrupt handler
+     * 
+     * Wait-free and allocation-free: the payload is copied into a free slot
+     * out of LORA_RADIO_TASK_URGENT_SLOTS and the task is woken. The uplink
+     * goes out as soon as the one in progress finishes, ahead of every
+     * submit()ted request. Also safe from ordinary threads.
+     * 
+     * @param data Payload, copied into the slot
+     * @param len Length of payload, at most LORA_RADIO_TASK_MAX_PAYLOAD
+     * @param port FPort
+     * @param confirmed Whether to use confirmed transmission
+     * @return uint32_t Request id, 0 if all slots are taken
+     */
+    uint32_t enqueueFromIsr(const uint8_t* data, size_t len, uint8_t port = 1, bool confirmed = false);
+    
+    /**
+     * @brief Start an uplink tracked by a handle
+     * 
+     * The operation takes a slot from a fixed pool of LORA_ASYNC_POOL_SIZE;
+     * nothing is allocated. Its result is kept in the slot instead of going
+     * to poll(). Without a callback, poll the handle with getState() and
+     * free it with release(). With a callback, dispatch() calls it once and
+     * releases the handle itself.
+     * 
+     * @param data Payload, copied into the queue
+     * @param len Length of payload, at most LORA_RADIO_TASK_MAX_PAYLOAD
+     * @param port FPort
+     * @param confirmed Whether to use confirmed transmission
+     * @param timeoutMs Give up after this long, 0 for no timeout; an uplink
+     *        already on the radio still completes its RX windows
+     * @param callback Completion callback, or nullptr
+     * @param context Passed to the callback
+     * @return LoRaAsyncHandle Handle, invalid if the pool or the queue is full
+     */
+    LoRaAsyncHandle sendDataAsync(const uint8_t* data, size_t len, uint8_t port = 1, bool confirmed = false,
+                                  uint32_t timeoutMs = 0, LoRaAsyncCallback callback = nullptr,
+                                  void* context = nullptr);
+    
+    /**
+     * @brief Start a join tracked by a handle
+     * 
+     * @param timeoutMs Give up after this long, 0 for no timeout
+     * @param callback Completion callback, or nullptr
+     * @param context Passed to the callback
+     * @return LoRaAsyncHandle Handle, invalid if the pool or the queue is full
+     */
+    LoRaAsyncHandle joinAsync(uint32_t timeoutMs = 0, LoRaAsyncCallback callback = nullptr, void* context = nullptr);
+    
+    /**
+     * @brief Get the state of an async operation, applying its timeout
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     * @return uint8_t LORA_ASYNC_*
+     */
+    uint8_t getState(LoRaAsyncHandle handle);
+    
+    /**
+     * @brief Check if an async operation has reached a final state
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     * @return true if done, failed, cancelled, timed out or invalid
+     */
+    bool isDone(LoRaAsyncHandle handle);
+    
+    /**
+     * @brief Copy the result of a finished async operation
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     * @param result Output; state tells how the operation ended
+     * @return true if the operation has finished
+     */
+    bool getResult(LoRaAsyncHandle handle, LoRaRadioResult& result);
+    
+    /**
+     * @brief Cancel an async operation that has not started yet
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     * @return true if it was cancelled; false if it is already on the radio or finished
+     */
+    bool cancel(LoRaAsyncHandle handle);
+    
+    /**
+     * @brief Free the slot of an async operation
+     * 
+     * A queued operation is cancelled; one on the radio is forgotten and its
+     * slot is freed when it completes.
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     */
+    void release(LoRaAsyncHandle handle);
+    
+    /**
+     * @brief Apply timeouts, run callbacks and resume coroutines of finished operations
+     * 
+     * Call regularly from the thread that owns the handles (e.g. the loop).
+     */
+    void dispatch();
+    
+#if defined(LORA_RADIO_TASK_COROUTINES)
+    /**
+     * @brief Awaitable returned by wait()
+     */
+    struct Awaiter {
+        LoRaRadioTask& task;
+        LoRaAsyncHandle handle;
+
+        bool await_ready() { return task.isDone(handle); }
+        void await_suspend(std::coroutine_handle<> waiter) { task.setWaiter(handle, waiter.address()); }
+        LoRaRadioResult await_resume() {
+            LoRaRadioResult result;
+            task.getResult(handle, result);
+            task.release(handle);
+            return result;
+        }
+    };
+    
+    /**
+     * @brief Await an async operation in a C++20 coroutine
+     * 
+     * The coroutine is resumed from dispatch(), so it keeps running on the
+     * dispatching thread. The handle is released on resumption.
+     * 
+     * @param handle Handle from sendDataAsync() or joinAsync()
+     * @return Awaiter Use as co_await task.wait(handle)
+     */
+    Awaiter wait(LoRaAsyncHandle handle) { return Awaiter{*this, handle}; }
+#endif
+    
+    /**
+     * @brief Take the next result or downlink (consumer thread only)
+     *
+     * @param result Output
+     * @return true if a result was available
+     */
+    bool poll(LoRaRadioResult& result);
+
+    /**
+     * @brief Get the statistics
+     */
+    LoRaRadioTaskStats getStats() const;
+
+private:
+    // Async slot states; the state and the generation share one atomic word
+    static const uint8_t OP_FREE = 0;
+    static const uint8_t OP_CLAIMED = 1;         // being filled by the submitter
+    static const uint8_t OP_PENDING = 2;
+    static const uint8_t OP_RUNNING = 3;
+    static const uint8_t OP_EXPIRED = 4;         // running, but the timeout has passed
+    static const uint8_t OP_ORPHANED = 5;        // running, but released
+    static const uint8_t OP_DONE = 6;
+    static const uint8_t OP_FAILED = 7;
+    static const uint8_t OP_CANCELLED = 8;
+    static const uint8_t OP_TIMED_OUT = 9;
+
+    struct AsyncOp {
+        std::atomic<uint32_t> control;   // generation << 8 | state
+        uint32_t startMs;
+        uint32_t timeoutMs;
+        LoRaAsyncCallback callback;
+        void* context;
+        void* waiter;                    // suspended coroutine
+        bool notified;                   // callback or coroutine already run
+        LoRaRadioResult result;
+    };
+
+    // Urgent slot states
+    static const uint8_t SLOT_FREE = 0;
+    static const uint8_t SLOT_WRITING = 1;
+    static const uint8_t SLOT_READY = 2;
+    
+    struct UrgentSlot {
+        std::atomic<uint8_t> state;
+        LoRaUplinkRequest request;
+    };
+    
+    LoRaManager& manager;
+    UrgentSlot urgent[LORA_RADIO_TASK_URGENT_SLOTS];
+    AsyncOp ops[LORA_ASYNC_POOL_SIZE];
+
+    LoRaMpscQueue<LoRaUplinkRequest, LORA_RADIO_TASK_QUEUE_SIZE> requests;
+    LoRaSpscQueue<LoRaRadioResult, LORA_RADIO_TASK_QUEUE_SIZE> results;
+    std::atomic<bool> running;
+    std::atomic<bool> finished;
+    std::atomic<uint32_t> nextId;
+
+    // Request taken from the queue early so the manager can prepare it (task only)
+    LoRaUplinkRequest lookahead;
+    bool hasLookahead;
+
+    // Written by the producers, the task and the consumer respectively
+    std::atomic<uint32_t> submitted;
+    std::atomic<uint32_t> rejected;
+    std::atomic<uint32_t> completed;
+    std::atomic<uint32_t> droppedResults;
+    std::atomic<uint32_t> maxLatencyUs;
+    std::atomic<uint32_t> urgentSubmitted;
+    std::atomic<uint32_t> urgentRejected;
+    std::atomic<uint32_t> maxUrgentStartUs;
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+    void* taskHandle;
+#elif defined(LORA_RADIO_TASK_STD_THREAD)
+    std::thread thread;
+#endif
+
+    // Task whose queue receives downlinks from the manager's callback
+    static LoRaRadioTask* active;
+
+    static void taskEntry(void* param);
+    static void onDownlink(uint8_t* payload, size_t size, uint8_t port);
+    static uint32_t nowUs();
+    void run();
+    uint32_t submitRequest(LoRaUplinkRequest& request);
+    LoRaAsyncHandle startAsync(uint8_t kind, const uint8_t* data, size_t len, uint8_t port, bool confirmed,
+                               uint32_t timeoutMs, LoRaAsyncCallback callback, void* context);
+    bool claimAsync(const LoRaUplinkRequest& request);
+    void finishAsync(const LoRaUplinkRequest& request, const LoRaRadioResult& result);
+    uint8_t refreshState(LoRaAsyncHandle handle);
+    void setWaiter(LoRaAsyncHandle handle, void* waiter);
+    static uint32_t pack(uint16_t generation, uint8_t state) { return ((uint32_t)generation << 8) | state; }
+    bool takeNext(LoRaUplinkRequest& request);
+    bool hasUrgent() const;
+    uint8_t countQueued() const;
+    bool takeUrgent(LoRaUplinkRequest& request);
+    void process(const LoRaUplinkRequest& request, bool isUrgent);
+    void pushResult(const LoRaRadioResult& result);
+    void waitForWork();
+};
+
+#endif // LORA_RADIO_TASK_H
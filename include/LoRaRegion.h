@@ -0,0 +1,184 @@
+#ifndef LORA_REGION_H
+#define LORA_REGION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Band types, one per regional channel plan; BAND_TYPE_OTHER uses EU868-style defaults
+#define BAND_TYPE_OTHER   0
+#define BAND_TYPE_US915   1
+#define BAND_TYPE_EU868   2
+#define BAND_TYPE_AU915   3
+#define BAND_TYPE_AS923   4
+#define BAND_TYPE_AS923_2 5
+#define BAND_TYPE_AS923_3 6
+#define BAND_TYPE_AS923_4 7
+#define BAND_TYPE_KR920   8
+#define BAND_TYPE_IN865   9
+#define BAND_TYPE_CN470   10
+#define BAND_TYPE_EU433   11
+#define BAND_TYPE_COUNT   12
+
+// Data rates per region table entry (DR0-DR7); unused ones have maxPayload 0
+#define LORA_REGION_DATARATES 8
+
+/**
+ * @brief One uplink data rate of a regional channel plan
+ */
+struct LoRaDatarate {
+    uint8_t spreadingFactor;    // 0 for FSK
+    uint16_t bandwidth;         // kHz, or bit rate in kbps for FSK
+    uint8_t maxPayload;         // largest FRMPayload without FOpts, 0 if the data rate is not defined
+    uint8_t maxPayloadDwell;    // the same with the 400 ms dwell time in force, 0 if not allowed
+};
+
+/**
+ * @brief Regional parameters of a channel plan (LoRaWAN RP002-1.0.4)
+ *
+ * Duty cycle and EIRP are the plan's defaults; some sub-bands and
+ * countries are stricter. Dwell time is the regulatory limit per uplink
+ * where one applies, and dwellByDefault says whether the device starts
+ * with it in force (the network can change it with TxParamSetupReq).
+ */
+struct LoRaRegion {
+    const char* name;
+    uint32_t rx2Frequency;      // Hz
+    uint16_t dutyCycleFactor;   // 1 / duty cycle (100 for 1%), 0 if none
+    uint16_t dwellTimeMs;       // 0 if no dwell-time limit applies
+    uint8_t rx2Datarate;
+    uint8_t subBands;           // 8-channel sub-bands of a fixed plan (US915, AU915), 0 for dynamic plans
+    int8_t maxEirp;             // dBm
+    bool dwellByDefault;
+    LoRaDatarate datarates[LORA_REGION_DATARATES];
+};
+
+/**
+ * @brief Channel-plan tables and branch-free lookups
+ *
+ * Everything is constexpr data indexed by band type and data rate (masked
+ * to DR0-DR7), so lookups are plain table reads and can be evaluated at
+ * compile time. LoRaRegion.cpp checks every payload limit at build time.
+ */
+namespace LoRaRegions {
+
+#define LORA_DR(sf, bw, n, nDwell) { sf, bw, n, nDwell }
+#define LORA_DR_NONE               { 0, 0, 0, 0 }
+
+// EU868-style data rates: DR0-DR5 SF12-SF7 at 125 kHz, DR6 SF7 at 250 kHz, DR7 50 kbps FSK
+// (dwell-time payloads of DR0-DR1 are 0 in every such plan)
+#define LORA_DR_EU(n0, n3, n4, nDwell2, nDwell3, nDwell4, nDwell5)                         \
+    LORA_DR(12, 125, n0, 0), LORA_DR(11, 125, n0, 0), LORA_DR(10, 125, n0, nDwell2),       \
+    LORA_DR(9, 125, n3, nDwell3), LORA_DR(8, 125, n4, nDwell4), LORA_DR(7, 125, n4, nDwell5), \
+    LORA_DR(7, 250, n4, nDwell5), LORA_DR(0, 50, n4, nDwell5)
+
+constexpr LoRaRegion table[BAND_TYPE_COUNT] = {
+    // BAND_TYPE_OTHER: unknown plans are treated like EU868
+    { "Custom", 869525000UL, 100, 0, 0, 0, 16, false,
+      { LORA_DR_EU(51, 115, 222, 0, 0, 0, 0) } },
+    // BAND_TYPE_US915: DR0-DR3 SF10-SF7 at 125 kHz, DR4 SF8 at 500 kHz
+    { "US915", 923300000UL, 0, 400, 8, 8, 30, true,
+      { LORA_DR(10, 125, 11, 11), LORA_DR(9, 125, 53, 53), LORA_DR(8, 125, 125, 125), LORA_DR(7, 125, 242, 242),
+        LORA_DR(8, 500, 242, 242), LORA_DR_NONE, LORA_DR_NONE, LORA_DR_NONE } },
+    // BAND_TYPE_EU868
+    { "EU868", 869525000UL, 100, 0, 0, 0, 16, false,
+      { LORA_DR_EU(51, 115, 222, 0, 0, 0, 0) } },
+    // BAND_TYPE_AU915: DR0-DR5 SF12-SF7 at 125 kHz, DR6 SF8 at 500 kHz
+    { "AU915", 923300000UL, 0, 400, 8, 8, 30, false,
+      { LORA_DR(12, 125, 51, 0), LORA_DR(11, 125, 51, 0), LORA_DR(10, 125, 51, 11), LORA_DR(9, 125, 115, 53),
+        LORA_DR(8, 125, 242, 125), LORA_DR(7, 125, 242, 242), LORA_DR(8, 500, 242, 242), LORA_DR_NONE } },
+    // BAND_TYPE_AS923 and its frequency-offset variants
+    { "AS923", 923200000UL, 100, 400, 2, 0, 16, true,
+      { LORA_DR_EU(51, 115, 242, 11, 53, 125, 242) } },
+    { "AS923-2", 921400000UL, 100, 400, 2, 0, 16, true,
+      { LORA_DR_EU(51, 115, 242, 11, 53, 125, 242) } },
+    { "AS923-3", 916600000UL, 100, 400, 2, 0, 16, true,
+      { LORA_DR_EU(51, 115, 242, 11, 53, 125, 242) } },
+    { "AS923-4", 917300000UL, 100, 400, 2, 0, 16, true,
+      { LORA_DR_EU(51, 115, 242, 11, 53, 125, 242) } },
+    // BAND_TYPE_KR920: DR0-DR5 only; listen-before-talk instead of a duty cycle
+    { "KR920", 921900000UL, 0, 0, 0, 0, 14, false,
+      { LORA_DR(12, 125, 51, 0), LORA_DR(11, 125, 51, 0), LORA_DR(10, 125, 51, 0), LORA_DR(9, 125, 115, 0),
+        LORA_DR(8, 125, 222, 0), LORA_DR(7, 125, 222, 0), LORA_DR_NONE, LORA_DR_NONE } },
+    // BAND_TYPE_IN865: DR6 is reserved
+    { "IN865", 866550000UL, 0, 0, 2, 0, 30, false,
+      { LORA_DR(12, 125, 51, 0), LORA_DR(11, 125, 51, 0), LORA_DR(10, 125, 51, 0), LORA_DR(9, 125, 115, 0),
+        LORA_DR(8, 125, 222, 0), LORA_DR(7, 125, 222, 0), LORA_DR_NONE, LORA_DR(0, 50, 222, 0) } },
+    // BAND_TYPE_CN470: DR0-DR5 SF12-SF7 at 125 kHz
+    { "CN470", 505300000UL, 0, 0, 0, 0, 19, false,
+      { LORA_DR(12, 125, 51, 0), LORA_DR(11, 125, 51, 0), LORA_DR(10, 125, 51, 0), LORA_DR(9, 125, 115, 0),
+        LORA_DR(8, 125, 222, 0), LORA_DR(7, 125, 222, 0), LORA_DR_NONE, LORA_DR_NONE } },
+    // BAND_TYPE_EU433
+    { "EU433", 434665000UL, 100, 0, 0, 0, 12, false,
+      { LORA_DR_EU(51, 115, 222, 0, 0, 0, 0) } },
+};
+
+#undef LORA_DR_EU
+#undef LORA_DR_NONE
+#undef LORA_DR
+
+// Band type of each RadioLib band number (LoRaWANBandNum_t: EU868 = 1, US915, EU433, AU915,
+// CN470, AS923, AS923_2, AS923_3, AS923_4, KR920, IN865)
+constexpr uint8_t bandTypeByNum[] = {
+    BAND_TYPE_OTHER, BAND_TYPE_EU868, BAND_TYPE_US915, BAND_TYPE_EU433, BAND_TYPE_AU915, BAND_TYPE_CN470,
+    BAND_TYPE_AS923, BAND_TYPE_AS923_2, BAND_TYPE_AS923_3, BAND_TYPE_AS923_4, BAND_TYPE_KR920, BAND_TYPE_IN865,
+};
+
+/**
+ * @brief Get the band type of a RadioLib band number
+ *
+ * @param bandNum LoRaWANBand_t::bandNum
+ * @return uint8_t BAND_TYPE_* constant, BAND_TYPE_OTHER if unknown
+ */
+constexpr uint8_t bandType(uint8_t bandNum) {
+    return bandTypeByNum[bandNum < sizeof(bandTypeByNum) ? bandNum : 0];
+}
+
+/**
+ * @brief Get the parameters of a region
+ *
+ * @param bandType BAND_TYPE_* constant
+ */
+constexpr const LoRaRegion& get(uint8_t bandType) {
+    return table[bandType < BAND_TYPE_COUNT ? bandType : BAND_TYPE_OTHER];
+}
+
+/**
+ * @brief Get a data rate of a region
+ *
+ * @param bandType BAND_TYPE_* constant
+ * @param datarate Uplink data rate; values above DR7 read DR7
+ */
+constexpr const LoRaDatarate& datarate(uint8_t bandType, uint8_t datarate) {
+    return get(bandType).datarates[datarate < LORA_REGION_DATARATES ? datarate : LORA_REGION_DATARATES - 1];
+}
+
+/**
+ * @brief Get the largest FRMPayload of a data rate
+ *
+ * @param bandType BAND_TYPE_* constant
+ * @param datarate Uplink data rate
+ * @param dwell Whether the dwell time is in force
+ * @return size_t Bytes, 0 if the data rate does not exist
+ */
+constexpr size_t maxPayload(uint8_t bandType, uint8_t datarate, bool dwell = false) {
+    return datarate >= LORA_REGION_DATARATES ? 0 :
+           dwell ? LoRaRegions::datarate(bandType, datarate).maxPayloadDwell :
+                   LoRaRegions::datarate(bandType, datarate).maxPayload;
+}
+
+// Demodulation floor of each spreading factor in dB (SX126x/SX127x datasheets); FSK entries unused
+constexpr float snrFloor[13] = { 0, 0, 0, 0, 0, -2.5f, -5.0f, -7.5f, -10.0f, -12.5f, -15.0f, -17.5f, -20.0f };
+
+/**
+ * @brief Get the lowest SNR a spreading factor can be received at
+ *
+ * @param spreadingFactor 5-12
+ * @return float dB
+ */
+constexpr float requiredSnr(uint8_t spreadingFactor) {
+    return snrFloor[spreadingFactor < 13 ? spreadingFactor : 12];
+}
+
+} // namespace LoRaRegions
+
+#endif // LORA_REGION_H
@@ -0,0 +1,172 @@
+#ifndef LORA_RELAY_H
+#define LORA_RELAY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "LoRaPhy.h"
+
+// FPort on which forwarded frames travel between relay and network (as in LoRaWAN TS011)
+#define LORA_RELAY_FPORT 226
+
+// Largest end-device PHYPayload that is forwarded; it must fit the relay's own uplink
+#define LORA_RELAY_MAX_FRAME 64
+
+// Bytes of metadata in front of each forwarded frame
+#define LORA_RELAY_HEADER_LEN 2
+
+// Bounded buffers
+#define LORA_RELAY_MAX_CHILDREN 8
+#define LORA_RELAY_UPLINK_QUEUE 4
+#define LORA_RELAY_DOWNLINK_SLOTS 4
+
+/**
+ * @brief Relay configuration
+ */
+struct LoRaRelayConfig {
+    LoRaPhyConfig phy;            // channel the children transmit on
+    uint32_t cadPeriodMs;         // how often to run channel activity detection
+    uint32_t childRx1DelayMs;     // children's RX1 delay, for delivering downlinks
+    float childRx1Frequency;      // MHz, 0 to answer on the relay channel
+    uint16_t childUplinksPerHour; // sustained per-child forwarding rate
+    uint8_t childBurst;           // frames a child may send back to back
+};
+
+/**
+ * @brief Relay statistics
+ */
+struct LoRaRelayStats {
+    uint32_t received;
+    uint32_t forwarded;
+    uint32_t droppedRateLimit;
+    uint32_t droppedQueueFull;
+    uint32_t droppedInvalid;
+    uint32_t downlinksQueued;
+    uint32_t downlinksDelivered;
+};
+
+/**
+ * @brief Buffering and policy for forwarding end-device frames (relay role)
+ *
+ * In the style of LoRaWAN relay (TS011): frames heard from children on the
+ * relay channel are wrapped with their RSSI/SNR and sent as the relay's own
+ * uplinks on LORA_RELAY_FPORT. Downlinks the network sends back on that port
+ * hold a child's PHYPayload and are delivered in the child's RX1 window after
+ * its next uplink.
+ *
+ * Wrapped uplink:   [ -RSSI (dBm) | SNR * 4 (int8) | child PHYPayload ]
+ * Relayed downlink: [ child PHYPayload ]
+ *
+ * All storage is fixed; each child is rate limited with a token bucket. Radio
+ * access is done by LoRaManager, this class only holds the frames.
+ */
+class LoRaRelay {
+public:
+    LoRaRelay();
+
+    /**
+     * @brief Reset all buffers and apply a configuration
+     *
+     * @param config Relay configuration
+     */
+    void begin(const LoRaRelayConfig& config);
+
+    /**
+     * @brief Get the active configuration
+     */
+    const LoRaRelayConfig& getConfig() const;
+
+    /**
+     * @brief Offer a frame received from a child
+     *
+     * @param frame LoRaWAN PHYPayload
+     * @param len Length of frame
+     * @param rssi RSSI of the reception in dBm
+     * @param snr SNR of the reception in dB
+     * @param now Current time in milliseconds
+     * @return true if the frame was queued for forwarding
+     */
+    bool acceptUplink(const uint8_t* frame, size_t len, float rssi, float snr, uint32_t now);
+
+    /**
+     * @brief Check if there are frames waiting to be forwarded
+     */
+    bool hasPendingUplink() const;
+
+    /**
+     * @brief Copy the oldest wrapped frame without removing it
+     *
+     * @param out Output buffer of at least LORA_RELAY_HEADER_LEN + LORA_RELAY_MAX_FRAME bytes
+     * @return size_t Length of the wrapped frame, 0 if the queue is empty
+     */
+    size_t peekUplink(uint8_t* out) const;
+
+    /**
+     * @brief Remove the oldest wrapped frame after it has been forwarded
+     */
+    void popUplink();
+
+    /**
+     * @brief Store a downlink received from the network on LORA_RELAY_FPORT
+     *
+     * @param payload Child PHYPayload
+     * @param len Length of payload
+     * @return true if stored; an older downlink for the same child is replaced
+     */
+    bool acceptDownlink(const uint8_t* payload, size_t len);
+
+    /**
+     * @brief Take the pending downlink for a child, if any
+     *
+     * @param devAddr Child DevAddr
+     * @param out Output buffer of at least LORA_RELAY_MAX_FRAME bytes
+     * @return size_t Length of the downlink, 0 if none is pending
+     */
+    size_t takeDownlink(uint32_t devAddr, uint8_t* out);
+
+    /**
+     * @brief Get the DevAddr of an uplink PHYPayload
+     *
+     * @param frame LoRaWAN PHYPayload
+     * @param len Length of frame
+     * @param devAddr Output DevAddr
+     * @return true if the frame is a data uplink
+     */
+    static bool parseUplinkDevAddr(const uint8_t* frame, size_t len, uint32_t& devAddr);
+
+    /**
+     * @brief Get the relay statistics
+     */
+    const LoRaRelayStats& getStats() const;
+
+private:
+    struct Child {
+        uint32_t devAddr;
+        uint32_t lastRefill;
+        uint32_t lastSeen;
+        uint16_t tokensMilli;   // tokens * 1000
+        bool used;
+    };
+
+    struct QueuedFrame {
+        uint8_t len;
+        uint8_t data[LORA_RELAY_HEADER_LEN + LORA_RELAY_MAX_FRAME];
+    };
+
+    struct DownlinkSlot {
+        uint32_t devAddr;
+        uint8_t len;
+        uint8_t data[LORA_RELAY_MAX_FRAME];
+    };
+
+    LoRaRelayConfig config;
+    LoRaRelayStats stats;
+    Child children[LORA_RELAY_MAX_CHILDREN];
+    QueuedFrame uplinks[LORA_RELAY_UPLINK_QUEUE];
+    uint8_t uplinkHead;
+    uint8_t uplinkCount;
+    DownlinkSlot downlinks[LORA_RELAY_DOWNLINK_SLOTS];
+
+    bool consumeToken(uint32_t devAddr, uint32_t now);
+};
+
+#endif // LORA_RELAY_H
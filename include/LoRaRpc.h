@@ -0,0 +1,190 @@
+#ifndef LORA_RPC_H
+#define LORA_RPC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FPort reserved for commands and their responses; below 224, so end-to-end encryption covers it
+#ifndef LORA_RPC_FPORT
+#define LORA_RPC_FPORT 223
+#endif
+
+// Requests remembered for deduplication, which also bounds the responses waiting to be sent
+#define LORA_RPC_SLOTS 8
+
+// Largest response a handler can write
+#define LORA_RPC_MAX_RESULT 16
+
+// Methods that can have a handler
+#define LORA_RPC_MAX_HANDLERS 16
+
+// Bytes in front of each request and response: ID, method or status, length
+#define LORA_RPC_HEADER_LEN 3
+
+// Response statuses; handlers return LORA_RPC_OK or their own codes below LORA_RPC_ERR_UNKNOWN
+#define LORA_RPC_OK              0x00
+#define LORA_RPC_ERR_UNKNOWN     0xFF   // no handler for the method
+#define LORA_RPC_ERR_RESULT_SIZE 0xFE   // handler wrote more than LORA_RPC_MAX_RESULT bytes
+
+/**
+ * @brief A request's arguments, pointing into the received downlink
+ *
+ * Valid only for the duration of the handler call.
+ */
+struct LoRaRpcView {
+    const uint8_t* data;
+    uint8_t len;
+    uint8_t id;
+    uint8_t method;
+};
+
+/**
+ * @brief Command handler
+ *
+ * @param args Arguments (no copy)
+ * @param result Response buffer of LORA_RPC_MAX_RESULT bytes, written in place
+ * @param resultLen Output response length
+ * @return uint8_t Status, LORA_RPC_OK on success
+ */
+typedef uint8_t (*LoRaRpcHandler)(const LoRaRpcView& args, uint8_t* result, uint8_t& resultLen);
+
+/**
+ * @brief RPC statistics
+ */
+struct LoRaRpcStats {
+    uint32_t requests;      // requests executed
+    uint32_t duplicates;    // retransmitted requests not executed again
+    uint32_t unknown;       // requests without a handler
+    uint32_t malformed;     // truncated requests
+    uint32_t dropped;       // requests refused because every slot was waiting to send
+    uint32_t responses;     // responses sent
+    uint32_t resent;        // responses sent again for a duplicate request
+};
+
+/**
+ * @brief Round-trip statistics of one method
+ *
+ * Measured on the device, from the downlink carrying the request to the
+ * uplink carrying the response; the server adds the downlink latency.
+ */
+struct LoRaRpcMethodStats {
+    uint32_t calls;
+    uint32_t totalRttMs;
+    uint32_t maxRttMs;
+};
+
+/**
+ * @brief Command dispatch, deduplication and response queuing over one FPort
+ *
+ * Downlinks on LORA_RPC_FPORT carry one or more requests; responses are
+ * batched into uplinks on the same port:
+ *
+ * Request:  [ ID | method | length | arguments ]
+ * Response: [ ID | status | length | result ]
+ *
+ * IDs are chosen by the server and only need to differ between requests
+ * close in time. The last LORA_RPC_SLOTS requests are remembered (least
+ * recently used goes first): a retransmitted one is not executed again,
+ * its response is queued again instead if it has already been sent. The
+ * same slots hold the responses until they are sent, so nothing is
+ * allocated. Radio access is done by LoRaManager, this class only keeps
+ * the books. Times are millis() values.
+ */
+class LoRaRpc {
+public:
+    LoRaRpc();
+
+    /**
+     * @brief Register the handler of a method
+     *
+     * @param method Method number
+     * @param handler Handler, or nullptr to remove it
+     * @return false if LORA_RPC_MAX_HANDLERS methods are already registered
+     */
+    bool on(uint8_t method, LoRaRpcHandler handler);
+
+    /**
+     * @brief Execute the requests of a downlink
+     *
+     * @param payload Downlink FRMPayload on LORA_RPC_FPORT
+     * @param len Length of payload
+     * @param now Current time
+     * @return uint8_t Requests executed (duplicates excluded)
+     */
+    uint8_t acceptDownlink(const uint8_t* payload, size_t len, uint32_t now);
+
+    /**
+     * @brief Check if there are responses waiting to be sent
+     */
+    bool hasPendingResponse() const;
+
+    /**
+     * @brief Get the number of responses waiting to be sent
+     */
+    uint8_t getPendingCount() const;
+
+    /**
+     * @brief Pack waiting responses, oldest first, into an uplink
+     *
+     * The packed responses are held until confirmUplink().
+     *
+     * @param out Output buffer
+     * @param maxLen Largest uplink payload
+     * @return size_t Length of the uplink, 0 if nothing fits
+     */
+    size_t buildUplink(uint8_t* out, size_t maxLen);
+
+    /**
+     * @brief Report the outcome of the uplink from buildUplink()
+     *
+     * @param sent Whether it went out; if not, its responses wait for the next one
+     * @param now Current time
+     */
+    void confirmUplink(bool sent, uint32_t now);
+
+    /**
+     * @brief Get the RPC statistics
+     */
+    const LoRaRpcStats& getStats() const;
+
+    /**
+     * @brief Get the round-trip statistics of a method
+     *
+     * @param method Method number
+     * @param stats Output statistics
+     * @return true if the method has a handler
+     */
+    bool getMethodStats(uint8_t method, LoRaRpcMethodStats& stats) const;
+
+private:
+    struct Slot {
+        uint32_t receivedMs;
+        uint32_t lastUsed;      // LRU tick
+        uint8_t id;
+        uint8_t method;
+        uint8_t status;
+        uint8_t resultLen;
+        uint8_t state;
+        bool resend;            // queued again for a duplicate request
+        uint8_t result[LORA_RPC_MAX_RESULT];
+    };
+
+    struct Method {
+        LoRaRpcHandler handler;
+        LoRaRpcMethodStats stats;
+        uint8_t method;
+    };
+
+    Slot slots[LORA_RPC_SLOTS];
+    Method methods[LORA_RPC_MAX_HANDLERS];
+    LoRaRpcStats stats;
+    uint32_t tick;
+    uint8_t methodCount;
+
+    Slot* findSlot(uint8_t id);
+    Slot* takeSlot();
+    Method* findMethod(uint8_t method);
+    void execute(Slot& slot, const LoRaRpcView& args);
+};
+
+#endif // LORA_RPC_H
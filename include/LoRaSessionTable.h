@@ -0,0 +1,258 @@
+#ifndef LORA_SESSION_TABLE_H
+#define LORA_SESSION_TABLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <RadioLib.h>
+
+// Returned when there is no such session
+#define LORA_SESSION_NONE 0xFFFF
+
+// Join retries back off from this delay, doubling up to the cap
+#define LORA_SESSION_JOIN_BACKOFF_MS     15000UL
+#define LORA_SESSION_JOIN_BACKOFF_MAX_MS 3600000UL
+
+// Bytes RadioLib needs to restore one session
+#define LORA_SESSION_STATE_SIZE (RADIOLIB_LORAWAN_NONCES_BUF_SIZE + RADIOLIB_LORAWAN_SESSION_BUF_SIZE)
+
+/**
+ * @brief Where the RadioLib buffers of parked sessions are kept
+ *
+ * A session buffer is a few hundred bytes, so with many sessions it belongs
+ * in PSRAM or flash rather than in the session table. Implement this for
+ * the storage at hand; LoRaRamSessionStore keeps them in RAM.
+ */
+class LoRaSessionStore {
+public:
+    virtual ~LoRaSessionStore() {}
+
+    /**
+     * @brief Read back a parked session
+     *
+     * @param index Session
+     * @param nonces Output, RADIOLIB_LORAWAN_NONCES_BUF_SIZE bytes
+     * @param session Output, RADIOLIB_LORAWAN_SESSION_BUF_SIZE bytes
+     * @return true if the session was found
+     */
+    virtual bool load(uint16_t index, uint8_t* nonces, uint8_t* session) = 0;
+
+    /**
+     * @brief Park a session
+     *
+     * @param index Session
+     * @param nonces RADIOLIB_LORAWAN_NONCES_BUF_SIZE bytes
+     * @param session RADIOLIB_LORAWAN_SESSION_BUF_SIZE bytes
+     * @return true if stored
+     */
+    virtual bool save(uint16_t index, const uint8_t* nonces, const uint8_t* session) = 0;
+};
+
+/**
+ * @brief LoRaSessionStore in RAM
+ *
+ * @tparam N Number of sessions
+ */
+template <uint16_t N>
+class LoRaRamSessionStore : public LoRaSessionStore {
+public:
+    LoRaRamSessionStore() {
+        memset(valid, 0, sizeof(valid));
+    }
+
+    bool load(uint16_t index, uint8_t* nonces, uint8_t* session) override {
+        if (index >= N || (valid[index / 8] & (1 << (index % 8))) == 0) {
+            return false;
+        }
+        memcpy(nonces, state[index], RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
+        memcpy(session, &state[index][RADIOLIB_LORAWAN_NONCES_BUF_SIZE], RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
+        return true;
+    }
+
+    bool save(uint16_t index, const uint8_t* nonces, const uint8_t* session) override {
+        if (index >= N) {
+            return false;
+        }
+        memcpy(state[index], nonces, RADIOLIB_LORAWAN_NONCES_BUF_SIZE);
+        memcpy(&state[index][RADIOLIB_LORAWAN_NONCES_BUF_SIZE], session, RADIOLIB_LORAWAN_SESSION_BUF_SIZE);
+        valid[index / 8] |= (uint8_t)(1 << (index % 8));
+        return true;
+    }
+
+private:
+    uint8_t state[N][LORA_SESSION_STATE_SIZE];
+    uint8_t valid[(N + 7) / 8];
+};
+
+/**
+ * @brief Compact bookkeeping for many virtual LoRaWAN devices
+ *
+ * Holds what is needed to schedule sessions and route downlinks: DevAddr,
+ * next due time, uplink interval and join backoff, in a 20-byte slot per
+ * session. Credentials come from a callback and RadioLib buffers from a
+ * LoRaSessionStore, so neither takes table memory. DevAddr lookups go
+ * through a hash index. Storage is provided by the caller, usually through
+ * LoRaStaticSessionTable. Radio access is done by LoRaManager, this class
+ * only keeps the books. Times are millis() values.
+ */
+class LoRaSessionTable {
+public:
+    /**
+     * @brief One session
+     */
+    struct Slot {
+        uint32_t devAddr;       // 0 until joined
+        uint32_t dueMs;         // next uplink or join attempt
+        uint32_t uplinks;
+        uint16_t intervalS;     // uplink period, 0 for requestUplink() only
+        uint16_t nextInBucket;  // DevAddr index chain
+        uint8_t flags;
+        uint8_t failures;       // consecutive failed joins or uplinks
+    };
+
+    /**
+     * @brief Constructor
+     *
+     * @param slots Storage for capacity sessions
+     * @param buckets Storage for capacity DevAddr index heads
+     * @param capacity Number of sessions
+     */
+    LoRaSessionTable(Slot* slots, uint16_t* buckets, uint16_t capacity);
+
+    /**
+     * @brief Add a session, due at once
+     *
+     * @param intervalS Uplink period in seconds, 0 for requestUplink() only
+     * @param now Current time
+     * @return uint16_t Index, or LORA_SESSION_NONE if the table is full
+     */
+    uint16_t add(uint16_t intervalS, uint32_t now);
+
+    /**
+     * @brief Remove all sessions
+     */
+    void clear();
+
+    /**
+     * @brief Get the number of sessions
+     */
+    uint16_t size() const;
+
+    /**
+     * @brief Get the maximum number of sessions
+     */
+    uint16_t capacity() const;
+
+    /**
+     * @brief Get the session due first (earliest deadline)
+     *
+     * @param now Current time
+     * @return uint16_t Index, or LORA_SESSION_NONE if none is due
+     */
+    uint16_t next(uint32_t now) const;
+
+    /**
+     * @brief Get how long until a session is due
+     *
+     * @param now Current time
+     * @return uint32_t Milliseconds, 0 if one is due now, 0xFFFFFFFF if none is scheduled
+     */
+    uint32_t getWait(uint32_t now) const;
+
+    /**
+     * @brief Find the session of a DevAddr
+     *
+     * @param devAddr Device address
+     * @return uint16_t Index, or LORA_SESSION_NONE
+     */
+    uint16_t find(uint32_t devAddr) const;
+
+    /**
+     * @brief Make a session due now
+     *
+     * @param index Session
+     * @param now Current time
+     */
+    void requestUplink(uint16_t index, uint32_t now);
+
+    /**
+     * @brief Record a successful join
+     *
+     * @param index Session
+     * @param devAddr Device address assigned by the network
+     * @param now Current time
+     */
+    void markJoined(uint16_t index, uint32_t devAddr, uint32_t now);
+
+    /**
+     * @brief Record a sent uplink and schedule the next one
+     *
+     * @param index Session
+     * @param now Current time
+     */
+    void markSent(uint16_t index, uint32_t now);
+
+    /**
+     * @brief Schedule the next uplink without counting one, e.g. when there was nothing to send
+     *
+     * @param index Session
+     * @param now Current time
+     */
+    void reschedule(uint16_t index, uint32_t now);
+
+    /**
+     * @brief Record a failed join or uplink and back off
+     *
+     * @param index Session
+     * @param now Current time
+     */
+    void markFailed(uint16_t index, uint32_t now);
+
+    /**
+     * @brief Forget a session's join, e.g. when its parked state is lost
+     *
+     * @param index Session
+     * @param now Current time
+     */
+    void markLost(uint16_t index, uint32_t now);
+
+    /**
+     * @brief Check if a session has joined
+     *
+     * @param index Session
+     */
+    bool isJoined(uint16_t index) const;
+
+    /**
+     * @brief Get a session's slot, e.g. for its DevAddr and counters
+     *
+     * @param index Session
+     */
+    const Slot& getSlot(uint16_t index) const;
+
+private:
+    Slot* slots;
+    uint16_t* buckets;
+    uint16_t slotCount;
+    uint16_t count;
+
+    uint16_t bucketOf(uint32_t devAddr) const;
+    void unlink(uint16_t index);
+};
+
+/**
+ * @brief LoRaSessionTable with its own storage
+ *
+ * @tparam N Number of sessions
+ */
+template <uint16_t N>
+class LoRaStaticSessionTable : public LoRaSessionTable {
+public:
+    LoRaStaticSessionTable() : LoRaSessionTable(storage, index, N) {}
+
+private:
+    Slot storage[N];
+    uint16_t index[N];
+};
+
+#endif // LORA_SESSION_TABLE_H
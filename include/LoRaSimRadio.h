@@ -0,0 +1,176 @@
+#ifndef LORA_SIM_RADIO_H
+#define LORA_SIM_RADIO_H
+
+// Simulated radio for host builds (Linux, macOS); not available on Arduino targets
+#if !defined(ARDUINO)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <mutex>
+#include <RadioLib.h>
+#include "LoRaRadioDriver.h"
+
+// Largest simulated frame
+#define LORA_SIM_MAX_FRAME 255
+
+// Frames remembered by a channel; older ones are overwritten
+#define LORA_SIM_HISTORY 32
+
+// How long receive() listens before giving up, by default
+#define LORA_SIM_RX_TIMEOUT_MS 100
+
+class LoRaSimRadio;
+
+/**
+ * @brief The shared air between simulated radios in one process
+ *
+ * A frame is heard by every other radio tuned to the same frequency,
+ * modulation, sync word and IQ polarity, from the moment it is sent until
+ * its time on air has passed. Frames can be dropped at random to test
+ * retransmission logic.
+ */
+class LoRaSimChannel {
+public:
+    /**
+     * @brief Constructor
+     *
+     * @param lossPercent Chance of a frame being lost for each receiver
+     * @param seed Seed of the loss generator, for repeatable runs
+     */
+    LoRaSimChannel(uint8_t lossPercent = 0, uint32_t seed = 1);
+
+    /**
+     * @brief Set the loss rate
+     *
+     * @param lossPercent Chance of a frame being lost for each receiver
+     */
+    void setLossPercent(uint8_t lossPercent);
+
+    /**
+     * @brief Set the link quality reported to receivers
+     *
+     * @param rssi RSSI in dBm
+     * @param snr SNR in dB
+     */
+    void setLinkQuality(float rssi, float snr);
+
+    /**
+     * @brief Get the number of frames sent so far
+     */
+    uint32_t getFramesSent() const;
+
+private:
+    friend class LoRaSimRadio;
+
+    struct Frame {
+        uint32_t seq;
+        uint32_t key;        // modulation settings the frame can be heard on
+        uint16_t sender;
+        uint32_t airEndMs;
+        uint8_t len;
+        uint8_t data[LORA_SIM_MAX_FRAME];
+    };
+
+    mutable std::mutex lock;
+    Frame frames[LORA_SIM_HISTORY];
+    uint32_t nextSeq;
+    uint16_t nextRadioId;
+    uint8_t lossPercent;
+    uint32_t randomState;
+    float rssi;
+    float snr;
+
+    uint16_t attach();
+    void send(uint16_t sender, uint32_t key, uint32_t airtimeMs, const uint8_t* data, size_t len);
+    bool find(uint16_t receiver, uint32_t key, uint32_t afterSeq, uint32_t notBeforeMs, Frame& frame);
+};
+
+/**
+ * @brief A radio on a LoRaSimChannel
+ *
+ * Implements the RadioLib calls LoRaManager uses for raw PHY work (P2P,
+ * bulk transfers, relay), so those features can run and be tested on a
+ * host. The LoRaWAN stack needs a real radio.
+ */
+class LoRaSimRadio : public PhysicalLayer {
+public:
+    explicit LoRaSimRadio(LoRaSimChannel& channel);
+
+    int16_t transmit(const uint8_t* data, size_t len, uint8_t addr = 0) override;
+    int16_t receive(uint8_t* data, size_t len) override;
+    size_t getPacketLength(bool update = true) override;
+    int16_t standby() override;
+    int16_t sleep() override;
+    int16_t setFrequency(float freq) override;
+    int16_t setOutputPower(int8_t power) override;
+    float getRSSI() override;
+    float getSNR() override;
+    RadioLibTime_t getTimeOnAir(size_t len) override;
+    int16_t scanChannel() override;
+
+    // Chip-style setters used by LoRaRadioDriverBase
+    int16_t setBandwidth(float bw);
+    int16_t setSpreadingFactor(uint8_t sf);
+    int16_t setCodingRate(uint8_t cr);
+    int16_t setSyncWord(uint8_t syncWord);
+    int16_t setPreambleLength(size_t symbols);
+    int16_t invertIQ(bool enable);
+
+    /**
+     * @brief Switch to LoRa with default settings
+     */
+    int16_t beginLoRa();
+
+    /**
+     * @brief Switch to FSK
+     *
+     * @param freq Frequency in MHz
+     * @param bitRate Bit rate in kbps
+     */
+    int16_t beginFsk(float freq, float bitRate);
+
+    /**
+     * @brief Set how long receive() listens before timing out
+     *
+     * @param timeoutMs Timeout in milliseconds
+     */
+    void setRxTimeout(uint32_t timeoutMs);
+
+private:
+    LoRaSimChannel& channel;
+    uint16_t id;
+    bool fsk;
+    float frequency;
+    float bandwidth;
+    float bitRate;
+    uint8_t spreadingFactor;
+    uint8_t codingRate;
+    uint8_t syncWord;
+    uint16_t preambleLength;
+    bool iqInverted;
+    uint32_t rxTimeoutMs;
+    uint32_t lastSeq;
+    uint8_t lastLen;
+
+    uint32_t getKey() const;
+};
+
+/**
+ * @brief LoRaRadioDriver for a simulated radio
+ */
+class LoRaSimDriver : public LoRaRadioDriverBase<LoRaSimRadio, LoRaSimDriver> {
+public:
+    explicit LoRaSimDriver(LoRaSimChannel& channel);
+
+    const char* getName() const override { return "Sim"; }
+    LoRaSimRadio& getChip() { return radio; }
+    int beginChip() { return radio.beginLoRa(); }
+    int beginFsk(const LoRaPhyConfig& config) { return radio.beginFsk(config.frequency, config.bitRate); }
+
+private:
+    LoRaSimRadio radio;
+};
+
+#endif // !ARDUINO
+
+#endif // LORA_SIM_RADIO_H
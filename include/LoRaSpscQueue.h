@@ -0,0 +1,83 @@
+#ifndef LORA_SPSC_QUEUE_H
+#define LORA_SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * @brief Lock-free single-producer/single-consumer ring buffer
+ *
+ * Exactly one thread may push and exactly one thread may pop. Items are
+ * copied in and out of a fixed array, so nothing is allocated. Head and tail
+ * are free-running counters on separate cache lines; the producer publishes
+ * an item with a release store that the consumer's acquire load pairs with.
+ *
+ * @tparam T Item type (copied with operator=)
+ * @tparam N Capacity, a power of two
+ */
+template <typename T, size_t N>
+class LoRaSpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "LoRaSpscQueue capacity must be a power of two");
+
+public:
+    LoRaSpscQueue() : head(0), tail(0) {}
+
+    /**
+     * @brief Add an item (producer side)
+     *
+     * @param item Item to copy in
+     * @return false if the queue is full
+     */
+    bool push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Remove the oldest item (consumer side)
+     *
+     * @param item Output
+     * @return false if the queue is empty
+     */
+    bool pop(T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Check if the queue is empty (exact only on the consumer side)
+     */
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the number of queued items (a snapshot when called from a third thread)
+     */
+    size_t size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the capacity
+     */
+    static constexpr size_t capacity() { return N; }
+
+private:
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    T items[N];
+};
+
+#endif // LORA_SPSC_QUEUE_H
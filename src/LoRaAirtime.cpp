@@ -0,0 +1,236 @@
+#include "LoRaAirtime.h"
+#include <string.h>
+
+namespace LoRaAirtime {
+
+// Time on air of a LoRa packet
+uint32_t loraUs(size_t phyLen, uint8_t spreadingFactor, float bandwidth, uint8_t codingRate,
+                uint16_t preambleLength, bool explicitHeader, bool crc) {
+  if (bandwidth <= 0 || spreadingFactor < 5 || spreadingFactor > 12) {
+    return 0;
+  }
+
+  // Symbol time in µs; low data rate optimization kicks in from 16 ms symbols
+  float symbolUs = (float)(1UL << spreadingFactor) * 1000.0f / bandwidth;
+  int lowDatarate = symbolUs >= 16000.0f ? 1 : 0;
+
+  // SF5 and SF6 need two extra symbols and skip the header term (SX126x)
+  int sf = spreadingFactor;
+  int bits = 8 * (int)phyLen - 4 * sf + (sf >= 7 ? 8 : 0) + (crc ? 16 : 0) + (explicitHeader ? 20 : 0);
+  int divisor = 4 * (sf - 2 * lowDatarate);
+  int payloadSymbols = 0;
+  if (bits > 0) {
+    payloadSymbols = ((bits + divisor - 1) / divisor) * codingRate;
+  }
+
+  float preambleSymbols = preambleLength + (sf >= 7 ? 4.25f : 6.25f);
+  float totalSymbols = preambleSymbols + 8 + payloadSymbols;
+  return (uint32_t)(totalSymbols * symbolUs + 0.5f);
+}
+
+// Time on air of an FSK packet with LoRaWAN framing
+uint32_t fskUs(size_t phyLen, float bitRate) {
+  if (bitRate <= 0) {
+    return 0;
+  }
+  size_t bytes = 5 + 3 + 1 + phyLen + 2;
+  return (uint32_t)(bytes * 8 * 1000.0f / bitRate + 0.5f);
+}
+
+// Shortest interval at which frames of a given airtime can be sent forever
+uint32_t sustainableIntervalMs(uint32_t airtimeMs, uint16_t dutyCycleFactor, uint32_t budgetMs, uint32_t periodMs) {
+  uint64_t interval = airtimeMs;
+  if (dutyCycleFactor > 0) {
+    uint64_t dutyCycleInterval = (uint64_t)airtimeMs * dutyCycleFactor;
+    interval = dutyCycleInterval > interval ? dutyCycleInterval : interval;
+  }
+  if (budgetMs > 0) {
+    uint64_t budgetInterval = ((uint64_t)airtimeMs * periodMs + budgetMs - 1) / budgetMs;
+    interval = budgetInterval > interval ? budgetInterval : interval;
+  }
+  return interval > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)interval;
+}
+
+} // namespace LoRaAirtime
+
+// Constructor
+LoRaAirtimeLimiter::LoRaAirtimeLimiter() {
+  memset(&global, 0, sizeof(global));
+  memset(ports, 0, sizeof(ports));
+}
+
+// Set up a bucket, starting full
+void LoRaAirtimeLimiter::configure(Bucket& bucket, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now) {
+  bucket.enabled = budgetMs > 0 && periodMs > 0;
+  bucket.budgetMs = budgetMs;
+  bucket.periodMs = periodMs;
+  uint64_t capacity = (uint64_t)(burstMs > 0 ? burstMs : budgetMs) * 1000;
+  bucket.capacityUs = (uint32_t)(capacity > 0xFFFFFFFFULL ? 0xFFFFFFFFULL : capacity);
+  bucket.tokensUs = bucket.capacityUs;
+  bucket.lastRefill = now;
+  bucket.remainder = 0;
+}
+
+// Credit the airtime earned since the last refill, keeping the fraction
+void LoRaAirtimeLimiter::refill(Bucket& bucket, uint32_t now) {
+  uint32_t elapsed = now - bucket.lastRefill;
+  bucket.lastRefill = now;
+  if (bucket.tokensUs >= bucket.capacityUs) {
+    bucket.remainder = 0;
+    return;
+  }
+
+  uint64_t earned = (uint64_t)elapsed * bucket.budgetMs * 1000 + bucket.remainder;
+  uint64_t creditUs = earned / bucket.periodMs;
+  bucket.remainder = earned % bucket.periodMs;
+
+  bucket.tokensUs += (int64_t)creditUs;
+  if (bucket.tokensUs >= bucket.capacityUs) {
+    bucket.tokensUs = bucket.capacityUs;
+    bucket.remainder = 0;
+  }
+}
+
+// Milliseconds until a bucket holds the given airtime; the refill is worked out on a copy
+uint32_t LoRaAirtimeLimiter::waitFor(const Bucket& bucket, uint32_t airtimeUs, uint32_t now) {
+  if (!bucket.enabled) {
+    return 0;
+  }
+  if (airtimeUs > bucket.capacityUs) {
+    return LORA_AIRTIME_NEVER;
+  }
+  Bucket current = bucket;
+  refill(current, now);
+  if (current.tokensUs >= airtimeUs) {
+    return 0;
+  }
+
+  uint64_t missing = (uint64_t)((int64_t)airtimeUs - current.tokensUs) * current.periodMs;
+  missing = missing > current.remainder ? missing - current.remainder : 0;
+  uint64_t perMs = (uint64_t)bucket.budgetMs * 1000;
+  uint64_t wait = (missing + perMs - 1) / perMs;
+  return wait >= LORA_AIRTIME_NEVER ? LORA_AIRTIME_NEVER - 1 : (uint32_t)wait;
+}
+
+// Find the bucket of a port, if it has one
+const LoRaAirtimeLimiter::Bucket* LoRaAirtimeLimiter::findPort(uint8_t port) const {
+  for (uint8_t i = 0; i < LORA_AIRTIME_MAX_PORT_LIMITS; i++) {
+    if (ports[i].enabled && ports[i].port == port) {
+      return &ports[i];
+    }
+  }
+  return nullptr;
+}
+
+LoRaAirtimeLimiter::Bucket* LoRaAirtimeLimiter::findPort(uint8_t port) {
+  return const_cast<Bucket*>(static_cast<const LoRaAirtimeLimiter*>(this)->findPort(port));
+}
+
+// Limit the airtime of all ports together
+void LoRaAirtimeLimiter::setGlobalLimit(uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now) {
+  configure(global, budgetMs, periodMs, burstMs, now);
+}
+
+// Limit the airtime of one port
+bool LoRaAirtimeLimiter::setPortLimit(uint8_t port, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs, uint32_t now) {
+  if (port == LORA_AIRTIME_GLOBAL_ONLY) {
+    return false;
+  }
+  Bucket* bucket = findPort(port);
+  if (bucket == nullptr) {
+    if (budgetMs == 0) {
+      return true;
+    }
+    for (uint8_t i = 0; i < LORA_AIRTIME_MAX_PORT_LIMITS && bucket == nullptr; i++) {
+      if (!ports[i].enabled) {
+        bucket = &ports[i];
+      }
+    }
+    if (bucket == nullptr) {
+      return false;
+    }
+  }
+  configure(*bucket, budgetMs, periodMs, burstMs, now);
+  bucket->port = port;
+  return true;
+}
+
+// Get how long to wait before a frame may be sent
+uint32_t LoRaAirtimeLimiter::getWait(uint8_t port, uint32_t airtimeMs, uint32_t now) const {
+  uint32_t airtimeUs = airtimeMs * 1000;
+  uint32_t wait = waitFor(global, airtimeUs, now);
+  const Bucket* bucket = findPort(port);
+  if (bucket != nullptr) {
+    uint32_t portWait = waitFor(*bucket, airtimeUs, now);
+    if (portWait > wait) {
+      wait = portWait;
+    }
+  }
+  return wait;
+}
+
+// Charge a frame if the budgets allow it
+bool LoRaAirtimeLimiter::tryConsume(uint8_t port, uint32_t airtimeMs, uint32_t now) {
+  if (getWait(port, airtimeMs, now) != 0) {
+    return false;
+  }
+  consume(port, airtimeMs, now);
+  return true;
+}
+
+// Charge a frame whatever the budgets; the stored buckets catch up first
+void LoRaAirtimeLimiter::consume(uint8_t port, uint32_t airtimeMs, uint32_t now) {
+  if (global.enabled) {
+    refill(global, now);
+  }
+  Bucket* bucket = findPort(port);
+  if (bucket != nullptr) {
+    refill(*bucket, now);
+  }
+  adjust(port, (int32_t)airtimeMs);
+}
+
+// Correct an earlier charge once the real airtime is known
+void LoRaAirtimeLimiter::adjust(uint8_t port, int32_t deltaMs) {
+  Bucket* buckets[2] = {&global, findPort(port)};
+  for (uint8_t i = 0; i < 2; i++) {
+    Bucket* bucket = buckets[i];
+    if (bucket == nullptr || !bucket->enabled) {
+      continue;
+    }
+    // Overruns are kept as debt rather than lost; refunds stop at the burst size
+    bucket->tokensUs -= (int64_t)deltaMs * 1000;
+    if (bucket->tokensUs > bucket->capacityUs) {
+      bucket->tokensUs = bucket->capacityUs;
+    }
+  }
+}
+
+// Get the airtime left in the global bucket
+uint32_t LoRaAirtimeLimiter::getGlobalAvailable(uint32_t now) const {
+  if (!global.enabled) {
+    return LORA_AIRTIME_NEVER;
+  }
+  Bucket current = global;
+  refill(current, now);
+  return current.tokensUs > 0 ? (uint32_t)(current.tokensUs / 1000) : 0;
+}
+
+// Get the configured global budget
+bool LoRaAirtimeLimiter::getGlobalLimit(uint32_t& budgetMs, uint32_t& periodMs) const {
+  budgetMs = global.budgetMs;
+  periodMs = global.periodMs;
+  return global.enabled;
+}
+
+// Get the configured budget of a port
+bool LoRaAirtimeLimiter::getPortLimit(uint8_t port, uint32_t& budgetMs, uint32_t& periodMs) const {
+  for (uint8_t i = 0; i < LORA_AIRTIME_MAX_PORT_LIMITS; i++) {
+    if (ports[i].enabled && ports[i].port == port) {
+      budgetMs = ports[i].budgetMs;
+      periodMs = ports[i].periodMs;
+      return true;
+    }
+  }
+  return false;
+}
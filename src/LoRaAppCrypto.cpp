@@ -0,0 +1,183 @@
+#include "LoRaAppCrypto.h"
+#include <string.h>
+
+namespace LoRaAppCrypto {
+
+// Largest payload handled in one call (LoRaWAN FRMPayload limit plus margin)
+#define CCM_MAX_LEN 256
+
+// Build the CCM nonce for a frame
+void buildNonce(uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t* nonce) {
+  nonce[0] = dir;
+  for (uint8_t i = 0; i < 8; i++) {
+    nonce[1 + i] = (uint8_t)(devEUI >> (56 - 8 * i));
+  }
+  nonce[9] = (uint8_t)(fCnt >> 24);
+  nonce[10] = (uint8_t)(fCnt >> 16);
+  nonce[11] = (uint8_t)(fCnt >> 8);
+  nonce[12] = (uint8_t)fCnt;
+}
+
+// Build the session key derivation block, fields LSB first as in LoRaWAN
+void buildSessionBlock(uint32_t joinNonce, uint64_t joinEUI, uint16_t devNonce, uint8_t* block) {
+  memset(block, 0, 16);
+  block[0] = LORA_APP_CRYPTO_KEY_TYPE;
+  for (uint8_t i = 0; i < 3; i++) {
+    block[1 + i] = (uint8_t)(joinNonce >> (8 * i));
+  }
+  for (uint8_t i = 0; i < 8; i++) {
+    block[4 + i] = (uint8_t)(joinEUI >> (8 * i));
+  }
+  block[12] = (uint8_t)devNonce;
+  block[13] = (uint8_t)(devNonce >> 8);
+}
+
+// Get the session key of a join; the provider derives it once and caches it
+LoRaKeyHandle sessionKey(LoRaKeyProvider& keys, uint32_t joinNonce, uint64_t joinEUI, uint16_t devNonce) {
+  uint8_t block[16];
+  buildSessionBlock(joinNonce, joinEUI, devNonce, block);
+  return keys.getSessionKey(LORA_KEY_HANDLE_E2E_KEY, block);
+}
+
+// CBC-MAC over B0, the associated data and the plaintext
+static bool cbcMac(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                   const uint8_t* aad, size_t aadLen, const uint8_t* data, size_t len,
+                   uint8_t tagLen, uint8_t* mac) {
+  uint8_t x[16];
+
+  // B0: flags (Adata, M', L'), nonce, message length
+  x[0] = (uint8_t)((aadLen > 0 ? 0x40 : 0x00) | (((tagLen - 2) / 2) << 3) | 0x01);
+  memcpy(&x[1], nonce, LORA_APP_CRYPTO_NONCE_LEN);
+  x[14] = (uint8_t)(len >> 8);
+  x[15] = (uint8_t)len;
+  if (!keys.encryptBlock(key, x, x)) {
+    return false;
+  }
+
+  // Associated data fits a single block together with its 2-byte length
+  if (aadLen > 0) {
+    x[0] ^= (uint8_t)(aadLen >> 8);
+    x[1] ^= (uint8_t)aadLen;
+    for (size_t i = 0; i < aadLen; i++) {
+      x[2 + i] ^= aad[i];
+    }
+    if (!keys.encryptBlock(key, x, x)) {
+      return false;
+    }
+  }
+
+  for (size_t pos = 0; pos < len; pos += 16) {
+    size_t chunk = (len - pos < 16) ? len - pos : 16;
+    for (size_t i = 0; i < chunk; i++) {
+      x[i] ^= data[pos + i];
+    }
+    if (!keys.encryptBlock(key, x, x)) {
+      return false;
+    }
+  }
+
+  memcpy(mac, x, 16);
+  return true;
+}
+
+// CTR keystream: S0 (for the tag) followed by S1.. (for the payload), XORed in place
+static bool ctrCrypt(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                     uint8_t* data, size_t len, uint8_t* tag, uint8_t tagLen) {
+  uint8_t counters[CCM_MAX_LEN + 16];
+  size_t blocks = 1 + (len + 15) / 16;
+  for (size_t b = 0; b < blocks; b++) {
+    uint8_t* a = &counters[b * 16];
+    a[0] = 0x01;
+    memcpy(&a[1], nonce, LORA_APP_CRYPTO_NONCE_LEN);
+    a[14] = (uint8_t)(b >> 8);
+    a[15] = (uint8_t)b;
+  }
+
+  // All counter blocks are independent, so the provider can batch them
+  if (!keys.encryptBlocks(key, counters, counters, blocks)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < tagLen; i++) {
+    tag[i] ^= counters[i];
+  }
+  for (size_t i = 0; i < len; i++) {
+    data[i] ^= counters[16 + i];
+  }
+  LoRaKeyProvider::wipe(counters, blocks * 16);
+  return true;
+}
+
+// Generic AES-CCM encryption
+bool ccmEncrypt(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len,
+                uint8_t* out, uint8_t tagLen) {
+  if (len > CCM_MAX_LEN || aadLen > 14 || tagLen < 4 || tagLen > 16 || (tagLen & 1)) {
+    return false;
+  }
+
+  uint8_t mac[16];
+  if (!cbcMac(keys, key, nonce, aad, aadLen, in, len, tagLen, mac)) {
+    return false;
+  }
+
+  memmove(out, in, len);
+  if (!ctrCrypt(keys, key, nonce, out, len, mac, tagLen)) {
+    return false;
+  }
+  memcpy(&out[len], mac, tagLen);
+  return true;
+}
+
+// Generic AES-CCM decryption and tag verification
+bool ccmDecrypt(LoRaKeyProvider& keys, LoRaKeyHandle key, const uint8_t* nonce,
+                const uint8_t* aad, size_t aadLen, const uint8_t* in, size_t len,
+                uint8_t* out, uint8_t tagLen) {
+  if (len < tagLen || len - tagLen > CCM_MAX_LEN || aadLen > 14 || tagLen < 4 || tagLen > 16 || (tagLen & 1)) {
+    return false;
+  }
+  size_t dataLen = len - tagLen;
+
+  uint8_t receivedTag[16];
+  memcpy(receivedTag, &in[dataLen], tagLen);
+  memmove(out, in, dataLen);
+
+  // Decrypting also unmasks the received tag
+  if (!ctrCrypt(keys, key, nonce, out, dataLen, receivedTag, tagLen)) {
+    return false;
+  }
+
+  uint8_t mac[16];
+  if (!cbcMac(keys, key, nonce, aad, aadLen, out, dataLen, tagLen, mac)) {
+    return false;
+  }
+
+  // Constant-time comparison
+  uint8_t diff = 0;
+  for (uint8_t i = 0; i < tagLen; i++) {
+    diff |= (uint8_t)(mac[i] ^ receivedTag[i]);
+  }
+  if (diff != 0) {
+    LoRaKeyProvider::wipe(out, dataLen);
+    return false;
+  }
+  return true;
+}
+
+// Encrypt an application payload for the given frame
+bool seal(LoRaKeyProvider& keys, LoRaKeyHandle key, uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t port,
+          const uint8_t* in, size_t len, uint8_t* out) {
+  uint8_t nonce[LORA_APP_CRYPTO_NONCE_LEN];
+  buildNonce(dir, devEUI, fCnt, nonce);
+  return ccmEncrypt(keys, key, nonce, &port, 1, in, len, out, LORA_APP_CRYPTO_TAG_LEN);
+}
+
+// Verify and decrypt an application payload from the given frame
+bool open(LoRaKeyProvider& keys, LoRaKeyHandle key, uint8_t dir, uint64_t devEUI, uint32_t fCnt, uint8_t port,
+          const uint8_t* in, size_t len, uint8_t* out) {
+  uint8_t nonce[LORA_APP_CRYPTO_NONCE_LEN];
+  buildNonce(dir, devEUI, fCnt, nonce);
+  return ccmDecrypt(keys, key, nonce, &port, 1, in, len, out, LORA_APP_CRYPTO_TAG_LEN);
+}
+
+} // namespace LoRaAppCrypto
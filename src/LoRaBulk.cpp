@@ -0,0 +1,296 @@
+#include "LoRaBulk.h"
+#include <string.h>
+
+// Frame types (high nibble of the first byte)
+#define FRAME_START 0x10
+#define FRAME_DATA  0x20
+#define FRAME_ACK   0x30
+#define FRAME_TYPE_MASK 0xF0
+#define FLAG_ACK_REQUEST 0x01
+
+#define START_FRAME_LEN 8
+#define ACK_FRAME_LEN   8
+
+// Big-endian helpers
+static void put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)(value >> 8);
+  out[1] = (uint8_t)value;
+}
+
+static void put32(uint8_t* out, uint32_t value) {
+  out[0] = (uint8_t)(value >> 24);
+  out[1] = (uint8_t)(value >> 16);
+  out[2] = (uint8_t)(value >> 8);
+  out[3] = (uint8_t)value;
+}
+
+static uint16_t get16(const uint8_t* in) {
+  return (uint16_t)(((uint16_t)in[0] << 8) | in[1]);
+}
+
+static uint32_t get32(const uint8_t* in) {
+  return ((uint32_t)in[0] << 24) | ((uint32_t)in[1] << 16) | ((uint32_t)in[2] << 8) | in[3];
+}
+
+// Constructor
+LoRaBulkSender::LoRaBulkSender() :
+  read(nullptr),
+  context(nullptr),
+  totalLen(0),
+  chunkCount(0),
+  base(0),
+  cursor(0),
+  acked(0),
+  framesSent(0),
+  sessionId(0),
+  chunkSize(0),
+  window(0),
+  started(false),
+  failed(false) {
+}
+
+// Start a new transfer
+bool LoRaBulkSender::begin(uint8_t sessionId, uint32_t totalLen, uint8_t chunkSize, uint8_t window,
+                           LoRaBulkReadCallback read, void* context) {
+  if (read == nullptr || totalLen == 0 || chunkSize == 0 || chunkSize > LORA_BULK_CHUNK_SIZE ||
+      window == 0 || window > LORA_BULK_MAX_WINDOW) {
+    return false;
+  }
+  uint32_t chunks = (totalLen + chunkSize - 1) / chunkSize;
+  if (chunks > 0xFFFF) {
+    return false;
+  }
+
+  this->read = read;
+  this->context = context;
+  this->totalLen = totalLen;
+  this->chunkCount = (uint16_t)chunks;
+  this->sessionId = sessionId;
+  this->chunkSize = chunkSize;
+  this->window = window;
+  base = 0;
+  cursor = 0;
+  acked = 0;
+  framesSent = 0;
+  started = false;
+  failed = false;
+  return true;
+}
+
+// One past the last chunk the window allows
+uint16_t LoRaBulkSender::windowEnd() const {
+  uint32_t end = (uint32_t)base + window;
+  return (uint16_t)(end < chunkCount ? end : chunkCount);
+}
+
+// Build the next frame of the current burst
+size_t LoRaBulkSender::nextFrame(uint8_t* out) {
+  if (failed || isComplete()) {
+    return 0;
+  }
+
+  // Announce the transfer until the receiver acknowledges it
+  if (!started) {
+    if (cursor != 0) {
+      return 0;
+    }
+    cursor = 1;
+    out[0] = FRAME_START | FLAG_ACK_REQUEST;
+    out[1] = sessionId;
+    put32(&out[2], totalLen);
+    out[6] = chunkSize;
+    out[7] = window;
+    return START_FRAME_LEN;
+  }
+
+  // Skip chunks the receiver already has
+  uint16_t end = windowEnd();
+  while (cursor < end && (acked & (1UL << (cursor - base)))) {
+    cursor++;
+  }
+  if (cursor >= end) {
+    return 0;
+  }
+
+  uint16_t seq = cursor++;
+  uint32_t offset = (uint32_t)seq * chunkSize;
+  size_t len = totalLen - offset < chunkSize ? (size_t)(totalLen - offset) : chunkSize;
+  if (read(offset, &out[LORA_BULK_HEADER_LEN], len, context) != len) {
+    failed = true;
+    return 0;
+  }
+
+  // The last outstanding chunk of the burst asks for an acknowledgement
+  while (cursor < end && (acked & (1UL << (cursor - base)))) {
+    cursor++;
+  }
+  out[0] = (uint8_t)(FRAME_DATA | (cursor >= end ? FLAG_ACK_REQUEST : 0));
+  out[1] = sessionId;
+  put16(&out[2], seq);
+  framesSent++;
+  return LORA_BULK_HEADER_LEN + len;
+}
+
+// Process a frame received from the peer
+bool LoRaBulkSender::onFrame(const uint8_t* frame, size_t len) {
+  if (len != ACK_FRAME_LEN || (frame[0] & FRAME_TYPE_MASK) != FRAME_ACK || frame[1] != sessionId) {
+    return false;
+  }
+
+  uint16_t ackBase = get16(&frame[2]);
+  uint32_t bitmap = get32(&frame[4]);
+  started = true;
+
+  // Acknowledgements can only move the window forward
+  if (ackBase >= base && ackBase <= chunkCount) {
+    uint16_t shift = (uint16_t)(ackBase - base);
+    acked = shift >= 32 ? 0 : (acked >> shift);
+    acked |= bitmap;
+    base = ackBase;
+  }
+  cursor = base;
+  return true;
+}
+
+// No ACK arrived; repeat the unacknowledged frames of the window
+void LoRaBulkSender::onTimeout() {
+  cursor = started ? base : 0;
+}
+
+// Check if the peer has acknowledged everything
+bool LoRaBulkSender::isComplete() const {
+  return started && base >= chunkCount;
+}
+
+// Check if the read callback failed
+bool LoRaBulkSender::hasFailed() const {
+  return failed;
+}
+
+// Get the number of data frames transmitted
+uint32_t LoRaBulkSender::getFramesSent() const {
+  return framesSent;
+}
+
+// Constructor
+LoRaBulkReceiver::LoRaBulkReceiver(LoRaBulkWriteCallback write, void* context) :
+  write(write),
+  context(context),
+  totalLen(0),
+  chunkCount(0),
+  base(0),
+  received(0),
+  sessionId(0),
+  chunkSize(0),
+  started(false),
+  failed(false) {
+}
+
+// Process a frame received from the sender
+bool LoRaBulkReceiver::onFrame(const uint8_t* frame, size_t len) {
+  if (len < 2 || failed) {
+    return false;
+  }
+  uint8_t type = frame[0] & FRAME_TYPE_MASK;
+  bool ackRequested = (frame[0] & FLAG_ACK_REQUEST) != 0;
+
+  if (type == FRAME_START && len == START_FRAME_LEN) {
+    // A repeated START (our ACK was lost) must not reset progress
+    if (!started || frame[1] != sessionId) {
+      totalLen = get32(&frame[2]);
+      chunkSize = frame[6];
+      if (chunkSize == 0 || totalLen == 0) {
+        return false;
+      }
+      chunkCount = (uint16_t)((totalLen + chunkSize - 1) / chunkSize);
+      sessionId = frame[1];
+      base = 0;
+      received = 0;
+      started = true;
+    }
+    return ackRequested;
+  }
+
+  if (type != FRAME_DATA || len <= LORA_BULK_HEADER_LEN || !started || frame[1] != sessionId) {
+    return false;
+  }
+
+  // Store chunks inside the window once; duplicates only trigger an ACK
+  uint16_t seq = get16(&frame[2]);
+  if (seq >= base && seq < chunkCount && seq - base < 32 && !(received & (1UL << (seq - base)))) {
+    uint32_t offset = (uint32_t)seq * chunkSize;
+    size_t expected = totalLen - offset < chunkSize ? (size_t)(totalLen - offset) : chunkSize;
+    if (len - LORA_BULK_HEADER_LEN != expected) {
+      return ackRequested;
+    }
+    if (!write(offset, &frame[LORA_BULK_HEADER_LEN], expected, context)) {
+      failed = true;
+      return false;
+    }
+    received |= 1UL << (seq - base);
+
+    // Slide past the chunks that are now contiguous
+    while (received & 1UL) {
+      received >>= 1;
+      base++;
+    }
+  }
+  return ackRequested;
+}
+
+// Build an ACK describing the chunks received so far
+size_t LoRaBulkReceiver::buildAck(uint8_t* out) const {
+  out[0] = FRAME_ACK;
+  out[1] = sessionId;
+  put16(&out[2], base);
+  put32(&out[4], received);
+  return ACK_FRAME_LEN;
+}
+
+// Check if all data has been received
+bool LoRaBulkReceiver::isComplete() const {
+  return started && base >= chunkCount;
+}
+
+// Check if the write callback aborted the transfer
+bool LoRaBulkReceiver::hasFailed() const {
+  return failed;
+}
+
+// Get the total length announced by the sender
+uint32_t LoRaBulkReceiver::getTotalLength() const {
+  return totalLen;
+}
+
+namespace LoRaBulk {
+
+// 50 kbps GFSK
+LoRaPhyConfig fskConfig(float frequency, int8_t power) {
+  LoRaPhyConfig config;
+  memset(&config, 0, sizeof(config));
+  config.modem = LORA_PHY_MODEM_FSK;
+  config.frequency = frequency;
+  config.bandwidth = 156.2;
+  config.bitRate = 50.0;
+  config.frequencyDeviation = 25.0;
+  config.power = power;
+  config.preambleLength = 32;
+  return config;
+}
+
+// LoRa SF7 / 500 kHz
+LoRaPhyConfig loraConfig(float frequency, int8_t power) {
+  LoRaPhyConfig config;
+  memset(&config, 0, sizeof(config));
+  config.modem = LORA_PHY_MODEM_LORA;
+  config.frequency = frequency;
+  config.bandwidth = 500.0;
+  config.spreadingFactor = 7;
+  config.codingRate = 5;
+  config.syncWord = LORA_PHY_SYNC_WORD_PRIVATE;
+  config.power = power;
+  config.preambleLength = 8;
+  return config;
+}
+
+} // namespace LoRaBulk
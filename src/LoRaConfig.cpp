@@ -0,0 +1,382 @@
+#include "LoRaConfig.h"
+#include "LoRaProvisioning.h"
+
+// Journal record framing: length, version, CRC-16
+#define RECORD_HEADER_LEN 3
+#define RECORD_OVERHEAD   5
+
+// Largest record body: every entry as key, type and a 32-bit value
+#define RECORD_MAX_BODY (LORA_CONFIG_MAX_ENTRIES * 6)
+
+#if LORA_CONFIG_MAX_ENTRIES > 32 || RECORD_MAX_BODY > 254
+#error "LORA_CONFIG_MAX_ENTRIES too large for the patch mask or the journal record"
+#endif
+
+// Bytes per LORA_CONFIG_* type, and its range
+static const uint8_t typeSize[] = {1, 1, 1, 2, 2, 4};
+static const int32_t typeMin[] = {0, 0, -128, 0, -32768, INT32_MIN};
+static const int32_t typeMax[] = {1, 255, 127, 65535, 32767, INT32_MAX};
+
+#define TYPE_COUNT (sizeof(typeSize) / sizeof(typeSize[0]))
+
+// Write a value MSB first
+static void encodeValue(uint8_t* out, uint8_t type, int32_t value) {
+  for (int i = typeSize[type] - 1; i >= 0; i--) {
+    out[i] = (uint8_t)(value & 0xFF);
+    value >>= 8;
+  }
+}
+
+// Read a value written MSB first, sign-extending the signed types
+static int32_t decodeValue(const uint8_t* in, uint8_t type) {
+  uint32_t raw = 0;
+  for (uint8_t i = 0; i < typeSize[type]; i++) {
+    raw = (raw << 8) | in[i];
+  }
+  if (type == LORA_CONFIG_I8) {
+    return (int8_t)raw;
+  }
+  if (type == LORA_CONFIG_I16) {
+    return (int16_t)raw;
+  }
+  return (int32_t)raw;
+}
+
+// Constructor
+LoRaConfig::LoRaConfig()
+  : storage(nullptr),
+    writeOffset(0),
+    pendingMask(0),
+    version(0),
+    entryCount(0),
+    bank(0),
+    reportStatus(LORA_CONFIG_CURRENT),
+    reportPending(false) {
+  memset(entries, 0, sizeof(entries));
+  memset(pendingValues, 0, sizeof(pendingValues));
+  memset(&stats, 0, sizeof(stats));
+}
+
+// Define an entry, keeping the table in key order for the hash
+bool LoRaConfig::define(uint8_t key, uint8_t type, int32_t defaultValue, int32_t minValue, int32_t maxValue) {
+  if (type >= TYPE_COUNT || entryCount >= LORA_CONFIG_MAX_ENTRIES || findEntry(key) >= 0) {
+    return false;
+  }
+  if (minValue < typeMin[type]) {
+    minValue = typeMin[type];
+  }
+  if (maxValue > typeMax[type]) {
+    maxValue = typeMax[type];
+  }
+  if (defaultValue < minValue || defaultValue > maxValue) {
+    return false;
+  }
+
+  uint8_t i = entryCount;
+  while (i > 0 && entries[i - 1].key > key) {
+    entries[i] = entries[i - 1];
+    i--;
+  }
+  entries[i].value = defaultValue;
+  entries[i].minValue = minValue;
+  entries[i].maxValue = maxValue;
+  entries[i].key = key;
+  entries[i].type = type;
+  entryCount++;
+  return true;
+}
+
+// Get the value of an entry
+int32_t LoRaConfig::get(uint8_t key) const {
+  int index = findEntry(key);
+  return index >= 0 ? entries[index].value : 0;
+}
+
+// Find an entry by key
+int LoRaConfig::findEntry(uint8_t key) const {
+  for (uint8_t i = 0; i < entryCount; i++) {
+    if (entries[i].key == key) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Restore from the bank with the newest valid journal
+bool LoRaConfig::load(LoRaConfigStorage* storage) {
+  this->storage = storage;
+  bank = 0;
+  writeOffset = 0;
+  if (storage == nullptr) {
+    return false;
+  }
+
+  size_t end[2];
+  uint16_t last[2];
+  bool valid[2];
+  for (uint8_t b = 0; b < 2; b++) {
+    valid[b] = scanBank(b, false, end[b], last[b]);
+  }
+  if (!valid[0] && !valid[1]) {
+    return false;
+  }
+
+  // Versions wrap; the newer one is less than half the range ahead
+  if (!valid[0] || (valid[1] && (int16_t)(last[1] - last[0]) > 0)) {
+    bank = 1;
+  }
+  scanBank(bank, true, writeOffset, version);
+  return true;
+}
+
+// Walk a bank's journal, optionally applying it; stops at the first bad record
+bool LoRaConfig::scanBank(uint8_t fromBank, bool apply, size_t& end, uint16_t& lastVersion) {
+  size_t bankSize = storage->size() / 2;
+  size_t base = fromBank * bankSize;
+  uint8_t record[RECORD_MAX_BODY + RECORD_OVERHEAD];
+  bool found = false;
+  end = 0;
+  lastVersion = 0;
+
+  while (end + RECORD_OVERHEAD <= bankSize) {
+    if (!storage->read(base + end, record, RECORD_HEADER_LEN)) {
+      break;
+    }
+    size_t bodyLen = record[0];
+    size_t len = bodyLen + RECORD_OVERHEAD;
+    if (bodyLen == 0 || bodyLen > RECORD_MAX_BODY || end + len > bankSize ||
+        !storage->read(base + end + RECORD_HEADER_LEN, &record[RECORD_HEADER_LEN], len - RECORD_HEADER_LEN)) {
+      break;
+    }
+    uint16_t crc = LoRaProvisioning::crc16(record, len - 2);
+    uint16_t recordVersion = (uint16_t)((record[1] << 8) | record[2]);
+    if (crc != (uint16_t)((record[len - 2] << 8) | record[len - 1]) ||
+        (found && recordVersion != (uint16_t)(lastVersion + 1))) {
+      break;
+    }
+
+    // Entries the firmware no longer defines, or defines differently, are skipped
+    if (apply) {
+      size_t pos = RECORD_HEADER_LEN;
+      while (pos + 2 <= RECORD_HEADER_LEN + bodyLen) {
+        uint8_t key = record[pos];
+        uint8_t type = record[pos + 1];
+        if (type >= TYPE_COUNT || pos + 2 + typeSize[type] > RECORD_HEADER_LEN + bodyLen) {
+          break;
+        }
+        int32_t value = decodeValue(&record[pos + 2], type);
+        int index = findEntry(key);
+        if (index >= 0 && entries[index].type == type &&
+            value >= entries[index].minValue && value <= entries[index].maxValue) {
+          entries[index].value = value;
+        }
+        pos += 2 + typeSize[type];
+      }
+    }
+
+    found = true;
+    lastVersion = recordVersion;
+    end += len;
+  }
+  return found;
+}
+
+// Check a patch as a whole and stage it
+uint8_t LoRaConfig::acceptPatch(const uint8_t* payload, size_t len) {
+  if (len == 2) {
+    stats.queries++;
+    queueReport(LORA_CONFIG_CURRENT);
+    return LORA_CONFIG_CURRENT;
+  }
+
+  stats.patches++;
+  if (len < 2) {
+    stats.rejected++;
+    queueReport(LORA_CONFIG_INVALID);
+    return LORA_CONFIG_INVALID;
+  }
+  if (pendingMask != 0) {
+    stats.rejected++;
+    queueReport(LORA_CONFIG_BUSY);
+    return LORA_CONFIG_BUSY;
+  }
+  if ((uint16_t)((payload[0] << 8) | payload[1]) != version) {
+    stats.stale++;
+    queueReport(LORA_CONFIG_STALE);
+    return LORA_CONFIG_STALE;
+  }
+
+  uint32_t mask = 0;
+  size_t pos = 2;
+  while (pos < len) {
+    int index = findEntry(payload[pos]);
+    if (index < 0 || pos + 1 + typeSize[entries[index].type] > len) {
+      stats.rejected++;
+      queueReport(LORA_CONFIG_INVALID);
+      return LORA_CONFIG_INVALID;
+    }
+    int32_t value = decodeValue(&payload[pos + 1], entries[index].type);
+    if (value < entries[index].minValue || value > entries[index].maxValue) {
+      stats.rejected++;
+      queueReport(LORA_CONFIG_INVALID);
+      return LORA_CONFIG_INVALID;
+    }
+    pendingValues[index] = value;
+    mask |= (uint32_t)1 << index;
+    pos += 1 + typeSize[entries[index].type];
+  }
+
+  pendingMask = mask;
+  return LORA_CONFIG_APPLIED;
+}
+
+// Check if a patch is waiting
+bool LoRaConfig::hasPendingPatch() const {
+  return pendingMask != 0;
+}
+
+// Apply the staged patch in one go, then persist it and tell the callback
+bool LoRaConfig::applyPatch(LoRaConfigCallback callback) {
+  if (pendingMask == 0) {
+    return false;
+  }
+
+  uint32_t mask = pendingMask;
+  uint32_t changed = 0;
+  pendingMask = 0;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    if ((mask & ((uint32_t)1 << i)) != 0 && entries[i].value != pendingValues[i]) {
+      entries[i].value = pendingValues[i];
+      changed |= (uint32_t)1 << i;
+    }
+  }
+  version++;
+  stats.applied++;
+  queueReport(persist(mask) ? LORA_CONFIG_APPLIED : LORA_CONFIG_UNSAVED);
+
+  if (callback != nullptr) {
+    for (uint8_t i = 0; i < entryCount; i++) {
+      if ((changed & ((uint32_t)1 << i)) != 0) {
+        callback(entries[i].key, entries[i].value);
+      }
+    }
+  }
+  return true;
+}
+
+// Serialize the masked entries as a journal record at the current version
+size_t LoRaConfig::buildRecord(uint8_t* out, uint32_t mask) const {
+  size_t pos = RECORD_HEADER_LEN;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    if ((mask & ((uint32_t)1 << i)) != 0) {
+      out[pos++] = entries[i].key;
+      out[pos++] = entries[i].type;
+      encodeValue(&out[pos], entries[i].type, entries[i].value);
+      pos += typeSize[entries[i].type];
+    }
+  }
+  out[0] = (uint8_t)(pos - RECORD_HEADER_LEN);
+  out[1] = (uint8_t)(version >> 8);
+  out[2] = (uint8_t)(version & 0xFF);
+
+  uint16_t crc = LoRaProvisioning::crc16(out, pos);
+  out[pos++] = (uint8_t)(crc >> 8);
+  out[pos++] = (uint8_t)(crc & 0xFF);
+  return pos;
+}
+
+// Write a record and end the journal behind it
+bool LoRaConfig::writeRecord(uint8_t toBank, size_t offset, const uint8_t* record, size_t len) {
+  size_t bankSize = storage->size() / 2;
+  size_t base = toBank * bankSize;
+  if (offset + len > bankSize || !storage->write(base + offset, record, len)) {
+    return false;
+  }
+  if (offset + len < bankSize) {
+    const uint8_t end = 0;
+    return storage->write(base + offset + len, &end, 1);
+  }
+  return true;
+}
+
+// Append the patched entries; rewrite everything into the other bank when full
+bool LoRaConfig::persist(uint32_t mask) {
+  if (storage == nullptr) {
+    return true;
+  }
+
+  uint8_t record[RECORD_MAX_BODY + RECORD_OVERHEAD];
+  size_t len = buildRecord(record, mask);
+  if (writeRecord(bank, writeOffset, record, len)) {
+    writeOffset += len;
+    stats.persisted++;
+    return true;
+  }
+
+  // The old bank stays valid until the new one holds a good record
+  uint8_t other = bank ^ 1;
+  len = buildRecord(record, entryCount >= 32 ? 0xFFFFFFFF : ((uint32_t)1 << entryCount) - 1);
+  if (!writeRecord(other, 0, record, len)) {
+    stats.storageErrors++;
+    return false;
+  }
+  bank = other;
+  writeOffset = len;
+  stats.compactions++;
+  stats.persisted++;
+  return true;
+}
+
+// Queue a report; a newer one replaces a waiting one
+void LoRaConfig::queueReport(uint8_t status) {
+  reportStatus = status;
+  reportPending = true;
+}
+
+// Check if a report is waiting
+bool LoRaConfig::hasReport() const {
+  return reportPending;
+}
+
+// Write the waiting report
+size_t LoRaConfig::buildReport(uint8_t* out) const {
+  if (!reportPending) {
+    return 0;
+  }
+  uint16_t hash = getHash();
+  out[0] = reportStatus;
+  out[1] = (uint8_t)(version >> 8);
+  out[2] = (uint8_t)(version & 0xFF);
+  out[3] = (uint8_t)(hash >> 8);
+  out[4] = (uint8_t)(hash & 0xFF);
+  return LORA_CONFIG_REPORT_LEN;
+}
+
+// Report the outcome of the uplink carrying the report
+void LoRaConfig::confirmReport(bool sent) {
+  if (sent) {
+    reportPending = false;
+  }
+}
+
+// Get the configuration version
+uint16_t LoRaConfig::getVersion() const {
+  return version;
+}
+
+// CRC-16 of [key | value] over all entries in key order
+uint16_t LoRaConfig::getHash() const {
+  uint8_t bytes[LORA_CONFIG_MAX_ENTRIES * 5];
+  size_t pos = 0;
+  for (uint8_t i = 0; i < entryCount; i++) {
+    bytes[pos++] = entries[i].key;
+    encodeValue(&bytes[pos], entries[i].type, entries[i].value);
+    pos += typeSize[entries[i].type];
+  }
+  return LoRaProvisioning::crc16(bytes, pos);
+}
+
+// Get the configuration store statistics
+const LoRaConfigStats& LoRaConfig::getStats() const {
+  return stats;
+}
@@ -0,0 +1,344 @@
+#include "LoRaCrypto.h"
+#include <string.h>
+
+#if defined(ESP32)
+#if __has_include("aes/esp_aes.h")
+#include "aes/esp_aes.h"
+#else
+#include "hwcrypto/aes.h"
+#endif
+#endif
+
+#if defined(LORA_CRYPTO_HAS_AESNI)
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#endif
+
+// AES S-box
+static const uint8_t SBOX[256] = {
+  0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
+  0xCA, 0x82, 0xC9, 0x7D, 0xFA, 0x59, 0x47, 0xF0, 0xAD, 0xD4, 0xA2, 0xAF, 0x9C, 0xA4, 0x72, 0xC0,
+  0xB7, 0xFD, 0x93, 0x26, 0x36, 0x3F, 0xF7, 0xCC, 0x34, 0xA5, 0xE5, 0xF1, 0x71, 0xD8, 0x31, 0x15,
+  0x04, 0xC7, 0x23, 0xC3, 0x18, 0x96, 0x05, 0x9A, 0x07, 0x12, 0x80, 0xE2, 0xEB, 0x27, 0xB2, 0x75,
+  0x09, 0x83, 0x2C, 0x1A, 0x1B, 0x6E, 0x5A, 0xA0, 0x52, 0x3B, 0xD6, 0xB3, 0x29, 0xE3, 0x2F, 0x84,
+  0x53, 0xD1, 0x00, 0xED, 0x20, 0xFC, 0xB1, 0x5B, 0x6A, 0xCB, 0xBE, 0x39, 0x4A, 0x4C, 0x58, 0xCF,
+  0xD0, 0xEF, 0xAA, 0xFB, 0x43, 0x4D, 0x33, 0x85, 0x45, 0xF9, 0x02, 0x7F, 0x50, 0x3C, 0x9F, 0xA8,
+  0x51, 0xA3, 0x40, 0x8F, 0x92, 0x9D, 0x38, 0xF5, 0xBC, 0xB6, 0xDA, 0x21, 0x10, 0xFF, 0xF3, 0xD2,
+  0xCD, 0x0C, 0x13, 0xEC, 0x5F, 0x97, 0x44, 0x17, 0xC4, 0xA7, 0x7E, 0x3D, 0x64, 0x5D, 0x19, 0x73,
+  0x60, 0x81, 0x4F, 0xDC, 0x22, 0x2A, 0x90, 0x88, 0x46, 0xEE, 0xB8, 0x14, 0xDE, 0x5E, 0x0B, 0xDB,
+  0xE0, 0x32, 0x3A, 0x0A, 0x49, 0x06, 0x24, 0x5C, 0xC2, 0xD3, 0xAC, 0x62, 0x91, 0x95, 0xE4, 0x79,
+  0xE7, 0xC8, 0x37, 0x6D, 0x8D, 0xD5, 0x4E, 0xA9, 0x6C, 0x56, 0xF4, 0xEA, 0x65, 0x7A, 0xAE, 0x08,
+  0xBA, 0x78, 0x25, 0x2E, 0x1C, 0xA6, 0xB4, 0xC6, 0xE8, 0xDD, 0x74, 0x1F, 0x4B, 0xBD, 0x8B, 0x8A,
+  0x70, 0x3E, 0xB5, 0x66, 0x48, 0x03, 0xF6, 0x0E, 0x61, 0x35, 0x57, 0xB9, 0x86, 0xC1, 0x1D, 0x9E,
+  0xE1, 0xF8, 0x98, 0x11, 0x69, 0xD9, 0x8E, 0x94, 0x9B, 0x1E, 0x87, 0xE9, 0xCE, 0x55, 0x28, 0xDF,
+  0x8C, 0xA1, 0x89, 0x0D, 0xBF, 0xE6, 0x42, 0x68, 0x41, 0x99, 0x2D, 0x0F, 0xB0, 0x54, 0xBB, 0x16
+};
+
+// Combined SubBytes/MixColumns table for column 0; the other columns are rotations
+static const uint32_t TE0[256] = {
+  0xC66363A5UL, 0xF87C7C84UL, 0xEE777799UL, 0xF67B7B8DUL, 0xFFF2F20DUL, 0xD66B6BBDUL, 0xDE6F6FB1UL, 0x91C5C554UL,
+  0x60303050UL, 0x02010103UL, 0xCE6767A9UL, 0x562B2B7DUL, 0xE7FEFE19UL, 0xB5D7D762UL, 0x4DABABE6UL, 0xEC76769AUL,
+  0x8FCACA45UL, 0x1F82829DUL, 0x89C9C940UL, 0xFA7D7D87UL, 0xEFFAFA15UL, 0xB25959EBUL, 0x8E4747C9UL, 0xFBF0F00BUL,
+  0x41ADADECUL, 0xB3D4D467UL, 0x5FA2A2FDUL, 0x45AFAFEAUL, 0x239C9CBFUL, 0x53A4A4F7UL, 0xE4727296UL, 0x9BC0C05BUL,
+  0x75B7B7C2UL, 0xE1FDFD1CUL, 0x3D9393AEUL, 0x4C26266AUL, 0x6C36365AUL, 0x7E3F3F41UL, 0xF5F7F702UL, 0x83CCCC4FUL,
+  0x6834345CUL, 0x51A5A5F4UL, 0xD1E5E534UL, 0xF9F1F108UL, 0xE2717193UL, 0xABD8D873UL, 0x62313153UL, 0x2A15153FUL,
+  0x0804040CUL, 0x95C7C752UL, 0x46232365UL, 0x9DC3C35EUL, 0x30181828UL, 0x379696A1UL, 0x0A05050FUL, 0x2F9A9AB5UL,
+  0x0E070709UL, 0x24121236UL, 0x1B80809BUL, 0xDFE2E23DUL, 0xCDEBEB26UL, 0x4E272769UL, 0x7FB2B2CDUL, 0xEA75759FUL,
+  0x1209091BUL, 0x1D83839EUL, 0x582C2C74UL, 0x341A1A2EUL, 0x361B1B2DUL, 0xDC6E6EB2UL, 0xB45A5AEEUL, 0x5BA0A0FBUL,
+  0xA45252F6UL, 0x763B3B4DUL, 0xB7D6D661UL, 0x7DB3B3CEUL, 0x5229297BUL, 0xDDE3E33EUL, 0x5E2F2F71UL, 0x13848497UL,
+  0xA65353F5UL, 0xB9D1D168UL, 0x00000000UL, 0xC1EDED2CUL, 0x40202060UL, 0xE3FCFC1FUL, 0x79B1B1C8UL, 0xB65B5BEDUL,
+  0xD46A6ABEUL, 0x8DCBCB46UL, 0x67BEBED9UL, 0x7239394BUL, 0x944A4ADEUL, 0x984C4CD4UL, 0xB05858E8UL, 0x85CFCF4AUL,
+  0xBBD0D06BUL, 0xC5EFEF2AUL, 0x4FAAAAE5UL, 0xEDFBFB16UL, 0x864343C5UL, 0x9A4D4DD7UL, 0x66333355UL, 0x11858594UL,
+  0x8A4545CFUL, 0xE9F9F910UL, 0x04020206UL, 0xFE7F7F81UL, 0xA05050F0UL, 0x783C3C44UL, 0x259F9FBAUL, 0x4BA8A8E3UL,
+  0xA25151F3UL, 0x5DA3A3FEUL, 0x804040C0UL, 0x058F8F8AUL, 0x3F9292ADUL, 0x219D9DBCUL, 0x70383848UL, 0xF1F5F504UL,
+  0x63BCBCDFUL, 0x77B6B6C1UL, 0xAFDADA75UL, 0x42212163UL, 0x20101030UL, 0xE5FFFF1AUL, 0xFDF3F30EUL, 0xBFD2D26DUL,
+  0x81CDCD4CUL, 0x180C0C14UL, 0x26131335UL, 0xC3ECEC2FUL, 0xBE5F5FE1UL, 0x359797A2UL, 0x884444CCUL, 0x2E171739UL,
+  0x93C4C457UL, 0x55A7A7F2UL, 0xFC7E7E82UL, 0x7A3D3D47UL, 0xC86464ACUL, 0xBA5D5DE7UL, 0x3219192BUL, 0xE6737395UL,
+  0xC06060A0UL, 0x19818198UL, 0x9E4F4FD1UL, 0xA3DCDC7FUL, 0x44222266UL, 0x542A2A7EUL, 0x3B9090ABUL, 0x0B888883UL,
+  0x8C4646CAUL, 0xC7EEEE29UL, 0x6BB8B8D3UL, 0x2814143CUL, 0xA7DEDE79UL, 0xBC5E5EE2UL, 0x160B0B1DUL, 0xADDBDB76UL,
+  0xDBE0E03BUL, 0x64323256UL, 0x743A3A4EUL, 0x140A0A1EUL, 0x924949DBUL, 0x0C06060AUL, 0x4824246CUL, 0xB85C5CE4UL,
+  0x9FC2C25DUL, 0xBDD3D36EUL, 0x43ACACEFUL, 0xC46262A6UL, 0x399191A8UL, 0x319595A4UL, 0xD3E4E437UL, 0xF279798BUL,
+  0xD5E7E732UL, 0x8BC8C843UL, 0x6E373759UL, 0xDA6D6DB7UL, 0x018D8D8CUL, 0xB1D5D564UL, 0x9C4E4ED2UL, 0x49A9A9E0UL,
+  0xD86C6CB4UL, 0xAC5656FAUL, 0xF3F4F407UL, 0xCFEAEA25UL, 0xCA6565AFUL, 0xF47A7A8EUL, 0x47AEAEE9UL, 0x10080818UL,
+  0x6FBABAD5UL, 0xF0787888UL, 0x4A25256FUL, 0x5C2E2E72UL, 0x381C1C24UL, 0x57A6A6F1UL, 0x73B4B4C7UL, 0x97C6C651UL,
+  0xCBE8E823UL, 0xA1DDDD7CUL, 0xE874749CUL, 0x3E1F1F21UL, 0x964B4BDDUL, 0x61BDBDDCUL, 0x0D8B8B86UL, 0x0F8A8A85UL,
+  0xE0707090UL, 0x7C3E3E42UL, 0x71B5B5C4UL, 0xCC6666AAUL, 0x904848D8UL, 0x06030305UL, 0xF7F6F601UL, 0x1C0E0E12UL,
+  0xC26161A3UL, 0x6A35355FUL, 0xAE5757F9UL, 0x69B9B9D0UL, 0x17868691UL, 0x99C1C158UL, 0x3A1D1D27UL, 0x279E9EB9UL,
+  0xD9E1E138UL, 0xEBF8F813UL, 0x2B9898B3UL, 0x22111133UL, 0xD26969BBUL, 0xA9D9D970UL, 0x078E8E89UL, 0x339494A7UL,
+  0x2D9B9BB6UL, 0x3C1E1E22UL, 0x15878792UL, 0xC9E9E920UL, 0x87CECE49UL, 0xAA5555FFUL, 0x50282878UL, 0xA5DFDF7AUL,
+  0x038C8C8FUL, 0x59A1A1F8UL, 0x09898980UL, 0x1A0D0D17UL, 0x65BFBFDAUL, 0xD7E6E631UL, 0x844242C6UL, 0xD06868B8UL,
+  0x824141C3UL, 0x299999B0UL, 0x5A2D2D77UL, 0x1E0F0F11UL, 0x7BB0B0CBUL, 0xA85454FCUL, 0x6DBBBBD6UL, 0x2C16163AUL
+};
+
+static const uint8_t RCON[10] = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x1B, 0x36};
+
+static inline uint32_t rotr8(uint32_t x) {
+  return (x >> 8) | (x << 24);
+}
+
+static inline uint32_t loadBE(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void storeBE(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)(v >> 24);
+  p[1] = (uint8_t)(v >> 16);
+  p[2] = (uint8_t)(v >> 8);
+  p[3] = (uint8_t)v;
+}
+
+// Default: one block at a time
+void LoRaCryptoBackend::encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks) {
+  for (size_t i = 0; i < blocks; i++) {
+    encryptBlock(schedule, &in[i * 16], &out[i * 16]);
+  }
+}
+
+// Standard AES-128 key expansion, round keys stored as big-endian words
+void LoRaSoftAesBackend::expandKey(const uint8_t* key, LoRaAesSchedule& schedule) {
+  memcpy(schedule.roundKeys, key, 16);
+  uint8_t* rk = schedule.roundKeys;
+  for (uint8_t i = 4; i < 44; i++) {
+    uint8_t t[4];
+    memcpy(t, &rk[(i - 1) * 4], 4);
+    if (i % 4 == 0) {
+      uint8_t first = t[0];
+      t[0] = (uint8_t)(SBOX[t[1]] ^ RCON[i / 4 - 1]);
+      t[1] = SBOX[t[2]];
+      t[2] = SBOX[t[3]];
+      t[3] = SBOX[first];
+    }
+    for (uint8_t j = 0; j < 4; j++) {
+      rk[i * 4 + j] = (uint8_t)(rk[(i - 4) * 4 + j] ^ t[j]);
+    }
+  }
+}
+
+// Table-based encryption: 16 table lookups per round
+void LoRaSoftAesBackend::encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) {
+  const uint8_t* rk = schedule.roundKeys;
+  uint32_t s0 = loadBE(&in[0]) ^ loadBE(&rk[0]);
+  uint32_t s1 = loadBE(&in[4]) ^ loadBE(&rk[4]);
+  uint32_t s2 = loadBE(&in[8]) ^ loadBE(&rk[8]);
+  uint32_t s3 = loadBE(&in[12]) ^ loadBE(&rk[12]);
+
+  for (uint8_t round = 1; round < 10; round++) {
+    rk += 16;
+    uint32_t t0 = TE0[s0 >> 24] ^ rotr8(TE0[(s1 >> 16) & 0xFF]) ^ rotr8(rotr8(TE0[(s2 >> 8) & 0xFF])) ^ rotr8(rotr8(rotr8(TE0[s3 & 0xFF]))) ^ loadBE(&rk[0]);
+    uint32_t t1 = TE0[s1 >> 24] ^ rotr8(TE0[(s2 >> 16) & 0xFF]) ^ rotr8(rotr8(TE0[(s3 >> 8) & 0xFF])) ^ rotr8(rotr8(rotr8(TE0[s0 & 0xFF]))) ^ loadBE(&rk[4]);
+    uint32_t t2 = TE0[s2 >> 24] ^ rotr8(TE0[(s3 >> 16) & 0xFF]) ^ rotr8(rotr8(TE0[(s0 >> 8) & 0xFF])) ^ rotr8(rotr8(rotr8(TE0[s1 & 0xFF]))) ^ loadBE(&rk[8]);
+    uint32_t t3 = TE0[s3 >> 24] ^ rotr8(TE0[(s0 >> 16) & 0xFF]) ^ rotr8(rotr8(TE0[(s1 >> 8) & 0xFF])) ^ rotr8(rotr8(rotr8(TE0[s2 & 0xFF]))) ^ loadBE(&rk[12]);
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  // Final round has no MixColumns
+  rk += 16;
+  uint32_t state[4] = {s0, s1, s2, s3};
+  for (uint8_t c = 0; c < 4; c++) {
+    uint32_t v = ((uint32_t)SBOX[state[c] >> 24] << 24) |
+                 ((uint32_t)SBOX[(state[(c + 1) & 3] >> 16) & 0xFF] << 16) |
+                 ((uint32_t)SBOX[(state[(c + 2) & 3] >> 8) & 0xFF] << 8) |
+                 (uint32_t)SBOX[state[(c + 3) & 3] & 0xFF];
+    storeBE(&out[c * 4], v ^ loadBE(&rk[c * 4]));
+  }
+}
+
+#if defined(ESP32)
+// The peripheral expands the key itself; keep the raw key
+void LoRaEsp32AesBackend::expandKey(const uint8_t* key, LoRaAesSchedule& schedule) {
+  memcpy(schedule.roundKeys, key, 16);
+}
+
+// Encrypt one block on the AES peripheral
+void LoRaEsp32AesBackend::encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) {
+  encryptBlocks(schedule, in, out, 1);
+}
+
+// Encrypt several blocks under a single peripheral acquisition
+void LoRaEsp32AesBackend::encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks) {
+  esp_aes_context ctx;
+  esp_aes_init(&ctx);
+  esp_aes_setkey(&ctx, schedule.roundKeys, 128);
+  for (size_t i = 0; i < blocks; i++) {
+    esp_aes_crypt_ecb(&ctx, ESP_AES_ENCRYPT, &in[i * 16], &out[i * 16]);
+  }
+  esp_aes_free(&ctx);
+}
+#endif
+
+#if defined(LORA_CRYPTO_HAS_AESNI)
+// Check CPUID for AES-NI
+bool LoRaAesNiBackend::isSupported() const {
+  return __builtin_cpu_supports("aes");
+}
+
+__attribute__((target("aes,sse2")))
+static inline __m128i expandStep(__m128i key, __m128i assist) {
+  assist = _mm_shuffle_epi32(assist, 0xFF);
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+// Key expansion with AESKEYGENASSIST
+__attribute__((target("aes,sse2")))
+void LoRaAesNiBackend::expandKey(const uint8_t* key, LoRaAesSchedule& schedule) {
+  __m128i* rk = (__m128i*)schedule.roundKeys;
+  __m128i k = _mm_loadu_si128((const __m128i*)key);
+  rk[0] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x01)); rk[1] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x02)); rk[2] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x04)); rk[3] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x08)); rk[4] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x10)); rk[5] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x20)); rk[6] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x40)); rk[7] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x80)); rk[8] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x1B)); rk[9] = k;
+  k = expandStep(k, _mm_aeskeygenassist_si128(k, 0x36)); rk[10] = k;
+}
+
+// Encrypt one block with AESENC
+__attribute__((target("aes,sse2")))
+void LoRaAesNiBackend::encryptBlock(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out) {
+  const __m128i* rk = (const __m128i*)schedule.roundKeys;
+  __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)in), rk[0]);
+  for (uint8_t round = 1; round < 10; round++) {
+    b = _mm_aesenc_si128(b, rk[round]);
+  }
+  _mm_storeu_si128((__m128i*)out, _mm_aesenclast_si128(b, rk[10]));
+}
+
+// Encrypt four independent blocks at a time to hide AESENC latency
+__attribute__((target("aes,sse2")))
+void LoRaAesNiBackend::encryptBlocks(const LoRaAesSchedule& schedule, const uint8_t* in, uint8_t* out, size_t blocks) {
+  const __m128i* rk = (const __m128i*)schedule.roundKeys;
+  size_t i = 0;
+  for (; i + 4 <= blocks; i += 4) {
+    __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[i * 16]), rk[0]);
+    __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[i * 16 + 16]), rk[0]);
+    __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[i * 16 + 32]), rk[0]);
+    __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&in[i * 16 + 48]), rk[0]);
+    for (uint8_t round = 1; round < 10; round++) {
+      b0 = _mm_aesenc_si128(b0, rk[round]);
+      b1 = _mm_aesenc_si128(b1, rk[round]);
+      b2 = _mm_aesenc_si128(b2, rk[round]);
+      b3 = _mm_aesenc_si128(b3, rk[round]);
+    }
+    _mm_storeu_si128((__m128i*)&out[i * 16], _mm_aesenclast_si128(b0, rk[10]));
+    _mm_storeu_si128((__m128i*)&out[i * 16 + 16], _mm_aesenclast_si128(b1, rk[10]));
+    _mm_storeu_si128((__m128i*)&out[i * 16 + 32], _mm_aesenclast_si128(b2, rk[10]));
+    _mm_storeu_si128((__m128i*)&out[i * 16 + 48], _mm_aesenclast_si128(b3, rk[10]));
+  }
+  for (; i < blocks; i++) {
+    encryptBlock(schedule, &in[i * 16], &out[i * 16]);
+  }
+}
+#endif
+
+namespace LoRaCrypto {
+
+// Get the software backend
+LoRaCryptoBackend& softwareBackend() {
+  static LoRaSoftAesBackend backend;
+  return backend;
+}
+
+// Get the fastest backend supported on this platform
+LoRaCryptoBackend& defaultBackend() {
+#if defined(ESP32)
+  static LoRaEsp32AesBackend backend;
+  return backend;
+#elif defined(LORA_CRYPTO_HAS_AESNI)
+  static LoRaAesNiBackend backend;
+  if (backend.isSupported()) {
+    return backend;
+  }
+  return softwareBackend();
+#else
+  return softwareBackend();
+#endif
+}
+
+// Double a value in GF(2^128) for the CMAC subkeys
+static void gfDouble(const uint8_t* in, uint8_t* out) {
+  uint8_t carry = in[0] & 0x80;
+  for (uint8_t i = 0; i < 15; i++) {
+    out[i] = (uint8_t)((in[i] << 1) | (in[i + 1] >> 7));
+  }
+  out[15] = (uint8_t)(in[15] << 1);
+  if (carry) {
+    out[15] ^= 0x87;
+  }
+}
+
+// Expand a key and derive its CMAC subkeys
+void prepare(LoRaCryptoBackend& backend, const uint8_t* key, LoRaAesSchedule& schedule) {
+  backend.expandKey(key, schedule);
+
+  uint8_t l[16] = {0};
+  backend.encryptBlock(schedule, l, l);
+  gfDouble(l, schedule.cmacK1);
+  gfDouble(schedule.cmacK1, schedule.cmacK2);
+  memset(l, 0, sizeof(l));
+}
+
+// AES-128 CMAC (RFC 4493)
+void cmac(LoRaCryptoBackend& backend, const LoRaAesSchedule& schedule, const uint8_t* data, size_t len, uint8_t* mac) {
+  uint8_t x[16] = {0};
+
+  // All complete blocks except the last one
+  size_t fullBlocks = (len == 0) ? 0 : (len - 1) / 16;
+  for (size_t b = 0; b < fullBlocks; b++) {
+    for (uint8_t i = 0; i < 16; i++) {
+      x[i] ^= data[b * 16 + i];
+    }
+    backend.encryptBlock(schedule, x, x);
+  }
+
+  // Last block: complete blocks use K1, padded blocks use K2
+  size_t rest = len - fullBlocks * 16;
+  const uint8_t* subkey = (rest == 16) ? schedule.cmacK1 : schedule.cmacK2;
+  for (uint8_t i = 0; i < 16; i++) {
+    uint8_t m = (i < rest) ? data[fullBlocks * 16 + i] : (i == rest ? 0x80 : 0x00);
+    x[i] ^= (uint8_t)(m ^ subkey[i]);
+  }
+  backend.encryptBlock(schedule, x, mac);
+}
+
+// AES-128 counter mode
+void ctr(LoRaCryptoBackend& backend, const LoRaAesSchedule& schedule, const uint8_t* counterBlock,
+         const uint8_t* in, uint8_t* out, size_t len) {
+  uint8_t counters[64];
+  uint8_t keystream[64];
+  uint16_t counter = (uint16_t)((counterBlock[14] << 8) | counterBlock[15]);
+
+  size_t pos = 0;
+  while (pos < len) {
+    // Build up to four counter blocks and encrypt them in one call
+    size_t chunk = len - pos;
+    if (chunk > sizeof(keystream)) {
+      chunk = sizeof(keystream);
+    }
+    size_t blocks = (chunk + 15) / 16;
+    for (size_t b = 0; b < blocks; b++) {
+      memcpy(&counters[b * 16], counterBlock, 14);
+      counters[b * 16 + 14] = (uint8_t)(counter >> 8);
+      counters[b * 16 + 15] = (uint8_t)counter;
+      counter++;
+    }
+    backend.encryptBlocks(schedule, counters, keystream, blocks);
+
+    for (size_t i = 0; i < chunk; i++) {
+      out[pos + i] = (uint8_t)(in[pos + i] ^ keystream[i]);
+    }
+    pos += chunk;
+  }
+  memset(keystream, 0, sizeof(keystream));
+}
+
+} // namespace LoRaCrypto
@@ -0,0 +1,200 @@
+#include "LoRaDiagnostics.h"
+#include <string.h>
+
+#if defined(ESP32)
+#include <esp_system.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#endif
+
+// Write 16 and 32-bit values MSB first
+static uint8_t* put16(uint8_t* out, uint16_t value) {
+  out[0] = (uint8_t)(value >> 8);
+  out[1] = (uint8_t)(value & 0xFF);
+  return out + 2;
+}
+
+static uint8_t* put32(uint8_t* out, uint32_t value) {
+  out = put16(out, (uint16_t)(value >> 16));
+  return put16(out, (uint16_t)(value & 0xFFFF));
+}
+
+// Clamp to the int16 range of the snapshot fields
+static int16_t clamp16(long value) {
+  return (int16_t)(value < -32768 ? -32768 : (value > 32767 ? 32767 : value));
+}
+
+// Constructor
+LoRaDiagnostics::LoRaDiagnostics()
+  : lastUplinkMs(0),
+    uplinks(0),
+    failedUplinks(0),
+    retries(0),
+    joins(0),
+    failedJoins(0),
+    errorHead(0),
+    dumpId(0),
+    sentLen(0),
+    chunkLen(0),
+    failures(0),
+    requested(false),
+    dumping(false) {
+  memset(&stats, 0, sizeof(stats));
+  memset(errors, 0, sizeof(errors));
+  memset(snapshot, 0, sizeof(snapshot));
+}
+
+// Record the outcome of an uplink
+void LoRaDiagnostics::recordUplink(uint8_t attempts, bool sent, uint32_t now) {
+  uplinks++;
+  if (!sent) {
+    failedUplinks++;
+  }
+  if (attempts > 1) {
+    retries += attempts - 1;
+  }
+  lastUplinkMs = now;
+}
+
+// Record the outcome of a join
+void LoRaDiagnostics::recordJoin(uint8_t attempts, bool joined) {
+  joins += attempts;
+  if (!joined) {
+    failedJoins++;
+  }
+}
+
+// Remember an error code in the ring
+void LoRaDiagnostics::recordError(int code) {
+  errors[errorHead] = clamp16(code);
+  errorHead = (uint8_t)((errorHead + 1) % LORA_DIAG_ERRORS);
+}
+
+// Take a dump request; a repeat of the dump in progress is ignored
+bool LoRaDiagnostics::acceptRequest(const uint8_t* payload, size_t len) {
+  uint8_t id = len > 0 ? payload[0] : (uint8_t)(dumpId + 1);
+  if ((requested || dumping) && id == dumpId) {
+    stats.duplicates++;
+    return false;
+  }
+  stats.requests++;
+  dumpId = id;
+  requested = true;
+  dumping = false;
+  return true;
+}
+
+// Check if a requested snapshot has not been taken yet
+bool LoRaDiagnostics::isRequested() const {
+  return requested;
+}
+
+// Serialize the snapshot; fixed size, one pass
+void LoRaDiagnostics::capture(const LoRaDiagState& state, uint32_t now) {
+  uint8_t* p = snapshot;
+  *p++ = LORA_DIAG_FORMAT;
+  *p++ = state.flags;
+  p = put32(p, now / 1000);
+  p = put16(p, (uint16_t)clamp16(state.lastError));
+  for (uint8_t i = 1; i <= LORA_DIAG_ERRORS; i++) {
+    p = put16(p, (uint16_t)errors[(errorHead + LORA_DIAG_ERRORS - i) % LORA_DIAG_ERRORS]);
+  }
+  p = put16(p, uplinks);
+  p = put16(p, failedUplinks);
+  p = put16(p, retries);
+  p = put16(p, joins);
+  p = put16(p, failedJoins);
+  *p++ = state.consecutiveErrors;
+  p = put16(p, (uint16_t)clamp16((long)state.rssi));
+  float snrSteps = state.snr * 4;
+  *p++ = (uint8_t)(int8_t)(snrSteps < -128 ? -128 : (snrSteps > 127 ? 127 : snrSteps));
+  *p++ = state.datarate;
+  *p++ = (uint8_t)state.txPowerDbm;
+  *p++ = state.queued;
+  *p++ = state.relayQueued;
+  p = put32(p, state.airtimeMs);
+  p = put32(p, state.airtimeAvailableMs);
+  p = put32(p, minFreeHeap());
+  uint32_t headroom = stackHeadroom();
+  p = put16(p, (uint16_t)(headroom > 0xFFFF ? 0xFFFF : headroom));
+  *p++ = (uint8_t)((state.healthyRadios << 4) | (state.radios & 0x0F));
+  p = put16(p, state.configVersion);
+
+  requested = false;
+  dumping = true;
+  sentLen = 0;
+  chunkLen = 0;
+  failures = 0;
+}
+
+// Check if snapshot bytes are waiting to be sent
+bool LoRaDiagnostics::hasChunk() const {
+  return dumping;
+}
+
+// Get the time of the last uplink recorded
+uint32_t LoRaDiagnostics::getLastUplink() const {
+  return lastUplinkMs;
+}
+
+// Write the next chunk, as much of the snapshot as the frame takes
+size_t LoRaDiagnostics::buildChunk(uint8_t* out, size_t maxLen) {
+  if (!dumping || maxLen <= LORA_DIAG_HEADER_LEN) {
+    return 0;
+  }
+  size_t len = LORA_DIAG_SNAPSHOT_LEN - sentLen;
+  if (len > maxLen - LORA_DIAG_HEADER_LEN) {
+    len = maxLen - LORA_DIAG_HEADER_LEN;
+  }
+  out[0] = dumpId;
+  out[1] = sentLen;
+  out[2] = LORA_DIAG_SNAPSHOT_LEN;
+  memcpy(&out[LORA_DIAG_HEADER_LEN], &snapshot[sentLen], len);
+  chunkLen = (uint8_t)len;
+  return LORA_DIAG_HEADER_LEN + len;
+}
+
+// Move on after a sent chunk; give the dump up after repeated failures
+void LoRaDiagnostics::confirmChunk(bool sent) {
+  if (!dumping) {
+    return;
+  }
+  if (!sent) {
+    if (++failures >= LORA_DIAG_MAX_FAILURES) {
+      stats.abandoned++;
+      dumping = false;
+    }
+    return;
+  }
+  failures = 0;
+  sentLen += chunkLen;
+  chunkLen = 0;
+  stats.chunks++;
+  if (sentLen >= LORA_DIAG_SNAPSHOT_LEN) {
+    stats.completed++;
+    dumping = false;
+  }
+}
+
+// Get the diagnostics statistics
+const LoRaDiagStats& LoRaDiagnostics::getStats() const {
+  return stats;
+}
+
+// Lowest free heap since boot
+uint32_t LoRaDiagnostics::minFreeHeap() {
+#if defined(ESP32)
+  return esp_get_minimum_free_heap_size();
+#else
+  return 0;
+#endif
+}
+
+// Stack high-water mark of the calling task (ESP-IDF counts bytes)
+uint32_t LoRaDiagnostics::stackHeadroom() {
+#if defined(ESP32)
+  return uxTaskGetStackHighWaterMark(nullptr);
+#else
+  return 0;
+#endif
+}
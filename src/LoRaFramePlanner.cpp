@@ -0,0 +1,85 @@
+#include "LoRaFramePlanner.h"
+#include <string.h>
+
+namespace LoRaFramePlanner {
+
+// LoRa 125 kHz data rates everywhere, 500 kHz ones only in fixed channel plans
+bool isDefaultDatarate(uint8_t bandType, uint8_t datarate) {
+  const LoRaDatarate& dr = LoRaRegions::datarate(bandType, datarate);
+  return datarate < LORA_REGION_DATARATES && dr.maxPayload > 0 && dr.spreadingFactor > 0 &&
+         (dr.bandwidth == 125 || (dr.bandwidth == 500 && LoRaRegions::get(bandType).subBands > 0));
+}
+
+// Plan a frame: keep the data rate, move up as little as needed, or split
+bool plan(uint8_t bandType, uint8_t datarate, size_t frameLen, bool dwellTime, LoRaFramePlan& plan) {
+  memset(&plan, 0, sizeof(plan));
+  plan.datarate = datarate;
+  plan.fragments = 1;
+  plan.maxLen = (uint8_t)LoRaRegions::maxPayload(bandType, datarate, dwellTime);
+  if (frameLen <= plan.maxLen) {
+    plan.action = LORA_FRAME_FITS;
+    return true;
+  }
+
+  // Slowest faster data rate the frame fits at; remember the first one carrying anything
+  uint8_t fallback = plan.maxLen > 0 ? datarate : LORA_REGION_DATARATES;
+  for (uint8_t dr = datarate + 1; dr < LORA_REGION_DATARATES; dr++) {
+    if (!isDefaultDatarate(bandType, dr)) {
+      continue;
+    }
+    size_t maxLen = LoRaRegions::maxPayload(bandType, dr, dwellTime);
+    if (frameLen <= maxLen) {
+      plan.action = LORA_FRAME_CHANGE_DR;
+      plan.datarate = dr;
+      plan.maxLen = (uint8_t)maxLen;
+      return true;
+    }
+    if (fallback == LORA_REGION_DATARATES && maxLen > 0) {
+      fallback = dr;
+    }
+  }
+  if (fallback == LORA_REGION_DATARATES) {
+    return false;
+  }
+
+  // Fits nowhere: split it at the most robust data rate that carries payload
+  plan.action = LORA_FRAME_FRAGMENT;
+  plan.datarate = fallback;
+  plan.maxLen = (uint8_t)LoRaRegions::maxPayload(bandType, fallback, dwellTime);
+  size_t fragments = (frameLen + plan.maxLen - 1) / plan.maxLen;
+  plan.fragments = (uint8_t)(fragments < 0xFF ? fragments : 0xFF);
+  return true;
+}
+
+// Fastest data rate that carries the frame with margin to spare, else the most robust that carries it
+uint8_t selectDatarate(uint8_t bandType, size_t frameLen, bool dwellTime, float snr, float marginDb,
+                       uint8_t minDatarate, uint8_t maxDatarate, float& margin) {
+  uint8_t best = LORA_REGION_DATARATES;
+  uint8_t slowest = LORA_REGION_DATARATES;
+  float slowestMargin = 0;
+  for (uint8_t dr = minDatarate; dr <= maxDatarate && dr < LORA_REGION_DATARATES; dr++) {
+    if (!isDefaultDatarate(bandType, dr) || frameLen > LoRaRegions::maxPayload(bandType, dr, dwellTime)) {
+      continue;
+    }
+
+    // Wider channels collect more noise: 3 dB per doubling of the bandwidth
+    const LoRaDatarate& params = LoRaRegions::datarate(bandType, dr);
+    float bandwidthPenalty = params.bandwidth == 500 ? 6.0f : (params.bandwidth == 250 ? 3.0f : 0.0f);
+    float drMargin = snr - LoRaRegions::requiredSnr(params.spreadingFactor) - bandwidthPenalty;
+    if (slowest == LORA_REGION_DATARATES) {
+      slowest = dr;
+      slowestMargin = drMargin;
+    }
+    if (drMargin >= marginDb) {
+      best = dr;
+      margin = drMargin;
+    }
+  }
+  if (best == LORA_REGION_DATARATES) {
+    margin = slowestMargin;
+    return slowest;
+  }
+  return best;
+}
+
+} // namespace LoRaFramePlanner
@@ -0,0 +1,91 @@
+#include "LoRaHex.h"
+#include <string.h>
+
+namespace LoRaHex {
+
+// Nibble lookup table: 0x00-0x0F for hex digits, 0x80 for everything else.
+// Decoding a pair is two loads and an OR; validity is checked with one mask.
+static const uint8_t NIBBLE_TABLE[256] = {
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+  0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+};
+
+static const uint8_t NIBBLE_INVALID_BIT = 0x80;
+
+// Convert a hex string of known length to a byte array
+bool parse(const char* hex, size_t hexLen, uint8_t* result, size_t resultLen) {
+  if (hex == nullptr || result == nullptr || resultLen == 0 || hexLen != resultLen * 2) {
+    return false;
+  }
+
+  // Validate everything first so a bad string never leaves a half-written key
+  uint8_t invalid = 0;
+  for (size_t i = 0; i < hexLen; i++) {
+    invalid |= NIBBLE_TABLE[(uint8_t)hex[i]];
+  }
+  if (invalid & NIBBLE_INVALID_BIT) {
+    return false;
+  }
+
+  for (size_t i = 0; i < resultLen; i++) {
+    result[i] = (uint8_t)((NIBBLE_TABLE[(uint8_t)hex[2 * i]] << 4) | NIBBLE_TABLE[(uint8_t)hex[2 * i + 1]]);
+  }
+
+  return true;
+}
+
+// Convert a null-terminated hex string to a byte array
+bool parse(const char* hex, uint8_t* result, size_t resultLen) {
+  if (hex == nullptr) {
+    return false;
+  }
+
+  // Never scan further than one character past the expected length
+  size_t hexLen = strnlen(hex, resultLen * 2 + 1);
+  return parse(hex, hexLen, result, resultLen);
+}
+
+// Convert a hex string of known length to a key
+bool parseKey(const char* hex, size_t hexLen, LoRaKey& result) {
+  return parse(hex, hexLen, result.bytes, sizeof(result.bytes));
+}
+
+// Convert a hex string of known length to an EUI
+bool parseEui(const char* hex, size_t hexLen, uint64_t& result) {
+  uint8_t bytes[8];
+  if (!parse(hex, hexLen, bytes, sizeof(bytes))) {
+    return false;
+  }
+
+  // EUIs are written MSB first
+  uint64_t value = 0;
+  for (size_t i = 0; i < sizeof(bytes); i++) {
+    value = (value << 8) | bytes[i];
+  }
+  result = value;
+  return true;
+}
+
+// Convert a null-terminated hex string to an EUI
+bool parseEui(const char* hex, uint64_t& result) {
+  if (hex == nullptr) {
+    return false;
+  }
+  return parseEui(hex, strnlen(hex, 17), result);
+}
+
+} // namespace LoRaHex
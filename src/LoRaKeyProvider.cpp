@@ -0,0 +1,331 @@
+#include "LoRaKeyProvider.h"
+#include <string.h>
+
+#if defined(ESP32)
+#include <Preferences.h>
+#endif
+
+// Constructor
+LoRaKeyProvider::LoRaKeyProvider() :
+  useCounter(0) {
+  for (uint8_t i = 0; i < LORA_KEY_CACHE_SIZE; i++) {
+    cache[i].rootKey = LORA_KEY_HANDLE_INVALID;
+    cache[i].lastUsed = 0;
+  }
+}
+
+// Default: one block at a time
+bool LoRaKeyProvider::encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks) {
+  for (size_t i = 0; i < blocks; i++) {
+    if (!encryptBlock(handle, &in[i * 16], &out[i * 16])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Get a derived session key, deriving it only on a cache miss
+LoRaKeyHandle LoRaKeyProvider::getSessionKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock) {
+  useCounter++;
+
+  // Look for an existing derivation, tracking the least recently used slot
+  uint8_t victim = 0;
+  for (uint8_t i = 0; i < LORA_KEY_CACHE_SIZE; i++) {
+    if (cache[i].rootKey == rootKey && memcmp(cache[i].derivationBlock, derivationBlock, 16) == 0) {
+      cache[i].lastUsed = useCounter;
+      return (LoRaKeyHandle)(LORA_KEY_HANDLE_FIRST_DERIVED + i);
+    }
+    if (cache[i].rootKey == LORA_KEY_HANDLE_INVALID) {
+      victim = i;
+    } else if (cache[victim].rootKey != LORA_KEY_HANDLE_INVALID && cache[i].lastUsed < cache[victim].lastUsed) {
+      victim = i;
+    }
+  }
+
+  // Evict and derive into the chosen slot
+  LoRaKeyHandle handle = (LoRaKeyHandle)(LORA_KEY_HANDLE_FIRST_DERIVED + victim);
+  if (cache[victim].rootKey != LORA_KEY_HANDLE_INVALID) {
+    releaseKey(handle);
+    cache[victim].rootKey = LORA_KEY_HANDLE_INVALID;
+  }
+
+  if (!deriveKey(rootKey, derivationBlock, handle)) {
+    return LORA_KEY_HANDLE_INVALID;
+  }
+
+  cache[victim].rootKey = rootKey;
+  memcpy(cache[victim].derivationBlock, derivationBlock, 16);
+  cache[victim].lastUsed = useCounter;
+  return handle;
+}
+
+// Forget all derived keys
+void LoRaKeyProvider::clearSessionKeys() {
+  for (uint8_t i = 0; i < LORA_KEY_CACHE_SIZE; i++) {
+    if (cache[i].rootKey != LORA_KEY_HANDLE_INVALID) {
+      releaseKey((LoRaKeyHandle)(LORA_KEY_HANDLE_FIRST_DERIVED + i));
+      cache[i].rootKey = LORA_KEY_HANDLE_INVALID;
+    }
+  }
+}
+
+// Overwrite a buffer through a volatile pointer so the store is not elided
+void LoRaKeyProvider::wipe(void* buffer, size_t len) {
+  volatile uint8_t* p = (volatile uint8_t*)buffer;
+  while (len--) {
+    *p++ = 0;
+  }
+}
+
+// Constructor
+LoRaSoftKeyStore::LoRaSoftKeyStore(LoRaCryptoBackend& backend) :
+  backend(backend) {
+  memset(keys, 0, sizeof(keys));
+  memset(schedules, 0, sizeof(schedules));
+  memset(present, 0, sizeof(present));
+}
+
+// Destructor
+LoRaSoftKeyStore::~LoRaSoftKeyStore() {
+  wipe(keys, sizeof(keys));
+  wipe(schedules, sizeof(schedules));
+}
+
+// Store a key
+bool LoRaSoftKeyStore::setKey(LoRaKeyHandle handle, const uint8_t* key) {
+  if (handle >= SLOT_COUNT || key == nullptr) {
+    return false;
+  }
+
+  // A new root key invalidates everything derived from the old one
+  if (handle < LORA_KEY_HANDLE_FIRST_DERIVED && present[handle]) {
+    clearSessionKeys();
+  }
+
+  memcpy(keys[handle].bytes, key, 16);
+  LoRaCrypto::prepare(backend, key, schedules[handle]);
+  present[handle] = true;
+  return true;
+}
+
+// Check if a key is available
+bool LoRaSoftKeyStore::hasKey(LoRaKeyHandle handle) {
+  return handle < SLOT_COUNT && present[handle];
+}
+
+// Encrypt a single block
+bool LoRaSoftKeyStore::encryptBlock(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out) {
+  if (!hasKey(handle)) {
+    return false;
+  }
+  backend.encryptBlock(schedules[handle], in, out);
+  return true;
+}
+
+// Encrypt several blocks in one backend call
+bool LoRaSoftKeyStore::encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks) {
+  if (!hasKey(handle)) {
+    return false;
+  }
+  backend.encryptBlocks(schedules[handle], in, out, blocks);
+  return true;
+}
+
+// Compute an AES-128 CMAC
+bool LoRaSoftKeyStore::computeCmac(LoRaKeyHandle handle, const uint8_t* data, size_t len, uint8_t* mac) {
+  if (!hasKey(handle)) {
+    return false;
+  }
+  LoRaCrypto::cmac(backend, schedules[handle], data, len, mac);
+  return true;
+}
+
+// Copy a raw key out of the store
+bool LoRaSoftKeyStore::exportKey(LoRaKeyHandle handle, uint8_t* key) {
+  if (!hasKey(handle)) {
+    return false;
+  }
+  memcpy(key, keys[handle].bytes, 16);
+  return true;
+}
+
+// Derive a key and store it under a handle
+bool LoRaSoftKeyStore::deriveKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock, LoRaKeyHandle handle) {
+  if (handle < LORA_KEY_HANDLE_FIRST_DERIVED || handle >= SLOT_COUNT) {
+    return false;
+  }
+  uint8_t derived[16];
+  if (!encryptBlock(rootKey, derivationBlock, derived)) {
+    return false;
+  }
+  memcpy(keys[handle].bytes, derived, 16);
+  LoRaCrypto::prepare(backend, derived, schedules[handle]);
+  wipe(derived, sizeof(derived));
+  present[handle] = true;
+  return true;
+}
+
+// Wipe and remove a key
+void LoRaSoftKeyStore::removeKey(LoRaKeyHandle handle) {
+  if (handle < SLOT_COUNT) {
+    wipe(keys[handle].bytes, 16);
+    wipe(&schedules[handle], sizeof(schedules[handle]));
+    present[handle] = false;
+  }
+}
+
+// Release a derived key
+void LoRaSoftKeyStore::releaseKey(LoRaKeyHandle handle) {
+  removeKey(handle);
+}
+
+#if defined(ESP32)
+// NVS entry names for the root keys
+static const char* nvsKeyName(LoRaKeyHandle handle) {
+  switch (handle) {
+    case LORA_KEY_HANDLE_APP_KEY:
+      return "appkey";
+    case LORA_KEY_HANDLE_NWK_KEY:
+      return "nwkkey";
+    case LORA_KEY_HANDLE_E2E_KEY:
+      return "e2ekey";
+    default:
+      return nullptr;
+  }
+}
+
+// Constructor
+LoRaNvsKeyStore::LoRaNvsKeyStore(const char* nvsNamespace, LoRaCryptoBackend& backend) :
+  nvsNamespace(nvsNamespace),
+  backend(backend),
+  sessionKeys(backend) {
+}
+
+// Write a root key to NVS
+bool LoRaNvsKeyStore::storeKey(LoRaKeyHandle handle, const uint8_t* key) {
+  const char* name = nvsKeyName(handle);
+  if (name == nullptr || key == nullptr) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(nvsNamespace, false)) {
+    return false;
+  }
+  size_t written = prefs.putBytes(name, key, 16);
+  prefs.end();
+
+  clearSessionKeys();
+  return written == 16;
+}
+
+// Read a root key into a caller-provided buffer
+bool LoRaNvsKeyStore::loadRootKey(LoRaKeyHandle handle, uint8_t* key) {
+  const char* name = nvsKeyName(handle);
+  if (name == nullptr) {
+    return false;
+  }
+
+  Preferences prefs;
+  if (!prefs.begin(nvsNamespace, true)) {
+    return false;
+  }
+  size_t readLen = prefs.getBytes(name, key, 16);
+  prefs.end();
+  return readLen == 16;
+}
+
+// Check if a key is available
+bool LoRaNvsKeyStore::hasKey(LoRaKeyHandle handle) {
+  if (handle >= LORA_KEY_HANDLE_FIRST_DERIVED) {
+    return sessionKeys.hasKey(handle);
+  }
+
+  uint8_t key[16];
+  bool found = loadRootKey(handle, key);
+  wipe(key, sizeof(key));
+  return found;
+}
+
+// Encrypt a single block
+bool LoRaNvsKeyStore::encryptBlock(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out) {
+  if (handle >= LORA_KEY_HANDLE_FIRST_DERIVED) {
+    return sessionKeys.encryptBlock(handle, in, out);
+  }
+
+  uint8_t key[16];
+  if (!loadRootKey(handle, key)) {
+    return false;
+  }
+  LoRaAesSchedule schedule;
+  backend.expandKey(key, schedule);
+  backend.encryptBlock(schedule, in, out);
+
+  // Leave neither the key nor its schedule behind
+  wipe(key, sizeof(key));
+  wipe(&schedule, sizeof(schedule));
+  return true;
+}
+
+// Encrypt several blocks with one NVS read and one key expansion
+bool LoRaNvsKeyStore::encryptBlocks(LoRaKeyHandle handle, const uint8_t* in, uint8_t* out, size_t blocks) {
+  if (handle >= LORA_KEY_HANDLE_FIRST_DERIVED) {
+    return sessionKeys.encryptBlocks(handle, in, out, blocks);
+  }
+
+  uint8_t key[16];
+  if (!loadRootKey(handle, key)) {
+    return false;
+  }
+  LoRaAesSchedule schedule;
+  backend.expandKey(key, schedule);
+  backend.encryptBlocks(schedule, in, out, blocks);
+
+  wipe(key, sizeof(key));
+  wipe(&schedule, sizeof(schedule));
+  return true;
+}
+
+// Compute an AES-128 CMAC
+bool LoRaNvsKeyStore::computeCmac(LoRaKeyHandle handle, const uint8_t* data, size_t len, uint8_t* mac) {
+  if (handle >= LORA_KEY_HANDLE_FIRST_DERIVED) {
+    return sessionKeys.computeCmac(handle, data, len, mac);
+  }
+
+  uint8_t key[16];
+  if (!loadRootKey(handle, key)) {
+    return false;
+  }
+  LoRaAesSchedule schedule;
+  LoRaCrypto::prepare(backend, key, schedule);
+  LoRaCrypto::cmac(backend, schedule, data, len, mac);
+
+  wipe(key, sizeof(key));
+  wipe(&schedule, sizeof(schedule));
+  return true;
+}
+
+// Copy a raw key out of the store
+bool LoRaNvsKeyStore::exportKey(LoRaKeyHandle handle, uint8_t* key) {
+  if (handle >= LORA_KEY_HANDLE_FIRST_DERIVED) {
+    return sessionKeys.exportKey(handle, key);
+  }
+  return loadRootKey(handle, key);
+}
+
+// Derive a key and keep it in the session store
+bool LoRaNvsKeyStore::deriveKey(LoRaKeyHandle rootKey, const uint8_t* derivationBlock, LoRaKeyHandle handle) {
+  uint8_t derived[16];
+  if (!encryptBlock(rootKey, derivationBlock, derived)) {
+    return false;
+  }
+  bool stored = sessionKeys.setKey(handle, derived);
+  wipe(derived, sizeof(derived));
+  return stored;
+}
+
+// Release a derived key
+void LoRaNvsKeyStore::releaseKey(LoRaKeyHandle handle) {
+  sessionKeys.removeKey(handle);
+}
+#endif
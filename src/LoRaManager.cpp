@@ -28,29 +28,128 @@
 // Initialize static instance pointer
 LoRaManager* LoRaManager::instance = nullptr;
 
+// Claims the radio for one public call; a second caller fails fast instead of waiting
+class RadioClaim {
+public:
+  explicit RadioClaim(std::atomic<bool>& busy) :
+    busy(busy),
+    owned(!busy.exchange(true, std::memory_order_acquire)) {
+  }
+  ~RadioClaim() {
+    if (owned) {
+      busy.store(false, std::memory_order_release);
+    }
+  }
+  bool isOwned() const {
+    return owned;
+  }
+
+private:
+  std::atomic<bool>& busy;
+  bool owned;
+};
+
+// Compare an uplink with a staged or prepared one
+static bool isSamePayload(const uint8_t* data, size_t len, uint8_t port,
+                          const uint8_t* other, uint8_t otherLen, uint8_t otherPort) {
+  return port == otherPort && len == otherLen && memcmp(data, other, len) == 0;
+}
+
+// Errors that point at the transceiver rather than the network
+static bool isRadioFault(int state) {
+  return state == RADIOLIB_ERR_TX_TIMEOUT || state == RADIOLIB_ERR_CHIP_NOT_FOUND ||
+         state == RADIOLIB_ERR_SPI_CMD_TIMEOUT || state == RADIOLIB_ERR_SPI_CMD_INVALID ||
+         state == RADIOLIB_ERR_SPI_CMD_FAILED;
+}
+
+// Rejections LoRaWANNode raises before the radio is keyed; nothing went on air
+static bool isRejectedBeforeTx(int state) {
+  return state == RADIOLIB_ERR_NO_CHANNEL_AVAILABLE || state == RADIOLIB_ERR_DWELL_TIME_EXCEEDED ||
+         state == RADIOLIB_ERR_PACKET_TOO_LONG || state == RADIOLIB_ERR_NETWORK_NOT_JOINED ||
+         state == RADIOLIB_ERR_UPLINK_UNAVAILABLE;
+}
+
 // Constructor with configurable frequency band and subband
 LoRaManager::LoRaManager(LoRaWANBand_t freqBand, uint8_t subBand) : 
+  driver(nullptr),
+  ownedDriver(nullptr),
   radio(nullptr),
   node(nullptr),
+  activeRadio(0),
   joinEUI(0),
   devEUI(0),
+  keyProvider(&softKeyStore),
   freqBand(freqBand),
   subBand(subBand),
   isJoined(false),
   lastRssi(0),
   lastSnr(0),
+  consecutiveTransmitErrors(0),
   receivedBytes(0),
   lastErrorCode(RADIOLIB_ERR_NONE),
-  consecutiveTransmitErrors(0),
-  downlinkCallback(nullptr) {
+  radioBusy(false),
+  queuedUplinks(0),
+  linkSeq(0),
+  downlinkCallback(nullptr),
+  appCryptoProvider(nullptr),
+  fCntUpOffset(0),
+  relayEnabled(false),
+  lastRelayScan(0),
+  rpcEnabled(false),
+  configCallback(nullptr),
+  remoteConfigEnabled(false),
+  diagnosticsEnabled(false),
+  sessionTable(nullptr),
+  sessionStore(nullptr),
+  virtualCredentials(nullptr),
+  virtualUplink(nullptr),
+  virtualDownlink(nullptr),
+  ownJoined(false),
+  p2pEnabled(false),
+  p2pListenPeriod(0),
+  p2pWakePreamble(0),
+  lastP2PScan(0),
+  p2pCallback(nullptr),
+  uplinkDatarate(1),
+  planCallback(nullptr),
+  planSampleInterval(0),
+  planBytesPerSample(0),
+  planHeaderBytes(0),
+  planPort(1),
+  plannedDatarate(0xFF),
+  stagedLen(0),
+  stagedPort(0),
+  preparedLen(0),
+  preparedPort(0),
+  staged(false),
+  prepared(false),
+  preparedFCnt(0),
+  uplinkInFlight(false),
+  inFlightFCnt(0),
+  rxWaitCallback(nullptr),
+  bandType(LoRaRegions::bandType(freqBand.bandNum)),
+  dwellTimeUp(LoRaRegions::get(bandType).dwellByDefault),
+  maxEirp(LoRaRegions::get(bandType).maxEirp),
+  datarateSelection(false),
+  datarateMargin(LORA_DR_DEFAULT_MARGIN_DB),
+  minSelectedDatarate(0),
+  maxSelectedDatarate(LORA_REGION_DATARATES - 1),
+  downlinkSnr(0),
+  hasDownlinkSnr(false),
+  powerControlEnabled(false),
+  networkTxPower(0) {
+  memset(&pipelineStats, 0, sizeof(pipelineStats));
+  memset(&datarateStats, 0, sizeof(datarateStats));
+  updatePowerCeiling();
+  memset(radioDrivers, 0, sizeof(radioDrivers));
+  memset(radioNodes, 0, sizeof(radioNodes));
   
   // Set this instance as the active one
   instance = this;
   
   // Initialize arrays
-  memset(appKey, 0, sizeof(appKey));
-  memset(nwkKey, 0, sizeof(nwkKey));
   memset(receivedData, 0, sizeof(receivedData));
+  memset(&p2pPhy, 0, sizeof(p2pPhy));
   
   // Log selected frequency band using bandNum instead of name
   Serial.print(F("[LoRaManager] Selected frequency band: "));
@@ -63,15 +162,18 @@ LoRaManager::LoRaManager(LoRaWANBand_t freqBand, uint8_t subBand) :
 // Destructor
 LoRaManager::~LoRaManager() {
   // Clean up allocated resources
-  if (node != nullptr) {
-    delete node;
-    node = nullptr;
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    delete radioNodes[i];
+    radioNodes[i] = nullptr;
   }
+  node = nullptr;
   
-  if (radio != nullptr) {
-    delete radio;
-    radio = nullptr;
+  if (ownedDriver != nullptr) {
+    delete ownedDriver;
+    ownedDriver = nullptr;
   }
+  driver = nullptr;
+  radio = nullptr;
   
   // Clear the instance pointer
   if (instance == this) {
@@ -81,52 +183,26 @@ LoRaManager::~LoRaManager() {
 
 // Get band type based on band number
 uint8_t LoRaManager::getBandType() const {
-  // Check band number instead of name
-  if (freqBand.bandNum == 0) {
-    return BAND_TYPE_OTHER;
-  }
-  
-  // Use band number to determine type
-  // US915 is typically band number 2
-  if (freqBand.bandNum == 2) {
-    return BAND_TYPE_US915;
-  } 
-  // EU868 is typically band number 1
-  else if (freqBand.bandNum == 1) {
-    return BAND_TYPE_EU868;
-  }
-  
-  return BAND_TYPE_OTHER;
+  return bandType;
+}
+
+// Get the regional parameters of the current band
+const LoRaRegion& LoRaManager::getRegion() const {
+  return LoRaRegions::get(bandType);
 }
 
 // Initialize the LoRa module
 bool LoRaManager::begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pinBusy) {
-  // Store the error code
-  lastErrorCode = RADIOLIB_ERR_NONE;
-  
-  // Create a new Module instance
-  Module* module = new Module(pinCS, pinDIO1, pinReset, pinBusy);
-  
   // Debug output
   Serial.println(F("[LoRaManager] Creating SX1262 instance..."));
   
-  // Create a new SX1262 instance
-  radio = new SX1262(module);
-  
-  // Initialize the radio with more detailed error reporting
-  Serial.print(F("[SX1262] Initializing ... "));
+  // Create the default SX1262 driver
+  if (ownedDriver != nullptr) {
+    delete ownedDriver;
+  }
+  ownedDriver = new LoRaSx1262Driver(pinCS, pinDIO1, pinReset, pinBusy);
   
-  // Initialize the radio with more robust error handling
-  int state = radio->begin();
-  if (state == RADIOLIB_ERR_NONE) {
-    Serial.println(F("success!"));
-  } else {
-    Serial.print(F("failed, code "));
-    Serial.println(state);
-    
-    // Store the error code
-    lastErrorCode = state;
-    
+  if (!begin(*ownedDriver)) {
     // Additional debug info
     Serial.println(F("[SX1262] Debug info:"));
     Serial.print(F("  CS pin: "));
@@ -140,19 +216,36 @@ bool LoRaManager::begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pi
     
     return false;
   }
+  return true;
+}
 
-  // Log frequency band configuration using band number
-  const char* bandName;
-  switch(freqBand.bandNum) {
-    case 1:
-      bandName = "EU868";
-      break;
-    case 2:
-      bandName = "US915";
-      break;
-    default:
-      bandName = "Custom";
+// Initialize with a caller-provided radio driver
+bool LoRaManager::begin(LoRaRadioDriver& driver) {
+  // Store the error code
+  lastErrorCode = RADIOLIB_ERR_NONE;
+  
+  this->driver = &driver;
+  radio = driver.getPhysicalLayer();
+  
+  // Initialize the radio with more detailed error reporting
+  Serial.print(F("["));
+  Serial.print(driver.getName());
+  Serial.print(F("] Initializing ... "));
+  
+  int state = driver.begin();
+  if (state == RADIOLIB_ERR_NONE) {
+    Serial.println(F("success!"));
+  } else {
+    Serial.print(F("failed, code "));
+    Serial.println(state);
+    
+    // Store the error code
+    lastErrorCode = state;
+    return false;
   }
+
+  // Log frequency band configuration using band number
+  const char* bandName = getRegion().name;
   
   Serial.print(F("[LoRaManager] Configuring LoRaWAN for "));
   Serial.print(bandName);
@@ -161,6 +254,12 @@ bool LoRaManager::begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pi
   // Initialize the node with the configured region and subband
   // For US915, the subband parameter will automatically configure the correct channels
   node = new LoRaWANNode(radio, &freqBand, subBand);
+  
+  // RX window waits go through onRadioSleep so they can do pipelined work
+  node->setSleepFunction(onRadioSleep);
+  
+  // The first transceiver of the pool
+  activeRadio = registerRadio(&driver, node);
 
   // Log detailed band configuration
   Serial.print(F("[LoRaManager] Using "));
@@ -168,9 +267,8 @@ bool LoRaManager::begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pi
   Serial.print(F(" region with subband: "));
   Serial.println(subBand);
   
-  // If using US915, log additional information about channels
-  uint8_t bandType = getBandType();
-  if (bandType == BAND_TYPE_US915) {
+  // If using a fixed channel plan, log additional information about channels
+  if (getRegion().subBands > 0) {
     Serial.print(F("[LoRaManager] This will enable channels for subband "));
     Serial.println(subBand);
   }
@@ -192,6 +290,130 @@ bool LoRaManager::begin(int8_t pinCS, int8_t pinDIO1, int8_t pinReset, int8_t pi
   return true;
 }
 
+// Add another transceiver for load balancing and failover
+bool LoRaManager::addRadio(LoRaRadioDriver& driver) {
+  if (node == nullptr || isJoined) {
+    Serial.println(F("[LoRaManager] Add radios after begin() and before joinNetwork()"));
+    return false;
+  }
+  if (radioPool.size() >= LORA_MAX_RADIOS) {
+    Serial.println(F("[LoRaManager] No room for another radio"));
+    return false;
+  }
+  
+  Serial.print(F("["));
+  Serial.print(driver.getName());
+  Serial.print(F("] Initializing additional radio ... "));
+  
+  int state = driver.begin();
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("failed, code "));
+    Serial.println(state);
+    lastErrorCode = state;
+    return false;
+  }
+  Serial.println(F("success!"));
+  
+  // A node of its own, so the session can be handed over between uplinks
+  LoRaWANNode* radioNode = new LoRaWANNode(driver.getPhysicalLayer(), &freqBand, subBand);
+  radioNode->setSleepFunction(onRadioSleep);
+  uint64_t defaultEUI = 0x0000000000000000;
+  uint8_t defaultKey[16] = {0};
+  radioNode->beginOTAA(defaultEUI, defaultEUI, defaultKey, defaultKey);
+  
+  uint8_t index = registerRadio(&driver, radioNode);
+  Serial.print(F("[LoRaManager] Radio "));
+  Serial.print(index);
+  Serial.println(F(" added"));
+  return true;
+}
+
+// Add an initialized transceiver and its node to the pool
+uint8_t LoRaManager::registerRadio(LoRaRadioDriver* driver, LoRaWANNode* radioNode) {
+  uint8_t index = radioPool.add();
+  if (index == LORA_RADIO_NONE) {
+    return index;
+  }
+  radioDrivers[index] = driver;
+  radioNodes[index] = radioNode;
+  if (datarateSelection || powerControlEnabled) {
+    radioNode->setADR(false);
+  }
+  
+  // Regional duty cycles apply to each transmitter
+  uint16_t dutyCycleFactor = getRegion().dutyCycleFactor;
+  if (dutyCycleFactor > 0) {
+    radioPool.setDutyCycle(index, LORA_RADIO_DUTY_PERIOD_MS / dutyCycleFactor, LORA_RADIO_DUTY_PERIOD_MS, millis());
+  }
+  return index;
+}
+
+// Set the duty-cycle budget of one transceiver
+bool LoRaManager::setRadioDutyCycle(uint8_t index, uint32_t budgetMs, uint32_t periodMs) {
+  if (index >= radioPool.size()) {
+    return false;
+  }
+  radioPool.setDutyCycle(index, budgetMs, periodMs, millis());
+  return true;
+}
+
+// Get the number of transceivers
+uint8_t LoRaManager::getRadioCount() const {
+  return radioPool.size();
+}
+
+// Get the transceiver that carried the last uplink
+uint8_t LoRaManager::getActiveRadio() const {
+  return activeRadio;
+}
+
+// Get the statistics of one transceiver
+LoRaRadioStats LoRaManager::getRadioStats(uint8_t index) const {
+  return radioPool.getStats(index);
+}
+
+// Move the LoRaWAN session to another transceiver
+bool LoRaManager::switchRadio(uint8_t index) {
+  if (index == activeRadio) {
+    return true;
+  }
+  
+  // The nonces carry the key checksum the session is verified against
+  LoRaWANNode* target = radioNodes[index];
+  int state = target->setBufferNonces(node->getBufferNonces());
+  if (state == RADIOLIB_ERR_NONE) {
+    state = target->setBufferSession(node->getBufferSession());
+  }
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[LoRaManager] Session handover to radio "));
+    Serial.print(index);
+    Serial.print(F(" failed, code "));
+    Serial.println(state);
+    return false;
+  }
+  
+  activeRadio = index;
+  node = target;
+  driver = radioDrivers[index];
+  radio = driver->getPhysicalLayer();
+  return true;
+}
+
+// Re-initialize transceivers that are due for a probe
+void LoRaManager::probeRadios() {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    if (!radioPool.isProbeDue(i, now)) {
+      continue;
+    }
+    bool ok = radioDrivers[i]->begin() == RADIOLIB_ERR_NONE;
+    radioPool.reportProbe(i, ok, now);
+    Serial.print(F("[LoRaManager] Radio "));
+    Serial.print(i);
+    Serial.println(ok ? F(" back in service") : F(" still failing"));
+  }
+}
+
 // Configure subband channel mask based on the current subband
 int LoRaManager::configureSubbandChannels(uint8_t targetSubBand) {
   if (!node) {
@@ -199,15 +421,15 @@ int LoRaManager::configureSubbandChannels(uint8_t targetSubBand) {
     return RADIOLIB_ERR_INVALID_STATE;
   }
   
-  // Only applicable for US915
-  uint8_t bandType = getBandType();
-  if (bandType != BAND_TYPE_US915) {
-    Serial.println(F("[LoRaWAN] Subband configuration only applies to US915"));
+  // Only applicable for fixed channel plans (US915, AU915)
+  uint8_t subBands = getRegion().subBands;
+  if (subBands == 0) {
+    Serial.println(F("[LoRaWAN] Subband configuration only applies to US915 and AU915"));
     return RADIOLIB_ERR_NONE;
   }
   
   // Validate subband (1-8)
-  if (targetSubBand < 1 || targetSubBand > 8) {
+  if (targetSubBand < 1 || targetSubBand > subBands) {
     Serial.println(F("[LoRaWAN] Invalid subband, must be 1-8"));
     return RADIOLIB_ERR_INVALID_INPUT;
   }
@@ -221,57 +443,78 @@ int LoRaManager::configureSubbandChannels(uint8_t targetSubBand) {
   return RADIOLIB_ERR_NONE;
 }
 
-// Convert hex string to byte array
-bool LoRaManager::hexStringToByteArray(const String& hexString, uint8_t* result, size_t resultLen) {
-  // Check if the string length is valid (2 chars per byte)
-  if (hexString.length() != resultLen * 2) {
-    Serial.println(F("[LoRaManager] Invalid hex string length"));
-    return false;
-  }
-  
-  // Convert each pair of hex chars to a byte
-  for (size_t i = 0; i < resultLen; i++) {
-    // Get the two hex characters
-    String byteStr = hexString.substring(i * 2, i * 2 + 2);
-    
-    // Convert to integer
-    char* endPtr;
-    uint8_t byteVal = strtol(byteStr.c_str(), &endPtr, 16);
-    
-    // Check if conversion was successful
-    if (*endPtr != '\0') {
-      Serial.println(F("[LoRaManager] Invalid hex character in string"));
-      return false;
-    }
-    
-    // Store the byte value
-    result[i] = byteVal;
-  }
+// Set the LoRaWAN credentials
+void LoRaManager::setCredentials(uint64_t joinEUI, uint64_t devEUI, const uint8_t* appKey, const uint8_t* nwkKey) {
+  this->joinEUI = joinEUI;
+  this->devEUI = devEUI;
   
-  return true;
+  // Keep the keys in the built-in software store
+  softKeyStore.setKey(LORA_KEY_HANDLE_APP_KEY, appKey);
+  softKeyStore.setKey(LORA_KEY_HANDLE_NWK_KEY, nwkKey);
+  keyProvider = &softKeyStore;
 }
 
-// Set the LoRaWAN credentials
-void LoRaManager::setCredentials(uint64_t joinEUI, uint64_t devEUI, uint8_t* appKey, uint8_t* nwkKey) {
+// Set the LoRaWAN EUIs and use an external key provider for the keys
+void LoRaManager::setCredentials(uint64_t joinEUI, uint64_t devEUI, LoRaKeyProvider& keyProvider) {
   this->joinEUI = joinEUI;
   this->devEUI = devEUI;
   
-  // Copy the keys
-  memcpy(this->appKey, appKey, 16);
-  memcpy(this->nwkKey, nwkKey, 16);
+  // Don't keep copies of keys the external provider now owns
+  softKeyStore.removeKey(LORA_KEY_HANDLE_APP_KEY);
+  softKeyStore.removeKey(LORA_KEY_HANDLE_NWK_KEY);
+  softKeyStore.clearSessionKeys();
+  this->keyProvider = &keyProvider;
+}
+
+// Get the key provider currently in use
+LoRaKeyProvider& LoRaManager::getKeyProvider() {
+  return *keyProvider;
+}
+
+// Set the LoRaWAN credentials from decoded keys
+void LoRaManager::setCredentials(uint64_t joinEUI, uint64_t devEUI, const LoRaKey& appKey, const LoRaKey& nwkKey) {
+  setCredentials(joinEUI, devEUI, appKey.bytes, nwkKey.bytes);
+}
+
+// Set the LoRaWAN credentials from a provisioning record
+void LoRaManager::setCredentials(const LoRaCredentials& credentials) {
+  setCredentials(credentials.joinEUI, credentials.devEUI, credentials.appKey, credentials.nwkKey);
 }
 
 // Set the LoRaWAN credentials using hex strings for keys
 bool LoRaManager::setCredentialsHex(uint64_t joinEUI, uint64_t devEUI, const String& appKeyHex, const String& nwkKeyHex) {
-  this->joinEUI = joinEUI;
-  this->devEUI = devEUI;
+  // Decode into temporaries so a bad string leaves the current keys intact
+  LoRaKey appKeyValue;
+  LoRaKey nwkKeyValue;
+  if (!LoRaHex::parseKey(appKeyHex.c_str(), appKeyHex.length(), appKeyValue) ||
+      !LoRaHex::parseKey(nwkKeyHex.c_str(), nwkKeyHex.length(), nwkKeyValue)) {
+    Serial.println(F("[LoRaManager] Invalid hex key, expected 32 hex characters"));
+    return false;
+  }
+  
+  setCredentials(joinEUI, devEUI, appKeyValue, nwkKeyValue);
+  return true;
+}
+
+// Set all LoRaWAN credentials, including the EUIs, from hex strings
+bool LoRaManager::setCredentialsHexEui(const char* joinEUIHex, const char* devEUIHex, const char* appKeyHex, const char* nwkKeyHex) {
+  uint64_t joinEUIValue;
+  uint64_t devEUIValue;
+  if (!LoRaHex::parseEui(joinEUIHex, joinEUIValue) || !LoRaHex::parseEui(devEUIHex, devEUIValue)) {
+    Serial.println(F("[LoRaManager] Invalid hex EUI, expected 16 hex characters"));
+    return false;
+  }
   
-  // Convert hex strings to byte arrays
-  bool appKeyResult = hexStringToByteArray(appKeyHex, this->appKey, 16);
-  bool nwkKeyResult = hexStringToByteArray(nwkKeyHex, this->nwkKey, 16);
+  LoRaKey appKeyValue;
+  LoRaKey nwkKeyValue;
+  if (!LoRaHex::parse(appKeyHex, appKeyValue.bytes, sizeof(appKeyValue.bytes)) ||
+      !LoRaHex::parse(nwkKeyHex, nwkKeyValue.bytes, sizeof(nwkKeyValue.bytes))) {
+    Serial.println(F("[LoRaManager] Invalid hex key, expected 32 hex characters"));
+    return false;
+  }
   
-  // Return true only if both conversions were successful
-  return appKeyResult && nwkKeyResult;
+  setCredentials(joinEUIValue, devEUIValue, appKeyValue, nwkKeyValue);
+  return true;
 }
 
 // Set the callback function for downlink data
@@ -280,345 +523,1834 @@ void LoRaManager::setDownlinkCallback(DownlinkCallback callback) {
   Serial.println(F("[LoRaManager] Downlink callback registered"));
 }
 
-// Join the LoRaWAN network
-bool LoRaManager::joinNetwork() {
-  if (node == nullptr) {
-    Serial.println(F("[LoRaWAN] Node not initialized!"));
-    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+// Enable application-layer encryption with a key held in the built-in key store
+void LoRaManager::enableAppEncryption(const uint8_t* e2eKey) {
+  softKeyStore.setKey(LORA_KEY_HANDLE_E2E_KEY, e2eKey);
+  appCryptoProvider = &softKeyStore;
+  Serial.println(F("[LoRaManager] Application-layer encryption enabled"));
+}
+
+// Enable application-layer encryption with a key held by a key provider
+bool LoRaManager::enableAppEncryption(LoRaKeyProvider& keyProvider) {
+  if (!keyProvider.hasKey(LORA_KEY_HANDLE_E2E_KEY)) {
+    Serial.println(F("[LoRaManager] Key provider has no end-to-end key"));
     return false;
   }
   
-  // Maximum number of join attempts
-  const uint8_t maxAttempts = 5;
-  uint8_t attemptCount = 0;
-  
-  // Initial backoff delay in milliseconds
-  uint16_t backoffDelay = 1000;
-  
-  // Try multiple times with exponential backoff
-  while (attemptCount < maxAttempts) {
-    // Increment attempt counter
-    attemptCount++;
-    
-    // Attempt to join the network
-    Serial.print(F("[LoRaWAN] Attempting over-the-air activation (attempt "));
-    Serial.print(attemptCount);
-    Serial.print(F(" of "));
-    Serial.print(maxAttempts);
-    Serial.print(F(") ... "));
-    
-    // Set the proper credentials before activation
-    node->beginOTAA(joinEUI, devEUI, nwkKey, appKey);
-    
-    // Select a subband based on the attempt number
-    uint8_t currentSubBand = attemptCount == 1 ? subBand : (1 + (attemptCount % 8)); // Start with configured subband, then try others
-    
-    // Configure channels for the selected subband (US915 only)
-    uint8_t bandType = getBandType();
-    if (bandType == BAND_TYPE_US915) {
-      int maskResult = configureSubbandChannels(currentSubBand);
-      
-      // If we couldn't set the channel mask, try the next attempt
-      if (maskResult != RADIOLIB_ERR_NONE) {
-        Serial.println(F("[LoRaWAN] Continuing with default channel configuration"));
-      }
-    }
+  softKeyStore.removeKey(LORA_KEY_HANDLE_E2E_KEY);
+  appCryptoProvider = &keyProvider;
+  Serial.println(F("[LoRaManager] Application-layer encryption enabled"));
+  return true;
+}
 
-    // Try to join the network
-    int state = node->activateOTAA();
-    lastErrorCode = state;
-    
-    // Check for successful join or new session status
-    if (state == RADIOLIB_ERR_NONE || state == RADIOLIB_LORAWAN_NEW_SESSION) {
-      // Successfully joined
-      isJoined = true;
-      
-      // Configure the data rate for reliability
-      Serial.println(F("[LoRaWAN] Setting data rate to DR1 for reliability"));
-      node->setDatarate(1);
-      
-      // Reset frame counters to ensure a clean session
-      node->resetFCntDown();
-      
-      // Send an initial small packet to confirm the join and establish the session fully
-      uint8_t testData[] = {0x01};
-      int sendState = node->sendReceive(testData, sizeof(testData), 1);
-      
-      if (sendState == RADIOLIB_ERR_NONE || sendState > 0) {
-        // Successfully sent the initial packet and potentially received a downlink
-        Serial.println(F("success! (new session started)"));
-        return true;
-      } else {
-        // Session started but initial message failed
-        Serial.println(F("session started but initial message failed, code "));
-        Serial.println(sendState);
-        // We'll still consider this a success since the join worked
-        return true;
-      }
-    } else {
-      // Join attempt failed
-      Serial.print(F("failed, code "));
-      Serial.println(state);
-      
-      if (state == RADIOLIB_ERR_NETWORK_NOT_JOINED) {
-        // Node rejected by network - try a different subband or wait longer
-        Serial.println(F("[LoRaWAN] Rejected by network. Will try again with different parameters."));
-      } else if (state == RADIOLIB_ERR_TX_TIMEOUT) {
-        // Signal problem - check antenna, power, or location
-        Serial.println(F("[LoRaWAN] Transmission timeout. Check antenna, signal strength, or move to better location."));
-      } else {
-        // Other error, print for debugging
-        Serial.print(F("[LoRaWAN] Error code: "));
-        Serial.println(state);
-      }
-      
-      // Wait a bit before the next attempt (with exponential backoff)
-      delay(backoffDelay);
-      backoffDelay *= 2;  // Exponential backoff
-      
-      // Cap the backoff delay at 30 seconds
-      if (backoffDelay > 30000) {
-        backoffDelay = 30000;
-      }
-    }
-  }
-  
-  // If we got here, all attempts failed
-  isJoined = false;
-  lastErrorCode = RADIOLIB_ERR_NETWORK_NOT_JOINED;
-  Serial.println(F("[LoRaWAN] Failed to join after maximum attempts."));
-  return false;
+// Disable application-layer encryption
+void LoRaManager::disableAppEncryption() {
+  softKeyStore.removeKey(LORA_KEY_HANDLE_E2E_KEY);
+  appCryptoProvider = nullptr;
 }
 
-// Send data to the LoRaWAN network
-bool LoRaManager::sendData(uint8_t* data, size_t len, uint8_t port, bool confirmed) {
-  // Check if we are joined to the network
-  if (!isJoined) {
-    Serial.println(F("[LoRaWAN] Not joined to network, cannot send data"));
-    lastErrorCode = RADIOLIB_ERR_NETWORK_NOT_JOINED;
-    return false;
-  }
+// Check if application-layer encryption is enabled
+bool LoRaManager::isAppEncryptionEnabled() const {
+  return appCryptoProvider != nullptr;
+}
+
+// Get the end-to-end key of the current session from the nonces of its join
+LoRaKeyHandle LoRaManager::getAppSessionKey() {
+  const uint8_t* nonces = node->getBufferNonces();
   
-  // Check for valid data
-  if (data == nullptr || len == 0) {
-    Serial.println(F("[LoRaWAN] Invalid data for transmission"));
-    lastErrorCode = RADIOLIB_ERR_INVALID_INPUT;
+  // RadioLib keeps the DevNonce of the next Join-Request, one past this session's
+  uint16_t devNonce = (uint16_t)((nonces[RADIOLIB_LORAWAN_NONCES_DEV_NONCE] |
+                                  (nonces[RADIOLIB_LORAWAN_NONCES_DEV_NONCE + 1] << 8)) - 1);
+  uint32_t joinNonce = (uint32_t)nonces[RADIOLIB_LORAWAN_NONCES_JOIN_NONCE] |
+                       ((uint32_t)nonces[RADIOLIB_LORAWAN_NONCES_JOIN_NONCE + 1] << 8) |
+                       ((uint32_t)nonces[RADIOLIB_LORAWAN_NONCES_JOIN_NONCE + 2] << 16);
+  return LoRaAppCrypto::sessionKey(*appCryptoProvider, joinNonce, joinEUI, devNonce);
+}
+
+// Limit the uplink airtime of all ports together
+void LoRaManager::setAirtimeLimit(uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs) {
+  airtimeLimiter.setGlobalLimit(budgetMs, periodMs, burstMs, millis());
+}
+
+// Limit the uplink airtime of one port
+bool LoRaManager::setPortAirtimeLimit(uint8_t port, uint32_t budgetMs, uint32_t periodMs, uint32_t burstMs) {
+  return airtimeLimiter.setPortLimit(port, budgetMs, periodMs, burstMs, millis());
+}
+
+// Get the earliest time a port may send a payload under the airtime limits
+uint32_t LoRaManager::getEarliestSendTime(uint8_t port, size_t len) {
+  uint32_t now = millis();
+  uint32_t wait = airtimeLimiter.getWait(port, estimateAirtime(getUplinkLength(len, port)), now);
+  return wait == LORA_AIRTIME_NEVER ? LORA_AIRTIME_NEVER : now + wait;
+}
+
+// Get the airtime limiter
+const LoRaAirtimeLimiter& LoRaManager::getAirtimeLimiter() const {
+  return airtimeLimiter;
+}
+
+// Get the modulation of a LoRaWAN data rate in the current band
+bool LoRaManager::getDatarateParams(uint8_t datarate, uint8_t& spreadingFactor, float& bandwidth) const {
+  const LoRaDatarate& dr = LoRaRegions::datarate(bandType, datarate);
+  spreadingFactor = dr.spreadingFactor;
+  bandwidth = dr.bandwidth;
+  return datarate < LORA_REGION_DATARATES && dr.maxPayload > 0;
+}
+
+// Get the largest application payload of a data rate in the current band
+size_t LoRaManager::getMaxPayload(uint8_t datarate) const {
+  return LoRaRegions::maxPayload(bandType, datarate, dwellTimeUp);
+}
+
+// Check an uplink against the regional limits before it is sent
+bool LoRaManager::planFrame(size_t len, uint8_t port, LoRaFramePlan& plan) {
+  size_t frameLen = getUplinkLength(len, port);
+  if (!LoRaFramePlanner::plan(bandType, uplinkDatarate, frameLen, dwellTimeUp, plan)) {
     return false;
   }
   
-  // Maximum number of transmission attempts
-  const uint8_t maxAttempts = 3;
+  // The planner counts frame bytes; each fragment carries its own encryption tag
+  size_t tagLen = frameLen - len;
+  if (plan.maxLen <= tagLen) {
+    return false;
+  }
+  plan.maxLen = (uint8_t)(plan.maxLen - tagLen);
+  if (plan.action == LORA_FRAME_FRAGMENT) {
+    size_t fragments = (len + plan.maxLen - 1) / plan.maxLen;
+    plan.fragments = (uint8_t)(fragments < 0xFF ? fragments : 0xFF);
+    frameLen = plan.maxLen + tagLen;
+  }
+  
+  // Then the airtime budgets, for the frame at the planned data rate
+  uint32_t now = millis();
+  plan.airtimeMs = estimateAirtimeAt(frameLen, plan.datarate);
+  uint32_t wait = airtimeLimiter.getWait(port, plan.airtimeMs, now);
+  uint32_t radioWait = radioPool.getWait(plan.airtimeMs, now);
+  plan.waitMs = radioWait > wait ? radioWait : wait;
+  if (plan.waitMs > 0 && plan.action != LORA_FRAME_FRAGMENT) {
+    plan.action = LORA_FRAME_DEFER;
+  }
+  return true;
+}
+
+// Choose the data rate of every uplink from its size and the link margin
+void LoRaManager::enableDatarateSelection(float marginDb, uint8_t minDatarate, uint8_t maxDatarate) {
+  datarateMargin = marginDb;
+  minSelectedDatarate = minDatarate;
+  maxSelectedDatarate = maxDatarate;
+  datarateSelection = true;
+  updateAdr();
+}
+
+// Stop per-frame data rate selection
+void LoRaManager::disableDatarateSelection() {
+  datarateSelection = false;
+  updateAdr();
+}
+
+// Network ADR runs only while neither the data rate nor the power is chosen locally
+void LoRaManager::updateAdr() {
+  bool adr = !datarateSelection && !powerControlEnabled;
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    radioNodes[i]->setADR(adr);
+  }
+}
+
+// Get the data rate decisions made for uplinks
+LoRaDatarateStats LoRaManager::getDatarateStats() const {
+  return datarateStats;
+}
+
+// Pick the data rate of the next uplink from its size and the last downlink's SNR
+void LoRaManager::selectUplinkDatarate(size_t len, uint8_t port) {
+  if (!hasDownlinkSnr) {
+    datarateStats.noLinkInfo++;
+    return;
+  }
+  float margin = 0;
+  uint8_t datarate = LoRaFramePlanner::selectDatarate(bandType, getUplinkLength(len, port), dwellTimeUp,
+                                                       downlinkSnr, datarateMargin,
+                                                       minSelectedDatarate, maxSelectedDatarate, margin);
+  if (datarate == LORA_REGION_DATARATES) {
+    // Fits no allowed data rate; planFrame() decides what happens
+    return;
+  }
+  if (margin < datarateMargin) {
+    datarateStats.belowMargin++;
+  }
+  datarateStats.lastMarginDb = margin;
+  if (datarate != uplinkDatarate) {
+    node->setDatarate(datarate);
+    uplinkDatarate = datarate;
+  }
+}
+
+// Control the transmit power from the link margin
+void LoRaManager::enablePowerControl(float marginDb, int8_t minDbm, int8_t maxDbm) {
+  powerControl.configure(minDbm, maxDbm, marginDb, LORA_POWER_DEFAULT_HYSTERESIS_DB);
+  updatePowerCeiling();
+  powerControlEnabled = true;
+  updateAdr();
+}
+
+// Stop transmit power control and go back to the ceiling
+void LoRaManager::disablePowerControl() {
+  powerControlEnabled = false;
+  powerControl.configure(LORA_POWER_MIN_DBM, LORA_POWER_MAX_DBM, LORA_POWER_DEFAULT_MARGIN_DB,
+                         LORA_POWER_DEFAULT_HYSTERESIS_DB);
+  updatePowerCeiling();
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    radioNodes[i]->setTxPower(powerControl.getCeiling());
+  }
+  updateAdr();
+}
+
+// Set the TXPower index of the network's last LinkADRReq
+void LoRaManager::setNetworkTxPower(uint8_t txPower) {
+  networkTxPower = txPower;
+  updatePowerCeiling();
+}
+
+// Get the transmit power and energy statistics
+LoRaPowerStats LoRaManager::getPowerStats() const {
+  return powerControl.getStats();
+}
+
+// The power ceiling is the max EIRP less 2 dB per LinkADRReq TXPower step
+void LoRaManager::updatePowerCeiling() {
+  int ceiling = maxEirp - LORA_POWER_STEP_DB * networkTxPower;
+  powerControl.setCeiling((int8_t)(ceiling > -128 ? ceiling : -128));
+}
+
+// Set the uplink transmit parameters of TxParamSetupReq
+void LoRaManager::setTxParams(bool dwellTime, int8_t maxEirpDbm) {
+  dwellTimeUp = dwellTime;
+  maxEirp = maxEirpDbm;
+  updatePowerCeiling();
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    radioNodes[i]->setDwellTime(dwellTime, getRegion().dwellTimeMs);
+  }
+}
+
+// Check if the uplink dwell time is in force
+bool LoRaManager::isDwellTimeEnabled() const {
+  return dwellTimeUp;
+}
+
+// Get the maximum EIRP allowed for uplinks
+int8_t LoRaManager::getMaxEirp() const {
+  return maxEirp;
+}
+
+// Get the length sendData() puts on air for a payload
+size_t LoRaManager::getUplinkLength(size_t len, uint8_t port) const {
+  if (appCryptoProvider != nullptr && port > 0 && port < 224) {
+    return len + LORA_APP_CRYPTO_TAG_LEN;
+  }
+  return len;
+}
+
+// Get the shortest interval at which a payload can be sent indefinitely
+uint32_t LoRaManager::getSustainableInterval(size_t len, uint8_t port) {
+  uint32_t airtimeMs = estimateAirtime(getUplinkLength(len, port));
+  uint16_t dutyCycleFactor = getRegion().dutyCycleFactor;
+  
+  // Each transceiver has its own duty cycle, so their uplink rates add up
+  uint32_t budgetMs;
+  uint32_t periodMs;
+  uint32_t interval = LoRaAirtime::sustainableIntervalMs(airtimeMs, dutyCycleFactor, 0, 0);
+  float uplinksPerMs = 0;
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    if (!radioPool.getStats(i).healthy) {
+      continue;
+    }
+    uint32_t radioInterval = airtimeMs;
+    if (radioPool.getDutyCycle(i, budgetMs, periodMs)) {
+      radioInterval = LoRaAirtime::sustainableIntervalMs(airtimeMs, 0, budgetMs, periodMs);
+    }
+    uplinksPerMs += 1.0f / (radioInterval > 0 ? radioInterval : 1);
+  }
+  if (uplinksPerMs > 0) {
+    interval = (uint32_t)(1.0f / uplinksPerMs);
+    interval = interval > airtimeMs ? interval : airtimeMs;
+  }
+  if (airtimeLimiter.getGlobalLimit(budgetMs, periodMs)) {
+    uint32_t globalInterval = LoRaAirtime::sustainableIntervalMs(airtimeMs, 0, budgetMs, periodMs);
+    interval = globalInterval > interval ? globalInterval : interval;
+  }
+  if (airtimeLimiter.getPortLimit(port, budgetMs, periodMs)) {
+    uint32_t portInterval = LoRaAirtime::sustainableIntervalMs(airtimeMs, 0, budgetMs, periodMs);
+    interval = portInterval > interval ? portInterval : interval;
+  }
+  return interval;
+}
+
+// Plan how many samples to aggregate per uplink
+bool LoRaManager::planUplinks(uint32_t sampleIntervalMs, size_t bytesPerSample, size_t headerBytes, LoRaUplinkPlan& plan,
+                              uint8_t port) {
+  size_t maxPayload = getMaxPayload(uplinkDatarate);
+  size_t overhead = getUplinkLength(headerBytes, port);
+  if (bytesPerSample == 0 || overhead + bytesPerSample > maxPayload) {
+    return false;
+  }
+  size_t maxSamples = (maxPayload - overhead) / bytesPerSample;
+  if (maxSamples > 255) {
+    maxSamples = 255;
+  }
+  
+  // The fewest samples per uplink keeps latency low; take it as soon as it is sustainable
+  uint8_t samples = 1;
+  uint32_t interval = 0;
+  for (; samples <= maxSamples; samples++) {
+    interval = getSustainableInterval(headerBytes + samples * bytesPerSample, port);
+    if ((uint64_t)samples * sampleIntervalMs >= interval || samples == maxSamples) {
+      break;
+    }
+  }
+  
+  plan.datarate = uplinkDatarate;
+  plan.samplesPerUplink = samples;
+  plan.payloadLen = (uint16_t)(headerBytes + samples * bytesPerSample);
+  plan.airtimeMs = estimateAirtime(getUplinkLength(plan.payloadLen, port));
+  if ((uint64_t)samples * sampleIntervalMs >= interval) {
+    plan.uplinkIntervalMs = samples * sampleIntervalMs;
+    plan.sampleIntervalMs = sampleIntervalMs;
+  } else {
+    // Full frames still can't keep up: sample less often
+    plan.uplinkIntervalMs = interval;
+    plan.sampleIntervalMs = (interval + samples - 1) / samples;
+  }
+  return true;
+}
+
+// Re-plan automatically whenever ADR changes the data rate
+void LoRaManager::enableAutoPlan(UplinkPlanCallback callback, uint32_t sampleIntervalMs, size_t bytesPerSample,
+                                 size_t headerBytes, uint8_t port) {
+  planCallback = callback;
+  planSampleInterval = sampleIntervalMs;
+  planBytesPerSample = (uint16_t)bytesPerSample;
+  planHeaderBytes = (uint16_t)headerBytes;
+  planPort = port;
+  plannedDatarate = 0xFF;
+}
+
+// Stop automatic re-planning
+void LoRaManager::disableAutoPlan() {
+  planCallback = nullptr;
+}
+
+// Stage the payload of the next uplink; a payload already prepared stays until its uplink is sent
+bool LoRaManager::stageUplink(const uint8_t* data, size_t len, uint8_t port) {
+  if (data == nullptr || len == 0 || len > LORA_PIPELINE_MAX_PAYLOAD) {
+    return false;
+  }
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  memcpy(stagedData, data, len);
+  stagedLen = (uint8_t)len;
+  stagedPort = port;
+  staged = true;
+  return true;
+}
+
+// Drop a staged uplink that will not be sent
+bool LoRaManager::unstageUplink(const uint8_t* data, size_t len, uint8_t port) {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  if (data == nullptr) {
+    return true;
+  }
+  if (staged && isSamePayload(data, len, port, stagedData, stagedLen, stagedPort)) {
+    staged = false;
+  }
+  if (prepared && isSamePayload(data, len, port, preparedSource, preparedLen, preparedPort)) {
+    prepared = false;
+    pipelineStats.stale++;
+  }
+  return true;
+}
+
+// Set the RX wait callback
+void LoRaManager::setRxWaitCallback(RxWaitCallback callback) {
+  rxWaitCallback = callback;
+}
+
+// Get the uplink pipelining statistics
+LoRaPipelineStats LoRaManager::getPipelineStats() const {
+  return pipelineStats;
+}
+
+// RadioLib sleep function: do pipelined work, then sleep for the rest of the wait
+void LoRaManager::onRadioSleep(RadioLibTime_t ms) {
+  uint32_t start = millis();
+  if (instance != nullptr && ms >= LORA_PIPELINE_MIN_WAIT_MS) {
+    instance->useRxWait((uint32_t)ms - LORA_PIPELINE_MARGIN_MS);
+  }
+  uint32_t elapsed = millis() - start;
+  if (elapsed < ms) {
+    delay(ms - elapsed);
+  }
+}
+
+// Use part of an RX wait for the staged uplink and the RX wait callback
+void LoRaManager::useRxWait(uint32_t budgetMs) {
+  uint32_t start = millis();
+  
+  // The next uplink carries the FCnt after the one now waiting for its downlink
+  bool sealed = appCryptoProvider != nullptr && stagedPort > 0 && stagedPort < 224;
+  if (uplinkInFlight && staged && !prepared && sealed) {
+    uint32_t sealStart = micros();
+    LoRaKeyHandle sessionKey = getAppSessionKey();
+    if (sessionKey != LORA_KEY_HANDLE_INVALID &&
+        LoRaAppCrypto::seal(*appCryptoProvider, sessionKey, LORA_APP_CRYPTO_UPLINK, devEUI, inFlightFCnt + 1,
+                            stagedPort, stagedData, stagedLen, preparedData)) {
+      // Keep the plaintext to match the uplink against; the staged slot is free for the one after
+      memcpy(preparedSource, stagedData, stagedLen);
+      preparedLen = stagedLen;
+      preparedPort = stagedPort;
+      staged = false;
+      prepared = true;
+      preparedFCnt = inFlightFCnt + 1;
+      pipelineStats.prepared++;
+      pipelineStats.preparedUs += micros() - sealStart;
+    }
+  }
+  
+  uint32_t elapsed = millis() - start;
+  if (rxWaitCallback != nullptr && elapsed < budgetMs) {
+    rxWaitCallback(budgetMs - elapsed);
+  }
+}
+
+// Take an uplink about to be sent off the pipeline, sealed or not
+bool LoRaManager::takePipelinedUplink(const uint8_t* data, size_t len, uint8_t port) {
+  if (staged && isSamePayload(data, len, port, stagedData, stagedLen, stagedPort)) {
+    staged = false;
+  }
+  if (!prepared) {
+    return false;
+  }
+  
+  // The prepared bytes stay valid until this uplink's RX waits prepare the next one
+  prepared = false;
+  if (!isSamePayload(data, len, port, preparedSource, preparedLen, preparedPort)) {
+    pipelineStats.stale++;
+    return false;
+  }
+  return true;
+}
+
+// Estimate the time on air of an uplink at the current data rate
+uint32_t LoRaManager::estimateAirtime(size_t len) {
+  return estimateAirtimeAt(len, uplinkDatarate);
+}
+
+// Estimate the time on air of an uplink at a given data rate
+uint32_t LoRaManager::estimateAirtimeAt(size_t len, uint8_t datarate) const {
+  uint8_t spreadingFactor;
+  float bandwidth;
+  if (!getDatarateParams(datarate, spreadingFactor, bandwidth)) {
+    // Unknown data rate: assume the slowest common one rather than undercharge
+    spreadingFactor = 12;
+    bandwidth = 125.0;
+  }
+  
+  size_t phyLen = len + LORA_AIRTIME_LORAWAN_OVERHEAD;
+  uint32_t airtimeUs = spreadingFactor == 0 ? LoRaAirtime::fskUs(phyLen, bandwidth)
+                                            : LoRaAirtime::loraUs(phyLen, spreadingFactor, bandwidth);
+  return (airtimeUs + 999) / 1000;
+}
+
+// Predict the frame counter of the next uplink
+uint32_t LoRaManager::nextUplinkFCnt() {
+  // getFCntUp() reports the session's uplink counter; fCntUpOffset is learned
+  // from the FCnt RadioLib reports after each uplink, so the prediction stays
+  // correct whichever way the counter is reported
+  return (uint32_t)((int32_t)node->getFCntUp() + fCntUpOffset);
+}
+
+// Join the LoRaWAN network
+bool LoRaManager::joinNetwork() {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  return joinNetworkLocked();
+}
+
+// Load the device's own root keys into every transceiver's node
+bool LoRaManager::loadRootKeys() {
+  // Hand the root keys to RadioLib once, through a stack buffer that is wiped
+  // straight away, rather than keeping copies around for every attempt
+  uint8_t appKeyBuffer[16];
+  uint8_t nwkKeyBuffer[16];
+  if (!keyProvider->exportKey(LORA_KEY_HANDLE_APP_KEY, appKeyBuffer) ||
+      !keyProvider->exportKey(LORA_KEY_HANDLE_NWK_KEY, nwkKeyBuffer)) {
+    LoRaKeyProvider::wipe(appKeyBuffer, sizeof(appKeyBuffer));
+    Serial.println(F("[LoRaWAN] Keys not available from key provider!"));
+    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+    return false;
+  }
+  
+  // Every transceiver's node gets the keys, so the session can move between them
+  for (uint8_t i = 0; i < radioPool.size(); i++) {
+    radioNodes[i]->beginOTAA(joinEUI, devEUI, nwkKeyBuffer, appKeyBuffer);
+  }
+  LoRaKeyProvider::wipe(appKeyBuffer, sizeof(appKeyBuffer));
+  LoRaKeyProvider::wipe(nwkKeyBuffer, sizeof(nwkKeyBuffer));
+  return true;
+}
+
+// Join the LoRaWAN network; the caller holds the radio
+bool LoRaManager::joinNetworkLocked() {
+  if (node == nullptr) {
+    Serial.println(F("[LoRaWAN] Node not initialized!"));
+    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+    return false;
+  }
+  if (sessionTable != nullptr) {
+    Serial.println(F("[LoRaWAN] Node is serving virtual devices"));
+    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+    return false;
+  }
+  
+  if (!loadRootKeys()) {
+    return false;
+  }
+  
+  // A new session invalidates any cached session keys and payloads sealed with them
+  keyProvider->clearSessionKeys();
+  if (appCryptoProvider != nullptr && appCryptoProvider != keyProvider) {
+    appCryptoProvider->clearSessionKeys();
+  }
+  prepared = false;
+  
+  // Maximum number of join attempts
+  const uint8_t maxAttempts = 5;
   uint8_t attemptCount = 0;
   
-  // Check if we need to rejoin
-  // Since isActive is a protected member, we'll just check our isJoined flag
-  if (!isJoined) {
-    Serial.println(F("[LoRaWAN] Not joined, attempting to rejoin the network..."));
-    if (joinNetwork()) {
-      Serial.println(F("[LoRaWAN] Successfully rejoined, will now try to send data"));
+  // Initial backoff delay in milliseconds
+  uint16_t backoffDelay = 1000;
+  
+  // Try multiple times with exponential backoff
+  while (attemptCount < maxAttempts) {
+    // Increment attempt counter
+    attemptCount++;
+    
+    // Attempt to join the network
+    Serial.print(F("[LoRaWAN] Attempting over-the-air activation (attempt "));
+    Serial.print(attemptCount);
+    Serial.print(F(" of "));
+    Serial.print(maxAttempts);
+    Serial.print(F(") ... "));
+    
+    // Select a subband based on the attempt number
+    uint8_t currentSubBand = attemptCount == 1 ? subBand : (1 + (attemptCount % 8)); // Start with configured subband, then try others
+    
+    // Configure channels for the selected subband (fixed channel plans only)
+    if (getRegion().subBands > 0) {
+      int maskResult = configureSubbandChannels(currentSubBand);
+      
+      // If we couldn't set the channel mask, try the next attempt
+      if (maskResult != RADIOLIB_ERR_NONE) {
+        Serial.println(F("[LoRaWAN] Continuing with default channel configuration"));
+      }
+    }
+
+    // Try to join the network
+    int state = node->activateOTAA();
+    lastErrorCode = state;
+    
+    // Check for successful join or new session status
+    if (state == RADIOLIB_ERR_NONE || state == RADIOLIB_LORAWAN_NEW_SESSION) {
+      // Successfully joined
+      isJoined = true;
+      diagnostics.recordJoin(attemptCount, true);
+      
+      // Configure the data rate for reliability
+      Serial.println(F("[LoRaWAN] Setting data rate to DR1 for reliability"));
+      node->setDatarate(1);
+      uplinkDatarate = 1;
+      
+      // Reset frame counters to ensure a clean session
+      node->resetFCntDown();
+      
+      // Send an initial small packet to confirm the join and establish the session fully
+      uint8_t testData[] = {0x01};
+      int sendState = node->sendReceive(testData, sizeof(testData), 1);
+      if (sendState == RADIOLIB_ERR_NONE || sendState > 0) {
+        airtimeLimiter.consume(1, (uint32_t)node->getLastToA(), millis());
+      }
+      
+      if (sendState == RADIOLIB_ERR_NONE || sendState > 0) {
+        // Successfully sent the initial packet and potentially received a downlink
+        Serial.println(F("success! (new session started)"));
+        return true;
+      } else {
+        // Session started but initial message failed
+        Serial.println(F("session started but initial message failed, code "));
+        Serial.println(sendState);
+        // We'll still consider this a success since the join worked
+        return true;
+      }
     } else {
-      Serial.println(F("[LoRaWAN] Rejoin failed, cannot send data"));
-      return false;
+      // Join attempt failed
+      Serial.print(F("failed, code "));
+      Serial.println(state);
+      diagnostics.recordError(state);
+      
+      if (state == RADIOLIB_ERR_NETWORK_NOT_JOINED) {
+        // Node rejected by network - try a different subband or wait longer
+        Serial.println(F("[LoRaWAN] Rejected by network. Will try again with different parameters."));
+      } else if (state == RADIOLIB_ERR_TX_TIMEOUT) {
+        // Signal problem - check antenna, power, or location
+        Serial.println(F("[LoRaWAN] Transmission timeout. Check antenna, signal strength, or move to better location."));
+      } else {
+        // Other error, print for debugging
+        Serial.print(F("[LoRaWAN] Error code: "));
+        Serial.println(state);
+      }
+      
+      // Wait a bit before the next attempt (with exponential backoff)
+      delay(backoffDelay);
+      backoffDelay *= 2;  // Exponential backoff
+      
+      // Cap the backoff delay at 30 seconds
+      if (backoffDelay > 30000) {
+        backoffDelay = 30000;
+      }
     }
   }
   
-  // Retry loop for sending data
-  while (attemptCount < maxAttempts) {
-    // Increment attempt counter
-    attemptCount++;
-    
-    // Send the data
-    Serial.print(F("[LoRaWAN] Sending data (attempt "));
-    Serial.print(attemptCount);
-    Serial.print(F(" of "));
-    Serial.print(maxAttempts);
-    Serial.print(F(") ... "));
+  // If we got here, all attempts failed
+  isJoined = false;
+  lastErrorCode = RADIOLIB_ERR_NETWORK_NOT_JOINED;
+  diagnostics.recordJoin(attemptCount, false);
+  Serial.println(F("[LoRaWAN] Failed to join after maximum attempts."));
+  return false;
+}
+
+// Send data to the LoRaWAN network
+bool LoRaManager::sendData(uint8_t* data, size_t len, uint8_t port, bool confirmed) {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  return sendDataLocked(data, len, port, confirmed);
+}
+
+// Send data to the LoRaWAN network; the caller holds the radio
+bool LoRaManager::sendDataLocked(uint8_t* data, size_t len, uint8_t port, bool confirmed) {
+  // This payload leaves the uplink pipeline whether it goes out or not
+  bool pipelined = data != nullptr && takePipelinedUplink(data, len, port);
+  
+  // Check if we are joined to the network
+  if (!isJoined) {
+    Serial.println(F("[LoRaWAN] Not joined to network, cannot send data"));
+    lastErrorCode = RADIOLIB_ERR_NETWORK_NOT_JOINED;
+    return false;
+  }
+  
+  // Check for valid data
+  if (data == nullptr || len == 0) {
+    Serial.println(F("[LoRaWAN] Invalid data for transmission"));
+    lastErrorCode = RADIOLIB_ERR_INVALID_INPUT;
+    return false;
+  }
+  
+  // Maximum number of transmission attempts
+  const uint8_t maxAttempts = 3;
+  uint8_t attemptCount = 0;
+  
+  // Check if we need to rejoin
+  // Since isActive is a protected member, we'll just check our isJoined flag
+  if (!isJoined) {
+    Serial.println(F("[LoRaWAN] Not joined, attempting to rejoin the network..."));
+    if (joinNetworkLocked()) {
+      Serial.println(F("[LoRaWAN] Successfully rejoined, will now try to send data"));
+    } else {
+      Serial.println(F("[LoRaWAN] Rejoin failed, cannot send data"));
+      return false;
+    }
+  }
+  
+  // Pick this frame's data rate, then check it against the payload and
+  // dwell-time limits before the radio is touched
+  if (datarateSelection) {
+    selectUplinkDatarate(len, port);
+  }
+  LoRaFramePlan framePlan;
+  if (!planFrame(len, port, framePlan) || framePlan.action == LORA_FRAME_FRAGMENT) {
+    Serial.println(F("[LoRaWAN] Payload too long for any usable data rate, split it (see planFrame())"));
+    lastErrorCode = RADIOLIB_ERR_PACKET_TOO_LONG;
+    return false;
+  }
+  if (framePlan.datarate != uplinkDatarate) {
+    Serial.print(F("[LoRaWAN] Payload needs DR"));
+    Serial.print(framePlan.datarate);
+    Serial.println(F(", switching data rate"));
+    node->setDatarate(framePlan.datarate);
+    uplinkDatarate = framePlan.datarate;
+    datarateStats.raisedForPayload++;
+  }
+  datarateStats.frames[uplinkDatarate % LORA_REGION_DATARATES]++;
+  datarateStats.lastDatarate = uplinkDatarate;
+  
+  // Retry loop for sending data
+  while (attemptCount < maxAttempts) {
+    // Increment attempt counter
+    attemptCount++;
+    
+    // Send the data
+    Serial.print(F("[LoRaWAN] Sending data (attempt "));
+    Serial.print(attemptCount);
+    Serial.print(F(" of "));
+    Serial.print(maxAttempts);
+    Serial.print(F(") ... "));
+    
+    // Prepare buffer for downlink
+    uint8_t downlinkData[256];
+    size_t downlinkLen = sizeof(downlinkData);
+    LoRaWANEvent_t eventUp;
+    LoRaWANEvent_t eventDown;
+    memset(&eventUp, 0, sizeof(eventUp));
+    memset(&eventDown, 0, sizeof(eventDown));
+    
+    // Application-layer encryption is bound to the FCnt of this attempt,
+    // so each retry is sealed again
+    const uint8_t* uplinkData = data;
+    size_t uplinkLen = len;
+    uint8_t sealedData[256];
+    uint32_t predictedFCnt = 0;
+    bool sealed = appCryptoProvider != nullptr && port > 0 && port < 224;
+    if (sealed) {
+      predictedFCnt = nextUplinkFCnt();
+      
+      // The payload prepared during the last uplink's RX waits serves the first attempt only
+      bool usePrepared = pipelined && predictedFCnt == preparedFCnt;
+      if (pipelined) {
+        pipelined = false;
+        if (usePrepared) {
+          pipelineStats.hits++;
+        } else {
+          pipelineStats.stale++;
+        }
+      }
+      if (usePrepared) {
+        memcpy(sealedData, preparedData, len + LORA_APP_CRYPTO_TAG_LEN);
+      } else if (len + LORA_APP_CRYPTO_TAG_LEN > sizeof(sealedData) ||
+                 !LoRaAppCrypto::seal(*appCryptoProvider, getAppSessionKey(), LORA_APP_CRYPTO_UPLINK, devEUI,
+                                      predictedFCnt, port, data, len, sealedData)) {
+        Serial.println(F("failed to encrypt payload"));
+        lastErrorCode = LORAMANAGER_ERR_APP_CRYPTO;
+        return false;
+      }
+      uplinkData = sealedData;
+      uplinkLen = len + LORA_APP_CRYPTO_TAG_LEN;
+    }
+    
+    // Enforce the airtime budgets before the radio is touched
+    uint32_t airtimeMs = estimateAirtime(uplinkLen);
+    if (!airtimeLimiter.tryConsume(port, airtimeMs, millis())) {
+      Serial.println(F("airtime budget exhausted"));
+      lastErrorCode = LORAMANAGER_ERR_AIRTIME_LIMIT;
+      return false;
+    }
+    
+    // Send on the healthy transceiver with the most duty-cycle budget left
+    uint8_t radioIndex = radioPool.select(airtimeMs, millis());
+    if (radioIndex == LORA_RADIO_NONE || !switchRadio(radioIndex)) {
+      airtimeLimiter.adjust(port, -(int32_t)airtimeMs);
+      if (radioPool.getHealthyCount() == 0) {
+        Serial.println(F("no radio in service"));
+        lastErrorCode = LORAMANAGER_ERR_NO_RADIO;
+      } else {
+        Serial.println(F("radio duty cycle exhausted"));
+        lastErrorCode = LORAMANAGER_ERR_AIRTIME_LIMIT;
+      }
+      return false;
+    }
+    radioPool.charge(radioIndex, airtimeMs, millis());
+    
+    // Transmit at the power the control loop settled on
+    if (powerControlEnabled) {
+      node->setTxPower(powerControl.getPower());
+    }
+    
+    // Send data and wait for downlink; the RX waits prepare the staged uplink
+    uplinkInFlight = true;
+    inFlightFCnt = sealed ? predictedFCnt : nextUplinkFCnt();
+    int state = node->sendReceive(uplinkData, uplinkLen, port, downlinkData, &downlinkLen, confirmed, &eventUp, &eventDown);
+    uplinkInFlight = false;
+    lastErrorCode = state;
+    
+    // Replace the estimate with the real time on air and track ADR's data rate
+    if (state == RADIOLIB_ERR_NONE || state > 0 || state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
+      airtimeLimiter.adjust(port, (int32_t)node->getLastToA() - (int32_t)airtimeMs);
+      radioPool.reportSent(radioIndex, airtimeMs, (uint32_t)node->getLastToA());
+      powerControl.charge((uint32_t)node->getLastToA());
+      uplinkDatarate = eventUp.datarate;
+      
+      // A different data rate changes the airtime per frame, so re-plan
+      if (planCallback != nullptr && uplinkDatarate != plannedDatarate) {
+        LoRaUplinkPlan plan;
+        if (planUplinks(planSampleInterval, planBytesPerSample, planHeaderBytes, plan, planPort)) {
+          plannedDatarate = uplinkDatarate;
+          planCallback(plan);
+        }
+      }
+    } else if (isRejectedBeforeTx(state)) {
+      // Nothing went on air, so the attempt costs no budget
+      airtimeLimiter.adjust(port, -(int32_t)airtimeMs);
+      radioPool.refund(radioIndex, airtimeMs);
+    }
+    
+    // Learn how the counter RadioLib reports relates to the FCnt on air
+    if (sealed && (state == RADIOLIB_ERR_NONE || state > 0) && eventUp.fCnt != predictedFCnt) {
+      fCntUpOffset += (int32_t)(eventUp.fCnt - predictedFCnt);
+      Serial.println(F("[LoRaWAN] Uplink FCnt prediction corrected, payload may fail to decrypt"));
+    }
+    
+    // Check for successful transmission
+    if (state == RADIOLIB_ERR_NONE || state > 0 || state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
+      if (state > 0) {
+        // Downlink received in window state (1 = RX1, 2 = RX2)
+        Serial.print(F("success! Received downlink in RX"));
+        Serial.println(state);
+        
+        // Process the downlink data
+        if (downlinkLen > 0) {
+          Serial.print(F("[LoRaWAN] Received "));
+          Serial.print(downlinkLen);
+          Serial.println(F(" bytes:"));
+          
+          for (size_t i = 0; i < downlinkLen; i++) {
+            Serial.print(downlinkData[i], HEX);
+            Serial.print(' ');
+          }
+          Serial.println();
+          
+          // Verify and decrypt application payloads before anyone sees them;
+          // frames for relay children are held for delivery instead
+          bool authentic = true;
+          if (relayEnabled && eventDown.fPort == LORA_RELAY_FPORT) {
+            if (!relay.acceptDownlink(downlinkData, downlinkLen)) {
+              Serial.println(F("[Relay] Downlink for child dropped"));
+            }
+            authentic = false;
+          } else if (appCryptoProvider != nullptr && eventDown.fPort > 0 && eventDown.fPort < 224) {
+            authentic = downlinkLen > LORA_APP_CRYPTO_TAG_LEN &&
+                        LoRaAppCrypto::open(*appCryptoProvider, getAppSessionKey(), LORA_APP_CRYPTO_DOWNLINK, devEUI,
+                                            eventDown.fCnt, eventDown.fPort, downlinkData, downlinkLen, downlinkData);
+            if (authentic) {
+              downlinkLen -= LORA_APP_CRYPTO_TAG_LEN;
+            } else {
+              Serial.println(F("[LoRaWAN] Downlink failed application-layer authentication, dropped"));
+              lastErrorCode = LORAMANAGER_ERR_DOWNLINK_AUTH;
+            }
+          }
+          
+          if (authentic && rpcEnabled && eventDown.fPort == LORA_RPC_FPORT) {
+            // Commands run here; their responses go out from handleEvents()
+            rpc.acceptDownlink(downlinkData, downlinkLen, millis());
+          } else if (authentic && remoteConfigEnabled && eventDown.fPort == LORA_CONFIG_FPORT) {
+            // Checked now, applied at the next handleEvents()
+            remoteConfig.acceptPatch(downlinkData, downlinkLen);
+          } else if (authentic && diagnosticsEnabled && eventDown.fPort == LORA_DIAG_FPORT) {
+            // The snapshot is taken at the next handleEvents()
+            diagnostics.acceptRequest(downlinkData, downlinkLen);
+          } else if (authentic) {
+            // Call the callback if registered
+            if (downlinkCallback != nullptr) {
+              downlinkCallback(downlinkData, downlinkLen, eventDown.fPort);
+            }
+            
+            // Copy the data to our buffer
+            memcpy(receivedData, downlinkData, downlinkLen);
+            receivedBytes = downlinkLen;
+          }
+        }
+      } else if (state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
+        // No downlink received but uplink was successful
+        Serial.println(F("success! No downlink received."));
+      } else {
+        // General success
+        Serial.println(F("success!"));
+      }
+      
+      // Get RSSI and SNR
+      publishLinkQuality(radio->getRSSI(), radio->getSNR());
+      
+      // The data rate selection estimates the link from received downlinks only
+      if (state > 0) {
+        downlinkSnr = radio->getSNR();
+        hasDownlinkSnr = true;
+      }
+      
+      // Close the power loop on downlinks; a confirmed uplink without its ACK counts as lost
+      if (powerControlEnabled && state > 0) {
+        const LoRaDatarate& dr = LoRaRegions::datarate(bandType, uplinkDatarate);
+        powerControl.update(radio->getRSSI(), radio->getSNR(), LoRaRegions::requiredSnr(dr.spreadingFactor));
+      } else if (powerControlEnabled && confirmed && state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
+        powerControl.reportLost();
+      }
+      
+      consecutiveTransmitErrors = 0; // Reset error counter on success
+      diagnostics.recordUplink(attemptCount, true, millis());
+      return true;
+    } else {
+      // Error occurred
+      Serial.print(F("failed, code "));
+      Serial.println(state);
+      diagnostics.recordError(state);
+      
+      // Add more specific error handling for common LoRaWAN transmission issues
+      bool shouldRetry = false;
+      
+      // Errors from the transceiver itself count towards taking it out of service;
+      // the retry then prefers the other transceiver
+      if (isRadioFault(state) && radioPool.reportFault(radioIndex, millis())) {
+        Serial.print(F("[LoRaManager] Radio "));
+        Serial.print(radioIndex);
+        Serial.println(F(" taken out of service"));
+      }
+      
+      // Handle different error cases
+      if (state == RADIOLIB_ERR_TX_TIMEOUT) {
+        Serial.println(F("[LoRaWAN] Transmission timeout. Check antenna and signal."));
+        shouldRetry = true;
+      } 
+      else if (state == RADIOLIB_ERR_NETWORK_NOT_JOINED) {
+        Serial.println(F("[LoRaWAN] Network not joined. Will try to rejoin."));
+        isJoined = false; // Force rejoin
+        
+        // Try to rejoin before next attempt
+        if (joinNetworkLocked()) {
+          Serial.println(F("[LoRaWAN] Rejoined successfully, will retry transmission."));
+          shouldRetry = true;
+        } else {
+          Serial.println(F("[LoRaWAN] Failed to rejoin, cannot continue."));
+          shouldRetry = false;
+        }
+      }
+      else if (state == RADIOLIB_ERR_NO_CHANNEL_AVAILABLE) {
+        Serial.println(F("[LoRaWAN] No channel available for the requested data rate."));
+        
+        // Only try different subbands for fixed channel plans
+        if (getRegion().subBands > 0) {
+          // Try selecting a different subband for next attempt
+          uint8_t alternateSubBand = 1 + (attemptCount % 8); // Try different subbands (1-8)
+          Serial.print(F("[LoRaWAN] Will try with subband "));
+          Serial.print(alternateSubBand);
+          Serial.println(F(" for next attempt"));
+          
+          // Configure the alternate subband
+          int maskResult = configureSubbandChannels(alternateSubBand);
+          
+          if (maskResult == RADIOLIB_ERR_NONE) {
+            shouldRetry = true;
+          } else {
+            shouldRetry = false;
+          }
+        } else {
+          Serial.println(F("[LoRaWAN] Subband adjustment not applicable for this region"));
+          shouldRetry = (attemptCount < maxAttempts);
+        }
+      }
+      else if (state == RADIOLIB_ERR_DWELL_TIME_EXCEEDED) {
+        // The network has turned the dwell time on; re-plan under it
+        Serial.println(F("[LoRaWAN] Frame exceeds the dwell time, network enabled TxParamSetup limits."));
+        dwellTimeUp = true;
+        shouldRetry = planFrame(len, port, framePlan) && framePlan.action != LORA_FRAME_FRAGMENT;
+        if (shouldRetry && framePlan.datarate != uplinkDatarate) {
+          node->setDatarate(framePlan.datarate);
+          uplinkDatarate = framePlan.datarate;
+        }
+      }
+      else {
+        // Default case for other errors
+        Serial.println(F("[LoRaWAN] Unknown error during transmission."));
+        shouldRetry = (attemptCount < maxAttempts);
+      }
+      
+      // Track consecutive errors
+      consecutiveTransmitErrors++;
+      
+      // If we should retry and have attempts left
+      if (shouldRetry && attemptCount < maxAttempts) {
+        Serial.print(F("[LoRaWAN] Will retry transmission in 3 seconds (attempt "));
+        Serial.print(attemptCount + 1);
+        Serial.print(F(" of "));
+        Serial.print(maxAttempts);
+        Serial.println(F(")"));
+        
+        // Wait before next attempt
+        delay(3000);
+      } else {
+        // If we've encountered errors multiple times in a row, try rejoining on next transmission
+        if (consecutiveTransmitErrors >= 3) {
+          Serial.println(F("[LoRaWAN] Multiple transmission errors, will attempt to rejoin on next transmission."));
+          isJoined = false; // Force a rejoin on next transmission
+        }
+        
+        diagnostics.recordUplink(attemptCount, false, millis());
+        return false;
+      }
+    }
+  }
+  
+  // If we've reached this point, all attempts failed
+  Serial.println(F("[LoRaWAN] All transmission attempts failed."));
+  diagnostics.recordUplink(attemptCount, false, millis());
+  return false;
+}
+
+// Helper method to send a string
+bool LoRaManager::sendString(const String& data, uint8_t port, bool confirmed) {
+  return sendData((uint8_t*)data.c_str(), data.length(), port, confirmed);
+}
+
+// Get the last RSSI value
+float LoRaManager::getLastRssi() {
+  return lastRssi.load(std::memory_order_relaxed);
+}
+
+// Get the last SNR value
+float LoRaManager::getLastSnr() {
+  return lastSnr.load(std::memory_order_relaxed);
+}
+
+// Check if the device is joined to the network
+bool LoRaManager::isNetworkJoined() {
+  return isJoined.load(std::memory_order_acquire);
+}
+
+// Get a consistent snapshot of the link status
+LoRaStatus LoRaManager::getStatus() const {
+  LoRaStatus status;
+  uint32_t before;
+  uint32_t after;
+  do {
+    before = linkSeq.load(std::memory_order_acquire);
+    status.rssi = lastRssi.load(std::memory_order_relaxed);
+    status.snr = lastSnr.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = linkSeq.load(std::memory_order_relaxed);
+  } while ((before & 1) != 0 || before != after);
+  status.joined = isJoined.load(std::memory_order_acquire);
+  status.errorCode = lastErrorCode.load(std::memory_order_relaxed);
+  status.busy = radioBusy.load(std::memory_order_relaxed);
+  return status;
+}
+
+// Store the RSSI and SNR of an uplink as a pair readers never see half-updated
+void LoRaManager::publishLinkQuality(float rssi, float snr) {
+  uint32_t seq = linkSeq.load(std::memory_order_relaxed);
+  linkSeq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  lastRssi.store(rssi, std::memory_order_relaxed);
+  lastSnr.store(snr, std::memory_order_relaxed);
+  linkSeq.store(seq + 2, std::memory_order_release);
+}
+
+// Get information about RX1 delay (time between uplink end and RX1 window opening)
+int LoRaManager::getRx1Delay() const {
+  // Default is 1 second for most networks
+  return 5; // This is usually configured by the network on join
+}
+
+// Get information about RX1 window timeout
+int LoRaManager::getRx1Timeout() const {
+  // Return the configured timeout, typically around 50ms
+  return 50; // This is the default for Class A devices
+}
+
+// Get information about RX2 window timeout
+int LoRaManager::getRx2Timeout() const {
+  // Return the configured timeout, typically around 190ms
+  return 190; // This is the default for Class A devices
+}
+
+// Register a command handler and serve RPC
+bool LoRaManager::onRpc(uint8_t method, LoRaRpcHandler handler) {
+  if (!rpc.on(method, handler)) {
+    return false;
+  }
+  rpcEnabled = true;
+  return true;
+}
+
+// Stop serving RPC
+void LoRaManager::disableRpc() {
+  rpcEnabled = false;
+}
+
+// Get the RPC statistics
+LoRaRpcStats LoRaManager::getRpcStats() const {
+  return rpc.getStats();
+}
+
+// Get the round-trip statistics of one command
+bool LoRaManager::getRpcMethodStats(uint8_t method, LoRaRpcMethodStats& stats) const {
+  return rpc.getMethodStats(method, stats);
+}
+
+// Send queued RPC responses in one uplink
+void LoRaManager::serviceRpc() {
+  // Fill the frame the current data rate allows, but always take one full
+  // response; sendData() moves to a faster data rate if needed
+  uint8_t frame[LORA_PIPELINE_MAX_PAYLOAD];
+  size_t tagLen = getUplinkLength(0, LORA_RPC_FPORT);
+  size_t maxLen = getMaxPayload(uplinkDatarate);
+  maxLen = maxLen > tagLen ? maxLen - tagLen : 0;
+  if (maxLen < LORA_RPC_HEADER_LEN + LORA_RPC_MAX_RESULT) {
+    maxLen = LORA_RPC_HEADER_LEN + LORA_RPC_MAX_RESULT;
+  }
+  if (maxLen > sizeof(frame)) {
+    maxLen = sizeof(frame);
+  }
+  
+  size_t len = rpc.buildUplink(frame, maxLen);
+  if (len > 0) {
+    rpc.confirmUplink(sendDataLocked(frame, len, LORA_RPC_FPORT, false), millis());
+  }
+}
+
+// Get the configuration store
+LoRaConfig& LoRaManager::getConfig() {
+  return remoteConfig;
+}
+
+// Accept configuration patches
+bool LoRaManager::enableRemoteConfig(LoRaConfigStorage* storage, LoRaConfigCallback callback) {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  bool restored = remoteConfig.load(storage);
+  configCallback = callback;
+  remoteConfigEnabled = true;
+  
+  Serial.print(F("[LoRaManager] Configuration version "));
+  Serial.println(remoteConfig.getVersion());
+  return restored;
+}
+
+// Stop accepting patches
+void LoRaManager::disableRemoteConfig() {
+  remoteConfigEnabled = false;
+}
+
+// Get the configuration store statistics
+LoRaConfigStats LoRaManager::getConfigStats() const {
+  return remoteConfig.getStats();
+}
+
+// Apply a staged configuration patch and send its report
+void LoRaManager::serviceConfig() {
+  if (remoteConfig.applyPatch(configCallback)) {
+    Serial.print(F("[LoRaManager] Configuration version "));
+    Serial.print(remoteConfig.getVersion());
+    Serial.println(F(" applied"));
+  }
+  
+  uint8_t report[LORA_CONFIG_REPORT_LEN];
+  if (isJoined && remoteConfig.buildReport(report) > 0) {
+    remoteConfig.confirmReport(sendDataLocked(report, sizeof(report), LORA_CONFIG_FPORT, false));
+  }
+}
+
+// Answer diagnostics dump requests
+void LoRaManager::enableDiagnostics() {
+  diagnosticsEnabled = true;
+}
+
+// Stop answering dump requests
+void LoRaManager::disableDiagnostics() {
+  diagnosticsEnabled = false;
+}
+
+// Get the diagnostics statistics
+LoRaDiagStats LoRaManager::getDiagnosticsStats() const {
+  return diagnostics.getStats();
+}
+
+// Report how many application uplinks wait to be sent
+void LoRaManager::setQueuedUplinks(uint8_t count) {
+  queuedUplinks.store(count, std::memory_order_relaxed);
+}
+
+// Take a requested diagnostics snapshot and send its next chunk
+void LoRaManager::serviceDiagnostics() {
+  uint32_t now = millis();
+  if (diagnostics.isRequested()) {
+    LoRaDiagState state;
+    memset(&state, 0, sizeof(state));
+    state.flags = (isJoined ? LORA_DIAG_FLAG_JOINED : 0) |
+                  (relayEnabled ? LORA_DIAG_FLAG_RELAY : 0) |
+                  (rpcEnabled ? LORA_DIAG_FLAG_RPC : 0) |
+                  (remoteConfigEnabled ? LORA_DIAG_FLAG_CONFIG : 0) |
+                  (powerControlEnabled ? LORA_DIAG_FLAG_POWER : 0) |
+                  (datarateSelection ? LORA_DIAG_FLAG_DR_SELECT : 0) |
+                  (appCryptoProvider != nullptr ? LORA_DIAG_FLAG_APP_CRYPTO : 0) |
+                  (sessionTable != nullptr ? LORA_DIAG_FLAG_VIRTUAL : 0);
+    for (uint8_t i = 0; i < radioPool.size(); i++) {
+      state.airtimeMs += radioPool.getStats(i).airtimeMs;
+    }
+    state.airtimeAvailableMs = airtimeLimiter.getGlobalAvailable(now);
+    state.rssi = lastRssi.load(std::memory_order_relaxed);
+    state.snr = lastSnr.load(std::memory_order_relaxed);
+    state.lastError = lastErrorCode.load(std::memory_order_relaxed);
+    state.configVersion = remoteConfig.getVersion();
+    state.datarate = uplinkDatarate;
+    state.txPowerDbm = powerControlEnabled ? powerControl.getPower() : powerControl.getCeiling();
+    state.consecutiveErrors = consecutiveTransmitErrors;
+    uint32_t queued = queuedUplinks.load(std::memory_order_relaxed) + rpc.getPendingCount() +
+                      (remoteConfig.hasReport() ? 1 : 0);
+    state.queued = (uint8_t)(queued > 0xFF ? 0xFF : queued);
+    const LoRaRelayStats& relayStats = relay.getStats();
+    state.relayQueued = (uint8_t)(relayStats.received - relayStats.forwarded - relayStats.droppedRateLimit -
+                                  relayStats.droppedQueueFull - relayStats.droppedInvalid);
+    state.radios = radioPool.size();
+    state.healthyRadios = radioPool.getHealthyCount();
+    diagnostics.capture(state, now);
+  }
+  
+  // Lowest priority: every other uplink goes first, and the channel has to be quiet
+  if (!isJoined || !diagnostics.hasChunk() || queuedUplinks.load(std::memory_order_relaxed) > 0 ||
+      rpc.hasPendingResponse() || remoteConfig.hasReport() || now - diagnostics.getLastUplink() < LORA_DIAG_GAP_MS) {
+    return;
+  }
+  
+  // As much of the snapshot as the current data rate carries, but always a useful part
+  uint8_t frame[LORA_DIAG_HEADER_LEN + LORA_DIAG_SNAPSHOT_LEN];
+  size_t tagLen = getUplinkLength(0, LORA_DIAG_FPORT);
+  size_t maxLen = getMaxPayload(uplinkDatarate);
+  maxLen = maxLen > tagLen ? maxLen - tagLen : 0;
+  if (maxLen < LORA_DIAG_HEADER_LEN + LORA_DIAG_MIN_CHUNK) {
+    maxLen = LORA_DIAG_HEADER_LEN + LORA_DIAG_MIN_CHUNK;
+  }
+  if (maxLen > sizeof(frame)) {
+    maxLen = sizeof(frame);
+  }
+  size_t len = diagnostics.buildChunk(frame, maxLen);
+  if (len == 0 || airtimeLimiter.getWait(LORA_DIAG_FPORT, estimateAirtime(getUplinkLength(len, LORA_DIAG_FPORT)), now) != 0) {
+    return;
+  }
+  diagnostics.confirmChunk(sendDataLocked(frame, len, LORA_DIAG_FPORT, false));
+}
+
+// Handle events (should be called in the loop)
+void LoRaManager::handleEvents() {
+  // Another thread is using the radio; the work is picked up on the next call
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    return;
+  }
+  
+  // Downlink handling happens in sendReceive; the main loop should handle
+  // reconnection if needed
+  probeRadios();
+  if (sessionTable != nullptr) {
+    serviceVirtualDevices();
+  }
+  if (relayEnabled) {
+    serviceRelay();
+  }
+  if (rpcEnabled && isJoined && rpc.hasPendingResponse()) {
+    serviceRpc();
+  }
+  if (remoteConfigEnabled) {
+    serviceConfig();
+  }
+  if (diagnosticsEnabled) {
+    serviceDiagnostics();
+  }
+  if (p2pEnabled) {
+    serviceP2P();
+  }
+}
+
+// Run many virtual LoRaWAN devices on this radio
+bool LoRaManager::enableVirtualDevices(LoRaSessionTable& table, LoRaSessionStore& store,
+                                       VirtualCredentialsCallback credentials, VirtualUplinkCallback uplink) {
+  if (node == nullptr || credentials == nullptr || uplink == nullptr) {
+    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+    return false;
+  }
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  
+  // Park the device's own session; the node now holds whichever virtual session is being served
+  if (sessionTable == nullptr) {
+    ownJoined = isJoined;
+    if (ownJoined) {
+      memcpy(ownNonces, node->getBufferNonces(), sizeof(ownNonces));
+      memcpy(ownSession, node->getBufferSession(), sizeof(ownSession));
+    }
+  }
+  sessionTable = &table;
+  sessionStore = &store;
+  virtualCredentials = credentials;
+  virtualUplink = uplink;
+  isJoined = false;
+  
+  Serial.print(F("[LoRaManager] Serving "));
+  Serial.print(table.size());
+  Serial.println(F(" virtual devices"));
+  return true;
+}
+
+// Stop serving virtual devices and bring the device's own session back
+bool LoRaManager::disableVirtualDevices() {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  if (sessionTable == nullptr) {
+    return true;
+  }
+  sessionTable = nullptr;
+  sessionStore = nullptr;
+  if (!ownJoined) {
+    return true;
+  }
+  ownJoined = false;
+  
+  // The nonces are checked against the keys, so the own keys go back in first
+  int state = RADIOLIB_ERR_INVALID_STATE;
+  if (loadRootKeys()) {
+    state = node->setBufferNonces(ownNonces);
+    if (state == RADIOLIB_ERR_NONE) {
+      state = node->setBufferSession(ownSession);
+    }
+  }
+  LoRaKeyProvider::wipe(ownNonces, sizeof(ownNonces));
+  LoRaKeyProvider::wipe(ownSession, sizeof(ownSession));
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[LoRaManager] Own session could not be restored, code "));
+    Serial.print(state);
+    Serial.println(F(", joining again"));
+    return joinNetworkLocked();
+  }
+  isJoined = true;
+  Serial.println(F("[LoRaManager] Own session restored"));
+  return true;
+}
+
+// Set the callback for downlinks to virtual devices
+void LoRaManager::setVirtualDownlinkCallback(VirtualDownlinkCallback callback) {
+  virtualDownlink = callback;
+}
+
+// Join or send for the virtual device due first
+void LoRaManager::serviceVirtualDevices() {
+  uint32_t now = millis();
+  uint16_t index = sessionTable->next(now);
+  if (index == LORA_SESSION_NONE) {
+    return;
+  }
+  bool joined = sessionTable->isJoined(index);
+  
+  // A join request is 23 bytes on air, 10 more than an empty data frame; it has
+  // no FPort, so only the global budget pays for it
+  uint8_t payload[LORA_PIPELINE_MAX_PAYLOAD];
+  size_t len = 10;
+  uint8_t port = 1;
+  uint8_t budgetPort = LORA_AIRTIME_GLOBAL_ONLY;
+  if (joined) {
+    len = virtualUplink(index, payload, sizeof(payload), port);
+    if (len == 0) {
+      sessionTable->reschedule(index, now);
+      return;
+    }
+    budgetPort = port;
+  }
+  
+  // Sessions share the duty cycle; one that has to wait stays due
+  uint32_t airtimeMs = estimateAirtime(len);
+  uint8_t radioIndex = radioPool.select(airtimeMs, now);
+  if (radioIndex == LORA_RADIO_NONE || airtimeLimiter.getWait(budgetPort, airtimeMs, now) != 0) {
+    return;
+  }
+  
+  // Load the session into the node of the chosen transceiver
+  LoRaCredentials credentials;
+  if (!virtualCredentials(index, credentials)) {
+    Serial.print(F("[LoRaManager] No credentials for virtual device "));
+    Serial.println(index);
+    sessionTable->markFailed(index, now);
+    return;
+  }
+  LoRaWANNode* target = radioNodes[radioIndex];
+  target->beginOTAA(credentials.joinEUI, credentials.devEUI, credentials.nwkKey.bytes, credentials.appKey.bytes);
+  LoRaKeyProvider::wipe(&credentials, sizeof(credentials));
+  activeRadio = radioIndex;
+  node = target;
+  driver = radioDrivers[radioIndex];
+  radio = driver->getPhysicalLayer();
+  
+  if (joined) {
+    uint8_t nonces[RADIOLIB_LORAWAN_NONCES_BUF_SIZE];
+    uint8_t session[RADIOLIB_LORAWAN_SESSION_BUF_SIZE];
+    if (!sessionStore->load(index, nonces, session) || node->setBufferNonces(nonces) != RADIOLIB_ERR_NONE ||
+        node->setBufferSession(session) != RADIOLIB_ERR_NONE) {
+      Serial.print(F("[LoRaManager] Session of virtual device "));
+      Serial.print(index);
+      Serial.println(F(" lost, joining again"));
+      sessionTable->markLost(index, now);
+      return;
+    }
+  }
+  
+  if (!airtimeLimiter.tryConsume(budgetPort, airtimeMs, now)) {
+    return;
+  }
+  radioPool.charge(radioIndex, airtimeMs, now);
+  
+  uint8_t downlinkData[256];
+  size_t downlinkLen = sizeof(downlinkData);
+  LoRaWANEvent_t eventUp;
+  LoRaWANEvent_t eventDown;
+  memset(&eventUp, 0, sizeof(eventUp));
+  memset(&eventDown, 0, sizeof(eventDown));
+  int state;
+  if (joined) {
+    state = node->sendReceive(payload, len, port, downlinkData, &downlinkLen, false, &eventUp, &eventDown);
+  } else {
+    state = node->activateOTAA();
+  }
+  lastErrorCode = state;
+  now = millis();
+  
+  // Charge the real time on air; activateOTAA() does not update getLastToA(), so joins keep the estimate
+  if (isRejectedBeforeTx(state)) {
+    airtimeLimiter.adjust(budgetPort, -(int32_t)airtimeMs);
+    radioPool.refund(radioIndex, airtimeMs);
+  } else if (isRadioFault(state)) {
+    radioPool.reportFault(radioIndex, now);
+  } else {
+    uint32_t lastToA = joined ? (uint32_t)node->getLastToA() : airtimeMs;
+    airtimeLimiter.adjust(budgetPort, (int32_t)lastToA - (int32_t)airtimeMs);
+    radioPool.reportSent(radioIndex, airtimeMs, lastToA);
+  }
+  
+  if (!joined) {
+    if (state != RADIOLIB_ERR_NONE && state != RADIOLIB_LORAWAN_NEW_SESSION) {
+      sessionTable->markFailed(index, now);
+      return;
+    }
+    sessionTable->markJoined(index, node->getDevAddr(), now);
+  } else if (state == RADIOLIB_ERR_NONE || state > 0 || state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
+    sessionTable->markSent(index, now);
+    
+    // RadioLib only accepts downlinks for the loaded session; route by its DevAddr
+    if (state > 0 && downlinkLen > 0 && virtualDownlink != nullptr) {
+      uint16_t recipient = sessionTable->find(node->getDevAddr());
+      if (recipient != LORA_SESSION_NONE) {
+        virtualDownlink(recipient, downlinkData, downlinkLen, eventDown.fPort);
+      }
+    }
+  } else {
+    sessionTable->markFailed(index, now);
+  }
+  
+  // Park the new counters and MAC state
+  sessionStore->save(index, node->getBufferNonces(), node->getBufferSession());
+}
+
+// Enable relay mode
+void LoRaManager::enableRelay(const LoRaRelayConfig& config) {
+  relay.begin(config);
+  relayEnabled = true;
+  lastRelayScan = millis() - config.cadPeriodMs;
+  Serial.print(F("[Relay] Enabled on "));
+  Serial.print(config.phy.frequency);
+  Serial.println(F(" MHz"));
+}
+
+// Disable relay mode
+void LoRaManager::disableRelay() {
+  relayEnabled = false;
+  relay.begin(relay.getConfig());
+}
+
+// Check if relay mode is enabled
+bool LoRaManager::isRelayEnabled() const {
+  return relayEnabled;
+}
+
+// Get the relay
+const LoRaRelay& LoRaManager::getRelay() const {
+  return relay;
+}
+
+// Borrow the radio from the LoRaWAN stack with raw PHY settings
+int LoRaManager::beginPhySession(const LoRaPhyConfig& config) {
+  if (driver == nullptr) {
+    return RADIOLIB_ERR_INVALID_STATE;
+  }
+  return driver->beginPhy(config);
+}
+
+// Hand the radio back to the LoRaWAN stack
+void LoRaManager::endPhySession(const LoRaPhyConfig& config) {
+  if (driver == nullptr) {
+    return;
+  }
+  driver->endPhy(config);
+}
+
+// Listen for child frames and forward or answer them
+void LoRaManager::serviceRelay() {
+  const LoRaRelayConfig& config = relay.getConfig();
+  
+  uint32_t now = millis();
+  if (now - lastRelayScan >= config.cadPeriodMs) {
+    lastRelayScan = now;
     
-    // Prepare buffer for downlink
-    uint8_t downlinkData[256];
-    size_t downlinkLen = sizeof(downlinkData);
-    
-    // Send data and wait for downlink
-    int state = node->sendReceive(data, len, port, downlinkData, &downlinkLen, confirmed);
-    lastErrorCode = state;
-    
-    // Check for successful transmission
-    if (state == RADIOLIB_ERR_NONE || state > 0 || state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
-      if (state > 0) {
-        // Downlink received in window state (1 = RX1, 2 = RX2)
-        Serial.print(F("success! Received downlink in RX"));
-        Serial.println(state);
-        
-        // Process the downlink data
-        if (downlinkLen > 0) {
-          Serial.print(F("[LoRaWAN] Received "));
-          Serial.print(downlinkLen);
-          Serial.println(F(" bytes:"));
-          
-          for (size_t i = 0; i < downlinkLen; i++) {
-            Serial.print(downlinkData[i], HEX);
-            Serial.print(' ');
-          }
-          Serial.println();
-          
-          // Call the callback if registered
-          if (downlinkCallback != nullptr) {
-            downlinkCallback(downlinkData, downlinkLen, port);
-          }
-          
-          // Copy the data to our buffer
-          memcpy(receivedData, downlinkData, downlinkLen);
-          receivedBytes = downlinkLen;
-        }
-      } else if (state == RADIOLIB_LORAWAN_NO_DOWNLINK) {
-        // No downlink received but uplink was successful
-        Serial.println(F("success! No downlink received."));
-      } else {
-        // General success
-        Serial.println(F("success!"));
-      }
-      
-      // Get RSSI and SNR
-      lastRssi = radio->getRSSI();
-      lastSnr = radio->getSNR();
-      
-      consecutiveTransmitErrors = 0; // Reset error counter on success
-      return true;
-    } else {
-      // Error occurred
-      Serial.print(F("failed, code "));
-      Serial.println(state);
+    // CAD costs a few symbols; only a detected preamble keeps the receiver on
+    if (beginPhySession(config.phy) == RADIOLIB_ERR_NONE && radio->scanChannel() == RADIOLIB_LORA_DETECTED) {
+      uint8_t frame[256];
+      int state = radio->receive(frame, sizeof(frame));
+      uint32_t rxEnd = millis();
+      size_t frameLen = radio->getPacketLength();
       
-      // Add more specific error handling for common LoRaWAN transmission issues
-      bool shouldRetry = false;
-      
-      // Handle different error cases
-      if (state == RADIOLIB_ERR_TX_TIMEOUT) {
-        Serial.println(F("[LoRaWAN] Transmission timeout. Check antenna and signal."));
-        shouldRetry = true;
-      } 
-      else if (state == RADIOLIB_ERR_NETWORK_NOT_JOINED) {
-        Serial.println(F("[LoRaWAN] Network not joined. Will try to rejoin."));
-        isJoined = false; // Force rejoin
-        
-        // Try to rejoin before next attempt
-        if (joinNetwork()) {
-          Serial.println(F("[LoRaWAN] Rejoined successfully, will retry transmission."));
-          shouldRetry = true;
-        } else {
-          Serial.println(F("[LoRaWAN] Failed to rejoin, cannot continue."));
-          shouldRetry = false;
+      uint32_t childAddr;
+      if (state == RADIOLIB_ERR_NONE && frameLen <= sizeof(frame) &&
+          LoRaRelay::parseUplinkDevAddr(frame, frameLen, childAddr)) {
+        if (!relay.acceptUplink(frame, frameLen, radio->getRSSI(), radio->getSNR(), rxEnd)) {
+          Serial.println(F("[Relay] Child uplink dropped"));
         }
-      }
-      else if (state == RADIOLIB_ERR_NO_CHANNEL_AVAILABLE) {
-        Serial.println(F("[LoRaWAN] No channel available for the requested data rate."));
         
-        // Only try different subbands for US915
-        uint8_t bandType = getBandType();
-        if (bandType == BAND_TYPE_US915) {
-          // Try selecting a different subband for next attempt
-          uint8_t alternateSubBand = 1 + (attemptCount % 8); // Try different subbands (1-8)
-          Serial.print(F("[LoRaWAN] Will try with subband "));
-          Serial.print(alternateSubBand);
-          Serial.println(F(" for next attempt"));
-          
-          // Configure the alternate subband
-          int maskResult = configureSubbandChannels(alternateSubBand);
-          
-          if (maskResult == RADIOLIB_ERR_NONE) {
-            shouldRetry = true;
-          } else {
-            shouldRetry = false;
+        // Answer in the child's RX1 window if the network left something for it
+        uint8_t downlink[LORA_RELAY_MAX_FRAME];
+        size_t downlinkLen = relay.takeDownlink(childAddr, downlink);
+        if (downlinkLen > 0) {
+          if (config.childRx1Frequency > 0) {
+            radio->setFrequency(config.childRx1Frequency);
           }
-        } else {
-          Serial.println(F("[LoRaWAN] Subband adjustment not applicable for this region"));
-          shouldRetry = (attemptCount < maxAttempts);
-        }
-      }
-      else {
-        // Default case for other errors
-        Serial.println(F("[LoRaWAN] Unknown error during transmission."));
-        shouldRetry = (attemptCount < maxAttempts);
-      }
-      
-      // Track consecutive errors
-      consecutiveTransmitErrors++;
-      
-      // If we should retry and have attempts left
-      if (shouldRetry && attemptCount < maxAttempts) {
-        Serial.print(F("[LoRaWAN] Will retry transmission in 3 seconds (attempt "));
-        Serial.print(attemptCount + 1);
-        Serial.print(F(" of "));
-        Serial.print(maxAttempts);
-        Serial.println(F(")"));
-        
-        // Wait before next attempt
-        delay(3000);
-      } else {
-        // If we've encountered errors multiple times in a row, try rejoining on next transmission
-        if (consecutiveTransmitErrors >= 3) {
-          Serial.println(F("[LoRaWAN] Multiple transmission errors, will attempt to rejoin on next transmission."));
-          isJoined = false; // Force a rejoin on next transmission
+          driver->invertIQ(true);
+          while (millis() - rxEnd < config.childRx1DelayMs) {
+            yield();
+          }
+          radio->transmit(downlink, downlinkLen);
+          driver->invertIQ(false);
         }
-        
-        return false;
       }
     }
+    endPhySession(config.phy);
   }
   
-  // If we've reached this point, all attempts failed
-  Serial.println(F("[LoRaWAN] All transmission attempts failed."));
-  return false;
+  // Forward at most one frame per call to keep the loop responsive
+  if (isJoined && relay.hasPendingUplink()) {
+    uint8_t wrapped[LORA_RELAY_HEADER_LEN + LORA_RELAY_MAX_FRAME];
+    size_t wrappedLen = relay.peekUplink(wrapped);
+    if (sendDataLocked(wrapped, wrappedLen, LORA_RELAY_FPORT, false)) {
+      relay.popUplink();
+    }
+  }
 }
 
-// Helper method to send a string
-bool LoRaManager::sendString(const String& data, uint8_t port, bool confirmed) {
-  return sendData((uint8_t*)data.c_str(), data.length(), port, confirmed);
+// Enable peer-to-peer messaging
+bool LoRaManager::enableP2P(uint16_t address, const LoRaPhyConfig& phy, uint32_t listenPeriodMs) {
+  if (address == LORA_P2P_BROADCAST || phy.modem != LORA_PHY_MODEM_LORA || phy.bandwidth <= 0) {
+    return false;
+  }
+  
+  // Stretch the message preamble over a whole listen period so a periodic CAD never misses it
+  float symbolMs = (float)(1UL << phy.spreadingFactor) / phy.bandwidth;
+  uint32_t wakeSymbols = (uint32_t)(listenPeriodMs / symbolMs) + 8;
+  
+  p2pPhy = phy;
+  p2pWakePreamble = (uint16_t)(wakeSymbols > 0xFFFF ? 0xFFFF : wakeSymbols);
+  if (p2pWakePreamble < phy.preambleLength) {
+    p2pWakePreamble = phy.preambleLength;
+  }
+  p2p.begin(address, (uint8_t)micros());
+  p2pListenPeriod = listenPeriodMs;
+  lastP2PScan = millis() - listenPeriodMs;
+  p2pEnabled = true;
+  
+  Serial.print(F("[P2P] Enabled, address "));
+  Serial.println(address);
+  return true;
 }
 
-// Get the last RSSI value
-float LoRaManager::getLastRssi() {
-  return lastRssi;
+// Disable peer-to-peer messaging
+void LoRaManager::disableP2P() {
+  p2pEnabled = false;
 }
 
-// Get the last SNR value
-float LoRaManager::getLastSnr() {
-  return lastSnr;
+// Set the callback for received peer-to-peer messages
+void LoRaManager::setP2PCallback(P2PMessageCallback callback) {
+  p2pCallback = callback;
 }
 
-// Check if the device is joined to the network
-bool LoRaManager::isNetworkJoined() {
-  return isJoined;
+// Get the peer-to-peer state
+const LoRaP2P& LoRaManager::getP2P() const {
+  return p2p;
 }
 
-// Get information about RX1 delay (time between uplink end and RX1 window opening)
-int LoRaManager::getRx1Delay() const {
-  // Default is 1 second for most networks
-  return 5; // This is usually configured by the network on join
+// Deliver and acknowledge a frame received on the P2P channel
+uint8_t LoRaManager::handleP2PFrame(const uint8_t* frame, size_t len) {
+  LoRaP2PMessage message;
+  uint8_t kind = p2p.parse(frame, len, message);
+  
+  // Acknowledge duplicates too; the sender is repeating because our ACK was lost
+  if ((kind == LORA_P2P_FRAME_MESSAGE || kind == LORA_P2P_FRAME_DUPLICATE) && message.ackRequested) {
+    uint8_t ack[LORA_P2P_HEADER_LEN];
+    radio->transmit(ack, p2p.buildAck(message, ack));
+  }
+  
+  if (kind == LORA_P2P_FRAME_MESSAGE && p2pCallback != nullptr) {
+    p2pCallback(message.from, message.payload, message.len);
+  }
+  return kind;
 }
 
-// Get information about RX1 window timeout
-int LoRaManager::getRx1Timeout() const {
-  // Return the configured timeout, typically around 50ms
-  return 50; // This is the default for Class A devices
+// Check the P2P channel and handle a received message
+void LoRaManager::serviceP2P() {
+  uint32_t now = millis();
+  if (now - lastP2PScan < p2pListenPeriod) {
+    return;
+  }
+  lastP2PScan = now;
+  
+  if (beginPhySession(p2pPhy) == RADIOLIB_ERR_NONE && radio->scanChannel() == RADIOLIB_LORA_DETECTED) {
+    uint8_t frame[LORA_P2P_MAX_FRAME];
+    if (radio->receive(frame, sizeof(frame)) == RADIOLIB_ERR_NONE) {
+      handleP2PFrame(frame, radio->getPacketLength());
+    }
+  }
+  endPhySession(p2pPhy);
 }
 
-// Get information about RX2 window timeout
-int LoRaManager::getRx2Timeout() const {
-  // Return the configured timeout, typically around 190ms
-  return 190; // This is the default for Class A devices
+// Send a message to a peer
+bool LoRaManager::sendP2P(uint16_t to, const uint8_t* data, size_t len, bool ack) {
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    lastErrorCode = LORAMANAGER_ERR_BUSY;
+    return false;
+  }
+  if (!p2pEnabled || radio == nullptr) {
+    lastErrorCode = RADIOLIB_ERR_INVALID_STATE;
+    return false;
+  }
+  
+  uint8_t frame[LORA_P2P_MAX_FRAME];
+  size_t frameLen = p2p.buildMessage(to, data, len, ack, frame);
+  if (frameLen == 0) {
+    lastErrorCode = RADIOLIB_ERR_INVALID_INPUT;
+    return false;
+  }
+  bool wantAck = p2p.isAckPending();
+  
+  int state = beginPhySession(p2pPhy);
+  if (state != RADIOLIB_ERR_NONE) {
+    endPhySession(p2pPhy);
+    lastErrorCode = state;
+    return false;
+  }
+  
+  LoRaP2PStats& stats = p2p.getStats();
+  const uint8_t maxAttempts = wantAck ? 3 : 1;
+  bool delivered = false;
+  for (uint8_t attempt = 0; attempt < maxAttempts && !delivered; attempt++) {
+    if (attempt > 0) {
+      stats.retries++;
+    }
+    
+    // Listen before talk, backing off a random few milliseconds while busy
+    for (uint8_t i = 0; i < 5 && radio->scanChannel() == RADIOLIB_LORA_DETECTED; i++) {
+      delay(10 + micros() % 40);
+    }
+    
+    // Only messages need the long wake-up preamble; the peer is already listening for the ACK
+    driver->setPreambleLength(p2pWakePreamble);
+    uint32_t txStart = millis();
+    state = radio->transmit(frame, frameLen);
+    stats.sent++;
+    stats.lastAirtimeMs = (uint32_t)(radio->getTimeOnAir(frameLen) / 1000);
+    driver->setPreambleLength(p2pPhy.preambleLength);
+    if (state != RADIOLIB_ERR_NONE) {
+      continue;
+    }
+    if (!wantAck) {
+      delivered = true;
+      break;
+    }
+    
+    // The ACK is only a few symbols long; handle any message that arrives instead
+    uint8_t reply[LORA_P2P_MAX_FRAME];
+    if (radio->receive(reply, sizeof(reply)) == RADIOLIB_ERR_NONE &&
+        handleP2PFrame(reply, radio->getPacketLength()) == LORA_P2P_FRAME_ACK) {
+      delivered = true;
+      stats.delivered++;
+      stats.lastRoundTripMs = millis() - txStart;
+    }
+  }
+  
+  endPhySession(p2pPhy);
+  
+  if (!delivered) {
+    if (wantAck) {
+      p2p.cancelPending();
+      stats.failed++;
+    }
+    lastErrorCode = state != RADIOLIB_ERR_NONE ? state : RADIOLIB_ERR_RX_TIMEOUT;
+    return false;
+  }
+  return true;
 }
 
-// Handle events (should be called in the loop)
-void LoRaManager::handleEvents() {
-  // We can't access the node's internal properties directly
-  // This function is a placeholder for future RadioLib updates
+// Read callback for sending from a buffer
+static size_t readFromBuffer(uint32_t offset, uint8_t* buffer, size_t len, void* context) {
+  memcpy(buffer, (const uint8_t*)context + offset, len);
+  return len;
+}
+
+// Send a buffer to a peer over a raw LoRa/FSK link
+int LoRaManager::sendBulk(const LoRaPhyConfig& phy, const uint8_t* data, uint32_t len, uint32_t timeoutMs) {
+  return sendBulk(phy, readFromBuffer, (void*)data, len, timeoutMs);
+}
+
+// Send a large block of data to a peer over a raw LoRa/FSK link
+int LoRaManager::sendBulk(const LoRaPhyConfig& phy, LoRaBulkReadCallback read, void* context, uint32_t totalLen,
+                          uint32_t timeoutMs) {
+  if (radio == nullptr) {
+    return RADIOLIB_ERR_INVALID_STATE;
+  }
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    return LORAMANAGER_ERR_BUSY;
+  }
+  
+  LoRaBulkSender sender;
+  if (!sender.begin((uint8_t)micros(), totalLen, LORA_BULK_CHUNK_SIZE, LORA_BULK_WINDOW, read, context)) {
+    return RADIOLIB_ERR_INVALID_INPUT;
+  }
+  
+  int state = beginPhySession(phy);
+  if (state != RADIOLIB_ERR_NONE) {
+    endPhySession(phy);
+    return state;
+  }
+  
+  Serial.print(F("[Bulk] Sending "));
+  Serial.print(totalLen);
+  Serial.println(F(" bytes"));
+  
+  uint8_t frame[LORA_BULK_MAX_FRAME];
+  uint32_t start = millis();
+  state = LORAMANAGER_ERR_BULK_TIMEOUT;
+  while (millis() - start < timeoutMs) {
+    // Send the burst back to back, then wait for the receiver's ACK
+    size_t frameLen;
+    while ((frameLen = sender.nextFrame(frame)) > 0) {
+      radio->transmit(frame, frameLen);
+    }
+    if (sender.hasFailed()) {
+      state = LORAMANAGER_ERR_BULK_ABORTED;
+      break;
+    }
+    
+    if (radio->receive(frame, sizeof(frame)) == RADIOLIB_ERR_NONE) {
+      sender.onFrame(frame, radio->getPacketLength());
+    } else {
+      sender.onTimeout();
+    }
+    
+    if (sender.isComplete()) {
+      state = RADIOLIB_ERR_NONE;
+      break;
+    }
+  }
+  
+  endPhySession(phy);
+  
+  uint32_t elapsed = millis() - start;
+  Serial.print(F("[Bulk] "));
+  Serial.print(state == RADIOLIB_ERR_NONE ? F("Done") : F("Failed"));
+  Serial.print(F(" after "));
+  Serial.print(elapsed);
+  Serial.print(F(" ms, "));
+  Serial.print(sender.getFramesSent());
+  Serial.print(F(" frames, "));
+  Serial.print(elapsed > 0 ? (uint32_t)((uint64_t)totalLen * 8 / elapsed) : 0);
+  Serial.println(F(" kbit/s"));
+  return state;
+}
 
-  // Nothing to do here - downlink handling happens in sendReceive
-  // The main loop should handle reconnection if needed
+// Receive a bulk transfer from a peer over a raw LoRa/FSK link
+int LoRaManager::receiveBulk(const LoRaPhyConfig& phy, LoRaBulkWriteCallback write, void* context, uint32_t timeoutMs) {
+  if (radio == nullptr) {
+    return RADIOLIB_ERR_INVALID_STATE;
+  }
+  RadioClaim claim(radioBusy);
+  if (!claim.isOwned()) {
+    return LORAMANAGER_ERR_BUSY;
+  }
+  if (write == nullptr) {
+    return RADIOLIB_ERR_INVALID_INPUT;
+  }
+  
+  int state = beginPhySession(phy);
+  if (state != RADIOLIB_ERR_NONE) {
+    endPhySession(phy);
+    return state;
+  }
+  
+  LoRaBulkReceiver receiver(write, context);
+  uint8_t frame[LORA_BULK_MAX_FRAME];
+  uint32_t start = millis();
+  while (millis() - start < timeoutMs) {
+    if (radio->receive(frame, sizeof(frame)) != RADIOLIB_ERR_NONE) {
+      // Once complete, linger until the sender stops repeating, in case our last ACK was lost
+      if (receiver.isComplete()) {
+        break;
+      }
+      continue;
+    }
+    
+    if (receiver.onFrame(frame, radio->getPacketLength())) {
+      uint8_t ack[8];
+      radio->transmit(ack, receiver.buildAck(ack));
+    }
+    if (receiver.hasFailed()) {
+      break;
+    }
+  }
+  
+  endPhySession(phy);
+  
+  if (receiver.hasFailed()) {
+    return LORAMANAGER_ERR_BULK_ABORTED;
+  }
+  if (!receiver.isComplete()) {
+    return LORAMANAGER_ERR_BULK_TIMEOUT;
+  }
+  
+  Serial.print(F("[Bulk] Received "));
+  Serial.print(receiver.getTotalLength());
+  Serial.println(F(" bytes"));
+  return RADIOLIB_ERR_NONE;
 }
 
 // Get the last error from LoRaWAN operations
 int LoRaManager::getLastErrorCode() {
-  return lastErrorCode;
+  return lastErrorCode.load(std::memory_order_relaxed);
 } 
\ No newline at end of file
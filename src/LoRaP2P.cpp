@@ -0,0 +1,129 @@
+#include "LoRaP2P.h"
+#include <string.h>
+
+// Frame types (high nibble of the first byte)
+#define FRAME_MESSAGE 0x50
+#define FRAME_ACK     0x60
+#define FRAME_TYPE_MASK 0xF0
+#define FLAG_ACK_REQUEST 0x01
+
+// Constructor
+LoRaP2P::LoRaP2P() {
+  begin(0);
+}
+
+// Set this node's address and clear all state
+void LoRaP2P::begin(uint16_t address, uint8_t initialSeq) {
+  this->address = address;
+  nextSeq = initialSeq;
+  pendingTo = 0;
+  pendingSeq = 0;
+  pending = false;
+  memset(seen, 0, sizeof(seen));
+  seenNext = 0;
+  memset(&stats, 0, sizeof(stats));
+}
+
+// Get this node's address
+uint16_t LoRaP2P::getAddress() const {
+  return address;
+}
+
+// Write the common header
+static void putHeader(uint8_t* out, uint8_t type, uint16_t to, uint16_t from, uint8_t seq) {
+  out[0] = type;
+  out[1] = (uint8_t)(to >> 8);
+  out[2] = (uint8_t)to;
+  out[3] = (uint8_t)(from >> 8);
+  out[4] = (uint8_t)from;
+  out[5] = seq;
+}
+
+// Build a message frame with the next sequence number
+size_t LoRaP2P::buildMessage(uint16_t to, const uint8_t* payload, size_t len, bool ackRequested, uint8_t* out) {
+  if (len > LORA_P2P_MAX_PAYLOAD) {
+    return 0;
+  }
+
+  // Nobody answers a broadcast
+  bool wantAck = ackRequested && to != LORA_P2P_BROADCAST;
+  uint8_t seq = nextSeq++;
+  putHeader(out, (uint8_t)(FRAME_MESSAGE | (wantAck ? FLAG_ACK_REQUEST : 0)), to, address, seq);
+  memcpy(&out[LORA_P2P_HEADER_LEN], payload, len);
+
+  pending = wantAck;
+  pendingTo = to;
+  pendingSeq = seq;
+  return LORA_P2P_HEADER_LEN + len;
+}
+
+// Build the acknowledgement for a received message
+size_t LoRaP2P::buildAck(const LoRaP2PMessage& message, uint8_t* out) const {
+  putHeader(out, FRAME_ACK, message.from, address, message.seq);
+  return LORA_P2P_HEADER_LEN;
+}
+
+// Classify a received frame
+uint8_t LoRaP2P::parse(const uint8_t* frame, size_t len, LoRaP2PMessage& message) {
+  if (len < LORA_P2P_HEADER_LEN || len > LORA_P2P_MAX_FRAME) {
+    return LORA_P2P_FRAME_IGNORED;
+  }
+
+  uint8_t type = frame[0] & FRAME_TYPE_MASK;
+  uint16_t to = (uint16_t)(((uint16_t)frame[1] << 8) | frame[2]);
+  uint16_t from = (uint16_t)(((uint16_t)frame[3] << 8) | frame[4]);
+  uint8_t seq = frame[5];
+
+  if (type == FRAME_ACK) {
+    if (len == LORA_P2P_HEADER_LEN && to == address && pending && from == pendingTo && seq == pendingSeq) {
+      pending = false;
+      return LORA_P2P_FRAME_ACK;
+    }
+    return LORA_P2P_FRAME_IGNORED;
+  }
+
+  if (type != FRAME_MESSAGE || (to != address && to != LORA_P2P_BROADCAST) || from == address) {
+    return LORA_P2P_FRAME_IGNORED;
+  }
+
+  message.from = from;
+  message.to = to;
+  message.seq = seq;
+  message.ackRequested = (frame[0] & FLAG_ACK_REQUEST) != 0 && to != LORA_P2P_BROADCAST;
+  message.payload = &frame[LORA_P2P_HEADER_LEN];
+  message.len = len - LORA_P2P_HEADER_LEN;
+
+  for (uint8_t i = 0; i < LORA_P2P_DEDUP_SIZE; i++) {
+    if (seen[i].used && seen[i].from == from && seen[i].seq == seq) {
+      stats.duplicates++;
+      return LORA_P2P_FRAME_DUPLICATE;
+    }
+  }
+
+  // Remember it, overwriting the oldest entry
+  seen[seenNext].from = from;
+  seen[seenNext].seq = seq;
+  seen[seenNext].used = true;
+  seenNext = (uint8_t)((seenNext + 1) % LORA_P2P_DEDUP_SIZE);
+  stats.received++;
+  return LORA_P2P_FRAME_MESSAGE;
+}
+
+// Check if an acknowledged message is still waiting for its ACK
+bool LoRaP2P::isAckPending() const {
+  return pending;
+}
+
+// Stop waiting for the pending ACK
+void LoRaP2P::cancelPending() {
+  pending = false;
+}
+
+// Get the statistics
+LoRaP2PStats& LoRaP2P::getStats() {
+  return stats;
+}
+
+const LoRaP2PStats& LoRaP2P::getStats() const {
+  return stats;
+}
@@ -0,0 +1,123 @@
+#include "LoRaPowerControl.h"
+#include <string.h>
+
+// Approximate SX1262 supply current at 0, 2, ... 22 dBm (DC-DC, 3.3 V), mA
+static const float txCurrentTable[] = {18, 20, 22, 25, 28, 32, 38, 45, 58, 75, 102, 118};
+
+// Constructor
+LoRaPowerControl::LoRaPowerControl() {
+  memset(&stats, 0, sizeof(stats));
+  configure(LORA_POWER_MIN_DBM, LORA_POWER_MAX_DBM, LORA_POWER_DEFAULT_MARGIN_DB, LORA_POWER_DEFAULT_HYSTERESIS_DB);
+}
+
+// Set the loop's limits and targets; starts at the ceiling
+void LoRaPowerControl::configure(int8_t minDbm, int8_t maxDbm, float marginDb, float hysteresisDb) {
+  this->minDbm = minDbm < maxDbm ? minDbm : maxDbm;
+  this->maxDbm = maxDbm;
+  this->marginDb = marginDb;
+  this->hysteresisDb = hysteresisDb > 0 ? hysteresisDb : 0;
+  ceilingDbm = maxDbm;
+  haveMargin = false;
+  smoothedMargin = 0;
+  stats.powerDbm = maxDbm;
+}
+
+// Cap the power
+void LoRaPowerControl::setCeiling(int8_t dbm) {
+  ceilingDbm = dbm < minDbm ? minDbm : (dbm > maxDbm ? maxDbm : dbm);
+  if (stats.powerDbm > ceilingDbm) {
+    stats.powerDbm = ceilingDbm;
+  }
+}
+
+// Get the power ceiling
+int8_t LoRaPowerControl::getCeiling() const {
+  return ceilingDbm;
+}
+
+// Get the power to send the next uplink at
+int8_t LoRaPowerControl::getPower() const {
+  return stats.powerDbm;
+}
+
+// Move the power within the floor and the ceiling
+void LoRaPowerControl::setPower(int8_t dbm) {
+  stats.powerDbm = dbm < minDbm ? minDbm : (dbm > ceilingDbm ? ceilingDbm : dbm);
+}
+
+// Raise at once when the margin runs short; lower only past the hysteresis
+bool LoRaPowerControl::update(float rssi, float snr, float requiredSnr) {
+  // Link margin at the ceiling; SNR stops growing near the gateway, RSSI does not
+  float snrMargin = snr - requiredSnr;
+  float rssiMargin = rssi - LORA_POWER_NOISE_FLOOR_DBM - requiredSnr;
+  float linkMargin = rssiMargin > snrMargin ? rssiMargin : snrMargin;
+
+  // Smoothing keeps single good downlinks from lowering the power
+  smoothedMargin = haveMargin ? smoothedMargin + (linkMargin - smoothedMargin) / 4 : linkMargin;
+  haveMargin = true;
+  int8_t before = stats.powerDbm;
+  float backoffDb = (float)(ceilingDbm - stats.powerDbm);
+
+  // Raise on the raw sample, by whole steps, so one bad downlink is enough
+  float margin = linkMargin - backoffDb;
+  if (margin < marginDb) {
+    int steps = (int)((marginDb - margin + LORA_POWER_STEP_DB - 1) / LORA_POWER_STEP_DB);
+    setPower((int8_t)(stats.powerDbm + steps * LORA_POWER_STEP_DB));
+    if (stats.powerDbm != before) {
+      stats.stepsUp++;
+      return true;
+    }
+    return false;
+  }
+
+  // Lower on the smoothed margin, keeping the hysteresis on top of the target
+  float excess = smoothedMargin - backoffDb - marginDb - hysteresisDb;
+  int steps = (int)(excess / LORA_POWER_STEP_DB);
+  if (steps > 0) {
+    setPower((int8_t)(stats.powerDbm - steps * LORA_POWER_STEP_DB));
+    if (stats.powerDbm != before) {
+      stats.stepsDown++;
+      return true;
+    }
+  }
+  return false;
+}
+
+// An expected downlink was lost: one step up
+bool LoRaPowerControl::reportLost() {
+  int8_t before = stats.powerDbm;
+  setPower((int8_t)(stats.powerDbm + LORA_POWER_STEP_DB));
+  if (stats.powerDbm != before) {
+    stats.stepsUp++;
+    return true;
+  }
+  return false;
+}
+
+// Account the energy of a sent uplink at the current power
+void LoRaPowerControl::charge(uint32_t airtimeMs) {
+  // mA * V * ms is µJ
+  float used = txCurrentMa(stats.powerDbm) * LORA_POWER_SUPPLY_V * airtimeMs / 1000.0f;
+  float atCeiling = txCurrentMa(ceilingDbm) * LORA_POWER_SUPPLY_V * airtimeMs / 1000.0f;
+  stats.uplinks++;
+  stats.energyMj += used;
+  stats.savedMj += atCeiling - used;
+}
+
+// Get the transmit power and energy statistics
+const LoRaPowerStats& LoRaPowerControl::getStats() const {
+  return stats;
+}
+
+// Approximate supply current while transmitting, interpolated between 2 dB points
+float LoRaPowerControl::txCurrentMa(int8_t dbm) {
+  const int last = (int)(sizeof(txCurrentTable) / sizeof(txCurrentTable[0])) - 1;
+  if (dbm <= 0) {
+    return txCurrentTable[0];
+  }
+  if (dbm >= last * 2) {
+    return txCurrentTable[last];
+  }
+  int index = dbm / 2;
+  return (dbm % 2) == 0 ? txCurrentTable[index] : (txCurrentTable[index] + txCurrentTable[index + 1]) / 2;
+}
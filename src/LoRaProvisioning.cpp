@@ -0,0 +1,343 @@
+#include "LoRaProvisioning.h"
+#include <string.h>
+
+// Field identifiers used for the column mapping
+#define FIELD_DEV_EUI   0
+#define FIELD_JOIN_EUI  1
+#define FIELD_APP_KEY   2
+#define FIELD_NWK_KEY   3
+#define FIELD_UNUSED    0xFF
+
+namespace LoRaProvisioning {
+
+// Write a 64-bit EUI MSB first
+static void putEui(uint8_t* out, uint64_t eui) {
+  for (int i = 7; i >= 0; i--) {
+    out[i] = (uint8_t)(eui & 0xFF);
+    eui >>= 8;
+  }
+}
+
+// Read a 64-bit EUI written MSB first
+static uint64_t getEui(const uint8_t* in) {
+  uint64_t eui = 0;
+  for (int i = 0; i < 8; i++) {
+    eui = (eui << 8) | in[i];
+  }
+  return eui;
+}
+
+// CRC-16/CCITT-FALSE, four bits at a time from a 16-entry table
+uint16_t crc16(const uint8_t* data, size_t len) {
+  static const uint16_t table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+  };
+
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+// Serialize credentials into a blob
+void toBlob(const LoRaCredentials& credentials, uint8_t* blob) {
+  blob[0] = LORA_CREDENTIAL_BLOB_VERSION;
+  putEui(&blob[1], credentials.devEUI);
+  putEui(&blob[9], credentials.joinEUI);
+  memcpy(&blob[17], credentials.appKey.bytes, 16);
+  memcpy(&blob[33], credentials.nwkKey.bytes, 16);
+
+  uint16_t crc = crc16(blob, LORA_CREDENTIAL_BLOB_SIZE - 2);
+  blob[49] = (uint8_t)(crc >> 8);
+  blob[50] = (uint8_t)(crc & 0xFF);
+}
+
+// Deserialize credentials from a blob
+bool fromBlob(const uint8_t* blob, LoRaCredentials& credentials) {
+  if (blob[0] != LORA_CREDENTIAL_BLOB_VERSION) {
+    return false;
+  }
+
+  uint16_t crc = crc16(blob, LORA_CREDENTIAL_BLOB_SIZE - 2);
+  if (blob[49] != (uint8_t)(crc >> 8) || blob[50] != (uint8_t)(crc & 0xFF)) {
+    return false;
+  }
+
+  credentials.devEUI = getEui(&blob[1]);
+  credentials.joinEUI = getEui(&blob[9]);
+  memcpy(credentials.appKey.bytes, &blob[17], 16);
+  memcpy(credentials.nwkKey.bytes, &blob[33], 16);
+  return true;
+}
+
+} // namespace LoRaProvisioning
+
+// Case-insensitive comparison of a field with a lower-case column name
+static bool fieldEquals(const char* field, uint8_t len, const char* name) {
+  size_t nameLen = strlen(name);
+  if (len != nameLen) {
+    return false;
+  }
+  for (uint8_t i = 0; i < len; i++) {
+    char c = field[i];
+    if (c >= 'A' && c <= 'Z') {
+      c = (char)(c - 'A' + 'a');
+    }
+    if (c != name[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Constructor
+LoRaManifestParser::LoRaManifestParser(RecordCallback onRecord, void* context) :
+  onRecord(onRecord),
+  onError(nullptr),
+  context(context) {
+  reset();
+}
+
+// Set the callback for rejected lines
+void LoRaManifestParser::setErrorCallback(ErrorCallback onError) {
+  this->onError = onError;
+}
+
+// Clear all state
+void LoRaManifestParser::reset() {
+  pendingLen = 0;
+  pendingOverflow = false;
+
+  // Default column order: DevEUI, JoinEUI, AppKey, NwkKey
+  for (uint8_t i = 0; i < MAX_FIELDS; i++) {
+    columns[i] = i;
+  }
+  columnCount = MAX_FIELDS;
+  headerChecked = false;
+
+  lineCount = 0;
+  recordCount = 0;
+  errorCount = 0;
+}
+
+// Parse the next chunk of the manifest
+void LoRaManifestParser::feed(const char* data, size_t len) {
+  while (len > 0) {
+    const char* newline = (const char*)memchr(data, '\n', len);
+    size_t chunkLen = newline ? (size_t)(newline - data) : len;
+
+    if (pendingLen == 0 && !pendingOverflow && newline) {
+      // Fast path: the whole line is in the caller's buffer
+      parseLine(data, chunkLen);
+    } else {
+      // Carry the fragment over, remembering if it no longer fits
+      if (!pendingOverflow && pendingLen + chunkLen <= sizeof(pending)) {
+        memcpy(&pending[pendingLen], data, chunkLen);
+        pendingLen += chunkLen;
+      } else {
+        pendingOverflow = true;
+      }
+
+      if (newline) {
+        if (pendingOverflow) {
+          lineCount++;
+          reportError(LORA_MANIFEST_ERR_LINE_TOO_LONG);
+        } else {
+          parseLine(pending, pendingLen);
+        }
+        pendingLen = 0;
+        pendingOverflow = false;
+      }
+    }
+
+    if (!newline) {
+      return;
+    }
+    data = newline + 1;
+    len -= chunkLen + 1;
+  }
+}
+
+// Parse a final line that has no trailing newline
+void LoRaManifestParser::finish() {
+  if (pendingOverflow) {
+    lineCount++;
+    reportError(LORA_MANIFEST_ERR_LINE_TOO_LONG);
+  } else if (pendingLen > 0) {
+    parseLine(pending, pendingLen);
+  }
+  pendingLen = 0;
+  pendingOverflow = false;
+}
+
+#ifdef ARDUINO
+// Parse a whole manifest from a stream
+uint32_t LoRaManifestParser::parse(Stream& stream) {
+  char buffer[128];
+  size_t readLen;
+  while ((readLen = stream.readBytes(buffer, sizeof(buffer))) > 0) {
+    feed(buffer, readLen);
+  }
+  finish();
+  return recordCount;
+}
+#endif
+
+// Get the number of valid records
+uint32_t LoRaManifestParser::getRecordCount() const {
+  return recordCount;
+}
+
+// Get the number of rejected lines
+uint32_t LoRaManifestParser::getErrorCount() const {
+  return errorCount;
+}
+
+// Get the number of lines seen so far
+uint32_t LoRaManifestParser::getLineCount() const {
+  return lineCount;
+}
+
+// Count a rejected line and notify the error callback
+void LoRaManifestParser::reportError(int error) {
+  errorCount++;
+  if (onError != nullptr) {
+    onError(error, lineCount, context);
+  }
+}
+
+// Map header column names to fields
+bool LoRaManifestParser::parseHeader(const char* const* fields, const uint8_t* fieldLens, uint8_t fieldCount) {
+  uint8_t mapping[MAX_FIELDS] = {FIELD_UNUSED, FIELD_UNUSED, FIELD_UNUSED, FIELD_UNUSED};
+
+  for (uint8_t i = 0; i < fieldCount; i++) {
+    uint8_t field;
+    if (fieldEquals(fields[i], fieldLens[i], "deveui")) {
+      field = FIELD_DEV_EUI;
+    } else if (fieldEquals(fields[i], fieldLens[i], "joineui") || fieldEquals(fields[i], fieldLens[i], "appeui")) {
+      field = FIELD_JOIN_EUI;
+    } else if (fieldEquals(fields[i], fieldLens[i], "appkey")) {
+      field = FIELD_APP_KEY;
+    } else if (fieldEquals(fields[i], fieldLens[i], "nwkkey")) {
+      field = FIELD_NWK_KEY;
+    } else {
+      return false;
+    }
+    mapping[field] = i;
+  }
+
+  // NwkKey is the only optional column
+  if (mapping[FIELD_DEV_EUI] == FIELD_UNUSED || mapping[FIELD_JOIN_EUI] == FIELD_UNUSED ||
+      mapping[FIELD_APP_KEY] == FIELD_UNUSED) {
+    return false;
+  }
+
+  memcpy(columns, mapping, sizeof(columns));
+  columnCount = fieldCount;
+  return true;
+}
+
+// Split and validate a single line
+void LoRaManifestParser::parseLine(const char* line, size_t len) {
+  lineCount++;
+
+  // Tolerate CRLF line endings
+  if (len > 0 && line[len - 1] == '\r') {
+    len--;
+  }
+
+  // Skip blank and comment lines
+  size_t start = 0;
+  while (start < len && (line[start] == ' ' || line[start] == '\t')) {
+    start++;
+  }
+  if (start == len || line[start] == '#') {
+    return;
+  }
+
+  if (len > LORA_MANIFEST_MAX_LINE) {
+    reportError(LORA_MANIFEST_ERR_LINE_TOO_LONG);
+    return;
+  }
+
+  // Split into trimmed, unquoted fields
+  const char* fields[MAX_FIELDS];
+  uint8_t fieldLens[MAX_FIELDS];
+  uint8_t fieldCount = 0;
+  size_t pos = 0;
+  while (pos <= len) {
+    size_t end = pos;
+    while (end < len && line[end] != ',' && line[end] != ';') {
+      end++;
+    }
+
+    if (fieldCount == MAX_FIELDS) {
+      reportError(LORA_MANIFEST_ERR_FIELD_COUNT);
+      return;
+    }
+
+    size_t a = pos;
+    size_t b = end;
+    while (a < b && (line[a] == ' ' || line[a] == '\t' || line[a] == '"')) {
+      a++;
+    }
+    while (b > a && (line[b - 1] == ' ' || line[b - 1] == '\t' || line[b - 1] == '"')) {
+      b--;
+    }
+    fields[fieldCount] = &line[a];
+    fieldLens[fieldCount] = (uint8_t)(b - a);
+    fieldCount++;
+
+    pos = end + 1;
+  }
+
+  // The first data line may be a header naming the columns
+  if (!headerChecked) {
+    headerChecked = true;
+    uint64_t firstEui;
+    if (!LoRaHex::parseEui(fields[0], fieldLens[0], firstEui) && parseHeader(fields, fieldLens, fieldCount)) {
+      return;
+    }
+  }
+
+  if (fieldCount < 3 || fieldCount > columnCount) {
+    reportError(LORA_MANIFEST_ERR_FIELD_COUNT);
+    return;
+  }
+
+  LoRaCredentials credentials;
+  uint8_t col = columns[FIELD_DEV_EUI];
+  if (col >= fieldCount || !LoRaHex::parseEui(fields[col], fieldLens[col], credentials.devEUI)) {
+    reportError(LORA_MANIFEST_ERR_DEV_EUI);
+    return;
+  }
+
+  col = columns[FIELD_JOIN_EUI];
+  if (col >= fieldCount || !LoRaHex::parseEui(fields[col], fieldLens[col], credentials.joinEUI)) {
+    reportError(LORA_MANIFEST_ERR_JOIN_EUI);
+    return;
+  }
+
+  col = columns[FIELD_APP_KEY];
+  if (col >= fieldCount || !LoRaHex::parseKey(fields[col], fieldLens[col], credentials.appKey)) {
+    reportError(LORA_MANIFEST_ERR_APP_KEY);
+    return;
+  }
+
+  // LoRaWAN 1.0.x devices only have an AppKey
+  col = columns[FIELD_NWK_KEY];
+  if (col == FIELD_UNUSED || col >= fieldCount || fieldLens[col] == 0) {
+    credentials.nwkKey = credentials.appKey;
+  } else if (!LoRaHex::parseKey(fields[col], fieldLens[col], credentials.nwkKey)) {
+    reportError(LORA_MANIFEST_ERR_NWK_KEY);
+    return;
+  }
+
+  recordCount++;
+  if (onRecord != nullptr) {
+    onRecord(credentials, lineCount, context);
+  }
+}
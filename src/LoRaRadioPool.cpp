@@ -0,0 +1,154 @@
+#include "LoRaRadioPool.h"
+#include <string.h>
+
+// Constructor
+LoRaRadioPool::LoRaRadioPool() :
+  count(0),
+  lastUsed(LORA_RADIO_NONE) {
+  for (uint8_t i = 0; i < LORA_MAX_RADIOS; i++) {
+    memset(&radios[i].stats, 0, sizeof(radios[i].stats));
+    radios[i].probeAt = 0;
+    radios[i].consecutiveFaults = 0;
+  }
+}
+
+// Add a transceiver
+uint8_t LoRaRadioPool::add() {
+  if (count >= LORA_MAX_RADIOS) {
+    return LORA_RADIO_NONE;
+  }
+  radios[count].stats.healthy = true;
+  return count++;
+}
+
+// Get the number of transceivers
+uint8_t LoRaRadioPool::size() const {
+  return count;
+}
+
+// Limit the airtime of one transceiver
+void LoRaRadioPool::setDutyCycle(uint8_t index, uint32_t budgetMs, uint32_t periodMs, uint32_t now) {
+  if (index < count) {
+    radios[index].budget.setGlobalLimit(budgetMs, periodMs, 0, now);
+  }
+}
+
+// Pick the healthy transceiver with the most budget left
+uint8_t LoRaRadioPool::select(uint32_t airtimeMs, uint32_t now) {
+  uint8_t best = LORA_RADIO_NONE;
+  uint32_t bestAvailable = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    Radio& radio = radios[i];
+    if (!radio.stats.healthy || radio.budget.getWait(0, airtimeMs, now) != 0) {
+      continue;
+    }
+    uint32_t available = radio.budget.getGlobalAvailable(now);
+    if (best == LORA_RADIO_NONE || available > bestAvailable ||
+        (available == bestAvailable && best == lastUsed)) {
+      best = i;
+      bestAvailable = available;
+    }
+  }
+  return best;
+}
+
+// Get how long until some healthy transceiver can send a frame
+uint32_t LoRaRadioPool::getWait(uint32_t airtimeMs, uint32_t now) const {
+  uint32_t wait = LORA_AIRTIME_NEVER;
+  for (uint8_t i = 0; i < count; i++) {
+    if (!radios[i].stats.healthy) {
+      continue;
+    }
+    uint32_t radioWait = radios[i].budget.getWait(0, airtimeMs, now);
+    if (radioWait < wait) {
+      wait = radioWait;
+    }
+  }
+  return wait;
+}
+
+// Charge a frame to a transceiver before it is sent
+void LoRaRadioPool::charge(uint8_t index, uint32_t airtimeMs, uint32_t now) {
+  if (index < count) {
+    radios[index].budget.consume(0, airtimeMs, now);
+    lastUsed = index;
+  }
+}
+
+// Record a sent frame and its real time on air
+void LoRaRadioPool::reportSent(uint8_t index, uint32_t chargedMs, uint32_t airtimeMs) {
+  if (index >= count) {
+    return;
+  }
+  Radio& radio = radios[index];
+  radio.budget.adjust(0, (int32_t)airtimeMs - (int32_t)chargedMs);
+  radio.stats.uplinks++;
+  radio.stats.airtimeMs += airtimeMs;
+  radio.consecutiveFaults = 0;
+}
+
+// Take back the charge of a frame that was never transmitted
+void LoRaRadioPool::refund(uint8_t index, uint32_t chargedMs) {
+  if (index < count) {
+    radios[index].budget.adjust(0, -(int32_t)chargedMs);
+  }
+}
+
+// Record a radio error; enough of them in a row take the transceiver out of service
+bool LoRaRadioPool::reportFault(uint8_t index, uint32_t now) {
+  if (index >= count) {
+    return false;
+  }
+  Radio& radio = radios[index];
+  radio.stats.faults++;
+  if (radio.consecutiveFaults < 0xFF) {
+    radio.consecutiveFaults++;
+  }
+  if (radio.stats.healthy && radio.consecutiveFaults >= LORA_RADIO_FAULT_LIMIT) {
+    radio.stats.healthy = false;
+    radio.stats.outages++;
+    radio.probeAt = now + LORA_RADIO_PROBE_INTERVAL_MS;
+    return true;
+  }
+  return false;
+}
+
+// Check if a faulted transceiver is due to be re-initialized
+bool LoRaRadioPool::isProbeDue(uint8_t index, uint32_t now) const {
+  return index < count && !radios[index].stats.healthy && (int32_t)(now - radios[index].probeAt) >= 0;
+}
+
+// Record the outcome of re-initializing a faulted transceiver
+void LoRaRadioPool::reportProbe(uint8_t index, bool ok, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  Radio& radio = radios[index];
+  if (ok) {
+    radio.stats.healthy = true;
+    radio.consecutiveFaults = 0;
+  } else {
+    radio.probeAt = now + LORA_RADIO_PROBE_INTERVAL_MS;
+  }
+}
+
+// Get the number of transceivers in service
+uint8_t LoRaRadioPool::getHealthyCount() const {
+  uint8_t healthy = 0;
+  for (uint8_t i = 0; i < count; i++) {
+    if (radios[i].stats.healthy) {
+      healthy++;
+    }
+  }
+  return healthy;
+}
+
+// Get the duty-cycle budget of a transceiver
+bool LoRaRadioPool::getDutyCycle(uint8_t index, uint32_t& budgetMs, uint32_t& periodMs) const {
+  return index < count && radios[index].budget.getGlobalLimit(budgetMs, periodMs);
+}
+
+// Get the statistics of a transceiver
+const LoRaRadioStats& LoRaRadioPool::getStats(uint8_t index) const {
+  return radios[index < count ? index : 0].stats;
+}
@@ -0,0 +1,623 @@
+#include "LoRaRadioTask.h"
+#include <string.h>
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(LORA_RADIO_TASK_STD_THREAD)
+#include <chrono>
+#endif
+
+LoRaRadioTask* LoRaRadioTask::active = nullptr;
+
+// Constructor
+LoRaRadioTask::LoRaRadioTask(LoRaManager& manager) :
+  manager(manager),
+  running(false),
+  finished(true),
+  nextId(1),
+  hasLookahead(false),
+  submitted(0),
+  rejected(0),
+  completed(0),
+  droppedResults(0),
+  maxLatencyUs(0),
+  urgentSubmitted(0),
+  urgentRejected(0),
+  maxUrgentStartUs(0) {
+  for (uint8_t i = 0; i < LORA_RADIO_TASK_URGENT_SLOTS; i++) {
+    urgent[i].state.store(SLOT_FREE, std::memory_order_relaxed);
+  }
+  for (uint8_t i = 0; i < LORA_ASYNC_POOL_SIZE; i++) {
+    ops[i].control.store(pack(0, OP_FREE), std::memory_order_relaxed);
+  }
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  taskHandle = nullptr;
+#endif
+}
+
+// Destructor
+LoRaRadioTask::~LoRaRadioTask() {
+  stop();
+}
+
+// Microsecond clock shared by the producers, interrupt handlers and the task
+LORA_RADIO_TASK_ISR_ATTR uint32_t LoRaRadioTask::nowUs() {
+#if defined(LORA_RADIO_TASK_STD_THREAD)
+  return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+  return (uint32_t)micros();
+#endif
+}
+
+// Start the radio task
+bool LoRaRadioTask::start(uint8_t core, uint8_t priority, uint32_t stackSize) {
+  if (running.load()) {
+    return true;
+  }
+
+  // Downlinks are raised inside sendData() on the task and go to the result queue
+  active = this;
+  manager.setDownlinkCallback(onDownlink);
+  running.store(true);
+  finished.store(false);
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  TaskHandle_t handle = nullptr;
+  if (xTaskCreatePinnedToCore(taskEntry, "lora", stackSize, this, priority, &handle, core) != pdPASS) {
+    running.store(false);
+    finished.store(true);
+    return false;
+  }
+  taskHandle = handle;
+#elif defined(LORA_RADIO_TASK_STD_THREAD)
+  (void)core;
+  (void)priority;
+  (void)stackSize;
+  thread = std::thread(taskEntry, this);
+#else
+  // No threading backend on this platform
+  (void)core;
+  (void)priority;
+  (void)stackSize;
+  running.store(false);
+  finished.store(true);
+  return false;
+#endif
+
+  Serial.println(F("[LoRaManager] Radio task started"));
+  return true;
+}
+
+// Stop the task after the request in progress
+void LoRaRadioTask::stop() {
+  if (!running.exchange(false)) {
+    return;
+  }
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  xTaskNotifyGive((TaskHandle_t)taskHandle);
+  while (!finished.load()) {
+    vTaskDelay(1);
+  }
+  taskHandle = nullptr;
+#elif defined(LORA_RADIO_TASK_STD_THREAD)
+  if (thread.joinable()) {
+    thread.join();
+  }
+#endif
+
+  if (active == this) {
+    manager.setDownlinkCallback(nullptr);
+    active = nullptr;
+  }
+}
+
+// Check if the task is running
+bool LoRaRadioTask::isRunning() const {
+  return running.load() && !finished.load();
+}
+
+// Queue an uplink
+uint32_t LoRaRadioTask::submit(const uint8_t* data, size_t len, uint8_t port, bool confirmed) {
+  if (data == nullptr || len == 0 || len > LORA_RADIO_TASK_MAX_PAYLOAD) {
+    return 0;
+  }
+
+  LoRaUplinkRequest request;
+  request.kind = LORA_RADIO_REQUEST_UPLINK;
+  request.slot = LORA_ASYNC_NO_SLOT;
+  request.generation = 0;
+  request.port = port;
+  request.confirmed = confirmed;
+  request.len = (uint8_t)len;
+  memcpy(request.data, data, len);
+  return submitRequest(request);
+}
+
+// Number a request and hand it to the task
+uint32_t LoRaRadioTask::submitRequest(LoRaUplinkRequest& request) {
+  do {
+    request.id = nextId.fetch_add(1, std::memory_order_relaxed);
+  } while (request.id == 0);
+  request.submitUs = nowUs();
+
+  if (!requests.push(request)) {
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return 0;
+  }
+  submitted.fetch_add(1, std::memory_order_relaxed);
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  if (taskHandle != nullptr) {
+    xTaskNotifyGive((TaskHandle_t)taskHandle);
+  }
+#endif
+  return request.id;
+}
+
+// Queue an urgent uplink from an interrupt handler
+LORA_RADIO_TASK_ISR_ATTR uint32_t LoRaRadioTask::enqueueFromIsr(const uint8_t* data, size_t len, uint8_t port, bool confirmed) {
+  if (data == nullptr || len == 0 || len > LORA_RADIO_TASK_MAX_PAYLOAD) {
+    return 0;
+  }
+
+  // One claim attempt per slot keeps this wait-free
+  for (uint8_t i = 0; i < LORA_RADIO_TASK_URGENT_SLOTS; i++) {
+    uint8_t expected = SLOT_FREE;
+    if (!urgent[i].state.compare_exchange_strong(expected, SLOT_WRITING, std::memory_order_acquire)) {
+      continue;
+    }
+
+    LoRaUplinkRequest& request = urgent[i].request;
+    request.submitUs = nowUs();
+    request.id = nextId.fetch_add(1, std::memory_order_relaxed);
+    if (request.id == 0) {
+      request.id = nextId.fetch_add(1, std::memory_order_relaxed);
+    }
+    request.kind = LORA_RADIO_REQUEST_UPLINK;
+    request.slot = LORA_ASYNC_NO_SLOT;
+    request.generation = 0;
+    request.port = port;
+    request.confirmed = confirmed;
+    request.len = (uint8_t)len;
+    memcpy(request.data, data, len);
+    urgent[i].state.store(SLOT_READY, std::memory_order_release);
+    urgentSubmitted.fetch_add(1, std::memory_order_relaxed);
+
+#if defined(LORA_RADIO_TASK_FREERTOS)
+    if (taskHandle != nullptr) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR((TaskHandle_t)taskHandle, &woken);
+      portYIELD_FROM_ISR(woken);
+    }
+#endif
+    return request.id;
+  }
+
+  urgentRejected.fetch_add(1, std::memory_order_relaxed);
+  return 0;
+}
+
+// Start an uplink tracked by a handle
+LoRaAsyncHandle LoRaRadioTask::sendDataAsync(const uint8_t* data, size_t len, uint8_t port, bool confirmed,
+                                             uint32_t timeoutMs, LoRaAsyncCallback callback, void* context) {
+  if (data == nullptr || len == 0 || len > LORA_RADIO_TASK_MAX_PAYLOAD) {
+    LoRaAsyncHandle invalid = {LORA_ASYNC_NO_SLOT, 0};
+    return invalid;
+  }
+  return startAsync(LORA_RADIO_REQUEST_UPLINK, data, len, port, confirmed, timeoutMs, callback, context);
+}
+
+// Start a join tracked by a handle
+LoRaAsyncHandle LoRaRadioTask::joinAsync(uint32_t timeoutMs, LoRaAsyncCallback callback, void* context) {
+  return startAsync(LORA_RADIO_REQUEST_JOIN, nullptr, 0, 0, false, timeoutMs, callback, context);
+}
+
+// Take a free pool slot and queue its request
+LoRaAsyncHandle LoRaRadioTask::startAsync(uint8_t kind, const uint8_t* data, size_t len, uint8_t port, bool confirmed,
+                                          uint32_t timeoutMs, LoRaAsyncCallback callback, void* context) {
+  LoRaAsyncHandle handle = {LORA_ASYNC_NO_SLOT, 0};
+  for (uint8_t i = 0; i < LORA_ASYNC_POOL_SIZE; i++) {
+    uint32_t control = ops[i].control.load(std::memory_order_relaxed);
+    if ((control & 0xFF) != OP_FREE) {
+      continue;
+    }
+    uint16_t generation = (uint16_t)((control >> 8) + 1);
+    if (ops[i].control.compare_exchange_strong(control, pack(generation, OP_CLAIMED), std::memory_order_acquire)) {
+      handle.slot = i;
+      handle.generation = generation;
+      break;
+    }
+  }
+  if (!handle.isValid()) {
+    rejected.fetch_add(1, std::memory_order_relaxed);
+    return handle;
+  }
+
+  AsyncOp& op = ops[handle.slot];
+  op.startMs = millis();
+  op.timeoutMs = timeoutMs;
+  op.callback = callback;
+  op.context = context;
+  op.waiter = nullptr;
+  op.notified = false;
+  op.control.store(pack(handle.generation, OP_PENDING), std::memory_order_release);
+
+  LoRaUplinkRequest request;
+  request.kind = kind;
+  request.slot = handle.slot;
+  request.generation = handle.generation;
+  request.port = port;
+  request.confirmed = confirmed;
+  request.len = (uint8_t)len;
+  if (len > 0) {
+    memcpy(request.data, data, len);
+  }
+  if (submitRequest(request) == 0) {
+    op.control.store(pack(handle.generation, OP_FREE), std::memory_order_release);
+    handle.slot = LORA_ASYNC_NO_SLOT;
+  }
+  return handle;
+}
+
+// Apply the timeout and map the slot state to LORA_ASYNC_*
+uint8_t LoRaRadioTask::refreshState(LoRaAsyncHandle handle) {
+  if (!handle.isValid() || handle.slot >= LORA_ASYNC_POOL_SIZE) {
+    return LORA_ASYNC_INVALID;
+  }
+
+  AsyncOp& op = ops[handle.slot];
+  uint32_t control = op.control.load(std::memory_order_acquire);
+  if ((uint16_t)(control >> 8) != handle.generation) {
+    return LORA_ASYNC_INVALID;
+  }
+
+  // A queued operation ends at once; one on the radio is left to finish unseen
+  uint8_t state = control & 0xFF;
+  if ((state == OP_PENDING || state == OP_RUNNING) && op.timeoutMs > 0 && millis() - op.startMs >= op.timeoutMs) {
+    uint8_t next = state == OP_PENDING ? OP_TIMED_OUT : OP_EXPIRED;
+    if (op.control.compare_exchange_strong(control, pack(handle.generation, next), std::memory_order_acq_rel)) {
+      state = next;
+    } else {
+      state = control & 0xFF;
+    }
+  }
+
+  switch (state) {
+    case OP_PENDING:
+      return LORA_ASYNC_PENDING;
+    case OP_RUNNING:
+      return LORA_ASYNC_RUNNING;
+    case OP_DONE:
+      return LORA_ASYNC_DONE;
+    case OP_FAILED:
+      return LORA_ASYNC_FAILED;
+    case OP_CANCELLED:
+      return LORA_ASYNC_CANCELLED;
+    case OP_EXPIRED:
+    case OP_TIMED_OUT:
+      return LORA_ASYNC_TIMED_OUT;
+    default:
+      return LORA_ASYNC_INVALID;
+  }
+}
+
+// Get the state of an async operation
+uint8_t LoRaRadioTask::getState(LoRaAsyncHandle handle) {
+  return refreshState(handle);
+}
+
+// Check if an async operation has reached a final state
+bool LoRaRadioTask::isDone(LoRaAsyncHandle handle) {
+  uint8_t state = refreshState(handle);
+  return state != LORA_ASYNC_PENDING && state != LORA_ASYNC_RUNNING;
+}
+
+// Copy the result of a finished async operation
+bool LoRaRadioTask::getResult(LoRaAsyncHandle handle, LoRaRadioResult& result) {
+  uint8_t state = refreshState(handle);
+  if (state == LORA_ASYNC_DONE || state == LORA_ASYNC_FAILED) {
+    result = ops[handle.slot].result;
+    result.state = state;
+    return true;
+  }
+
+  memset(&result, 0, sizeof(result));
+  result.state = state;
+  if (state == LORA_ASYNC_CANCELLED || state == LORA_ASYNC_TIMED_OUT) {
+    result.errorCode = RADIOLIB_ERR_UNKNOWN;
+    return true;
+  }
+  return false;
+}
+
+// Cancel an async operation that has not started yet
+bool LoRaRadioTask::cancel(LoRaAsyncHandle handle) {
+  if (refreshState(handle) != LORA_ASYNC_PENDING) {
+    return false;
+  }
+  uint32_t expected = pack(handle.generation, OP_PENDING);
+  return ops[handle.slot].control.compare_exchange_strong(expected, pack(handle.generation, OP_CANCELLED),
+                                                          std::memory_order_acq_rel);
+}
+
+// Free the slot of an async operation
+void LoRaRadioTask::release(LoRaAsyncHandle handle) {
+  if (!handle.isValid() || handle.slot >= LORA_ASYNC_POOL_SIZE) {
+    return;
+  }
+
+  AsyncOp& op = ops[handle.slot];
+  uint32_t control = op.control.load(std::memory_order_acquire);
+  while ((uint16_t)(control >> 8) == handle.generation) {
+    uint8_t state = control & 0xFF;
+    uint8_t next;
+    if (state == OP_RUNNING || state == OP_EXPIRED) {
+      // The task frees the slot when the radio is done with it
+      next = OP_ORPHANED;
+    } else if (state == OP_PENDING || state >= OP_DONE) {
+      // A queued request finds its slot gone and is skipped
+      next = OP_FREE;
+    } else {
+      return;
+    }
+    if (op.control.compare_exchange_weak(control, pack(handle.generation, next), std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+}
+
+// Remember the coroutine waiting on an operation
+void LoRaRadioTask::setWaiter(LoRaAsyncHandle handle, void* waiter) {
+  if (handle.isValid() && handle.slot < LORA_ASYNC_POOL_SIZE) {
+    ops[handle.slot].waiter = waiter;
+  }
+}
+
+// Apply timeouts, run callbacks and resume coroutines of finished operations
+void LoRaRadioTask::dispatch() {
+  for (uint8_t i = 0; i < LORA_ASYNC_POOL_SIZE; i++) {
+    AsyncOp& op = ops[i];
+    uint32_t control = op.control.load(std::memory_order_acquire);
+    uint8_t state = control & 0xFF;
+    if (state == OP_FREE || state == OP_CLAIMED || state == OP_ORPHANED || op.notified) {
+      continue;
+    }
+
+    LoRaAsyncHandle handle = {i, (uint16_t)(control >> 8)};
+    if (!isDone(handle) || (op.callback == nullptr && op.waiter == nullptr)) {
+      continue;
+    }
+    op.notified = true;
+
+    if (op.callback != nullptr) {
+      LoRaRadioResult result;
+      getResult(handle, result);
+      op.callback(handle, result, op.context);
+      release(handle);
+    }
+#if defined(LORA_RADIO_TASK_COROUTINES)
+    if (op.waiter != nullptr) {
+      std::coroutine_handle<>::from_address(op.waiter).resume();
+    }
+#endif
+  }
+}
+
+// Take the next result or downlink
+bool LoRaRadioTask::poll(LoRaRadioResult& result) {
+  return results.pop(result);
+}
+
+// Get the statistics
+LoRaRadioTaskStats LoRaRadioTask::getStats() const {
+  LoRaRadioTaskStats stats;
+  stats.submitted = submitted.load(std::memory_order_relaxed);
+  stats.rejected = rejected.load(std::memory_order_relaxed);
+  stats.completed = completed.load(std::memory_order_relaxed);
+  stats.droppedResults = droppedResults.load(std::memory_order_relaxed);
+  stats.maxLatencyUs = maxLatencyUs.load(std::memory_order_relaxed);
+  stats.urgentSubmitted = urgentSubmitted.load(std::memory_order_relaxed);
+  stats.urgentRejected = urgentRejected.load(std::memory_order_relaxed);
+  stats.maxUrgentStartUs = maxUrgentStartUs.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// Task entry point
+void LoRaRadioTask::taskEntry(void* param) {
+  LoRaRadioTask* task = (LoRaRadioTask*)param;
+  task->run();
+  task->finished.store(true);
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  vTaskDelete(nullptr);
+#endif
+}
+
+// Queue a downlink raised by the manager
+void LoRaRadioTask::onDownlink(uint8_t* payload, size_t size, uint8_t port) {
+  if (active == nullptr) {
+    return;
+  }
+
+  LoRaRadioResult result;
+  memset(&result, 0, sizeof(result));
+  result.type = LORA_RADIO_RESULT_DOWNLINK;
+  result.port = port;
+  result.len = (uint8_t)(size < LORA_RADIO_TASK_MAX_PAYLOAD ? size : LORA_RADIO_TASK_MAX_PAYLOAD);
+  memcpy(result.data, payload, result.len);
+  active->pushResult(result);
+}
+
+// Hand a result to the consumer, counting it if the queue is full
+void LoRaRadioTask::pushResult(const LoRaRadioResult& result) {
+  if (!results.push(result)) {
+    droppedResults.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+// Sleep until a request arrives or the idle period ends
+void LoRaRadioTask::waitForWork() {
+#if defined(LORA_RADIO_TASK_FREERTOS)
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(LORA_RADIO_TASK_IDLE_MS));
+#elif defined(LORA_RADIO_TASK_STD_THREAD)
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+}
+
+// Take the looked-ahead request, or the next one from the queue
+bool LoRaRadioTask::takeNext(LoRaUplinkRequest& request) {
+  if (hasLookahead) {
+    request = lookahead;
+    hasLookahead = false;
+    return true;
+  }
+  return requests.pop(request);
+}
+
+// Check if an urgent request is waiting
+bool LoRaRadioTask::hasUrgent() const {
+  for (uint8_t i = 0; i < LORA_RADIO_TASK_URGENT_SLOTS; i++) {
+    if (urgent[i].state.load(std::memory_order_acquire) == SLOT_READY) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Count the requests still to be sent: the lookahead, the queue and the urgent slots
+uint8_t LoRaRadioTask::countQueued() const {
+  size_t count = (hasLookahead ? 1 : 0) + requests.size();
+  for (uint8_t i = 0; i < LORA_RADIO_TASK_URGENT_SLOTS; i++) {
+    if (urgent[i].state.load(std::memory_order_acquire) == SLOT_READY) {
+      count++;
+    }
+  }
+  return (uint8_t)(count > 0xFF ? 0xFF : count);
+}
+
+// Take the oldest ready urgent request, if any
+bool LoRaRadioTask::takeUrgent(LoRaUplinkRequest& request) {
+  int8_t oldest = -1;
+  for (uint8_t i = 0; i < LORA_RADIO_TASK_URGENT_SLOTS; i++) {
+    if (urgent[i].state.load(std::memory_order_acquire) != SLOT_READY) {
+      continue;
+    }
+    if (oldest < 0 || (int32_t)(urgent[i].request.id - urgent[oldest].request.id) < 0) {
+      oldest = i;
+    }
+  }
+  if (oldest < 0) {
+    return false;
+  }
+
+  request = urgent[oldest].request;
+  urgent[oldest].state.store(SLOT_FREE, std::memory_order_release);
+  return true;
+}
+
+// Move a queued async operation onto the radio; false if it was cancelled or released
+bool LoRaRadioTask::claimAsync(const LoRaUplinkRequest& request) {
+  uint32_t expected = pack(request.generation, OP_PENDING);
+  return ops[request.slot].control.compare_exchange_strong(expected, pack(request.generation, OP_RUNNING),
+                                                           std::memory_order_acq_rel);
+}
+
+// Store the result of an async operation in its slot
+void LoRaRadioTask::finishAsync(const LoRaUplinkRequest& request, const LoRaRadioResult& result) {
+  AsyncOp& op = ops[request.slot];
+  op.result = result;
+
+  uint32_t control = pack(request.generation, OP_RUNNING);
+  for (;;) {
+    uint8_t state = control & 0xFF;
+    uint8_t next;
+    if (state == OP_RUNNING) {
+      next = result.success ? OP_DONE : OP_FAILED;
+    } else if (state == OP_EXPIRED) {
+      next = OP_TIMED_OUT;
+    } else {
+      next = OP_FREE;
+    }
+    if (op.control.compare_exchange_weak(control, pack(request.generation, next), std::memory_order_acq_rel)) {
+      return;
+    }
+  }
+}
+
+// Send one request and report the result
+void LoRaRadioTask::process(const LoRaUplinkRequest& request, bool isUrgent) {
+  bool isAsync = request.slot < LORA_ASYNC_POOL_SIZE;
+  if (isAsync && !claimAsync(request)) {
+    // Cancelled or released: it may have been staged as the lookahead
+    if (request.kind == LORA_RADIO_REQUEST_UPLINK) {
+      manager.unstageUplink(request.data, request.len, request.port);
+    }
+    return;
+  }
+
+  uint32_t startUs = nowUs() - request.submitUs;
+  bool success;
+  if (request.kind == LORA_RADIO_REQUEST_JOIN) {
+    success = manager.joinNetwork();
+  } else {
+    success = manager.sendData((uint8_t*)request.data, request.len, request.port, request.confirmed);
+  }
+
+  LoRaRadioResult result;
+  memset(&result, 0, sizeof(result));
+  result.type = request.kind == LORA_RADIO_REQUEST_JOIN ? LORA_RADIO_RESULT_JOIN : LORA_RADIO_RESULT_UPLINK;
+  result.id = request.id;
+  result.success = success;
+  result.urgent = isUrgent;
+  result.errorCode = (int16_t)manager.getLastErrorCode();
+  result.rssi = manager.getLastRssi();
+  result.snr = manager.getLastSnr();
+  result.startUs = startUs;
+  result.latencyUs = nowUs() - request.submitUs;
+  if (isAsync) {
+    finishAsync(request, result);
+  } else {
+    pushResult(result);
+  }
+
+  completed.fetch_add(1, std::memory_order_relaxed);
+  if (result.latencyUs > maxLatencyUs.load(std::memory_order_relaxed)) {
+    maxLatencyUs.store(result.latencyUs, std::memory_order_relaxed);
+  }
+  if (isUrgent && startUs > maxUrgentStartUs.load(std::memory_order_relaxed)) {
+    maxUrgentStartUs.store(startUs, std::memory_order_relaxed);
+  }
+}
+
+// Task body: urgent requests first, then the request queue, then background work
+void LoRaRadioTask::run() {
+  uint32_t lastEvents = millis();
+  while (running.load()) {
+    LoRaUplinkRequest request;
+    if (takeUrgent(request)) {
+      process(request, true);
+    } else if (takeNext(request)) {
+      // Stage the request after this one so it is prepared during this one's RX waits
+      if (requests.pop(lookahead)) {
+        hasLookahead = true;
+        if (lookahead.kind == LORA_RADIO_REQUEST_UPLINK) {
+          manager.stageUplink(lookahead.data, lookahead.len, lookahead.port);
+        }
+      }
+      process(request, false);
+    }
+
+    // Relay and peer-to-peer listening still need regular service, even under load;
+    // background uplinks such as diagnostics wait until the queue has drained
+    if (millis() - lastEvents >= LORA_RADIO_TASK_IDLE_MS) {
+      lastEvents = millis();
+      manager.setQueuedUplinks(countQueued());
+      manager.handleEvents();
+    }
+    if (!hasLookahead && requests.empty() && !hasUrgent()) {
+      waitForWork();
+    }
+  }
+}
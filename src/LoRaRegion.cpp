@@ -0,0 +1,61 @@
+#include "LoRaRegion.h"
+
+// Compile-time checks of the channel-plan tables against LoRaWAN RP002-1.0.4.
+// The expected limits are the FRMPayload size N (without FOpts) of every data
+// rate, written out per region independently of the table macros.
+
+namespace {
+
+// N per data rate DR0-DR7, without and with the 400 ms dwell time; 0 if not defined or not allowed
+constexpr uint8_t expectedPayload[BAND_TYPE_COUNT][2][LORA_REGION_DATARATES] = {
+    // BAND_TYPE_OTHER (EU868 values)
+    { { 51, 51, 51, 115, 222, 222, 222, 222 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    // BAND_TYPE_US915
+    { { 11, 53, 125, 242, 242, 0, 0, 0 }, { 11, 53, 125, 242, 242, 0, 0, 0 } },
+    // BAND_TYPE_EU868
+    { { 51, 51, 51, 115, 222, 222, 222, 222 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    // BAND_TYPE_AU915
+    { { 51, 51, 51, 115, 242, 242, 242, 0 }, { 0, 0, 11, 53, 125, 242, 242, 0 } },
+    // BAND_TYPE_AS923, AS923-2, AS923-3, AS923-4
+    { { 51, 51, 51, 115, 242, 242, 242, 242 }, { 0, 0, 11, 53, 125, 242, 242, 242 } },
+    { { 51, 51, 51, 115, 242, 242, 242, 242 }, { 0, 0, 11, 53, 125, 242, 242, 242 } },
+    { { 51, 51, 51, 115, 242, 242, 242, 242 }, { 0, 0, 11, 53, 125, 242, 242, 242 } },
+    { { 51, 51, 51, 115, 242, 242, 242, 242 }, { 0, 0, 11, 53, 125, 242, 242, 242 } },
+    // BAND_TYPE_KR920
+    { { 51, 51, 51, 115, 222, 222, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    // BAND_TYPE_IN865
+    { { 51, 51, 51, 115, 222, 222, 0, 222 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    // BAND_TYPE_CN470
+    { { 51, 51, 51, 115, 222, 222, 0, 0 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+    // BAND_TYPE_EU433
+    { { 51, 51, 51, 115, 222, 222, 222, 222 }, { 0, 0, 0, 0, 0, 0, 0, 0 } },
+};
+
+// Every data rate of a region, with and without dwell time (recursive for C++11 constexpr)
+constexpr bool payloadsMatch(uint8_t bandType, uint8_t datarate = 0) {
+    return datarate >= LORA_REGION_DATARATES ||
+           (LoRaRegions::maxPayload(bandType, datarate) == expectedPayload[bandType][0][datarate] &&
+            LoRaRegions::maxPayload(bandType, datarate, true) == expectedPayload[bandType][1][datarate] &&
+            payloadsMatch(bandType, datarate + 1));
+}
+
+} // namespace
+
+static_assert(payloadsMatch(BAND_TYPE_OTHER), "Custom payload limits");
+static_assert(payloadsMatch(BAND_TYPE_US915), "US915 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_EU868), "EU868 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_AU915), "AU915 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_AS923), "AS923 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_AS923_2), "AS923-2 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_AS923_3), "AS923-3 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_AS923_4), "AS923-4 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_KR920), "KR920 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_IN865), "IN865 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_CN470), "CN470 payload limits");
+static_assert(payloadsMatch(BAND_TYPE_EU433), "EU433 payload limits");
+
+// Lookups outside the tables
+static_assert(LoRaRegions::bandType(2) == BAND_TYPE_US915, "RadioLib band number of US915");
+static_assert(LoRaRegions::bandType(200) == BAND_TYPE_OTHER, "unknown RadioLib band number");
+static_assert(LoRaRegions::maxPayload(BAND_TYPE_KR920, 9) == 0, "data rates above DR7");
+static_assert(LoRaRegions::datarate(BAND_TYPE_AU915, 6).bandwidth == 500, "AU915 DR6 is SF8 at 500 kHz");
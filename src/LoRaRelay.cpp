@@ -0,0 +1,204 @@
+#include "LoRaRelay.h"
+#include <string.h>
+
+// LoRaWAN MHDR message types
+#define MTYPE_UNCONFIRMED_UP   0x40
+#define MTYPE_UNCONFIRMED_DOWN 0x60
+#define MTYPE_CONFIRMED_UP     0x80
+#define MTYPE_CONFIRMED_DOWN   0xA0
+#define MTYPE_MASK             0xE0
+
+// MHDR + DevAddr + FCtrl + FCnt + MIC
+#define MIN_DATA_FRAME_LEN 12
+
+// Read the little-endian DevAddr that follows the MHDR
+static uint32_t readDevAddr(const uint8_t* frame) {
+  return (uint32_t)frame[1] | ((uint32_t)frame[2] << 8) | ((uint32_t)frame[3] << 16) | ((uint32_t)frame[4] << 24);
+}
+
+// Constructor
+LoRaRelay::LoRaRelay() {
+  LoRaRelayConfig defaults;
+  memset(&defaults, 0, sizeof(defaults));
+  begin(defaults);
+}
+
+// Reset all buffers and apply a configuration
+void LoRaRelay::begin(const LoRaRelayConfig& config) {
+  this->config = config;
+  memset(&stats, 0, sizeof(stats));
+  memset(children, 0, sizeof(children));
+  memset(downlinks, 0, sizeof(downlinks));
+  uplinkHead = 0;
+  uplinkCount = 0;
+}
+
+// Get the active configuration
+const LoRaRelayConfig& LoRaRelay::getConfig() const {
+  return config;
+}
+
+// Get the relay statistics
+const LoRaRelayStats& LoRaRelay::getStats() const {
+  return stats;
+}
+
+// Get the DevAddr of an uplink PHYPayload
+bool LoRaRelay::parseUplinkDevAddr(const uint8_t* frame, size_t len, uint32_t& devAddr) {
+  if (len < MIN_DATA_FRAME_LEN) {
+    return false;
+  }
+  uint8_t mtype = frame[0] & MTYPE_MASK;
+  if (mtype != MTYPE_UNCONFIRMED_UP && mtype != MTYPE_CONFIRMED_UP) {
+    return false;
+  }
+  devAddr = readDevAddr(frame);
+  return true;
+}
+
+// Token bucket per child; the least recently seen child is evicted when the table is full
+bool LoRaRelay::consumeToken(uint32_t devAddr, uint32_t now) {
+  uint16_t capacity = (uint16_t)((config.childBurst > 0 ? config.childBurst : 1) * 1000);
+
+  Child* child = nullptr;
+  Child* victim = &children[0];
+  for (uint8_t i = 0; i < LORA_RELAY_MAX_CHILDREN; i++) {
+    if (children[i].used && children[i].devAddr == devAddr) {
+      child = &children[i];
+      break;
+    }
+    if (!children[i].used) {
+      victim = &children[i];
+    } else if (victim->used && (now - children[i].lastSeen) > (now - victim->lastSeen)) {
+      victim = &children[i];
+    }
+  }
+
+  if (child == nullptr) {
+    child = victim;
+    child->used = true;
+    child->devAddr = devAddr;
+    child->tokensMilli = capacity;
+    child->lastRefill = now;
+  }
+  child->lastSeen = now;
+
+  // Refill: childUplinksPerHour tokens per 3600000 ms, in thousandths of a token
+  uint32_t elapsed = now - child->lastRefill;
+  uint32_t refill = (uint32_t)(((uint64_t)elapsed * config.childUplinksPerHour) / 3600);
+  if (refill > 0) {
+    uint32_t tokens = child->tokensMilli + refill;
+    child->tokensMilli = (uint16_t)(tokens > capacity ? capacity : tokens);
+    child->lastRefill = now;
+  }
+
+  if (child->tokensMilli < 1000) {
+    return false;
+  }
+  child->tokensMilli -= 1000;
+  return true;
+}
+
+// Offer a frame received from a child
+bool LoRaRelay::acceptUplink(const uint8_t* frame, size_t len, float rssi, float snr, uint32_t now) {
+  stats.received++;
+
+  uint32_t devAddr;
+  if (len > LORA_RELAY_MAX_FRAME || !parseUplinkDevAddr(frame, len, devAddr)) {
+    stats.droppedInvalid++;
+    return false;
+  }
+
+  if (uplinkCount == LORA_RELAY_UPLINK_QUEUE) {
+    stats.droppedQueueFull++;
+    return false;
+  }
+
+  if (!consumeToken(devAddr, now)) {
+    stats.droppedRateLimit++;
+    return false;
+  }
+
+  // Wrap with the reception metadata the network needs for ADR decisions
+  QueuedFrame& slot = uplinks[(uplinkHead + uplinkCount) % LORA_RELAY_UPLINK_QUEUE];
+  float negRssi = -rssi;
+  slot.data[0] = (uint8_t)(negRssi < 0 ? 0 : (negRssi > 255 ? 255 : negRssi));
+  float snrQuarter = snr * 4;
+  slot.data[1] = (uint8_t)(int8_t)(snrQuarter < -128 ? -128 : (snrQuarter > 127 ? 127 : snrQuarter));
+  memcpy(&slot.data[LORA_RELAY_HEADER_LEN], frame, len);
+  slot.len = (uint8_t)(LORA_RELAY_HEADER_LEN + len);
+  uplinkCount++;
+  return true;
+}
+
+// Check if there are frames waiting to be forwarded
+bool LoRaRelay::hasPendingUplink() const {
+  return uplinkCount > 0;
+}
+
+// Copy the oldest wrapped frame without removing it
+size_t LoRaRelay::peekUplink(uint8_t* out) const {
+  if (uplinkCount == 0) {
+    return 0;
+  }
+  const QueuedFrame& slot = uplinks[uplinkHead];
+  memcpy(out, slot.data, slot.len);
+  return slot.len;
+}
+
+// Remove the oldest wrapped frame after it has been forwarded
+void LoRaRelay::popUplink() {
+  if (uplinkCount == 0) {
+    return;
+  }
+  uplinkHead = (uint8_t)((uplinkHead + 1) % LORA_RELAY_UPLINK_QUEUE);
+  uplinkCount--;
+  stats.forwarded++;
+}
+
+// Store a downlink received from the network
+bool LoRaRelay::acceptDownlink(const uint8_t* payload, size_t len) {
+  if (len < MIN_DATA_FRAME_LEN || len > LORA_RELAY_MAX_FRAME) {
+    return false;
+  }
+  uint8_t mtype = payload[0] & MTYPE_MASK;
+  if (mtype != MTYPE_UNCONFIRMED_DOWN && mtype != MTYPE_CONFIRMED_DOWN) {
+    return false;
+  }
+  uint32_t devAddr = readDevAddr(payload);
+
+  // One pending downlink per child; newer replaces older
+  DownlinkSlot* slot = nullptr;
+  for (uint8_t i = 0; i < LORA_RELAY_DOWNLINK_SLOTS; i++) {
+    if (downlinks[i].len > 0 && downlinks[i].devAddr == devAddr) {
+      slot = &downlinks[i];
+      break;
+    }
+    if (slot == nullptr && downlinks[i].len == 0) {
+      slot = &downlinks[i];
+    }
+  }
+  if (slot == nullptr) {
+    return false;
+  }
+
+  slot->devAddr = devAddr;
+  slot->len = (uint8_t)len;
+  memcpy(slot->data, payload, len);
+  stats.downlinksQueued++;
+  return true;
+}
+
+// Take the pending downlink for a child, if any
+size_t LoRaRelay::takeDownlink(uint32_t devAddr, uint8_t* out) {
+  for (uint8_t i = 0; i < LORA_RELAY_DOWNLINK_SLOTS; i++) {
+    if (downlinks[i].len > 0 && downlinks[i].devAddr == devAddr) {
+      size_t len = downlinks[i].len;
+      memcpy(out, downlinks[i].data, len);
+      downlinks[i].len = 0;
+      stats.downlinksDelivered++;
+      return len;
+    }
+  }
+  return 0;
+}
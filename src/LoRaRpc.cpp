@@ -0,0 +1,220 @@
+#include "LoRaRpc.h"
+#include <string.h>
+
+// Slot states
+#define RPC_SLOT_FREE      0
+#define RPC_SLOT_PENDING   1   // response waiting for an uplink
+#define RPC_SLOT_IN_FLIGHT 2   // response packed into the uplink being sent
+#define RPC_SLOT_SENT      3   // kept only to recognize duplicates
+
+// Constructor
+LoRaRpc::LoRaRpc() :
+  tick(0),
+  methodCount(0) {
+  memset(slots, 0, sizeof(slots));
+  memset(methods, 0, sizeof(methods));
+  memset(&stats, 0, sizeof(stats));
+}
+
+// Register the handler of a method
+bool LoRaRpc::on(uint8_t method, LoRaRpcHandler handler) {
+  Method* entry = findMethod(method);
+  if (entry == nullptr) {
+    if (methodCount >= LORA_RPC_MAX_HANDLERS) {
+      return false;
+    }
+    entry = &methods[methodCount++];
+    memset(entry, 0, sizeof(*entry));
+    entry->method = method;
+  }
+  entry->handler = handler;
+  return true;
+}
+
+// Find a method's registry entry
+LoRaRpc::Method* LoRaRpc::findMethod(uint8_t method) {
+  for (uint8_t i = 0; i < methodCount; i++) {
+    if (methods[i].method == method) {
+      return &methods[i];
+    }
+  }
+  return nullptr;
+}
+
+// Find the slot remembering a request ID
+LoRaRpc::Slot* LoRaRpc::findSlot(uint8_t id) {
+  for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+    if (slots[i].state != RPC_SLOT_FREE && slots[i].id == id) {
+      return &slots[i];
+    }
+  }
+  return nullptr;
+}
+
+// A free slot, or the least recently used one whose response has been sent
+LoRaRpc::Slot* LoRaRpc::takeSlot() {
+  Slot* oldest = nullptr;
+  for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+    if (slots[i].state == RPC_SLOT_FREE) {
+      return &slots[i];
+    }
+    if (slots[i].state == RPC_SLOT_SENT && (oldest == nullptr || (int32_t)(slots[i].lastUsed - oldest->lastUsed) < 0)) {
+      oldest = &slots[i];
+    }
+  }
+  return oldest;
+}
+
+// Run the handler, writing the response straight into the slot
+void LoRaRpc::execute(Slot& slot, const LoRaRpcView& args) {
+  Method* entry = findMethod(args.method);
+  slot.resultLen = 0;
+  if (entry == nullptr || entry->handler == nullptr) {
+    slot.status = LORA_RPC_ERR_UNKNOWN;
+    stats.unknown++;
+    return;
+  }
+  slot.status = entry->handler(args, slot.result, slot.resultLen);
+  if (slot.resultLen > LORA_RPC_MAX_RESULT) {
+    slot.status = LORA_RPC_ERR_RESULT_SIZE;
+    slot.resultLen = 0;
+  }
+}
+
+// Execute the requests of a downlink, skipping the ones already seen
+uint8_t LoRaRpc::acceptDownlink(const uint8_t* payload, size_t len, uint32_t now) {
+  uint8_t executed = 0;
+  size_t pos = 0;
+  while (pos < len) {
+    if (pos + LORA_RPC_HEADER_LEN > len || pos + LORA_RPC_HEADER_LEN + payload[pos + 2] > len) {
+      stats.malformed++;
+      break;
+    }
+    LoRaRpcView args;
+    args.id = payload[pos];
+    args.method = payload[pos + 1];
+    args.len = payload[pos + 2];
+    args.data = &payload[pos + LORA_RPC_HEADER_LEN];
+    pos += LORA_RPC_HEADER_LEN + args.len;
+
+    // A retransmission: answer again if the response is already out, never execute twice
+    Slot* slot = findSlot(args.id);
+    if (slot != nullptr) {
+      stats.duplicates++;
+      slot->lastUsed = ++tick;
+      if (slot->state == RPC_SLOT_SENT) {
+        slot->state = RPC_SLOT_PENDING;
+        slot->resend = true;
+      }
+      continue;
+    }
+
+    slot = takeSlot();
+    if (slot == nullptr) {
+      stats.dropped++;
+      continue;
+    }
+    slot->id = args.id;
+    slot->method = args.method;
+    slot->receivedMs = now;
+    slot->lastUsed = ++tick;
+    slot->resend = false;
+    execute(*slot, args);
+    slot->state = RPC_SLOT_PENDING;
+    stats.requests++;
+    executed++;
+  }
+  return executed;
+}
+
+// Check if there are responses waiting to be sent
+bool LoRaRpc::hasPendingResponse() const {
+  for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+    if (slots[i].state == RPC_SLOT_PENDING) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Get the number of responses waiting to be sent
+uint8_t LoRaRpc::getPendingCount() const {
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+    if (slots[i].state == RPC_SLOT_PENDING) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Pack waiting responses, oldest first, into an uplink
+size_t LoRaRpc::buildUplink(uint8_t* out, size_t maxLen) {
+  size_t pos = 0;
+  for (uint8_t packed = 0; packed < LORA_RPC_SLOTS; packed++) {
+    Slot* oldest = nullptr;
+    for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+      if (slots[i].state == RPC_SLOT_PENDING &&
+          (oldest == nullptr || (int32_t)(slots[i].lastUsed - oldest->lastUsed) < 0)) {
+        oldest = &slots[i];
+      }
+    }
+    if (oldest == nullptr || pos + LORA_RPC_HEADER_LEN + oldest->resultLen > maxLen) {
+      break;
+    }
+    out[pos] = oldest->id;
+    out[pos + 1] = oldest->status;
+    out[pos + 2] = oldest->resultLen;
+    memcpy(&out[pos + LORA_RPC_HEADER_LEN], oldest->result, oldest->resultLen);
+    pos += LORA_RPC_HEADER_LEN + oldest->resultLen;
+    oldest->state = RPC_SLOT_IN_FLIGHT;
+  }
+  return pos;
+}
+
+// Report the outcome of the uplink from buildUplink()
+void LoRaRpc::confirmUplink(bool sent, uint32_t now) {
+  for (uint8_t i = 0; i < LORA_RPC_SLOTS; i++) {
+    Slot& slot = slots[i];
+    if (slot.state != RPC_SLOT_IN_FLIGHT) {
+      continue;
+    }
+    if (!sent) {
+      slot.state = RPC_SLOT_PENDING;
+      continue;
+    }
+    slot.state = RPC_SLOT_SENT;
+    if (slot.resend) {
+      stats.resent++;
+      continue;
+    }
+    stats.responses++;
+
+    // Round trip of the first response only; a resend measures the network, not the command
+    Method* entry = findMethod(slot.method);
+    if (entry != nullptr) {
+      uint32_t rtt = now - slot.receivedMs;
+      entry->stats.calls++;
+      entry->stats.totalRttMs += rtt;
+      if (rtt > entry->stats.maxRttMs) {
+        entry->stats.maxRttMs = rtt;
+      }
+    }
+  }
+}
+
+// Get the RPC statistics
+const LoRaRpcStats& LoRaRpc::getStats() const {
+  return stats;
+}
+
+// Get the round-trip statistics of a method
+bool LoRaRpc::getMethodStats(uint8_t method, LoRaRpcMethodStats& methodStats) const {
+  for (uint8_t i = 0; i < methodCount; i++) {
+    if (methods[i].method == method && methods[i].handler != nullptr) {
+      methodStats = methods[i].stats;
+      return true;
+    }
+  }
+  return false;
+}
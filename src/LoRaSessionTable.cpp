@@ -0,0 +1,205 @@
+#include "LoRaSessionTable.h"
+
+// Slot flags
+#define SESSION_JOINED 0x01
+#define SESSION_IDLE   0x02   // no interval; waits for requestUplink()
+
+// Constructor
+LoRaSessionTable::LoRaSessionTable(Slot* slots, uint16_t* buckets, uint16_t capacity) :
+  slots(slots),
+  buckets(buckets),
+  slotCount(capacity < LORA_SESSION_NONE ? capacity : LORA_SESSION_NONE - 1),
+  count(0) {
+  clear();
+}
+
+// Remove all sessions
+void LoRaSessionTable::clear() {
+  memset(slots, 0, sizeof(Slot) * slotCount);
+  for (uint16_t i = 0; i < slotCount; i++) {
+    buckets[i] = LORA_SESSION_NONE;
+  }
+  count = 0;
+}
+
+// Add a session, due at once
+uint16_t LoRaSessionTable::add(uint16_t intervalS, uint32_t now) {
+  if (count >= slotCount) {
+    return LORA_SESSION_NONE;
+  }
+  Slot& slot = slots[count];
+  memset(&slot, 0, sizeof(slot));
+  slot.intervalS = intervalS;
+  slot.dueMs = now;
+  slot.nextInBucket = LORA_SESSION_NONE;
+  return count++;
+}
+
+// Get the number of sessions
+uint16_t LoRaSessionTable::size() const {
+  return count;
+}
+
+// Get the maximum number of sessions
+uint16_t LoRaSessionTable::capacity() const {
+  return slotCount;
+}
+
+// Earliest deadline first; a plain scan is a few µs even for hundreds of sessions
+uint16_t LoRaSessionTable::next(uint32_t now) const {
+  uint16_t best = LORA_SESSION_NONE;
+  int32_t bestLate = -1;
+  for (uint16_t i = 0; i < count; i++) {
+    if ((slots[i].flags & SESSION_IDLE) != 0) {
+      continue;
+    }
+    int32_t late = (int32_t)(now - slots[i].dueMs);
+    if (late > bestLate) {
+      best = i;
+      bestLate = late;
+    }
+  }
+  return best;
+}
+
+// Get how long until a session is due
+uint32_t LoRaSessionTable::getWait(uint32_t now) const {
+  uint32_t wait = 0xFFFFFFFFUL;
+  for (uint16_t i = 0; i < count; i++) {
+    if ((slots[i].flags & SESSION_IDLE) != 0) {
+      continue;
+    }
+    int32_t remaining = (int32_t)(slots[i].dueMs - now);
+    if (remaining <= 0) {
+      return 0;
+    }
+    if ((uint32_t)remaining < wait) {
+      wait = (uint32_t)remaining;
+    }
+  }
+  return wait;
+}
+
+// Multiplicative hash; the network allocates DevAddrs sequentially, so mix the low bits up
+uint16_t LoRaSessionTable::bucketOf(uint32_t devAddr) const {
+  return (uint16_t)(((uint32_t)(devAddr * 2654435761UL) >> 16) % slotCount);
+}
+
+// Find the session of a DevAddr
+uint16_t LoRaSessionTable::find(uint32_t devAddr) const {
+  if (slotCount == 0) {
+    return LORA_SESSION_NONE;
+  }
+  for (uint16_t i = buckets[bucketOf(devAddr)]; i != LORA_SESSION_NONE; i = slots[i].nextInBucket) {
+    if (slots[i].devAddr == devAddr) {
+      return i;
+    }
+  }
+  return LORA_SESSION_NONE;
+}
+
+// Take a joined session out of the DevAddr index
+void LoRaSessionTable::unlink(uint16_t index) {
+  Slot& slot = slots[index];
+  if ((slot.flags & SESSION_JOINED) == 0) {
+    return;
+  }
+  uint16_t* link = &buckets[bucketOf(slot.devAddr)];
+  while (*link != LORA_SESSION_NONE && *link != index) {
+    link = &slots[*link].nextInBucket;
+  }
+  if (*link == index) {
+    *link = slot.nextInBucket;
+  }
+  slot.nextInBucket = LORA_SESSION_NONE;
+  slot.flags &= ~SESSION_JOINED;
+  slot.devAddr = 0;
+}
+
+// Make a session due now; sessions that are already late stay ahead of it
+void LoRaSessionTable::requestUplink(uint16_t index, uint32_t now) {
+  if (index < count) {
+    slots[index].flags &= ~SESSION_IDLE;
+    slots[index].dueMs = now;
+  }
+}
+
+// Record a successful join and index the DevAddr
+void LoRaSessionTable::markJoined(uint16_t index, uint32_t devAddr, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  unlink(index);
+  Slot& slot = slots[index];
+  slot.devAddr = devAddr;
+  slot.flags = (uint8_t)((slot.flags | SESSION_JOINED) & ~SESSION_IDLE);
+  slot.failures = 0;
+  slot.dueMs = now;
+
+  uint16_t& head = buckets[bucketOf(devAddr)];
+  slot.nextInBucket = head;
+  head = index;
+}
+
+// Record a sent uplink and schedule the next one
+void LoRaSessionTable::markSent(uint16_t index, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  slots[index].uplinks++;
+  slots[index].failures = 0;
+  reschedule(index, now);
+}
+
+// Schedule the next uplink one interval from now
+void LoRaSessionTable::reschedule(uint16_t index, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  Slot& slot = slots[index];
+
+  // Sessions without an interval wait for requestUplink()
+  slot.dueMs = now + (uint32_t)slot.intervalS * 1000;
+  if (slot.intervalS == 0) {
+    slot.flags |= SESSION_IDLE;
+  }
+}
+
+// Record a failure and back off exponentially
+void LoRaSessionTable::markFailed(uint16_t index, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  Slot& slot = slots[index];
+  if (slot.failures < 0xFF) {
+    slot.failures++;
+  }
+  uint32_t backoff = LORA_SESSION_JOIN_BACKOFF_MS;
+  for (uint8_t i = 1; i < slot.failures && backoff < LORA_SESSION_JOIN_BACKOFF_MAX_MS; i++) {
+    backoff *= 2;
+  }
+  if (backoff > LORA_SESSION_JOIN_BACKOFF_MAX_MS) {
+    backoff = LORA_SESSION_JOIN_BACKOFF_MAX_MS;
+  }
+  slot.dueMs = now + backoff;
+}
+
+// Forget a session's join
+void LoRaSessionTable::markLost(uint16_t index, uint32_t now) {
+  if (index >= count) {
+    return;
+  }
+  unlink(index);
+  slots[index].flags &= ~SESSION_IDLE;
+  slots[index].dueMs = now;
+}
+
+// Check if a session has joined
+bool LoRaSessionTable::isJoined(uint16_t index) const {
+  return index < count && (slots[index].flags & SESSION_JOINED) != 0;
+}
+
+// Get a session's slot
+const LoRaSessionTable::Slot& LoRaSessionTable::getSlot(uint16_t index) const {
+  return slots[index < count ? index : 0];
+}
@@ -0,0 +1,274 @@
+#include "LoRaSimRadio.h"
+
+#if !defined(ARDUINO)
+
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "LoRaAirtime.h"
+
+// Monotonic millisecond clock
+static uint32_t simMillis() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Constructor
+LoRaSimChannel::LoRaSimChannel(uint8_t lossPercent, uint32_t seed) :
+  nextSeq(1),
+  nextRadioId(1),
+  lossPercent(lossPercent),
+  randomState(seed != 0 ? seed : 1),
+  rssi(-80.0f),
+  snr(9.0f) {
+  memset(frames, 0, sizeof(frames));
+}
+
+// Set the loss rate
+void LoRaSimChannel::setLossPercent(uint8_t lossPercent) {
+  std::lock_guard<std::mutex> guard(lock);
+  this->lossPercent = lossPercent;
+}
+
+// Set the link quality reported to receivers
+void LoRaSimChannel::setLinkQuality(float rssi, float snr) {
+  std::lock_guard<std::mutex> guard(lock);
+  this->rssi = rssi;
+  this->snr = snr;
+}
+
+// Get the number of frames sent so far
+uint32_t LoRaSimChannel::getFramesSent() const {
+  std::lock_guard<std::mutex> guard(lock);
+  return nextSeq - 1;
+}
+
+// Give a new radio its id
+uint16_t LoRaSimChannel::attach() {
+  std::lock_guard<std::mutex> guard(lock);
+  return nextRadioId++;
+}
+
+// Put a frame on the air
+void LoRaSimChannel::send(uint16_t sender, uint32_t key, uint32_t airtimeMs, const uint8_t* data, size_t len) {
+  std::lock_guard<std::mutex> guard(lock);
+  Frame& frame = frames[nextSeq % LORA_SIM_HISTORY];
+  frame.seq = nextSeq++;
+  frame.key = key;
+  frame.sender = sender;
+  frame.airEndMs = simMillis() + airtimeMs;
+  frame.len = (uint8_t)len;
+  memcpy(frame.data, data, len);
+}
+
+// Find the oldest frame a receiver has not seen yet and could still hear
+bool LoRaSimChannel::find(uint16_t receiver, uint32_t key, uint32_t afterSeq, uint32_t notBeforeMs, Frame& frame) {
+  std::lock_guard<std::mutex> guard(lock);
+  const Frame* best = nullptr;
+  for (uint8_t i = 0; i < LORA_SIM_HISTORY; i++) {
+    const Frame& candidate = frames[i];
+    if (candidate.seq == 0 || candidate.seq <= afterSeq || candidate.sender == receiver || candidate.key != key) {
+      continue;
+    }
+    if ((int32_t)(candidate.airEndMs - notBeforeMs) < 0) {
+      continue;
+    }
+    if (best == nullptr || candidate.seq < best->seq) {
+      best = &candidate;
+    }
+  }
+  if (best == nullptr) {
+    return false;
+  }
+  frame = *best;
+
+  // xorshift32; each receiver draws separately, so losses are independent
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  if (lossPercent > 0 && randomState % 100 < lossPercent) {
+    frame.len = 0;
+  }
+  return true;
+}
+
+// Constructor
+LoRaSimRadio::LoRaSimRadio(LoRaSimChannel& channel) :
+  PhysicalLayer(1.0f, LORA_SIM_MAX_FRAME),
+  channel(channel),
+  id(channel.attach()),
+  rxTimeoutMs(LORA_SIM_RX_TIMEOUT_MS),
+  lastSeq(0),
+  lastLen(0) {
+  beginLoRa();
+}
+
+// Switch to LoRa with default settings
+int16_t LoRaSimRadio::beginLoRa() {
+  fsk = false;
+  frequency = 434.0f;
+  bandwidth = 125.0f;
+  bitRate = 0;
+  spreadingFactor = 9;
+  codingRate = 7;
+  syncWord = RADIOLIB_SX126X_SYNC_WORD_PRIVATE;
+  preambleLength = 8;
+  iqInverted = false;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Switch to FSK
+int16_t LoRaSimRadio::beginFsk(float freq, float bitRate) {
+  fsk = true;
+  frequency = freq;
+  this->bitRate = bitRate;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Pack the settings a receiver must share with the transmitter
+uint32_t LoRaSimRadio::getKey() const {
+  uint32_t kHz = (uint32_t)(frequency * 1000.0f + 0.5f);
+  if (fsk) {
+    return (kHz << 8) ^ ((uint32_t)(bitRate * 10.0f) << 1) ^ 0x80000000UL;
+  }
+  uint32_t bwCode = (uint32_t)(bandwidth * 10.0f);
+  return (kHz << 8) ^ (bwCode << 16) ^ ((uint32_t)spreadingFactor << 4) ^ ((uint32_t)syncWord << 20) ^
+         (iqInverted ? 1 : 0);
+}
+
+// Transmit a frame; it is on the air for its time on air
+int16_t LoRaSimRadio::transmit(const uint8_t* data, size_t len, uint8_t addr) {
+  (void)addr;
+  if (len == 0 || len > LORA_SIM_MAX_FRAME) {
+    return RADIOLIB_ERR_PACKET_TOO_LONG;
+  }
+  channel.send(id, getKey(), (uint32_t)(getTimeOnAir(len) / 1000), data, len);
+  return RADIOLIB_ERR_NONE;
+}
+
+// Receive a frame, waiting up to the RX timeout
+int16_t LoRaSimRadio::receive(uint8_t* data, size_t len) {
+  uint32_t start = simMillis();
+  LoRaSimChannel::Frame frame;
+  while (!channel.find(id, getKey(), lastSeq, start, frame)) {
+    if (simMillis() - start >= rxTimeoutMs) {
+      return RADIOLIB_ERR_RX_TIMEOUT;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  lastSeq = frame.seq;
+
+  // A lost frame looks like a corrupted one
+  if (frame.len == 0) {
+    return RADIOLIB_ERR_CRC_MISMATCH;
+  }
+  lastLen = frame.len;
+  memcpy(data, frame.data, frame.len < len ? frame.len : len);
+  return RADIOLIB_ERR_NONE;
+}
+
+// Get the length of the last received frame
+size_t LoRaSimRadio::getPacketLength(bool update) {
+  (void)update;
+  return lastLen;
+}
+
+// Standby
+int16_t LoRaSimRadio::standby() {
+  return RADIOLIB_ERR_NONE;
+}
+
+// Sleep
+int16_t LoRaSimRadio::sleep() {
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the frequency
+int16_t LoRaSimRadio::setFrequency(float freq) {
+  frequency = freq;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the output power (not simulated)
+int16_t LoRaSimRadio::setOutputPower(int8_t power) {
+  (void)power;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Get the RSSI of the last frame
+float LoRaSimRadio::getRSSI() {
+  std::lock_guard<std::mutex> guard(channel.lock);
+  return channel.rssi;
+}
+
+// Get the SNR of the last frame
+float LoRaSimRadio::getSNR() {
+  std::lock_guard<std::mutex> guard(channel.lock);
+  return channel.snr;
+}
+
+// Get the time on air of a frame with the current settings
+RadioLibTime_t LoRaSimRadio::getTimeOnAir(size_t len) {
+  if (fsk) {
+    return LoRaAirtime::fskUs(len, bitRate);
+  }
+  return LoRaAirtime::loraUs(len, spreadingFactor, bandwidth, codingRate, preambleLength);
+}
+
+// Channel activity detection: is a frame we have not heard on the air now?
+int16_t LoRaSimRadio::scanChannel() {
+  LoRaSimChannel::Frame frame;
+  if (channel.find(id, getKey(), lastSeq, simMillis(), frame)) {
+    return RADIOLIB_LORA_DETECTED;
+  }
+  return RADIOLIB_CHANNEL_FREE;
+}
+
+// Set the bandwidth
+int16_t LoRaSimRadio::setBandwidth(float bw) {
+  bandwidth = bw;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the spreading factor
+int16_t LoRaSimRadio::setSpreadingFactor(uint8_t sf) {
+  spreadingFactor = sf;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the coding rate
+int16_t LoRaSimRadio::setCodingRate(uint8_t cr) {
+  codingRate = cr;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the sync word
+int16_t LoRaSimRadio::setSyncWord(uint8_t syncWord) {
+  this->syncWord = syncWord;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set the preamble length
+int16_t LoRaSimRadio::setPreambleLength(size_t symbols) {
+  preambleLength = (uint16_t)symbols;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Invert IQ; only radios with the same polarity hear each other
+int16_t LoRaSimRadio::invertIQ(bool enable) {
+  iqInverted = enable;
+  return RADIOLIB_ERR_NONE;
+}
+
+// Set how long receive() listens
+void LoRaSimRadio::setRxTimeout(uint32_t timeoutMs) {
+  rxTimeoutMs = timeoutMs;
+}
+
+// Constructor
+LoRaSimDriver::LoRaSimDriver(LoRaSimChannel& channel) :
+  LoRaRadioDriverBase<LoRaSimRadio, LoRaSimDriver>(LoRaRadioOptions()),
+  radio(channel) {
+}
+
+#endif // !ARDUINO
@@ -2,28 +2,16 @@
 #define RADIOLIB_BAND_UTIL_H
 
 #include <RadioLib.h>
-
-// Define band type constants
-#define BAND_TYPE_US915 1
-#define BAND_TYPE_EU868 2
-#define BAND_TYPE_OTHER 0
+#include "LoRaRegion.h"
 
 /**
- * @brief Get the band type from a LoRaWANBand_t by checking its name
+ * @brief Get the band type from a LoRaWANBand_t by its band number
  * 
  * @param band The LoRaWANBand_t object
- * @return uint8_t Band type constant (BAND_TYPE_US915, BAND_TYPE_EU868, or BAND_TYPE_OTHER)
+ * @return uint8_t Band type constant (BAND_TYPE_* from LoRaRegion.h, BAND_TYPE_OTHER if unknown)
  */
 inline uint8_t getBandTypeFromBand(const LoRaWANBand_t& band) {
-  if (band.name) {
-    String bandName = String(band.name);
-    if (bandName.indexOf("US915") >= 0) {
-      return BAND_TYPE_US915;
-    } else if (bandName.indexOf("EU868") >= 0) {
-      return BAND_TYPE_EU868;
-    }
-  }
-  return BAND_TYPE_OTHER;
+  return LoRaRegions::bandType(band.bandNum);
 }
 
 /**